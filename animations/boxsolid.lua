@@ -29,16 +29,11 @@ function Update()
         DoneIteration()
     end
 
-    for x=0, math.min(size, sx-1) do
-        for y=0, math.min(size, sy-1) do
-            for z=0, math.min(size, sz-1) do
-                SetVoxelState( T(X_AXIS, x), 
-                                T(Y_AXIS, y), 
-                                T(Z_AXIS, z),
-                                state         )
-            end
-        end
-    end
+    -- The box always grows from the chosen corner, so it can be filled in one call.
+    FillBox( T(X_AXIS, 0), T(Y_AXIS, 0), T(Z_AXIS, 0),
+             T(X_AXIS, math.min(size, sx-1)),
+             T(Y_AXIS, math.min(size, sy-1)),
+             T(Z_AXIS, math.min(size, sz-1)), state )
 
     size = (size + 1) % mSize
     init = true
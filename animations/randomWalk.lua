@@ -82,10 +82,10 @@ function ResetAnimation()
      pos = {}
 
      for i=X_AXIS, Z_AXIS do pos[i] = math.random(0, sc[i]-1)  end	
-     for i=0     , sx-1   do SetPlaneState(YZ_PLANE, i, false) end	
-    
      if (init and stats) then WriteStats() end
     
+     for i=0     , sx-1   do SetPlaneState(YZ_PLANE, i, false) end	
+    
      path  = 0
      reset = false	
      init  = true
@@ -108,7 +108,7 @@ end
 
 function WriteStats()
     local file = nil
-    local tmp = math.round ((path/vol)*100, 2, "ceil")		
+    local tmp = math.round ((CountLitVoxels()/vol)*100, 2, "ceil")		
     local avg = (avg*it) + tmp
 
     it  = it + 1		
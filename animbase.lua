@@ -36,6 +36,17 @@ COLOR_B  = 2    -- Represents the color blue.
 RGB_VALS = -1   --
 RGB_HEX  = -2   --
 
+SHIFT_LINEAR = 0    -- Shift moves every voxel (the default, see SetShiftMode).
+SHIFT_RING   = 1    -- Shift only moves the origin of the shifted axis.
+
+STORAGE_DEFAULT = 0 -- One byte per voxel (the default, see SetStorageMode).
+STORAGE_SPARSE  = 1 -- Only stores the 8x8x8 bricks with a lit voxel (for large cubes).
+
+BLIT_COPY = 0       -- CopyRegion replaces the destination voxels (the default).
+BLIT_AND  = 1       -- CopyRegion ANDs the source voxels with the destination.
+BLIT_OR   = 2       -- CopyRegion ORs the source voxels with the destination.
+BLIT_XOR  = 3       -- CopyRegion XORs the source voxels with the destination.
+
 sx = 0              -- The cube size in the x-dimension (set by InitSize).
 sy = 0              -- The cube size in the y-dimension (set by InitSize).
 sz = 0              -- The cube size in the z-dimension (set by InitSize).
@@ -13,7 +13,7 @@ CC="g++"
 #CFLAGS="-O3 -Wall"
 CFLAGS="-O3"
 CINCLUDE=`pkg-config --cflags sdl lua5.1`
-CLIBS=`pkg-config --libs sdl SDL_net gl glu lua5.1`
+CLIBS="`pkg-config --libs sdl SDL_net gl glu lua5.1` -lrt"
 
 # Build individual object files.
 $CC $CFLAGS -c src/main.cpp -o src/main.o $CINCLUDE
@@ -25,8 +25,23 @@ $CC $CFLAGS -c src/console_commands.cpp -o src/console_commands.o $CINCLUDE
 $CC $CFLAGS -c src/format_conversion.cpp -o src/format_conversion.o $CINCLUDE
 
 $CC $CFLAGS -c src/TCCube.cpp -o src/TCCube.o $CINCLUDE
+$CC $CFLAGS -c src/TCCubeBits.cpp -o src/TCCubeBits.o $CINCLUDE
+$CC $CFLAGS -c src/TCCubeSparse.cpp -o src/TCCubeSparse.o $CINCLUDE
+$CC $CFLAGS -c src/TCCubeChannel.cpp -o src/TCCubeChannel.o $CINCLUDE
+$CC $CFLAGS -c src/cube_kernels.cpp -o src/cube_kernels.o $CINCLUDE
+$CC $CFLAGS -c src/TCThreadPool.cpp -o src/TCThreadPool.o $CINCLUDE
+$CC $CFLAGS -c src/TCScheduler.cpp -o src/TCScheduler.o $CINCLUDE
 $CC $CFLAGS -c src/TCAnim.cpp -o src/TCAnim.o $CINCLUDE
+$CC $CFLAGS -c src/TCFrame.cpp -o src/TCFrame.o $CINCLUDE
+$CC $CFLAGS -c src/TCFrameBuffer.cpp -o src/TCFrameBuffer.o $CINCLUDE
+$CC $CFLAGS -c src/TCFrameQueue.cpp -o src/TCFrameQueue.o $CINCLUDE
+$CC $CFLAGS -c src/TCFrameInterp.cpp -o src/TCFrameInterp.o $CINCLUDE
+$CC $CFLAGS -c src/TCEffectChain.cpp -o src/TCEffectChain.o $CINCLUDE
+$CC $CFLAGS -c src/TCToneMap.cpp -o src/TCToneMap.o $CINCLUDE
+$CC $CFLAGS -c src/TCCompositor.cpp -o src/TCCompositor.o $CINCLUDE
+$CC $CFLAGS -c src/TCAutomaton.cpp -o src/TCAutomaton.o $CINCLUDE
 $CC $CFLAGS -c src/TCAnimLua.cpp -o src/TCAnimLua.o $CINCLUDE
+$CC $CFLAGS -c src/TCSlotEngine.cpp -o src/TCSlotEngine.o $CINCLUDE
 $CC $CFLAGS -c src/TCDriver.cpp -o src/TCDriver.o $CINCLUDE
 
 $CC $CFLAGS -c src/drivers/netdrv.cpp -o src/drivers/netdrv.o $CINCLUDE
@@ -25,7 +25,35 @@
 ///
 
 #include "TCAnim.h"
+#include "TCCubeBits.h"  // Used to store the state of animations without any colors.
+#include "TCCubeSparse.h"   // Used to store the state in the TC_STORAGE_SPARSE mode.
+#include "TCCubeChannel.h"  // Used to store the interleaved colors of RGB animations.
+#include "TCAnimCore.h"     // The color methods compiled for each number of colors.
+#include "TCEffectChain.h"  // The post-processing effects of the animation.
+#include "TCThreadPool.h"   // Used to update the regions of the cube in parallel.
 #include <cstdlib>      // Used for pointer NULL define value.
+#include <cstring>      // Used for the memcpy and memcmp functions.
+#include <cassert>      // Used to check the number of colors in the constructors.
+
+
+/// The color methods of animations in the palette mode (see TCAnim::SetPaletteMode).
+const TCAnimOps TCAnimPalette::ops =
+{
+    &TCAnimPalette::SetVoxelColor,
+    &TCAnimPalette::SetVoxelGrey,
+    &TCAnimPalette::GetVoxelColor,
+    &TCAnimPalette::SetColumnColor,
+    &TCAnimPalette::SetColumnGrey,
+    &TCAnimPalette::CompareColumnColor,
+    &TCAnimPalette::CompareColumnGrey,
+    &TCAnimPalette::SetPlaneColor,
+    &TCAnimPalette::SetPlaneGrey,
+    &TCAnimPalette::ComparePlaneColor,
+    &TCAnimPalette::ComparePlaneGrey,
+    &TCAnimPalette::Shift,
+    &TCAnimPalette::FillBoxColor,
+    &TCAnimPalette::FillBoxGrey
+};
 
 
 ///
@@ -43,12 +71,16 @@ TCAnim::TCAnim(byte cubeSize, byte colors)
     numColors = colors;
     if (colors == 0) colors = 1;
     cubeState = new TCCube*[colors];
-    for (byte i = 0; i < colors; i++)
-    {
-        cubeState[i] = new TCCube(cubeSize);
-    }
     sc[0] = sc[1] = sc[2] = cubeSize;
+    storageMode = TC_STORAGE_DEFAULT;
+    AllocateCubes(storageMode);
+    ops = SelectOps(numColors);
+    palette    = NULL;
+    paletteGen = 0;
+    effects    = NULL;
     iterations = ticks = 0;
+    parallelMode = TC_PARALLEL_NONE;
+    nextCube[0]  = nextCube[1] = nextCube[2] = NULL;
 }
 
 
@@ -70,13 +102,16 @@ TCAnim::TCAnim(byte sizeX, byte sizeY, byte sizeZ, byte colors)
     numColors = colors;
     if (colors == 0) colors = 1;
     cubeState = new TCCube*[colors];
-    for (byte i = 0; i < colors; i++)
-    {
-        cubeState[i] = new TCCube(sizeX, sizeY, sizeZ);
-    }
-    //cubeState = new TCCube(sizeX, sizeY, sizeZ);
     sc[0] = sizeX; sc[1] = sizeY; sc[2] = sizeZ;
+    storageMode = TC_STORAGE_DEFAULT;
+    AllocateCubes(storageMode);
+    ops = SelectOps(numColors);
+    palette    = NULL;
+    paletteGen = 0;
+    effects    = NULL;
     iterations = ticks = 0;
+    parallelMode = TC_PARALLEL_NONE;
+    nextCube[0]  = nextCube[1] = nextCube[2] = NULL;
 }
 
 
@@ -96,29 +131,40 @@ TCAnim::TCAnim(byte tccSize[3], byte colors)
     numColors = colors;
     if (colors == 0) colors = 1;
     cubeState = new TCCube*[colors];
-    for (byte i = 0; i < colors; i++)
-    {
-        cubeState[i] = new TCCube(tccSize);
-    }
     sc[0] = tccSize[0]; sc[1] = tccSize[1]; sc[2] = tccSize[2];
+    storageMode = TC_STORAGE_DEFAULT;
+    AllocateCubes(storageMode);
+    ops = SelectOps(numColors);
+    palette    = NULL;
+    paletteGen = 0;
+    effects    = NULL;
     iterations = ticks = 0;
+    parallelMode = TC_PARALLEL_NONE;
+    nextCube[0]  = nextCube[1] = nextCube[2] = NULL;
 }
 
 
 ///
 /// \brief Destructor
 ///
-/// Deletes the dynamically allocated TCCube cubeState object.
+/// Deletes the dynamically allocated TCCube cubeState object(s).  Note that one cube
+/// object is still allocated when numColors is 0.
 ///
 /// \see AllocateCube | pCubeState
 ///
 TCAnim::~TCAnim()
 {
-    for (byte i = 0; i < numColors; i++)
+    for (byte i = 0; i < ((numColors == 0) ? 1 : numColors); i++)
     {
         delete cubeState[i];
     }
     delete[] cubeState;
+    delete[] palette;
+    delete effects;
+    for (byte i = 0; i < 3; i++)
+    {
+        delete nextCube[i];
+    }
 }
 
 
@@ -126,14 +172,21 @@ TCAnim::~TCAnim()
 /// \brief Tick? Tock.
 ///
 /// Advances the animation by one step.  This increments the internal tick counter,
-/// and calls the animation-defined \ref Update method.
+/// and calls the animation-defined \ref Update method.  If a parallel mode is selected,
+/// the \ref UpdateRegion method is then called for every region of the cube, and once
+/// all of them are done (and the next state is stored), \ref FinishUpdate is called.
 ///
-/// \see Update | ticks
+/// \see Update | ticks | SetParallelMode
 ///
 void TCAnim::Tick()
 {
     ticks++;
     Update();
+    if (parallelMode != TC_PARALLEL_NONE)
+    {
+        UpdateParallel();
+        FinishUpdate();
+    }
 }
 
 
@@ -167,6 +220,27 @@ unsigned int TCAnim::GetTicks()
 }
 
 
+///
+/// \brief Get Generation
+///
+/// Method to get the generation number of the last change made to the cube state of any
+/// color in the animation.  If this returns the same number twice, the animation's cube
+/// state has not changed between the two calls.
+///
+/// \returns The highest generation of all cubeState objects (and of the palette).
+/// \see     TCCube::GetGeneration
+///
+uint64_t TCAnim::GetGeneration()
+{
+    uint64_t lastGen = paletteGen;
+    for (byte i = 0; i < ((numColors == 0) ? 1 : numColors); i++)
+    {
+        if (cubeState[i]->GetGeneration() > lastGen) lastGen = cubeState[i]->GetGeneration();
+    }
+    return lastGen;
+}
+
+
 ///
 /// \brief Get Number of Colors
 ///
@@ -196,20 +270,7 @@ byte TCAnim::GetNumColors()
 ///
 void TCAnim::SetVoxelColor(byte x, byte y, byte z, byte grey)
 {
-    switch (numColors)
-    {
-        case 0:
-            cubeState[0]->SetVoxelState(x, y, z, grey == 0x00 ? 0x00 : 0x01);
-            break;
-        case 1:
-            cubeState[0]->SetVoxelState(x, y, z, grey);
-            break;
-        case 3:
-            SetVoxelColor(x, y, z, grey, grey, grey);
-            break;
-        default:
-            break;
-    }
+    ops->SetVoxelGrey(*this, x, y, z, grey);
 }
 
 
@@ -225,28 +286,12 @@ void TCAnim::SetVoxelColor(byte x, byte y, byte z, byte grey)
 /// \param g The value (0-255) of the green color.
 /// \param b The value (0-255) of the blue color.
 ///
-/// \remarks If numColors is 0, the voxel state is set to 0x01 if r, g, and b are non-zero.
+/// \remarks If numColors is 0, the voxel state is set to 0x01 if r, g, or b is non-zero.
 ///          If numColors is 1, the voxel state is set to the average of r, g, and b.
 ///
 void TCAnim::SetVoxelColor(byte x, byte y, byte z, byte r, byte g, byte b)
 {
-    switch (numColors)
-    {
-        case 0:
-            cubeState[0]->SetVoxelState(x, y, z, 
-                (r == 0x00 && g == 0x00 && b == 0x00) == 0x00 ? 0x00 : 0x01);
-            break;
-        case 1:
-            cubeState[0]->SetVoxelState(x, y, z, (r + g + b) / 3);
-            break;
-        case 3:
-            cubeState[TC_COLOR_R]->SetVoxelState(x, y, z, r);
-            cubeState[TC_COLOR_G]->SetVoxelState(x, y, z, g);
-            cubeState[TC_COLOR_B]->SetVoxelState(x, y, z, b);
-            break;
-        default:
-            break;
-    }
+    ops->SetVoxelColor(*this, x, y, z, r, g, b);
 }
 
 
@@ -284,34 +329,12 @@ void TCAnim::SetVoxelColor(byte x, byte y, byte z, ulint rgbColorValue)
 /// \returns An unsigned integer with the lower 24-bits corresponding to the voxel color.
 ///
 /// \remarks If numColors is 0, this function returns 1 for a lit voxel (0 otherwise).
-///          If numColors is 1, the value returned will be greyscale.
+///          If numColors is 1, the value returned will be greyscale (or the palette color
+///          of the voxel, in the palette mode).
 ///
 ulint TCAnim::GetVoxelColor(byte x, byte y, byte z)
 {
-    ulint toReturn;
-    byte  voxelValue;
-    switch (numColors)
-    {
-        case 0:
-            toReturn = (cubeState[0]->GetVoxelState(x, y, z) == 0x00) ? 0x00 : 0x01;
-            break;
-        case 1:
-            voxelValue = cubeState[0]->GetVoxelState(x, y, z);
-            toReturn = voxelValue | (voxelValue <<  8) | (voxelValue << 16);
-            break;
-        case 3:
-            voxelValue = cubeState[TC_COLOR_R]->GetVoxelState(x, y, z);
-            toReturn = (voxelValue << 16);
-            voxelValue = cubeState[TC_COLOR_G]->GetVoxelState(x, y, z);
-            toReturn = toReturn | (voxelValue << 8);
-            voxelValue = cubeState[TC_COLOR_B]->GetVoxelState(x, y, z);
-            toReturn = toReturn | voxelValue;
-            break;
-        default:
-            return 0;
-            break;
-    }
-    return toReturn;
+    return ops->GetVoxelColor(*this, x, y, z);
 }
 
 
@@ -332,20 +355,7 @@ ulint TCAnim::GetVoxelColor(byte x, byte y, byte z)
 ///
 void TCAnim::SetColumnColor(byte axis, byte dim1, byte dim2, byte grey)
 {
-    switch (numColors)
-    {
-        case 0:
-            cubeState[0]->SetColumnState(axis, dim1, dim2, grey == 0x00 ? 0x00 : 0x01);
-            break;
-        case 1:
-            cubeState[0]->SetColumnState(axis, dim1, dim2, grey);
-            break;
-        case 3:
-            SetColumnColor(axis, dim1, dim2, grey, grey, grey);
-            break;
-        default:
-            break;
-    }
+    ops->SetColumnGrey(*this, axis, dim1, dim2, grey);
 }
 
 
@@ -368,23 +378,7 @@ void TCAnim::SetColumnColor(byte axis, byte dim1, byte dim2, byte grey)
 ///
 void TCAnim::SetColumnColor(byte axis, byte dim1, byte dim2, byte r, byte g, byte b)
 {
-    switch (numColors)
-    {
-        case 0:
-            cubeState[0]->SetColumnState(axis, dim1, dim2, 
-                (r == 0x00 && g == 0x00 && b == 0x00) == 0x00 ? 0x00 : 0x01);
-            break;
-        case 1:
-            cubeState[0]->SetColumnState(axis, dim1, dim2, (r + g + b) / 3);
-            break;
-        case 3:
-            cubeState[TC_COLOR_R]->SetColumnState(axis, dim1, dim2, r);
-            cubeState[TC_COLOR_G]->SetColumnState(axis, dim1, dim2, g);
-            cubeState[TC_COLOR_B]->SetColumnState(axis, dim1, dim2, b);
-            break;
-        default:
-            break;
-    }
+    ops->SetColumnColor(*this, axis, dim1, dim2, r, g, b);
 }
 
 
@@ -405,7 +399,7 @@ void TCAnim::SetColumnColor(byte axis, byte dim1, byte dim2, byte r, byte g, byt
 ///
 void TCAnim::SetColumnColor(byte axis, byte dim1, byte dim2, ulint rgbColorValue)
 {
-    SetVoxelColor(axis, dim1, dim2,
+    SetColumnColor(axis, dim1, dim2,
         (byte)((rgbColorValue & 0xFF0000) >> 16), 
         (byte)((rgbColorValue & 0x00FF00) >>  8), 
         (byte)((rgbColorValue & 0x0000FF)) );
@@ -429,24 +423,7 @@ void TCAnim::SetColumnColor(byte axis, byte dim1, byte dim2, ulint rgbColorValue
 ///
 bool TCAnim::CompareColumnColor(byte axis, byte dim1, byte dim2, byte grey)
 {
-    bool returnVal = false;
-    switch (numColors)
-    {
-        case 0:
-            cubeState[0]->GetColumnState(axis, dim1, dim2, grey == 0x00 ? 0x00 : 0x01);
-            break;
-        case 1:
-            cubeState[0]->GetColumnState(axis, dim1, dim2, grey);
-            break;
-        case 3:
-            returnVal = cubeState[0]->GetColumnState(axis, dim1, dim2, grey) &&
-                        cubeState[1]->GetColumnState(axis, dim1, dim2, grey) &&
-                        cubeState[2]->GetColumnState(axis, dim1, dim2, grey);
-            break;
-        default:
-            break;
-    }
-    return returnVal;
+    return ops->CompareColumnGrey(*this, axis, dim1, dim2, grey);
 }
 
 
@@ -469,25 +446,7 @@ bool TCAnim::CompareColumnColor(byte axis, byte dim1, byte dim2, byte grey)
 ///
 bool TCAnim::CompareColumnColor(byte axis, byte dim1, byte dim2, byte r, byte g, byte b)
 {
-    bool toReturn = false;
-    switch (numColors)
-    {
-        case 0:
-            toReturn = cubeState[0]->GetColumnState(axis, dim1, dim2, 
-                (r == 0x00 && g == 0x00 && b == 0x00) == 0x00 ? 0x00 : 0x01);
-            break;
-        case 1:
-            toReturn = cubeState[0]->GetColumnState(axis, dim1, dim2, (r + g + b) / 3);
-            break;
-        case 3:
-            toReturn = cubeState[TC_COLOR_R]->GetColumnState(axis, dim1, dim2, r) &&
-                       cubeState[TC_COLOR_G]->GetColumnState(axis, dim1, dim2, g) &&
-                       cubeState[TC_COLOR_B]->GetColumnState(axis, dim1, dim2, b);
-            break;
-        default:
-            break;
-    }
-    return toReturn;
+    return ops->CompareColumnColor(*this, axis, dim1, dim2, r, g, b);
 }
 
 
@@ -530,20 +489,7 @@ bool TCAnim::CompareColumnColor(byte axis, byte dim1, byte dim2, ulint rgbColorV
 ///
 void TCAnim::SetPlaneColor(byte plane, byte offset, byte grey)
 {
-    switch (numColors)
-    {
-        case 0:
-            cubeState[0]->SetPlaneState(plane, offset, grey == 0x00 ? 0x00 : 0x01);
-            break;
-        case 1:
-            cubeState[0]->SetPlaneState(plane, offset, grey);
-            break;
-        case 3:
-            SetPlaneColor(plane, offset, grey, grey, grey);
-            break;
-        default:
-            break;
-    }
+    ops->SetPlaneGrey(*this, plane, offset, grey);
 }
 
 
@@ -564,23 +510,7 @@ void TCAnim::SetPlaneColor(byte plane, byte offset, byte grey)
 ///
 void TCAnim::SetPlaneColor(byte plane, byte offset, byte r, byte g, byte b)
 {
-    switch (numColors)
-    {
-        case 0:
-            cubeState[0]->SetPlaneState(plane, offset, 
-                (r == 0x00 && g == 0x00 && b == 0x00) == 0x00 ? 0x00 : 0x01);
-            break;
-        case 1:
-            cubeState[0]->SetPlaneState(plane, offset, (r + g + b) / 3);
-            break;
-        case 3:
-            cubeState[TC_COLOR_R]->SetPlaneState(plane, offset, r);
-            cubeState[TC_COLOR_G]->SetPlaneState(plane, offset, g);
-            cubeState[TC_COLOR_B]->SetPlaneState(plane, offset, b);
-            break;
-        default:
-            break;
-    }
+    ops->SetPlaneColor(*this, plane, offset, r, g, b);
 }
 
 
@@ -623,25 +553,7 @@ void TCAnim::SetPlaneColor(byte plane, byte offset, ulint rgbColorValue)
 ///
 bool TCAnim::ComparePlaneColor(byte plane, byte offset, byte grey)
 {
-    bool returnVal = false;
-    switch (numColors)
-    {
-        case 0:
-            returnVal = cubeState[0]->GetPlaneState(plane, offset,
-                (grey == 0x00) ? 0x00 : 0x01);
-            break;
-        case 1:
-            returnVal = cubeState[0]->GetPlaneState(plane, offset, grey);
-            break;
-        case 3:
-            returnVal = cubeState[0]->GetPlaneState(plane, offset, grey) &&
-                        cubeState[1]->GetPlaneState(plane, offset, grey) &&
-                        cubeState[2]->GetPlaneState(plane, offset, grey);
-            break;
-        default:
-            break;
-    }
-    return returnVal;
+    return ops->ComparePlaneGrey(*this, plane, offset, grey);
 }
 
 
@@ -664,25 +576,7 @@ bool TCAnim::ComparePlaneColor(byte plane, byte offset, byte grey)
 ///
 bool TCAnim::ComparePlaneColor(byte plane, byte offset, byte r, byte g, byte b)
 {
-    bool toReturn = false;
-    switch (numColors)
-    {
-        case 0:
-            toReturn = cubeState[0]->GetPlaneState(plane, offset,
-                (r == 0x00 && g == 0x00 && b == 0x00) ? 0x00 : 0x01);
-            break;
-        case 1:
-            toReturn = cubeState[0]->GetPlaneState(plane, offset, (r + g + b) / 3);
-            break;
-        case 3:
-            toReturn = cubeState[TC_COLOR_R]->GetPlaneState(plane, offset, r) &&
-                       cubeState[TC_COLOR_G]->GetPlaneState(plane, offset, g) &&
-                       cubeState[TC_COLOR_B]->GetPlaneState(plane, offset, b);
-            break;
-        default:
-            break;
-    }
-    return toReturn;
+    return ops->ComparePlaneColor(*this, plane, offset, r, g, b);
 }
 
 
@@ -723,18 +617,752 @@ bool TCAnim::ComparePlaneColor(byte plane, byte offset, ulint rgbColorValue)
 ///
 void TCAnim::Shift(byte plane, sbyte offset)
 {
-    switch (numColors)
+    ops->Shift(*this, plane, offset);
+}
+
+
+///
+/// \brief Set Shift Mode
+///
+/// Sets how the \ref Shift method moves the voxels of each color in the cube.
+///
+/// \param mode The shift mode, either TC_SHIFT_LINEAR (the voxels are moved), or
+///             TC_SHIFT_RING (only the origin of the shifted axis is moved).
+///
+/// \see TCCube::SetShiftMode
+///
+void TCAnim::SetShiftMode(byte mode)
+{
+    for (byte i = 0; i < ((numColors == 0) ? 1 : numColors); i++)
+    {
+        cubeState[i]->SetShiftMode(mode);
+    }
+}
+
+
+///
+/// \brief Set Storage Mode
+///
+/// Replaces the cube of each color with one using the passed storage type, copying the
+/// current voxel states into it.  This is usually called once, when the animation is
+/// initialized (e.g. large animations where most voxels are off can use less memory,
+/// and spend less time on empty space, with TC_STORAGE_SPARSE).
+///
+/// \param mode The storage mode, either TC_STORAGE_DEFAULT (a TCCube, a TCCubeBits if
+///             numColors is 0, or a TCCubeChannel view of one interleaved buffer for
+///             each color if numColors is 3), or TC_STORAGE_SPARSE (a TCCubeSparse for
+///             each color).
+///
+/// \remarks The new cubes always start in the TC_SHIFT_LINEAR shift mode.
+///
+/// \see TCCubeSparse | GetStorageMode
+///
+void TCAnim::SetStorageMode(byte mode)
+{
+    if (mode == storageMode) return;
+    TCCube *oldCubes[3];
+    for (byte i = 0; i < ((numColors == 0) ? 1 : numColors); i++)
+    {
+        oldCubes[i] = cubeState[i];
+    }
+    AllocateCubes(mode);
+    for (byte i = 0; i < ((numColors == 0) ? 1 : numColors); i++)
+    {
+        cubeState[i]->Blit(*oldCubes[i], 0, 0, 0);
+        delete oldCubes[i];
+    }
+    storageMode = mode;
+}
+
+
+///
+/// \brief Get Color Cube
+///
+/// \returns The red cubeState object if the colors of the animation are stored in one
+///          interleaved buffer (see TCCubeChannel), or NULL otherwise.  This is the case
+///          for animations with 3 colors in the TC_STORAGE_DEFAULT mode.
+///
+TCCubeChannel *TCAnim::GetColorCube()
+{
+    return colorCube;
+}
+
+
+///
+/// \brief Set Palette Mode
+///
+/// Enables or disables the palette mode of an animation with 1 color.  In the palette
+/// mode, the state of each voxel is an index into a table of \ref TC_PALETTE_SIZE RGB
+/// colors, so an animation with only a few colors stores one byte per voxel instead of
+/// three, and recoloring (or fading) the whole cube only changes the palette.
+///
+/// \param enable True to enable the palette mode, false to disable it.
+///
+/// \remarks The greyscale color methods (e.g. SetVoxelColor with a grey value) set the
+///          palette index of the voxels, while the RGB color methods set the index of the
+///          closest palette color (see \ref FindPaletteIndex).  \ref GetVoxelColor
+///          returns the palette color of the voxel.  The palette starts as a greyscale
+///          ramp (index i is the grey value i), so the animation looks the same until a
+///          palette color is changed.  The reductions (e.g. \ref CountLitVoxels) count
+///          any voxel with a non-zero index as lit.
+///
+/// \see SetPaletteColor | GetPalette | TCAnimPalette
+///
+void TCAnim::SetPaletteMode(bool enable)
+{
+    assert(numColors == 1);
+    if (enable == (palette != NULL)) return;
+    if (enable)
+    {
+        palette = new uint32_t[TC_PALETTE_SIZE];
+        for (int i = 0; i < TC_PALETTE_SIZE; i++)
+        {
+            palette[i] = ((uint32_t)i << 16) | ((uint32_t)i << 8) | (uint32_t)i;
+        }
+        ops = &TCAnimPalette::ops;
+    }
+    else
+    {
+        delete[] palette;
+        palette = NULL;
+        ops     = SelectOps(numColors);
+    }
+    paletteGen = TCCube::NewGeneration();
+}
+
+
+///
+/// \brief Get Palette
+///
+/// \returns A pointer to the 24-bit color of each of the \ref TC_PALETTE_SIZE palette
+///          indices, or NULL if the palette mode is not enabled.
+///
+/// \see SetPaletteMode
+///
+const uint32_t *TCAnim::GetPalette()
+{
+    return palette;
+}
+
+
+///
+/// \brief Get Effects
+///
+/// Gets the post-processing effects applied to each frame published from the animation
+/// (see PublishFrame).  The effects only change the published frames, and never the
+/// state of the animation itself.
+///
+/// \returns The animation's effect chain (created without any effects the first time
+///          this method is called).
+///
+/// \see HasEffects | TCEffectChain
+///
+TCEffectChain *TCAnim::GetEffects()
+{
+    if (effects == NULL)
+    {
+        effects = new TCEffectChain();
+    }
+    return effects;
+}
+
+
+///
+/// \brief Has Effects
+///
+/// \returns True if any post-processing effects are applied to the animation's frames.
+///
+bool TCAnim::HasEffects()
+{
+    return (effects != NULL && effects->GetNumEffects() > 0);
+}
+
+
+///
+/// \brief Set Palette Color
+///
+/// Sets the color displayed for every voxel with the passed palette index.
+///
+/// \param index         The palette index to set the color of.
+/// \param rgbColorValue The hexadecimal RGB color value (only the lower 24-bits are used).
+///
+/// \remarks The palette mode must be enabled (see \ref SetPaletteMode).
+///
+void TCAnim::SetPaletteColor(byte index, ulint rgbColorValue)
+{
+    assert(palette != NULL);
+    palette[index] = (uint32_t)(rgbColorValue & 0xFFFFFF);
+    paletteGen     = TCCube::NewGeneration();
+}
+
+
+///
+/// \brief Get Palette Color
+///
+/// \param index The palette index to get the color of.
+///
+/// \returns The 24-bit color of the passed palette index.
+///
+/// \remarks The palette mode must be enabled (see \ref SetPaletteMode).
+///
+ulint TCAnim::GetPaletteColor(byte index)
+{
+    assert(palette != NULL);
+    return palette[index];
+}
+
+
+///
+/// \brief Find Palette Index
+///
+/// Finds the palette color closest to the passed color (by the sum of the squared
+/// differences of each color).  If two indices are equally close, the lowest is used.
+///
+/// \param rgbColorValue The hexadecimal RGB color value to find.
+///
+/// \returns The index of the closest palette color.
+///
+/// \remarks The palette mode must be enabled (see \ref SetPaletteMode).
+///
+byte TCAnim::FindPaletteIndex(ulint rgbColorValue)
+{
+    assert(palette != NULL);
+    int  r = (rgbColorValue >> 16) & 0xFF,
+         g = (rgbColorValue >>  8) & 0xFF,
+         b =  rgbColorValue        & 0xFF;
+    int  bestIndex = 0;
+    long bestDist  = -1;
+    for (int i = 0; i < TC_PALETTE_SIZE && bestDist != 0; i++)
+    {
+        int  dr = (int)((palette[i] >> 16) & 0xFF) - r,
+             dg = (int)((palette[i] >>  8) & 0xFF) - g,
+             db = (int)( palette[i]        & 0xFF) - b;
+        long dist = (long)dr * dr + (long)dg * dg + (long)db * db;
+        if (bestDist < 0 || dist < bestDist)
+        {
+            bestIndex = i;
+            bestDist  = dist;
+        }
+    }
+    return (byte)bestIndex;
+}
+
+
+///
+/// \brief Allocate Cubes
+///
+/// Creates a new TCCube object for each color of the animation (in the cubeState array,
+/// which must already be allocated), depending on the passed storage mode.  Any objects
+/// already in the cubeState array are not deleted.
+///
+/// \param mode The storage mode (e.g. TC_STORAGE_SPARSE).
+///
+void TCAnim::AllocateCubes(byte mode)
+{
+    colorCube = NULL;
+    if (mode == TC_STORAGE_SPARSE)
+    {
+        for (byte i = 0; i < ((numColors == 0) ? 1 : numColors); i++)
+        {
+            cubeState[i] = new TCCubeSparse(sc);
+        }
+    }
+    else if (numColors == 3)
+    {
+        // The colors share one buffer, so each voxel's color can be read at once.
+        colorCube = new TCCubeChannel(sc);
+        cubeState[TC_COLOR_R] = colorCube;
+        cubeState[TC_COLOR_G] = new TCCubeChannel(*colorCube, TC_COLOR_G);
+        cubeState[TC_COLOR_B] = new TCCubeChannel(*colorCube, TC_COLOR_B);
+    }
+    else if (numColors == 0)
+    {
+        // Animations without any colors only need one bit per voxel.
+        cubeState[0] = new TCCubeBits(sc);
+    }
+    else
+    {
+        cubeState[0] = new TCCube(sc);
+    }
+}
+
+
+///
+/// \brief Select Color Methods
+///
+/// Returns the table of color methods compiled for the passed number of colors (see the
+/// TCAnimCore template).  This is called once by each constructor, so the color methods
+/// (e.g. \ref SetVoxelColor) do not need to check the number of colors on every call.
+///
+/// \param colors The number of colors in the animation (0, 1, or 3).
+///
+/// \returns A pointer to the TCAnimCore<colors>::ops table.
+///
+const TCAnimOps *TCAnim::SelectOps(byte colors)
+{
+    switch (colors)
     {
         case 0:
+            return &TCAnimCore<0>::ops;
         case 1:
-            cubeState[0]->Shift(plane, offset);
-            break;
+            return &TCAnimCore<1>::ops;
         case 3:
-            cubeState[TC_COLOR_R]->Shift(plane, offset);
-            cubeState[TC_COLOR_G]->Shift(plane, offset);
-            cubeState[TC_COLOR_B]->Shift(plane, offset);
-            break;
+            return &TCAnimCore<3>::ops;
         default:
-            break;
+            assert(!"Animations must have 0, 1, or 3 colors.");
+            return NULL;
+    }
+}
+
+
+///
+/// \brief Get Storage Mode
+///
+/// \returns The current storage mode (e.g. TC_STORAGE_SPARSE).
+/// \see     SetStorageMode
+///
+byte TCAnim::GetStorageMode()
+{
+    return storageMode;
+}
+
+
+///
+/// \brief Fill Box (Greyscale)
+///
+/// Sets the color of every voxel in the box between the two passed corners (inclusive)
+/// to the passed greyscale value.  The box is clipped to the cube.
+///
+/// \param x1   The x-coordinate of the first corner.
+/// \param y1   The y-coordinate of the first corner.
+/// \param z1   The z-coordinate of the first corner.
+/// \param x2   The x-coordinate of the opposite corner.
+/// \param y2   The y-coordinate of the opposite corner.
+/// \param z2   The z-coordinate of the opposite corner.
+/// \param grey The greyscale value (0-255) to set the box to.
+///
+/// \remarks If numColors is 0, the box's state is set to 0x01 for a non-zero grey value.
+///          If numColors is 3, each R/G/B color value is set to the grey value.
+///
+/// \see TCCube::FillBox
+///
+void TCAnim::FillBox(byte x1, byte y1, byte z1, byte x2, byte y2, byte z2, byte grey)
+{
+    ops->FillBoxGrey(*this, x1, y1, z1, x2, y2, z2, grey);
+}
+
+
+///
+/// \brief Fill Box (RGB Values)
+///
+/// Sets the color of every voxel in the box between the two passed corners (inclusive)
+/// to the passed red, green, and blue values.  The box is clipped to the cube.
+///
+/// \param x1 The x-coordinate of the first corner.
+/// \param y1 The y-coordinate of the first corner.
+/// \param z1 The z-coordinate of the first corner.
+/// \param x2 The x-coordinate of the opposite corner.
+/// \param y2 The y-coordinate of the opposite corner.
+/// \param z2 The z-coordinate of the opposite corner.
+/// \param r  The value (0-255) of the red color.
+/// \param g  The value (0-255) of the green color.
+/// \param b  The value (0-255) of the blue color.
+///
+/// \remarks If numColors is 0, the box state is set to 0x01 if any of r, g, or b are
+///          non-zero.  If numColors is 1, the box state is set to the average of r, g,
+///          and b.
+///
+void TCAnim::FillBox(byte x1, byte y1, byte z1, byte x2, byte y2, byte z2,
+                     byte r, byte g, byte b)
+{
+    ops->FillBoxColor(*this, x1, y1, z1, x2, y2, z2, r, g, b);
+}
+
+
+///
+/// \brief Fill Box (RGB Hexadecimal)
+///
+/// Sets the color of every voxel in the box between the two passed corners (inclusive)
+/// to the passed hexadecimal value (e.g. 0xFF0000).  This function is a wrapper, which
+/// splits the rgbColorValue argument into the proper red, green, and blue values.
+///
+/// \param x1            The x-coordinate of the first corner.
+/// \param y1            The y-coordinate of the first corner.
+/// \param z1            The z-coordinate of the first corner.
+/// \param x2            The x-coordinate of the opposite corner.
+/// \param y2            The y-coordinate of the opposite corner.
+/// \param z2            The z-coordinate of the opposite corner.
+/// \param rgbColorValue The hexadecimal RGB color value (as a 32-bit integer).  Only the
+///                      lower 24-bits are considered (the remaining bits are masked off).
+///
+void TCAnim::FillBox(byte x1, byte y1, byte z1, byte x2, byte y2, byte z2,
+                     ulint rgbColorValue)
+{
+    FillBox(x1, y1, z1, x2, y2, z2,
+        (byte)((rgbColorValue & 0xFF0000) >> 16),
+        (byte)((rgbColorValue & 0x00FF00) >>  8),
+        (byte)((rgbColorValue & 0x0000FF)) );
+}
+
+
+///
+/// \brief Copy Region
+///
+/// Copies a box of voxels from one part of the animation to another, for each color.
+///
+/// \param srcX  The x-coordinate of the box's first voxel.
+/// \param srcY  The y-coordinate of the box's first voxel.
+/// \param srcZ  The z-coordinate of the box's first voxel.
+/// \param dstX  The x-coordinate to copy the box's first voxel to.
+/// \param dstY  The y-coordinate to copy the box's first voxel to.
+/// \param dstZ  The z-coordinate to copy the box's first voxel to.
+/// \param sizeX The size (in voxels) of the box in the x-dimension.
+/// \param sizeY The size (in voxels) of the box in the y-dimension.
+/// \param sizeZ The size (in voxels) of the box in the z-dimension.
+/// \param op    How the voxels are combined (TC_BLIT_COPY, TC_BLIT_AND, TC_BLIT_OR, or
+///              TC_BLIT_XOR).  Defaults to TC_BLIT_COPY.
+///
+/// \see TCCube::CopyRegion
+///
+void TCAnim::CopyRegion(byte srcX, byte srcY, byte srcZ, byte dstX, byte dstY, byte dstZ,
+                        byte sizeX, byte sizeY, byte sizeZ, byte op)
+{
+    for (byte i = 0; i < ((numColors == 0) ? 1 : numColors); i++)
+    {
+        cubeState[i]->CopyRegion(*cubeState[i], srcX, srcY, srcZ, dstX, dstY, dstZ,
+                                 sizeX, sizeY, sizeZ, op);
+    }
+}
+
+
+///
+/// \brief Blit
+///
+/// Copies the entire state of another animation into this one, with the other
+/// animation's (0, 0, 0) voxel placed at the passed (possibly negative) position.
+///
+/// \param src  The animation to copy the voxels from.
+/// \param dstX The x-coordinate to place the source animation's first voxel at.
+/// \param dstY The y-coordinate to place the source animation's first voxel at.
+/// \param dstZ The z-coordinate to place the source animation's first voxel at.
+/// \param op   How the voxels are combined (TC_BLIT_COPY, TC_BLIT_AND, TC_BLIT_OR, or
+///             TC_BLIT_XOR).  Defaults to TC_BLIT_COPY.
+///
+/// \remarks Each color of this animation is copied from the same color of the source
+///          animation.  If the source animation has fewer colors, its first color is
+///          used for each of the remaining colors.
+///
+/// \see TCCube::Blit
+///
+void TCAnim::Blit(const TCAnim &src, int dstX, int dstY, int dstZ, byte op)
+{
+    for (byte i = 0; i < ((numColors == 0) ? 1 : numColors); i++)
+    {
+        const TCCube *pSrc = (i < src.numColors) ? src.cubeState[i] : src.cubeState[0];
+        cubeState[i]->Blit(*pSrc, dstX, dstY, dstZ, op);
+    }
+}
+
+
+///
+/// \brief Count Lit Voxels
+///
+/// \returns The number of voxels with any non-zero color.
+///
+/// \see TCCube::CountLitVoxels
+///
+size_t TCAnim::CountLitVoxels()
+{
+    TCCube *litCube  = GetLitCube();
+    size_t  toReturn = litCube->CountLitVoxels();
+    if (litCube != cubeState[0]) delete litCube;
+    return toReturn;
+}
+
+
+///
+/// \brief Sum Color
+///
+/// \param color The color to sum (0 if numColors is 0 or 1, otherwise TC_COLOR_R,
+///              TC_COLOR_G, or TC_COLOR_B).
+///
+/// \returns The sum of the passed color's value over every voxel, or 0 if the color is
+///          not in the animation.
+///
+/// \see TCCube::SumVoxels
+///
+uint64_t TCAnim::SumColor(byte color)
+{
+    if (color >= ((numColors == 0) ? 1 : numColors)) return 0;
+    return cubeState[color]->SumVoxels();
+}
+
+
+///
+/// \brief Get Plane Counts
+///
+/// Counts the lit voxels in every plane of the passed orientation at once.
+///
+/// \param plane   The orientation of the planes (TC_XY_PLANE, TC_ZX_PLANE, or
+///                TC_YZ_PLANE).
+/// \param pCounts Array with an element for each plane (see TCCube::GetPlaneCounts).
+///
+void TCAnim::GetPlaneCounts(byte plane, size_t *pCounts)
+{
+    TCCube *litCube = GetLitCube();
+    litCube->GetPlaneCounts(plane, pCounts);
+    if (litCube != cubeState[0]) delete litCube;
+}
+
+
+///
+/// \brief Get Column Counts
+///
+/// Counts the lit voxels in every column along the passed axis at once.
+///
+/// \param axis    The axis of the columns (TC_X_AXIS, TC_Y_AXIS, or TC_Z_AXIS).
+/// \param pCounts Array with an element for each column (see TCCube::GetColumnCounts).
+///
+void TCAnim::GetColumnCounts(byte axis, size_t *pCounts)
+{
+    TCCube *litCube = GetLitCube();
+    litCube->GetColumnCounts(axis, pCounts);
+    if (litCube != cubeState[0]) delete litCube;
+}
+
+
+///
+/// \brief Get Bounding Box
+///
+/// Finds the smallest box which contains every lit voxel.
+///
+/// \param lo Array set to the coordinates of the box's lowest corner.
+/// \param hi Array set to the coordinates of the box's highest corner.
+///
+/// \returns True if any voxel is lit, false otherwise.
+///
+/// \see TCCube::GetBoundingBox
+///
+bool TCAnim::GetBoundingBox(byte lo[3], byte hi[3])
+{
+    TCCube *litCube  = GetLitCube();
+    bool    toReturn = litCube->GetBoundingBox(lo, hi);
+    if (litCube != cubeState[0]) delete litCube;
+    return toReturn;
+}
+
+
+///
+/// \brief Get Lit Cube
+///
+/// Returns a cube where each voxel is lit if any color of the voxel is lit.  For 0 and 1
+/// color animations, this is just the first cube state.  For RGB animations, the three
+/// colors are ORed together into a new cube.
+///
+/// \returns A pointer to the cube, which must be deleted by the caller if it is not the
+///          same as cubeState[0].
+///
+TCCube *TCAnim::GetLitCube()
+{
+    if (numColors != 3) return cubeState[0];
+    TCCube *litCube = cubeState[TC_COLOR_R]->Clone();
+    litCube->OP_OR(*cubeState[TC_COLOR_G]);
+    litCube->OP_OR(*cubeState[TC_COLOR_B]);
+    return litCube;
+}
+
+
+///
+/// \brief Set Parallel Mode
+///
+/// Selects how each tick of the animation is split between several threads.  In the
+/// TC_PARALLEL_SLICES and TC_PARALLEL_BRICKS modes, each \ref Tick calls the Update
+/// method first (which can advance anything shared by the whole cube), and then calls
+/// \ref UpdateRegion for each yz-plane or 8x8x8 brick of the cube on the shared
+/// TCThreadPool, waiting for all of them before the next state is stored.
+///
+/// \param mode The parallel mode (TC_PARALLEL_NONE, TC_PARALLEL_SLICES, or
+///             TC_PARALLEL_BRICKS).
+///
+/// \remarks Each region reads the state from before the tick, and only writes its own
+///          voxels, so the result of a tick does not depend on the number of threads, or
+///          the order in which the regions are updated.
+///
+void TCAnim::SetParallelMode(byte mode)
+{
+    assert(mode <= TC_PARALLEL_BRICKS);
+    parallelMode = mode;
+    for (byte i = 0; i < ((numColors == 0) ? 1 : numColors); i++)
+    {
+        if (mode == TC_PARALLEL_NONE)
+        {
+            delete nextCube[i];
+            nextCube[i] = NULL;
+        }
+        else if (nextCube[i] == NULL)
+        {
+            nextCube[i] = new TCCube(sc);
+        }
+    }
+}
+
+
+///
+/// \brief Get Parallel Mode
+///
+/// \returns The current parallel mode (e.g. TC_PARALLEL_SLICES).
+/// \see     SetParallelMode
+///
+byte TCAnim::GetParallelMode()
+{
+    return parallelMode;
+}
+
+
+///
+/// \brief Get Last State
+///
+/// \param color The color to get (0 if numColors is 0 or 1, otherwise TC_COLOR_R,
+///              TC_COLOR_G, or TC_COLOR_B).
+///
+/// \returns The voxels of the passed color from before the current tick (see
+///          \ref VoxelOffset).  Only valid while \ref UpdateRegion is being called.
+///
+const byte *TCAnim::GetLastState(byte color)
+{
+    assert(parallelMode != TC_PARALLEL_NONE);
+    assert(color < ((numColors == 0) ? 1 : numColors));
+    return lastData[color];
+}
+
+
+///
+/// \brief Get Next State
+///
+/// \param color The color to get (0 if numColors is 0 or 1, otherwise TC_COLOR_R,
+///              TC_COLOR_G, or TC_COLOR_B).
+///
+/// \returns The voxels of the passed color after the current tick (see \ref
+///          VoxelOffset).  Only valid while \ref UpdateRegion is being called, and each
+///          call may only write the voxels inside its own region.
+///
+byte *TCAnim::GetNextState(byte color)
+{
+    assert(parallelMode != TC_PARALLEL_NONE);
+    assert(color < ((numColors == 0) ? 1 : numColors));
+    return nextData[color];
+}
+
+
+///
+/// \brief Update Parallel
+///
+/// Calls \ref UpdateRegion for every region of the cube on the shared TCThreadPool, and
+/// then copies each yz-plane which changed from the next state into the cube state (so
+/// the other planes keep their generation, see TCCube::GetChangedSlices).
+///
+void TCAnim::UpdateParallel()
+{
+    byte numCubes = (numColors == 0) ? 1 : numColors;
+    for (byte i = 0; i < numCubes; i++)
+    {
+        // The buffers are taken before the regions are updated, since GetData may have to
+        // unpack (or linearize) the voxels of a cube, which is not safe on several threads.
+        lastData[i] = cubeState[i]->GetData();
+        nextData[i] = nextCube[i]->GetData();
+    }
+    size_t numRegions = sc[0];
+    if (parallelMode == TC_PARALLEL_BRICKS)
+    {
+        numRegions = (size_t)((sc[0] + TC_BRICK_MASK) >> TC_BRICK_SHIFT)
+                   * ((sc[1] + TC_BRICK_MASK) >> TC_BRICK_SHIFT)
+                   * ((sc[2] + TC_BRICK_MASK) >> TC_BRICK_SHIFT);
+    }
+    TCThreadPool::GetShared()->Run(UpdateRegions, this, numRegions, 1);
+    // The last state stays valid while the planes are copied, since each plane is only
+    // compared before it is written (and a shared voxel buffer is copied when written).
+    size_t numSlice = (size_t)sc[1] * sc[2];
+    for (byte i = 0; i < numCubes; i++)
+    {
+        for (byte x = 0; x < sc[0]; x++)
+        {
+            if (memcmp(lastData[i] + x * numSlice, nextData[i] + x * numSlice, numSlice))
+            {
+                cubeState[i]->CopyRegion(*nextCube[i], x, 0, 0, x, 0, 0, 1, sc[1], sc[2]);
+            }
+        }
+    }
+}
+
+
+///
+/// \brief Get Region
+///
+/// Gets the bounds of a region of the cube in the current parallel mode.  Slices are
+/// numbered along the x-axis, and bricks with z varying fastest, then y, then x (the
+/// same order as the voxels, so consecutive regions are close together in memory).
+///
+/// \param index The index of the region.
+/// \param lo    Array set to the coordinates of the region's lowest corner.
+/// \param hi    Array set to the coordinates of the region's highest corner.
+///
+void TCAnim::GetRegion(size_t index, byte lo[3], byte hi[3]) const
+{
+    if (parallelMode == TC_PARALLEL_SLICES)
+    {
+        lo[0] = hi[0] = (byte)index;
+        lo[1] = lo[2] = 0;
+        hi[1] = sc[1] - 1;
+        hi[2] = sc[2] - 1;
+        return;
+    }
+    size_t numBricks[3];
+    for (int i = 0; i < 3; i++)
+    {
+        numBricks[i] = (sc[i] + TC_BRICK_MASK) >> TC_BRICK_SHIFT;
+    }
+    size_t brick[3] = { index / (numBricks[1] * numBricks[2]),
+                        index / numBricks[2] % numBricks[1],
+                        index % numBricks[2] };
+    for (int i = 0; i < 3; i++)
+    {
+        size_t last = ((brick[i] + 1) << TC_BRICK_SHIFT) - 1;
+        lo[i] = (byte)(brick[i] << TC_BRICK_SHIFT);
+        hi[i] = (byte)((last < sc[i]) ? last : sc[i] - 1);
+    }
+}
+
+
+///
+/// \brief Update Regions
+///
+/// The task function run by the shared TCThreadPool for each tick in a parallel mode.
+/// The next state of each region starts as a copy of its last state, and is then
+/// passed to \ref UpdateRegion.
+///
+/// \param pAnim A pointer to the TCAnim object.
+/// \param first The index of the first region to update.
+/// \param last  One past the index of the last region to update.
+///
+void TCAnim::UpdateRegions(void *pAnim, size_t first, size_t last)
+{
+    TCAnim *anim = (TCAnim *)pAnim;
+    byte    lo[3], hi[3];
+    for (size_t r = first; r < last; r++)
+    {
+        anim->GetRegion(r, lo, hi);
+        size_t len = hi[2] - lo[2] + 1;
+        for (byte i = 0; i < ((anim->numColors == 0) ? 1 : anim->numColors); i++)
+        {
+            for (int x = lo[0]; x <= hi[0]; x++)
+            {
+                for (int y = lo[1]; y <= hi[1]; y++)
+                {
+                    size_t offset = anim->VoxelOffset(x, y, lo[2]);
+                    memcpy(anim->nextData[i] + offset, anim->lastData[i] + offset, len);
+                }
+            }
+        }
+        anim->UpdateRegion(lo, hi);
     }
 }
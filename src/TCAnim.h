@@ -31,11 +31,26 @@
 
 #include "TCCube.h"
 
+class TCCubeChannel;                ///< Defined in TCCubeChannel.h (see GetColorCube).
+struct TCAnimOps;                   ///< Defined in TCAnimCore.h (see SelectOps).
+class TCEffectChain;                ///< Defined in TCEffectChain.h (see GetEffects).
+
 // Color Definitions
 #define TC_COLOR_R 0                ///< Specifies the red color.
 #define TC_COLOR_G 1                ///< Specifies the green color.
 #define TC_COLOR_B 2                ///< Specifies the blue color.
 
+// Storage Mode Definitions
+#define TC_STORAGE_DEFAULT 0        ///< One byte (or bit, or RGBX word) per voxel.
+#define TC_STORAGE_SPARSE  1        ///< Only the 8x8x8 bricks with a lit voxel are stored.
+
+// Parallel Update Definitions (see SetParallelMode)
+#define TC_PARALLEL_NONE   0        ///< Each tick only calls the Update method.
+#define TC_PARALLEL_SLICES 1        ///< UpdateRegion is called for each yz-plane.
+#define TC_PARALLEL_BRICKS 2        ///< UpdateRegion is called for each 8x8x8 brick.
+
+#define TC_PALETTE_SIZE  256        ///< Number of colors in a palette (see SetPaletteMode).
+
 typedef unsigned long int ulint;    ///< Used to store 24-bit color values.  The long 
                                     ///  keyword is used to specify at least 32-bits.
 
@@ -47,7 +62,9 @@ typedef unsigned long int ulint;    ///< Used to store 24-bit color values.  The
 /// using the SetAnim function declared in main.h.
 ///
 /// \remarks This class uses TCCube objects to hold/provide the animation's state for
-///          each different color.
+///          each different color.  Animations which compute every voxel of each tick can
+///          select a parallel mode (see SetParallelMode), in which case the regions of
+///          the cube are updated on the shared TCThreadPool after each Update call.
 ///
 /// \see SetAnim
 ///
@@ -64,6 +81,8 @@ public:
     unsigned int GetIterations();   // Gets # of times animation has run.
     unsigned int GetTicks();        // Gets # of ticks (animation updates).
     byte         GetNumColors();    // Returns the number of colors in the animation.
+    uint64_t     GetGeneration();   // Gets the generation of the last change to any color.
+    byte         GetParallelMode(); // How each tick is split (e.g. TC_PARALLEL_SLICES).
 
     // Voxel color setting functions:
     void  SetVoxelColor(byte x, byte y, byte z, byte grey);
@@ -86,6 +105,37 @@ public:
     bool ComparePlaneColor(byte plane, byte offset, ulint rgbColorValue);
     
     void Shift(byte plane, sbyte offset);
+    void SetShiftMode(byte mode);
+    void SetStorageMode(byte mode); // Selects the TCCube type used for each color.
+    byte GetStorageMode();
+    TCCubeChannel *GetColorCube();  // Interleaved colors (NULL if not stored that way).
+
+    // Palette functions (only for animations with 1 color, see SetPaletteMode):
+    void            SetPaletteMode(bool enable);    // Each voxel holds a palette index.
+    const uint32_t *GetPalette();                   // The palette (NULL if not enabled).
+    void            SetPaletteColor(byte index, ulint rgbColorValue);
+    ulint           GetPaletteColor(byte index);
+    byte            FindPaletteIndex(ulint rgbColorValue);  // Index of the closest color.
+
+    // Post-processing functions (applied to each published frame, see TCEffectChain):
+    TCEffectChain *GetEffects();    // The animation's effects (created if needed).
+    bool           HasEffects();    // True if any effects are applied.
+
+    // Region functions (see TCCube::FillBox and TCCube::CopyRegion):
+    void FillBox(byte x1, byte y1, byte z1, byte x2, byte y2, byte z2, byte grey);
+    void FillBox(byte x1, byte y1, byte z1, byte x2, byte y2, byte z2,
+                 byte r, byte g, byte b);
+    void FillBox(byte x1, byte y1, byte z1, byte x2, byte y2, byte z2, ulint rgbColorValue);
+    void CopyRegion(byte srcX, byte srcY, byte srcZ, byte dstX, byte dstY, byte dstZ,
+                    byte sizeX, byte sizeY, byte sizeZ, byte op = TC_BLIT_COPY);
+    void Blit(const TCAnim &src, int dstX, int dstY, int dstZ, byte op = TC_BLIT_COPY);
+
+    // Reduction functions (a voxel is lit if any of its colors is non-zero):
+    size_t   CountLitVoxels();
+    uint64_t SumColor(byte color);
+    void     GetPlaneCounts(byte plane, size_t *pCounts);
+    void     GetColumnCounts(byte axis, size_t *pCounts);
+    bool     GetBoundingBox(byte lo[3], byte hi[3]);
 
     /// \brief TCCube object holding the current state of the animation.
     ///
@@ -97,11 +147,76 @@ protected:
     /// Advances the cube state by one step.  This method is defined by any animations
     /// which inheret this base class.
     virtual void Update(){}
+    /// \brief Update Region
+    ///
+    /// Computes the next state of the voxels from lo to hi (inclusive) if a parallel
+    /// mode is selected, and is called for every region of the cube after Update.  The
+    /// regions are updated on several threads at once, so this may only read the state
+    /// from before the tick (see GetLastState), and write the voxels of its own region
+    /// in the next state (see GetNextState), which starts as a copy of the last state.
+    virtual void UpdateRegion(const byte /*lo*/[3], const byte /*hi*/[3])
+        { }
+    /// \brief Finish Update
+    ///
+    /// Called on the ticking thread once every region of a tick was updated and the
+    /// next state was stored (in a parallel mode), so an animation can combine any
+    /// results its regions left behind.
+    virtual void FinishUpdate(){}
+
+    // Parallel update methods (see UpdateRegion):
+    void        SetParallelMode(byte mode);     // Selects how each tick is split.
+    const byte *GetLastState(byte color);       // Voxels before the tick (read only).
+    byte       *GetNextState(byte color);       // Voxels after the tick.
+    // Converts a voxel coordinate into an offset into the two buffers above.
+    size_t VoxelOffset(byte x, byte y, byte z) const
+        { return ((size_t)x * sc[1] + y) * sc[2] + z; }
+
     byte         sc[3],         ///< Number of cube voxels in each dimension.
-                 numColors;     ///< Number of colors in the current animation.
+                 numColors,     ///< Number of colors in the current animation.
+                 storageMode;   ///< How the cube state is stored (e.g. TC_STORAGE_SPARSE).
     unsigned int iterations;    ///< Number of times the animation has run.
 private:
+    // Returns a cube lit wherever any color is lit (delete it unless it is cubeState[0]).
+    TCCube *GetLitCube();
+    // Creates the cubeState object of each color for the passed storage mode.
+    void AllocateCubes(byte mode);
+    // Returns the color methods compiled for the passed number of colors.
+    static const TCAnimOps *SelectOps(byte colors);
+    // Updates every region of the cube in parallel, and stores the next state.
+    void UpdateParallel();
+    // Sets lo and hi to the bounds of the region with the passed index.
+    void GetRegion(size_t index, byte lo[3], byte hi[3]) const;
+    // The task function which updates a range of regions (passed the animation).
+    static void UpdateRegions(void *pAnim, size_t first, size_t last);
+
+    /// \brief The red cubeState object, if the colors share one interleaved buffer.
+    ///
+    /// Used by the color methods to read or write a whole voxel color at once.  NULL if
+    /// the animation does not have 3 colors, or uses the TC_STORAGE_SPARSE mode.
+    TCCubeChannel *colorCube;
+
+    /// \brief The color methods for the animation's number of colors (see TCAnimCore).
+    const TCAnimOps *ops;
+
+    /// \brief The 24-bit color of each palette index, if the palette mode is enabled.
+    ///
+    /// NULL unless \ref SetPaletteMode was called to enable it, in which case the voxels
+    /// of cubeState[0] hold indices into this array instead of brightness values.
+    uint32_t *palette;
+    /// \brief The generation of the last change made to the palette (or palette mode).
+    ///
+    /// Taken from TCCube::NewGeneration, so it is included in \ref GetGeneration.
+    uint64_t  paletteGen;
+
+    /// \brief The post-processing effects of the animation (NULL until GetEffects).
+    TCEffectChain *effects;
+
     unsigned int ticks;         ///< Number of times the animation's state was updated.
+
+    byte        parallelMode;   ///< How each tick is split (e.g. TC_PARALLEL_BRICKS).
+    TCCube     *nextCube[3];    ///< The next state of each color (in a parallel mode).
+    const byte *lastData[3];    ///< The voxels of each color before the current tick.
+    byte       *nextData[3];    ///< The voxels of each nextCube object.
 };
 
 
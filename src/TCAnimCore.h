@@ -0,0 +1,417 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *                          TCAnimCore Template Header File                            *
+ *                                      TRICLYSM                                       *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  This file contains the definition and implementation of the TCAnimCore template,   *
+ *  which provides the color methods of the TCAnim class for one number of colors.     *
+ *  Each color mode (0, 1, or 3 colors) is compiled separately, so the methods do not  *
+ *  have to check the number of colors of the animation every time they are called.    *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  Copyright (C) 2011 Brandon Castellano, Ryan Mantha. All rights reserved.           *
+ *  Triclysm is provided under the BSD-2-Clause license. This program uses the SDL     *
+ *  (Simple DirectMedia Layer) library, and the Lua scripting language. See the        *
+ *  included LICENSE file or <http://www.triclysm.com/> for more details.              *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+///
+/// \file  TCAnimCore.h
+/// \brief This file contains the definition and implementation of the TCAnimCore
+///        template, and the TCAnimOps table used by the TCAnim class.
+///
+
+#pragma once
+#ifndef TC_ANIM_CORE_
+#define TC_ANIM_CORE_
+
+#include "TCAnim.h"
+#include "TCCubeChannel.h"      // Used for the interleaved colors of RGB animations.
+#include <cstdlib>              // Used for pointer NULL define value.
+
+
+///
+/// \brief Triclysm Animation Color Method Table
+///
+/// Holds the TCAnimCore methods for one number of colors.  Each TCAnim object selects
+/// the table for its number of colors once (when it is created), and calls its color
+/// methods through it.
+///
+struct TCAnimOps
+{
+    void  (*SetVoxelColor)(TCAnim &anim, byte x, byte y, byte z, byte r, byte g, byte b);
+    void  (*SetVoxelGrey)(TCAnim &anim, byte x, byte y, byte z, byte grey);
+    ulint (*GetVoxelColor)(TCAnim &anim, byte x, byte y, byte z);
+
+    void (*SetColumnColor)(TCAnim &anim, byte axis, byte dim1, byte dim2,
+                           byte r, byte g, byte b);
+    void (*SetColumnGrey)(TCAnim &anim, byte axis, byte dim1, byte dim2, byte grey);
+    bool (*CompareColumnColor)(TCAnim &anim, byte axis, byte dim1, byte dim2,
+                               byte r, byte g, byte b);
+    bool (*CompareColumnGrey)(TCAnim &anim, byte axis, byte dim1, byte dim2, byte grey);
+
+    void (*SetPlaneColor)(TCAnim &anim, byte plane, byte offset, byte r, byte g, byte b);
+    void (*SetPlaneGrey)(TCAnim &anim, byte plane, byte offset, byte grey);
+    bool (*ComparePlaneColor)(TCAnim &anim, byte plane, byte offset,
+                              byte r, byte g, byte b);
+    bool (*ComparePlaneGrey)(TCAnim &anim, byte plane, byte offset, byte grey);
+
+    void (*Shift)(TCAnim &anim, byte plane, sbyte offset);
+
+    void (*FillBoxColor)(TCAnim &anim, byte x1, byte y1, byte z1,
+                         byte x2, byte y2, byte z2, byte r, byte g, byte b);
+    void (*FillBoxGrey)(TCAnim &anim, byte x1, byte y1, byte z1,
+                        byte x2, byte y2, byte z2, byte grey);
+};
+
+
+///
+/// \brief Triclysm Animation Color Core
+///
+/// Implements the color methods of the TCAnim class for animations with NumColors colors
+/// (0, 1, or 3).  Since NumColors is a constant, every check of the number of colors
+/// below is resolved when the template is compiled, and each method only contains the
+/// code for its own color mode.
+///
+/// \remarks Code which already knows the number of colors of an animation (e.g. the Lua
+///          functions registered for each color mode) can call these methods directly,
+///          instead of going through the TCAnim object's \ref TCAnimOps table.
+///
+template <byte NumColors>
+class TCAnimCore
+{
+  public:
+    static const TCAnimOps ops;     ///< Table holding each of the methods below.
+
+    /// \brief Converts a grey value to the state stored for this color mode.
+    static byte GreyState(byte grey)
+    {
+        return (NumColors == 0) ? (grey != 0x00) : grey;
+    }
+
+    /// \brief Converts an RGB color to the state stored for this color mode.
+    static byte ColorState(byte r, byte g, byte b)
+    {
+        return (NumColors == 0) ? (r != 0x00 || g != 0x00 || b != 0x00)
+                                : (byte)((r + g + b) / 3);
+    }
+
+    /// \brief Packs an RGB color into a 24-bit color value.
+    static uint32_t PackColor(byte r, byte g, byte b)
+    {
+        return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+    }
+
+    // Each part of a 24-bit color value (e.g. 0xFF8000):
+    static byte Red(ulint rgbColorValue)   { return (byte)((rgbColorValue >> 16) & 0xFF); }
+    static byte Green(ulint rgbColorValue) { return (byte)((rgbColorValue >>  8) & 0xFF); }
+    static byte Blue(ulint rgbColorValue)  { return (byte)( rgbColorValue        & 0xFF); }
+
+    // The methods below take the same arguments as the TCAnim methods of the same name
+    // (the "Grey" methods are the greyscale overloads), after the animation itself.
+
+    static void SetVoxelColor(TCAnim &anim, byte x, byte y, byte z, byte r, byte g, byte b)
+    {
+        if (NumColors != 3)
+        {
+            anim.cubeState[0]->SetVoxelState(x, y, z, ColorState(r, g, b));
+            return;
+        }
+        TCCubeChannel *colorCube = anim.GetColorCube();
+        if (colorCube != NULL)
+        {
+            colorCube->SetVoxelColor(x, y, z, PackColor(r, g, b));
+            return;
+        }
+        anim.cubeState[TC_COLOR_R]->SetVoxelState(x, y, z, r);
+        anim.cubeState[TC_COLOR_G]->SetVoxelState(x, y, z, g);
+        anim.cubeState[TC_COLOR_B]->SetVoxelState(x, y, z, b);
+    }
+
+    static void SetVoxelColor(TCAnim &anim, byte x, byte y, byte z, ulint rgbColorValue)
+    {
+        SetVoxelColor(anim, x, y, z, Red(rgbColorValue), Green(rgbColorValue),
+                      Blue(rgbColorValue));
+    }
+
+    static void SetVoxelGrey(TCAnim &anim, byte x, byte y, byte z, byte grey)
+    {
+        if (NumColors == 3) SetVoxelColor(anim, x, y, z, grey, grey, grey);
+        else anim.cubeState[0]->SetVoxelState(x, y, z, GreyState(grey));
+    }
+
+    static ulint GetVoxelColor(TCAnim &anim, byte x, byte y, byte z)
+    {
+        if (NumColors == 0)
+        {
+            return (anim.cubeState[0]->GetVoxelState(x, y, z) == 0x00) ? 0x00 : 0x01;
+        }
+        if (NumColors == 1)
+        {
+            ulint voxelValue = anim.cubeState[0]->GetVoxelState(x, y, z);
+            return voxelValue | (voxelValue << 8) | (voxelValue << 16);
+        }
+        TCCubeChannel *colorCube = anim.GetColorCube();
+        if (colorCube != NULL) return colorCube->GetVoxelColor(x, y, z);
+        return ((ulint)anim.cubeState[TC_COLOR_R]->GetVoxelState(x, y, z) << 16) |
+               ((ulint)anim.cubeState[TC_COLOR_G]->GetVoxelState(x, y, z) <<  8) |
+                (ulint)anim.cubeState[TC_COLOR_B]->GetVoxelState(x, y, z);
+    }
+
+    static void SetColumnColor(TCAnim &anim, byte axis, byte dim1, byte dim2,
+                               byte r, byte g, byte b)
+    {
+        if (NumColors != 3)
+        {
+            anim.cubeState[0]->SetColumnState(axis, dim1, dim2, ColorState(r, g, b));
+            return;
+        }
+        TCCubeChannel *colorCube = anim.GetColorCube();
+        if (colorCube != NULL)
+        {
+            colorCube->SetColumnColor(axis, dim1, dim2, PackColor(r, g, b));
+            return;
+        }
+        anim.cubeState[TC_COLOR_R]->SetColumnState(axis, dim1, dim2, r);
+        anim.cubeState[TC_COLOR_G]->SetColumnState(axis, dim1, dim2, g);
+        anim.cubeState[TC_COLOR_B]->SetColumnState(axis, dim1, dim2, b);
+    }
+
+    static void SetColumnColor(TCAnim &anim, byte axis, byte dim1, byte dim2,
+                               ulint rgbColorValue)
+    {
+        SetColumnColor(anim, axis, dim1, dim2, Red(rgbColorValue), Green(rgbColorValue),
+                       Blue(rgbColorValue));
+    }
+
+    static void SetColumnGrey(TCAnim &anim, byte axis, byte dim1, byte dim2, byte grey)
+    {
+        if (NumColors == 3) SetColumnColor(anim, axis, dim1, dim2, grey, grey, grey);
+        else anim.cubeState[0]->SetColumnState(axis, dim1, dim2, GreyState(grey));
+    }
+
+    static bool CompareColumnColor(TCAnim &anim, byte axis, byte dim1, byte dim2,
+                                   byte r, byte g, byte b)
+    {
+        if (NumColors != 3)
+        {
+            return anim.cubeState[0]->GetColumnState(axis, dim1, dim2, ColorState(r, g, b));
+        }
+        TCCubeChannel *colorCube = anim.GetColorCube();
+        if (colorCube != NULL)
+        {
+            return colorCube->CompareColumnColor(axis, dim1, dim2, PackColor(r, g, b));
+        }
+        return anim.cubeState[TC_COLOR_R]->GetColumnState(axis, dim1, dim2, r) &&
+               anim.cubeState[TC_COLOR_G]->GetColumnState(axis, dim1, dim2, g) &&
+               anim.cubeState[TC_COLOR_B]->GetColumnState(axis, dim1, dim2, b);
+    }
+
+    static bool CompareColumnColor(TCAnim &anim, byte axis, byte dim1, byte dim2,
+                                   ulint rgbColorValue)
+    {
+        return CompareColumnColor(anim, axis, dim1, dim2, Red(rgbColorValue),
+                                  Green(rgbColorValue), Blue(rgbColorValue));
+    }
+
+    static bool CompareColumnGrey(TCAnim &anim, byte axis, byte dim1, byte dim2, byte grey)
+    {
+        if (NumColors == 3) return CompareColumnColor(anim, axis, dim1, dim2, grey, grey, grey);
+        return anim.cubeState[0]->GetColumnState(axis, dim1, dim2, GreyState(grey));
+    }
+
+    static void SetPlaneColor(TCAnim &anim, byte plane, byte offset, byte r, byte g, byte b)
+    {
+        if (NumColors != 3)
+        {
+            anim.cubeState[0]->SetPlaneState(plane, offset, ColorState(r, g, b));
+            return;
+        }
+        TCCubeChannel *colorCube = anim.GetColorCube();
+        if (colorCube != NULL)
+        {
+            colorCube->SetPlaneColor(plane, offset, PackColor(r, g, b));
+            return;
+        }
+        anim.cubeState[TC_COLOR_R]->SetPlaneState(plane, offset, r);
+        anim.cubeState[TC_COLOR_G]->SetPlaneState(plane, offset, g);
+        anim.cubeState[TC_COLOR_B]->SetPlaneState(plane, offset, b);
+    }
+
+    static void SetPlaneColor(TCAnim &anim, byte plane, byte offset, ulint rgbColorValue)
+    {
+        SetPlaneColor(anim, plane, offset, Red(rgbColorValue), Green(rgbColorValue),
+                      Blue(rgbColorValue));
+    }
+
+    static void SetPlaneGrey(TCAnim &anim, byte plane, byte offset, byte grey)
+    {
+        if (NumColors == 3) SetPlaneColor(anim, plane, offset, grey, grey, grey);
+        else anim.cubeState[0]->SetPlaneState(plane, offset, GreyState(grey));
+    }
+
+    static bool ComparePlaneColor(TCAnim &anim, byte plane, byte offset,
+                                  byte r, byte g, byte b)
+    {
+        if (NumColors != 3)
+        {
+            return anim.cubeState[0]->GetPlaneState(plane, offset, ColorState(r, g, b));
+        }
+        TCCubeChannel *colorCube = anim.GetColorCube();
+        if (colorCube != NULL)
+        {
+            return colorCube->ComparePlaneColor(plane, offset, PackColor(r, g, b));
+        }
+        return anim.cubeState[TC_COLOR_R]->GetPlaneState(plane, offset, r) &&
+               anim.cubeState[TC_COLOR_G]->GetPlaneState(plane, offset, g) &&
+               anim.cubeState[TC_COLOR_B]->GetPlaneState(plane, offset, b);
+    }
+
+    static bool ComparePlaneColor(TCAnim &anim, byte plane, byte offset,
+                                  ulint rgbColorValue)
+    {
+        return ComparePlaneColor(anim, plane, offset, Red(rgbColorValue),
+                                 Green(rgbColorValue), Blue(rgbColorValue));
+    }
+
+    static bool ComparePlaneGrey(TCAnim &anim, byte plane, byte offset, byte grey)
+    {
+        if (NumColors == 3) return ComparePlaneColor(anim, plane, offset, grey, grey, grey);
+        return anim.cubeState[0]->GetPlaneState(plane, offset, GreyState(grey));
+    }
+
+    static void Shift(TCAnim &anim, byte plane, sbyte offset)
+    {
+        if (NumColors != 3)
+        {
+            anim.cubeState[0]->Shift(plane, offset);
+            return;
+        }
+        TCCubeChannel *colorCube = anim.GetColorCube();
+        if (colorCube != NULL)
+        {
+            colorCube->ShiftColors(plane, offset);
+            return;
+        }
+        anim.cubeState[TC_COLOR_R]->Shift(plane, offset);
+        anim.cubeState[TC_COLOR_G]->Shift(plane, offset);
+        anim.cubeState[TC_COLOR_B]->Shift(plane, offset);
+    }
+
+    static void FillBoxColor(TCAnim &anim, byte x1, byte y1, byte z1,
+                             byte x2, byte y2, byte z2, byte r, byte g, byte b)
+    {
+        if (NumColors != 3)
+        {
+            anim.cubeState[0]->FillBox(x1, y1, z1, x2, y2, z2, ColorState(r, g, b));
+            return;
+        }
+        TCCubeChannel *colorCube = anim.GetColorCube();
+        if (colorCube != NULL)
+        {
+            colorCube->FillColorBox(x1, y1, z1, x2, y2, z2, PackColor(r, g, b));
+            return;
+        }
+        anim.cubeState[TC_COLOR_R]->FillBox(x1, y1, z1, x2, y2, z2, r);
+        anim.cubeState[TC_COLOR_G]->FillBox(x1, y1, z1, x2, y2, z2, g);
+        anim.cubeState[TC_COLOR_B]->FillBox(x1, y1, z1, x2, y2, z2, b);
+    }
+
+    static void FillBoxColor(TCAnim &anim, byte x1, byte y1, byte z1,
+                             byte x2, byte y2, byte z2, ulint rgbColorValue)
+    {
+        FillBoxColor(anim, x1, y1, z1, x2, y2, z2, Red(rgbColorValue),
+                     Green(rgbColorValue), Blue(rgbColorValue));
+    }
+
+    static void FillBoxGrey(TCAnim &anim, byte x1, byte y1, byte z1,
+                            byte x2, byte y2, byte z2, byte grey)
+    {
+        if (NumColors == 3) FillBoxColor(anim, x1, y1, z1, x2, y2, z2, grey, grey, grey);
+        else anim.cubeState[0]->FillBox(x1, y1, z1, x2, y2, z2, GreyState(grey));
+    }
+};
+
+
+template <byte NumColors>
+const TCAnimOps TCAnimCore<NumColors>::ops =
+{
+    &TCAnimCore<NumColors>::SetVoxelColor,
+    &TCAnimCore<NumColors>::SetVoxelGrey,
+    &TCAnimCore<NumColors>::GetVoxelColor,
+    &TCAnimCore<NumColors>::SetColumnColor,
+    &TCAnimCore<NumColors>::SetColumnGrey,
+    &TCAnimCore<NumColors>::CompareColumnColor,
+    &TCAnimCore<NumColors>::CompareColumnGrey,
+    &TCAnimCore<NumColors>::SetPlaneColor,
+    &TCAnimCore<NumColors>::SetPlaneGrey,
+    &TCAnimCore<NumColors>::ComparePlaneColor,
+    &TCAnimCore<NumColors>::ComparePlaneGrey,
+    &TCAnimCore<NumColors>::Shift,
+    &TCAnimCore<NumColors>::FillBoxColor,
+    &TCAnimCore<NumColors>::FillBoxGrey
+};
+
+
+///
+/// \brief Triclysm Animation Palette Color Core
+///
+/// Implements the color methods of the TCAnim class for animations with 1 color in the
+/// palette mode (see TCAnim::SetPaletteMode).  The greyscale methods are inherited, since
+/// the grey value passed to them is stored as the palette index, while the RGB methods
+/// store the index of the closest palette color.
+///
+class TCAnimPalette : public TCAnimCore<1>
+{
+  public:
+    static const TCAnimOps ops;     ///< Table holding each of the methods (see TCAnim.cpp).
+
+    static void SetVoxelColor(TCAnim &anim, byte x, byte y, byte z, byte r, byte g, byte b)
+    {
+        SetVoxelGrey(anim, x, y, z, anim.FindPaletteIndex(PackColor(r, g, b)));
+    }
+
+    static ulint GetVoxelColor(TCAnim &anim, byte x, byte y, byte z)
+    {
+        return anim.GetPalette()[anim.cubeState[0]->GetVoxelState(x, y, z)];
+    }
+
+    static void SetColumnColor(TCAnim &anim, byte axis, byte dim1, byte dim2,
+                               byte r, byte g, byte b)
+    {
+        SetColumnGrey(anim, axis, dim1, dim2, anim.FindPaletteIndex(PackColor(r, g, b)));
+    }
+
+    static bool CompareColumnColor(TCAnim &anim, byte axis, byte dim1, byte dim2,
+                                   byte r, byte g, byte b)
+    {
+        return CompareColumnGrey(anim, axis, dim1, dim2,
+                                 anim.FindPaletteIndex(PackColor(r, g, b)));
+    }
+
+    static void SetPlaneColor(TCAnim &anim, byte plane, byte offset, byte r, byte g, byte b)
+    {
+        SetPlaneGrey(anim, plane, offset, anim.FindPaletteIndex(PackColor(r, g, b)));
+    }
+
+    static bool ComparePlaneColor(TCAnim &anim, byte plane, byte offset,
+                                  byte r, byte g, byte b)
+    {
+        return ComparePlaneGrey(anim, plane, offset,
+                                anim.FindPaletteIndex(PackColor(r, g, b)));
+    }
+
+    static void FillBoxColor(TCAnim &anim, byte x1, byte y1, byte z1,
+                             byte x2, byte y2, byte z2, byte r, byte g, byte b)
+    {
+        FillBoxGrey(anim, x1, y1, z1, x2, y2, z2,
+                    anim.FindPaletteIndex(PackColor(r, g, b)));
+    }
+};
+
+
+#endif
@@ -29,9 +29,12 @@
 
 #include <lua.hpp>          // The Lua C++ header file.
 #include <string>           // String object library.
+#include <vector>           // Used to hold the column counts.
+#include <algorithm>        // Used for std::swap.
 #include "main.h"           // Used to access the global cube size.
 #include "console.h"        // Used to print error messages to the console.
 #include "TCAnim.h"         // The base TCAnim object header.
+#include "TCAnimCore.h"     // Color methods for each number of colors.
 #include "TCAnimLua.h"      // Definition of the TCAnimLua class.
 
 
@@ -47,7 +50,9 @@
 ///
 namespace TC_Lua_Functions
 {
-    TCAnimLua *currAnim;    // Pointer to the currently registered TCAnimLua object.
+    // Pointer to the currently registered TCAnimLua object.  Each thread has its own, so
+    // an animation can be loaded by the console while another is ticked.
+    __thread TCAnimLua *currAnim;
 
     ///
     /// \brief Common Lua Functions
@@ -66,6 +71,140 @@ namespace TC_Lua_Functions
             return 0;
         }
 
+        int SetShiftMode(lua_State *L)
+        {
+            int argc = lua_gettop(L);
+            if (currAnim != NULL && argc == 1)
+            {
+                byte mode = (byte)lua_tointeger(L, 1);
+                if (mode == TC_SHIFT_LINEAR || mode == TC_SHIFT_RING)
+                {
+                    currAnim->SetShiftMode(mode);
+                }
+            }
+            return 0;
+        }
+
+        int SetStorageMode(lua_State *L)
+        {
+            int argc = lua_gettop(L);
+            if (currAnim != NULL && argc == 1)
+            {
+                byte mode = (byte)lua_tointeger(L, 1);
+                if (mode == TC_STORAGE_DEFAULT || mode == TC_STORAGE_SPARSE)
+                {
+                    currAnim->SetStorageMode(mode);
+                }
+            }
+            return 0;
+        }
+
+        int CopyRegion(lua_State *L)
+        {
+            int argc = lua_gettop(L);
+            if (currAnim != NULL && (argc == 9 || argc == 10))
+            {
+                byte op = (argc == 10) ? (byte)lua_tointeger(L, 10) : TC_BLIT_COPY;
+                if (op <= TC_BLIT_XOR)
+                {
+                    currAnim->CopyRegion(
+                        (byte)lua_tointeger(L, 1), (byte)lua_tointeger(L, 2),
+                        (byte)lua_tointeger(L, 3), (byte)lua_tointeger(L, 4),
+                        (byte)lua_tointeger(L, 5), (byte)lua_tointeger(L, 6),
+                        (byte)lua_tointeger(L, 7), (byte)lua_tointeger(L, 8),
+                        (byte)lua_tointeger(L, 9), op );
+                }
+            }
+            return 0;
+        }
+
+        int CountLitVoxels(lua_State *L)
+        {
+            int argc = lua_gettop(L);
+            if (currAnim != NULL && argc == 0)
+            {
+                lua_pushinteger(L, (lua_Integer)currAnim->CountLitVoxels());
+                return 1;
+            }
+            return 0;
+        }
+
+        int SumColor(lua_State *L)
+        {
+            int argc = lua_gettop(L);
+            if (currAnim != NULL && argc <= 1)
+            {
+                byte color = (argc == 1) ? (byte)lua_tointeger(L, 1) : 0;
+                lua_pushnumber(L, (lua_Number)currAnim->SumColor(color));
+                return 1;
+            }
+            return 0;
+        }
+
+        int GetPlaneCounts(lua_State *L)
+        {
+            int argc = lua_gettop(L);
+            if (currAnim != NULL && argc == 1)
+            {
+                byte plane = (byte)lua_tointeger(L, 1);
+                if (plane > TC_XY_PLANE) return 0;
+                // The planes are indexed by their offset (starting at 0, like coordinates).
+                byte   numPlanes = currAnim->cubeState[0]->GetSize(plane);
+                size_t counts[256];
+                currAnim->GetPlaneCounts(plane, counts);
+                lua_createtable(L, numPlanes, 1);
+                for (int i = 0; i < numPlanes; i++)
+                {
+                    lua_pushinteger(L, (lua_Integer)counts[i]);
+                    lua_rawseti(L, -2, i);
+                }
+                return 1;
+            }
+            return 0;
+        }
+
+        int GetColumnCounts(lua_State *L)
+        {
+            int argc = lua_gettop(L);
+            if (currAnim != NULL && argc == 1)
+            {
+                byte axis = (byte)lua_tointeger(L, 1);
+                if (axis > TC_Z_AXIS) return 0;
+                // The columns are indexed as counts[dim1][dim2] (like SetColumnState).
+                byte size1 = currAnim->cubeState[0]->GetSize(TC_OAXIS[axis][0]),
+                     size2 = currAnim->cubeState[0]->GetSize(TC_OAXIS[axis][1]);
+                if (axis == TC_Y_AXIS) std::swap(size1, size2);
+                std::vector<size_t> counts((size_t)size1 * size2);
+                currAnim->GetColumnCounts(axis, &counts[0]);
+                lua_createtable(L, size1, 1);
+                for (int i = 0; i < size1; i++)
+                {
+                    lua_createtable(L, size2, 1);
+                    for (int j = 0; j < size2; j++)
+                    {
+                        lua_pushinteger(L, (lua_Integer)counts[i * size2 + j]);
+                        lua_rawseti(L, -2, j);
+                    }
+                    lua_rawseti(L, -2, i);
+                }
+                return 1;
+            }
+            return 0;
+        }
+
+        int GetBoundingBox(lua_State *L)
+        {
+            int argc = lua_gettop(L);
+            byte lo[3], hi[3];
+            if (currAnim != NULL && argc == 0 && currAnim->GetBoundingBox(lo, hi))
+            {
+                for (int i = 0; i < 3; i++) lua_pushinteger(L, lo[i]);
+                for (int i = 0; i < 3; i++) lua_pushinteger(L, hi[i]);
+                return 6;
+            }
+            return 0;
+        }
+
         int DoneIteration(lua_State *L)
         {
             int argc = lua_gettop(L);
@@ -81,16 +220,26 @@ namespace TC_Lua_Functions
             int argc = lua_gettop(L);
             if (argc == 1)
             {
-                WriteOutput(lua_tostring(L, 1));
+                // Update runs outside of the console thread (on the animation thread, or
+                // a TCSlotEngine worker), so the output is posted to the console.
+                PostOutput(lua_tostring(L, 1));
             }
             return 0;
         }
     
         void RegisterCommands(lua_State *L)
         {
-            lua_register(L, "Shift",         Shift);
-            lua_register(L, "DoneIteration", DoneIteration);
-            lua_register(L, "WriteConsole",  WriteConsole);
+            lua_register(L, "Shift",           Shift);
+            lua_register(L, "SetShiftMode",    SetShiftMode);
+            lua_register(L, "SetStorageMode",  SetStorageMode);
+            lua_register(L, "CopyRegion",      CopyRegion);
+            lua_register(L, "CountLitVoxels",  CountLitVoxels);
+            lua_register(L, "SumColor",        SumColor);
+            lua_register(L, "GetPlaneCounts",  GetPlaneCounts);
+            lua_register(L, "GetColumnCounts", GetColumnCounts);
+            lua_register(L, "GetBoundingBox",  GetBoundingBox);
+            lua_register(L, "DoneIteration",   DoneIteration);
+            lua_register(L, "WriteConsole",    WriteConsole);
         }
     }
     
@@ -195,6 +344,20 @@ namespace TC_Lua_Functions
             }
         }
 
+        int FillBox(lua_State *L)
+        {
+            int argc = lua_gettop(L);
+            if (currAnim != NULL && argc == 7)
+            {
+                currAnim->cubeState[0]->FillBox(
+                    (byte)lua_tointeger(L, 1), (byte)lua_tointeger(L, 2),
+                    (byte)lua_tointeger(L, 3), (byte)lua_tointeger(L, 4),
+                    (byte)lua_tointeger(L, 5), (byte)lua_tointeger(L, 6),
+                    ((lua_toboolean(L, 7)) ? true : false) );
+            }
+            return 0;
+        }
+
         void RegisterCommands(lua_State *L)
         {
             lua_register(L, "SetVoxelState",  SetVoxelState);
@@ -203,6 +366,7 @@ namespace TC_Lua_Functions
             lua_register(L, "GetColumnState", GetColumnState);
             lua_register(L, "SetPlaneState",  SetPlaneState);
             lua_register(L, "GetPlaneState",  GetPlaneState);
+            lua_register(L, "FillBox",        FillBox);
         }
     }
     
@@ -214,12 +378,14 @@ namespace TC_Lua_Functions
     ///
     namespace Greyscale
     {
+        typedef TCAnimCore<1> Core;     ///< The color methods for one color.
+
         int SetVoxelValue(lua_State *L)
         {
             int argc = lua_gettop(L);
             if (currAnim != NULL && argc == 4)
             {
-                currAnim->SetVoxelColor(
+                Core::SetVoxelGrey(*currAnim,
                     (byte)lua_tointeger(L, 1),
                     (byte)lua_tointeger(L, 2),
                     (byte)lua_tointeger(L, 3),
@@ -250,7 +416,7 @@ namespace TC_Lua_Functions
             int argc = lua_gettop(L);
             if (currAnim != NULL && argc == 4)
             {
-                currAnim->SetColumnColor(
+                Core::SetColumnGrey(*currAnim,
                     (byte)lua_tointeger(L, 1),
                     (byte)lua_tointeger(L, 2),
                     (byte)lua_tointeger(L, 3),
@@ -264,7 +430,7 @@ namespace TC_Lua_Functions
             int argc = lua_gettop(L);
             if (currAnim != NULL && argc == 4)
             {
-                lua_pushboolean(L, currAnim->CompareColumnColor(
+                lua_pushboolean(L, Core::CompareColumnGrey(*currAnim,
                     (byte)lua_tointeger(L, 1),
                     (byte)lua_tointeger(L, 2),
                     (byte)lua_tointeger(L, 3),
@@ -279,7 +445,7 @@ namespace TC_Lua_Functions
             int argc = lua_gettop(L);
             if (currAnim != NULL && argc == 3)
             {
-                currAnim->SetPlaneColor(
+                Core::SetPlaneGrey(*currAnim,
                     (byte)lua_tointeger(L, 1),
                     (byte)lua_tointeger(L, 2),
                     (byte)lua_tointeger(L, 3));
@@ -292,7 +458,7 @@ namespace TC_Lua_Functions
             int argc = lua_gettop(L);
             if (currAnim != NULL && argc == 3)
             {
-                lua_pushboolean(L, currAnim->ComparePlaneColor(
+                lua_pushboolean(L, Core::ComparePlaneGrey(*currAnim,
                     (byte)lua_tointeger(L, 1),
                     (byte)lua_tointeger(L, 2),
                     (byte)lua_tointeger(L, 3) ));
@@ -301,14 +467,79 @@ namespace TC_Lua_Functions
             return 0;
         }
 
+        int FillBoxValue(lua_State *L)
+        {
+            int argc = lua_gettop(L);
+            if (currAnim != NULL && argc == 7)
+            {
+                Core::FillBoxGrey(*currAnim,
+                    (byte)lua_tointeger(L, 1), (byte)lua_tointeger(L, 2),
+                    (byte)lua_tointeger(L, 3), (byte)lua_tointeger(L, 4),
+                    (byte)lua_tointeger(L, 5), (byte)lua_tointeger(L, 6),
+                    (byte)lua_tointeger(L, 7) );
+            }
+            return 0;
+        }
+
+        int SetPaletteMode(lua_State *L)
+        {
+            int argc = lua_gettop(L);
+            if (currAnim != NULL && argc == 1)
+            {
+                currAnim->SetPaletteMode(lua_toboolean(L, 1) != 0);
+            }
+            return 0;
+        }
+
+        int SetPaletteColor(lua_State *L)
+        {
+            int argc = lua_gettop(L);
+            if (currAnim != NULL && currAnim->GetPalette() != NULL)
+            {
+                switch (argc)
+                {
+                    case 2:     // index, RGB
+                        currAnim->SetPaletteColor(
+                            (byte)lua_tointeger(L, 1),
+                            (ulint)lua_tointeger(L, 2) );
+                        break;
+                    case 4:     // index, r, g, b
+                        currAnim->SetPaletteColor(
+                            (byte)lua_tointeger(L, 1),
+                            ((ulint)(byte)lua_tointeger(L, 2) << 16) |
+                            ((ulint)(byte)lua_tointeger(L, 3) <<  8) |
+                             (ulint)(byte)lua_tointeger(L, 4) );
+                        break;
+                    default:
+                        break;
+                }
+            }
+            return 0;
+        }
+
+        int GetPaletteColor(lua_State *L)
+        {
+            int argc = lua_gettop(L);
+            if (currAnim != NULL && currAnim->GetPalette() != NULL && argc == 1)
+            {
+                lua_pushinteger(L, currAnim->GetPaletteColor((byte)lua_tointeger(L, 1)));
+                return 1;
+            }
+            return 0;
+        }
+
         void RegisterCommands(lua_State *L)
         {
             lua_register(L, "SetVoxelValue",      SetVoxelValue);
             lua_register(L, "GetVoxelValue",      GetVoxelValue);
-            lua_register(L, "SetColumnValue",     GetVoxelValue);
+            lua_register(L, "SetColumnValue",     SetColumnValue);
             lua_register(L, "CompareColumnValue", CompareColumnValue);
             lua_register(L, "SetPlaneValue",      SetPlaneValue);
             lua_register(L, "ComparePlaneValue",  ComparePlaneValue);
+            lua_register(L, "FillBoxValue",       FillBoxValue);
+            lua_register(L, "SetPaletteMode",     SetPaletteMode);
+            lua_register(L, "SetPaletteColor",    SetPaletteColor);
+            lua_register(L, "GetPaletteColor",    GetPaletteColor);
         }
     }
     
@@ -320,6 +551,8 @@ namespace TC_Lua_Functions
     ///
     namespace RGB
     {
+        typedef TCAnimCore<3> Core;     ///< The color methods for three colors.
+
         int SetVoxelColor(lua_State *L)
         {
             int argc = lua_gettop(L);
@@ -328,14 +561,14 @@ namespace TC_Lua_Functions
                 switch (argc)
                 {
                     case 4:     // x, y, z, RGB
-                        currAnim->SetVoxelColor(
+                        Core::SetVoxelColor(*currAnim,
                             (byte)lua_tointeger(L, 1),
                             (byte)lua_tointeger(L, 2),
                             (byte)lua_tointeger(L, 3),
                             (ulint)lua_tointeger(L, 4) );
                         break;
                     case 6:     // x, y, z, r, g, b
-                        currAnim->SetVoxelColor(
+                        Core::SetVoxelColor(*currAnim,
                             (byte)lua_tointeger(L, 1),
                             (byte)lua_tointeger(L, 2),
                             (byte)lua_tointeger(L, 3),
@@ -361,7 +594,7 @@ namespace TC_Lua_Functions
             {
                 if (mode == -2)
                 {
-                    lua_pushinteger(L, currAnim->GetVoxelColor(
+                    lua_pushinteger(L, Core::GetVoxelColor(*currAnim,
                         (byte)lua_tointeger(L, 1),
                         (byte)lua_tointeger(L, 2),
                         (byte)lua_tointeger(L, 3) ));
@@ -403,7 +636,7 @@ namespace TC_Lua_Functions
             {
                 if (argc == 4)
                 {
-                    currAnim->SetColumnColor(
+                    Core::SetColumnColor(*currAnim,
                         (byte)lua_tointeger(L, 1),
                         (byte)lua_tointeger(L, 2),
                         (byte)lua_tointeger(L, 3),
@@ -411,7 +644,7 @@ namespace TC_Lua_Functions
                 }
                 else
                 {
-                    currAnim->SetColumnColor(
+                    Core::SetColumnColor(*currAnim,
                         (byte)lua_tointeger(L, 1),
                         (byte)lua_tointeger(L, 2),
                         (byte)lua_tointeger(L, 3),
@@ -432,7 +665,7 @@ namespace TC_Lua_Functions
             {
                 if (argc == 4)
                 {
-                    lua_pushboolean(L, currAnim->CompareColumnColor(
+                    lua_pushboolean(L, Core::CompareColumnColor(*currAnim,
                         (byte)lua_tointeger(L, 1),
                         (byte)lua_tointeger(L, 2),
                         (byte)lua_tointeger(L, 3),
@@ -440,7 +673,7 @@ namespace TC_Lua_Functions
                 }
                 else
                 {
-                    lua_pushboolean(L, currAnim->CompareColumnColor(
+                    lua_pushboolean(L, Core::CompareColumnColor(*currAnim,
                         (byte)lua_tointeger(L, 1),
                         (byte)lua_tointeger(L, 2),
                         (byte)lua_tointeger(L, 3),
@@ -461,14 +694,14 @@ namespace TC_Lua_Functions
             {
                 if (argc == 3)
                 {
-                    currAnim->SetPlaneColor(
+                    Core::SetPlaneColor(*currAnim,
                         (byte)lua_tointeger(L, 1),
                         (byte)lua_tointeger(L, 2),
                         (ulint)lua_tointeger(L, 3) );
                 }
                 else
                 {
-                    currAnim->SetPlaneColor(
+                    Core::SetPlaneColor(*currAnim,
                         (byte)lua_tointeger(L, 1),
                         (byte)lua_tointeger(L, 2),
                         (byte)lua_tointeger(L, 3),
@@ -488,14 +721,14 @@ namespace TC_Lua_Functions
             {
                 if (argc == 3)
                 {
-                    lua_pushboolean(L, currAnim->ComparePlaneColor(
+                    lua_pushboolean(L, Core::ComparePlaneColor(*currAnim,
                         (byte)lua_tointeger(L, 1),
                         (byte)lua_tointeger(L, 2),
                         (ulint)lua_tointeger(L, 3)));
                 }
                 else
                 {
-                    lua_pushboolean(L, currAnim->ComparePlaneColor(
+                    lua_pushboolean(L, Core::ComparePlaneColor(*currAnim,
                         (byte)lua_tointeger(L, 1),
                         (byte)lua_tointeger(L, 2),
                         (byte)lua_tointeger(L, 3),
@@ -507,6 +740,33 @@ namespace TC_Lua_Functions
             return 0;
         }
         
+        int FillBoxColor(lua_State *L)
+        {
+            int argc = lua_gettop(L);
+            if (argc != 7 && argc != 9) return 0;
+            if (currAnim != NULL)
+            {
+                if (argc == 7)
+                {
+                    Core::FillBoxColor(*currAnim,
+                        (byte)lua_tointeger(L, 1), (byte)lua_tointeger(L, 2),
+                        (byte)lua_tointeger(L, 3), (byte)lua_tointeger(L, 4),
+                        (byte)lua_tointeger(L, 5), (byte)lua_tointeger(L, 6),
+                        (ulint)lua_tointeger(L, 7) );
+                }
+                else
+                {
+                    Core::FillBoxColor(*currAnim,
+                        (byte)lua_tointeger(L, 1), (byte)lua_tointeger(L, 2),
+                        (byte)lua_tointeger(L, 3), (byte)lua_tointeger(L, 4),
+                        (byte)lua_tointeger(L, 5), (byte)lua_tointeger(L, 6),
+                        (byte)lua_tointeger(L, 7), (byte)lua_tointeger(L, 8),
+                        (byte)lua_tointeger(L, 9) );
+                }
+            }
+            return 0;
+        }
+        
         void RegisterCommands(lua_State *L)
         {
             lua_register(L, "SetVoxelColor",      SetVoxelColor);
@@ -515,6 +775,7 @@ namespace TC_Lua_Functions
             lua_register(L, "CompareColumnColor", CompareColumnColor);
             lua_register(L, "SetPlaneColor",      SetPlaneColor);
             lua_register(L, "ComparePlaneColor",  ComparePlaneColor);
+            lua_register(L, "FillBoxColor",       FillBoxColor);
         }
     }
 }
@@ -530,12 +791,14 @@ namespace TC_Lua_Functions
 /// \param fname A C-string containing the filename to be passed to luaL_loadfile.
 /// \param argc  The number of arguments to pass to the animation when initializing.
 /// \param argv  Pointer to each of the arguments. If there are no arguments, set to NULL.
+/// \param animSize The size of the animation (or NULL to use the current cube size).
 ///
 /// \returns A pointer to a TCAnimLua object, casted to a TCAnim object.  If the Lua file
 ///          could not be loaded, NULL is returned.
 ///
-TCAnim *LuaAnimLoader(char const *fname, int argc, int *argv)
+TCAnim *LuaAnimLoader(char const *fname, int argc, int *argv, byte *animSize)
 {
+    if (animSize == NULL) animSize = cubeSize;
     TCAnimLua *toReturn  = NULL;        // The TCAnimLua object to return (as a TCAnim).
     lua_State *pLuaState;               // Pointer to the current Lua state.
     TC_Lua_Functions::currAnim = NULL;  // Initialize the Lua animation pointer to NULL.
@@ -611,7 +874,7 @@ TCAnim *LuaAnimLoader(char const *fname, int argc, int *argv)
     }
     // Next, we initialize the object so that the registered functions are valid.  We also
     // delete the object if we need to quit (since lua_close is called in the destructor).
-    toReturn = new TCAnimLua(cubeSize, _numColors, pLuaState);
+    toReturn = new TCAnimLua(animSize, _numColors, pLuaState);
     // We also store the pointer for use with the registered commands in TC_Lua_Functions.
     TC_Lua_Functions::currAnim = toReturn;
     // Now, we attempt to call the InitSize function (which is in animbase.lua).
@@ -626,9 +889,9 @@ TCAnim *LuaAnimLoader(char const *fname, int argc, int *argv)
         return NULL;
     }
     // Next, we push each of the sizes onto the Lua stack, and call the InitSize function.
-    lua_pushinteger(pLuaState, cubeSize[0]);
-    lua_pushinteger(pLuaState, cubeSize[1]);
-    lua_pushinteger(pLuaState, cubeSize[2]);
+    lua_pushinteger(pLuaState, animSize[0]);
+    lua_pushinteger(pLuaState, animSize[1]);
+    lua_pushinteger(pLuaState, animSize[2]);
     lua_pcall(pLuaState, 3, 0, 0);
     // Now, we repeat the above steps, but with the Initialize function.
     lua_getglobal(pLuaState, "Initialize");
@@ -657,7 +920,9 @@ TCAnim *LuaAnimLoader(char const *fname, int argc, int *argv)
     }
     if (!lua_toboolean(pLuaState, -1))      // If Initialize returned false...
     {
-        // We output an error to the console, close the Lua state, and return NULL.
+        // We output an error to the console (after any output posted by Initialize, since
+        // the loader runs on the console thread), close the Lua state, and return NULL.
+        WritePostedOutput();
         WriteOutput("Error - call to Initialize failed (returned false). See above for "
                     "additional information (if applicable).");
         delete toReturn;
@@ -717,8 +982,12 @@ TCAnimLua::~TCAnimLua()
 /// Called on every tick, this function calls the Update function defined by the Lua
 /// animation file.  This function assumes that the function exists and is valid.
 ///
+/// \remarks The registered commands are pointed to this object first, since several Lua
+///          animations can be updated in turn (e.g. as the layers of a TCCompositor).
+///
 void TCAnimLua::Update()
 {
+    TC_Lua_Functions::currAnim = this;
     lua_pcall(pLuaState, 0, 0, 0);
     lua_getglobal(pLuaState, "Update");
 }
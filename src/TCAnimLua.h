@@ -35,7 +35,7 @@
 
 
 // Function to validate and load a Lua file as a TCAnim object.
-TCAnim *LuaAnimLoader(char const *fname, int argc, int *argv);
+TCAnim *LuaAnimLoader(char const *fname, int argc, int *argv, byte *animSize = NULL);
 
 ///
 /// \brief Triclysm Animation Lua Object
@@ -0,0 +1,434 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *                          TCAutomaton Object  Source Code                            *
+ *                                      TRICLYSM                                       *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  This file contains the implementation of the TCAutomaton class as defined by the   *
+ *  TCAutomaton.h header file.  This class is a native animation which runs a 3D       *
+ *  cellular automaton (e.g. 3D Life) with a configurable birth and survival rule.     *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  Copyright (C) 2011 Brandon Castellano, Ryan Mantha. All rights reserved.           *
+ *  Triclysm is provided under the BSD-2-Clause license. This program uses the SDL     *
+ *  (Simple DirectMedia Layer) library, and the Lua scripting language. See the        *
+ *  included LICENSE file or <http://www.triclysm.com/> for more details.              *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+///
+/// \file  TCAutomaton.cpp
+/// \brief This file contains the implementation of the TCAutomaton class as defined by
+///        the TCAutomaton.h header file.
+///
+
+#include "TCAutomaton.h"
+#include "main.h"           // Used to access the global cube size.
+#include "console.h"        // Used to print error messages to the console.
+#include <cassert>          // Used to validate the rule and size arguments.
+#include <cstdlib>          // Used for the strtol function.
+#include <cstring>          // Used for the memset function.
+#include <ctime>            // Used to seed the random number generator.
+#include <string>           // Used to build the error messages.
+
+#define TC_COUNT_BITS 5     ///< Bits needed to count up to 26 neighbours.
+
+
+///
+/// \brief Automaton Constructor
+///
+/// Creates an automaton of the passed size, which is seeded with random cells on its
+/// first tick.
+///
+/// \param tccSize    An array containing the x, y, and z sizes (in voxels).
+/// \param birth      The birth set of the rule (bit n is set if a dead cell with n live
+///                   neighbours becomes alive).
+/// \param survival   The survival set of the rule (bit n is set if a live cell with n
+///                   live neighbours stays alive).
+/// \param neighbours The neighbourhood of each cell (e.g. TC_NEIGHBOURS_FACES).
+/// \param wrap       True if the cells on each border are neighbours of the cells on
+///                   the opposite border, or false if the cells outside the cube are
+///                   always dead.
+/// \param density    The percentage of cells alive after seeding (from 0 to 100).
+///
+/// \see ParseRule
+///
+TCAutomaton::TCAutomaton(byte tccSize[3], uint32_t birth, uint32_t survival,
+                         byte neighbours, bool wrap, byte density)
+    : TCAnim(tccSize, 0)
+{
+    assert(   neighbours == TC_NEIGHBOURS_FACES || neighbours == TC_NEIGHBOURS_EDGES
+           || neighbours == TC_NEIGHBOURS_CORNERS );
+    assert(density <= 100);
+    cells = dynamic_cast<TCCubeBits *>(cubeState[0]);
+    assert(cells != NULL);
+    this->birth    = birth;
+    this->survival = survival;
+    this->wrap     = wrap;
+    this->density  = density;
+    wordsPerRow    = cells->GetWordsPerRow();
+    lastWordMask   = ~(qword)0 >> (63 - ((sc[2] - 1) & 63));
+    for (byte i = 0; i < 2; i++)
+    {
+        grid[i].assign((size_t)sc[0] * sc[1] * wordsPerRow, 0);
+    }
+    sliceFlags.assign(sc[0], 0);
+    sliceLive.assign(sc[0], 0);
+    // A neighbour at an offset of (dx, dy, dz) is part of the neighbourhood if it is at
+    // most 1, 2, or 3 steps away (for 6, 18, or 26 neighbours).
+    int maxSteps = (neighbours == TC_NEIGHBOURS_FACES) ? 1 :
+                   (neighbours == TC_NEIGHBOURS_EDGES) ? 2 : 3;
+    for (int dx = -1; dx <= 1; dx++)
+    {
+        for (int dy = -1; dy <= 1; dy++)
+        {
+            RowOffset offset;
+            int       steps = abs(dx) + abs(dy);
+            offset.dx      = dx;
+            offset.dy      = dy;
+            offset.same    = (steps >= 1 && steps <= maxSteps);
+            offset.shifted = (steps + 1 <= maxSteps);
+            if (offset.same || offset.shifted) offsets.push_back(offset);
+        }
+    }
+    for (byte n = 0; n <= TC_NEIGHBOURS_CORNERS; n++)
+    {
+        if (((birth | survival) >> n) & 1) counts.push_back(n);
+    }
+    current     = 0;
+    generations = -1;   // Seeded on the first tick.
+    seeding     = false;
+    rng         = ((uint64_t)time(NULL) << 1) | 1;
+    SetParallelMode(TC_PARALLEL_SLICES);
+}
+
+
+///
+/// \brief Parse Rule
+///
+/// Parses a rule in the form "B<counts>/S<counts>", where each list of counts is made of
+/// neighbour counts (from 0 to 26) and ranges of them, separated by commas.  For example,
+/// "B5/S4-5" gives birth to cells with 5 neighbours, and keeps cells with 4 or 5.
+///
+/// \param rule     The rule to parse (the B and S parts can be in either order, or left
+///                 out for an empty set).
+/// \param birth    Set to the birth set of the rule (see the constructor).
+/// \param survival Set to the survival set of the rule.
+///
+/// \returns True if the rule was parsed, or false if it is not valid.
+///
+bool TCAutomaton::ParseRule(const char *rule, uint32_t &birth, uint32_t &survival)
+{
+    birth = survival = 0;
+    uint32_t *pSet = NULL;
+    while (*rule != '\0')
+    {
+        if (*rule == 'B' || *rule == 'b')
+        {
+            pSet = &birth;
+            rule++;
+        }
+        else if (*rule == 'S' || *rule == 's')
+        {
+            pSet = &survival;
+            rule++;
+        }
+        else if (*rule == '/' || *rule == ',')
+        {
+            rule++;
+        }
+        else
+        {
+            // Otherwise, this must be a count (or a range of counts) in the current set.
+            char *pEnd;
+            long  lo = strtol(rule, &pEnd, 10), hi = lo;
+            if (pSet == NULL || pEnd == rule) return false;
+            rule = pEnd;
+            if (*rule == '-')
+            {
+                hi = strtol(rule + 1, &pEnd, 10);
+                if (pEnd == rule + 1) return false;
+                rule = pEnd;
+            }
+            if (lo < 0 || hi > TC_NEIGHBOURS_CORNERS || lo > hi) return false;
+            for (long n = lo; n <= hi; n++)
+            {
+                *pSet |= (uint32_t)1 << n;
+            }
+        }
+    }
+    return true;
+}
+
+
+///
+/// \brief Update
+///
+/// Seeds the cube at the start of each iteration.  On every other tick, the next
+/// generation is computed one yz-plane at a time by \ref UpdateRegion.
+///
+void TCAutomaton::Update()
+{
+    seeding = (generations < 0);
+    if (seeding) Seed();
+}
+
+
+///
+/// \brief Update Region
+///
+/// Computes the next generation of one yz-plane into the other grid, sets the flags and
+/// live cell count of the plane, and writes the plane into the next state.  Each plane
+/// only writes its own rows and flags, so the planes can be computed by separate threads.
+/// Nothing is computed on a tick which seeded the cube (so the next state is the seed).
+///
+/// \param lo The lowest corner of the plane (only the x-coordinate is used).
+/// \param hi The highest corner of the plane.
+///
+void TCAutomaton::UpdateRegion(const byte lo[3], const byte /*hi*/[3])
+{
+    if (seeding) return;
+    byte         x        = lo[0];
+    size_t       numSlice = (size_t)sc[1] * wordsPerRow;
+    const qword *pCur     = &grid[current][x * numSlice];
+    qword       *pNext    = &grid[current ^ 1][x * numSlice];
+    byte        *pState   = GetNextState(0) + VoxelOffset(x, 0, 0);
+    byte         flags    = 0;
+    size_t       live     = 0;
+    std::vector<qword> row(wordsPerRow);
+    for (int y = 0; y < sc[1]; y++)
+    {
+        StepRow(x, y, &row[0]);
+        for (size_t w = 0; w < wordsPerRow; w++)
+        {
+            // The next grid still holds the generation before the current one.
+            if (row[w] != *pCur)  flags |= 0x01;
+            if (row[w] != *pNext) flags |= 0x02;
+            live += __builtin_popcountll(row[w]);
+            *pNext++ = row[w];
+            pCur++;
+        }
+        for (int z = 0; z < sc[2]; z++)
+        {
+            *pState++ = (byte)((row[z >> 6] >> (z & 63)) & 1);
+        }
+    }
+    sliceFlags[x] = flags;
+    sliceLive[x]  = live;
+}
+
+
+///
+/// \brief Finish Update
+///
+/// Swaps the grids once every plane of a generation is done.  Once every cell is dead,
+/// or the last generation is the same as one of the two before it, the iteration is
+/// done, and the cube is seeded again on the next tick.
+///
+void TCAutomaton::FinishUpdate()
+{
+    if (seeding) return;
+    current ^= 1;
+    size_t numLive  = 0;
+    byte   anyFlags = 0;
+    for (byte x = 0; x < sc[0]; x++)
+    {
+        anyFlags |= sliceFlags[x];
+        numLive  += sliceLive[x];
+    }
+    generations++;
+    // Bit 0 of the flags is set if a plane differs from the last generation, and bit 1
+    // if it differs from the generation before (which is only valid after two ticks).
+    if (numLive == 0 || !(anyFlags & 0x01) || (generations >= 2 && !(anyFlags & 0x02)))
+    {
+        iterations++;
+        generations = -1;
+    }
+}
+
+
+///
+/// \brief Seed
+///
+/// Fills the current grid (and the cube state) with random cells, where each cell is
+/// alive with a probability of \ref density percent.
+///
+void TCAutomaton::Seed()
+{
+    std::vector<qword> &cur       = grid[current];
+    uint32_t            threshold = (uint32_t)((density * 0xFFFFFFFFull) / 100);
+    for (size_t row = 0; row < cur.size(); row += wordsPerRow)
+    {
+        for (size_t w = 0; w < wordsPerRow; w++)
+        {
+            qword word = 0;
+            for (int bit = 0; bit < 64; bit++)
+            {
+                // A 64-bit xorshift generator (the high bits are the most random).
+                rng ^= rng << 13;
+                rng ^= rng >> 7;
+                rng ^= rng << 17;
+                if ((uint32_t)(rng >> 32) < threshold) word |= (qword)1 << bit;
+            }
+            cur[row + w] = (w + 1 < wordsPerRow) ? word : (word & lastWordMask);
+        }
+    }
+    size_t numSlice = (size_t)sc[1] * wordsPerRow;
+    for (byte x = 0; x < sc[0]; x++)
+    {
+        cells->SetSliceBits(x, &cur[x * numSlice]);
+    }
+    generations = 0;
+}
+
+
+///
+/// \brief Step Row
+///
+/// Computes the next generation of the 64 cells in each word of a row at once.  Each
+/// neighbouring word (the word of a neighbouring row, or that word shifted by one cell
+/// along the z-axis) is added to a 5-bit count of each cell, stored with one bit of
+/// every count in each of the words p[0] to p[4].  The rule is then applied by comparing
+/// the counts against each count in the birth and survival sets.
+///
+/// \param x    The x-coordinate of the row.
+/// \param y    The y-coordinate of the row.
+/// \param pDst Set to the next generation of the row.
+///
+void TCAutomaton::StepRow(int x, int y, qword *pDst) const
+{
+    const std::vector<qword> &cur = grid[current];
+    const size_t W    = wordsPerRow;
+    const int    topZ = (sc[2] - 1) & 63;   // Bit of the last cell in the last word.
+    const qword *pRows[9];
+    for (size_t i = 0; i < offsets.size(); i++)
+    {
+        int nx = x + offsets[i].dx,
+            ny = y + offsets[i].dy;
+        if (wrap)
+        {
+            nx = (nx + sc[0]) % sc[0];
+            ny = (ny + sc[1]) % sc[1];
+        }
+        pRows[i] = (nx < 0 || nx >= sc[0] || ny < 0 || ny >= sc[1]) ? NULL :
+                   &cur[((size_t)nx * sc[1] + ny) * W];
+    }
+    const qword *pSelf = &cur[((size_t)x * sc[1] + y) * W];
+    for (size_t w = 0; w < W; w++)
+    {
+        qword p[TC_COUNT_BITS] = { 0, 0, 0, 0, 0 };
+        for (size_t i = 0; i < offsets.size(); i++)
+        {
+            const qword *r = pRows[i];
+            if (r == NULL) continue;
+            qword in[3];
+            int   numIn = 0;
+            if (offsets[i].same) in[numIn++] = r[w];
+            if (offsets[i].shifted)
+            {
+                // Bit z of lower is the cell at z - 1, and bit z of upper is at z + 1.
+                qword lower = r[w] << 1,
+                      upper = r[w] >> 1;
+                if (w > 0)     lower |= r[w - 1] >> 63;
+                else if (wrap) lower |= (r[W - 1] >> topZ) & 1;
+                if (w + 1 < W) upper |= r[w + 1] << 63;
+                else if (wrap) upper |= (r[0] & 1) << topZ;
+                in[numIn++] = lower;
+                in[numIn++] = upper;
+            }
+            for (int j = 0; j < numIn; j++)
+            {
+                // Ripple-carry addition of one bit to every count at once.
+                qword carry = in[j];
+                for (int b = 0; b < TC_COUNT_BITS && carry != 0; b++)
+                {
+                    qword next = p[b] & carry;
+                    p[b] ^= carry;
+                    carry  = next;
+                }
+            }
+        }
+        qword born = 0, survive = 0;
+        for (size_t i = 0; i < counts.size(); i++)
+        {
+            qword match = ~(qword)0;
+            for (int b = 0; b < TC_COUNT_BITS; b++)
+            {
+                match &= ((counts[i] >> b) & 1) ? p[b] : ~p[b];
+            }
+            if ((birth    >> counts[i]) & 1) born    |= match;
+            if ((survival >> counts[i]) & 1) survive |= match;
+        }
+        qword alive = pSelf[w],
+              next  = (alive & survive) | (~alive & born);
+        pDst[w] = (w + 1 < W) ? next : (next & lastWordMask);
+    }
+}
+
+
+///
+/// \brief Automaton Loader
+///
+/// Creates a cellular automaton the size of the cube from the arguments of the loadanim
+/// command (after the animation name), which are all optional:
+///
+///     [rule] [neighbours] [border] [density]
+///
+/// Where rule is a rule for \ref TCAutomaton::ParseRule (B5/S4-5 by default), neighbours
+/// is 6, 18, or 26 (the default), border is wrap (the default) or clamp, and density is
+/// the percentage of cells alive after seeding (25 by default).
+///
+/// \param argc     The number of arguments.
+/// \param argv     Pointer to each of the arguments.
+/// \param animSize The size of the automaton (or NULL to use the current cube size).
+///
+/// \returns A pointer to the new TCAutomaton object, or NULL if an argument was invalid
+///          (in which case an error is written to the console).
+///
+TCAnim *AutomatonLoader(int argc, char const *const *argv, byte *animSize)
+{
+    uint32_t birth, survival;
+    long     neighbours = TC_NEIGHBOURS_CORNERS,
+             density    = 25;
+    bool     wrap       = true;
+    char    *pEnd;
+    if (!TCAutomaton::ParseRule((argc > 0) ? argv[0] : "B5/S4-5", birth, survival))
+    {
+        WriteOutput(std::string("Error - invalid automaton rule \"") + argv[0] + "\" "
+                    "(rules are in the form B5/S4-5).");
+        return NULL;
+    }
+    if (argc > 1)
+    {
+        neighbours = strtol(argv[1], &pEnd, 10);
+        if (   *pEnd != '\0' || (neighbours != TC_NEIGHBOURS_FACES
+            && neighbours != TC_NEIGHBOURS_EDGES && neighbours != TC_NEIGHBOURS_CORNERS) )
+        {
+            WriteOutput("Error - the number of neighbours must be 6, 18, or 26.");
+            return NULL;
+        }
+    }
+    if (argc > 2)
+    {
+        std::string border(argv[2]);
+        if (border != "wrap" && border != "clamp")
+        {
+            WriteOutput("Error - the border must be wrap or clamp.");
+            return NULL;
+        }
+        wrap = (border == "wrap");
+    }
+    if (argc > 3)
+    {
+        density = strtol(argv[3], &pEnd, 10);
+        if (*pEnd != '\0' || density < 0 || density > 100)
+        {
+            WriteOutput("Error - the density must be a percentage (from 0 to 100).");
+            return NULL;
+        }
+    }
+    return new TCAutomaton((animSize != NULL) ? animSize : cubeSize, birth, survival,
+                           (byte)neighbours, wrap, (byte)density);
+}
@@ -0,0 +1,115 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *                          TCAutomaton Object  Header File                            *
+ *                                      TRICLYSM                                       *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  This file contains the definition of the TCAutomaton class as implemented by the   *
+ *  TCAutomaton.cpp source file.  This class is a native animation which runs a 3D     *
+ *  cellular automaton (e.g. 3D Life) with a configurable birth and survival rule.     *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  Copyright (C) 2011 Brandon Castellano, Ryan Mantha. All rights reserved.           *
+ *  Triclysm is provided under the BSD-2-Clause license. This program uses the SDL     *
+ *  (Simple DirectMedia Layer) library, and the Lua scripting language. See the        *
+ *  included LICENSE file or <http://www.triclysm.com/> for more details.              *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+///
+/// \file  TCAutomaton.h
+/// \brief This file contains the definition of the TCAutomaton class as implemented by
+///        the TCAutomaton.cpp source file.
+///
+
+#pragma once
+#ifndef TC_AUTOMATON_
+#define TC_AUTOMATON_
+
+#include "TCAnim.h"
+#include "TCCubeBits.h"         // Used for the qword type, and to store the cells.
+#include <vector>               // Used to hold the cell grids.
+#include <stdint.h>             // Used for the uint32_t and uint64_t types.
+
+// Neighbourhood Definitions (the number of neighbours of each cell)
+#define TC_NEIGHBOURS_FACES    6    ///< Cells sharing a face.
+#define TC_NEIGHBOURS_EDGES   18    ///< Cells sharing a face or an edge.
+#define TC_NEIGHBOURS_CORNERS 26    ///< Cells sharing a face, an edge, or a corner.
+
+#define TC_AUTOMATON_NAME "automaton"   ///< Name used to load the animation (loadanim).
+
+
+///
+/// \brief Triclysm Cellular Automaton Animation Object
+///
+/// This class is an animation without any colors, where each voxel is a cell of a 3D
+/// cellular automaton.  Every tick, a dead cell becomes alive if its number of live
+/// neighbours is in the birth set of the rule, and a live cell stays alive if its number
+/// of live neighbours is in the survival set.  The cube is filled with random cells at
+/// the start of each iteration, and an iteration ends once every cell is dead, or the
+/// cells stop changing (or alternate between two states).
+///
+/// \remarks The cells are packed 64 to a word along the z-axis (the same way as a
+///          TCCubeBits object), and the neighbours of 64 cells are counted at once with
+///          bit-sliced adders.  The animation uses the TC_PARALLEL_SLICES mode, so the
+///          yz-planes of each tick are computed on the shared TCThreadPool, and each tick
+///          is written to the other of two grids, so the planes can be computed in any
+///          order.
+///
+/// \see AutomatonLoader
+///
+class TCAutomaton : public TCAnim
+{
+  public:
+    TCAutomaton(byte tccSize[3], uint32_t birth, uint32_t survival,
+                byte neighbours = TC_NEIGHBOURS_CORNERS, bool wrap = true,
+                byte density = 25);
+
+    // Parses a rule such as "B5/S4-5" (returns false if it is not valid):
+    static bool ParseRule(const char *rule, uint32_t &birth, uint32_t &survival);
+
+  protected:
+    void Update();                  // Seeds the cube at the start of each iteration.
+    void UpdateRegion(const byte lo[3], const byte hi[3]);  // Steps one yz-plane.
+    void FinishUpdate();            // Ends the iteration once the cells settle.
+
+  private:
+    /// \brief The neighbours of one row of cells in the row at an (x, y) offset.
+    struct RowOffset
+    {
+        int  dx, dy;                ///< The offset of the neighbouring row.
+        bool same,                  ///< True if the cells at the same z are neighbours.
+             shifted;               ///< True if the cells at z - 1 and z + 1 are.
+    };
+
+    // Fills the grid with random cells (and starts a new iteration).
+    void Seed();
+    // Computes the next generation of one row.
+    void StepRow(int x, int y, qword *pDst) const;
+
+    TCCubeBits          *cells;     ///< The animation's cube state (see cubeState).
+    std::vector<qword>   grid[2];   ///< The current and the next generation.
+    std::vector<byte>    sliceFlags;///< Which planes changed in the last generation.
+    std::vector<size_t>  sliceLive; ///< The number of live cells in each plane.
+    std::vector<RowOffset> offsets; ///< The rows holding the neighbours of each row.
+    std::vector<byte>    counts;    ///< Each neighbour count in the birth or survival set.
+    size_t   wordsPerRow;           ///< Number of 64-bit words used for each row.
+    qword    lastWordMask;          ///< Mask of the valid bits in the last word of a row.
+    uint32_t birth,                 ///< Bit n is set if n neighbours give birth to a cell.
+             survival;              ///< Bit n is set if a cell with n neighbours survives.
+    bool     wrap;                  ///< True if the borders wrap around (a torus).
+    byte     density;               ///< Percentage of the cells alive when seeded.
+    byte     current;               ///< Index of the grid holding the current generation.
+    int      generations;           ///< Number of generations since the last seed.
+    bool     seeding;               ///< True if the cube was seeded on this tick.
+    uint64_t rng;                   ///< State of the random number generator.
+};
+
+
+// Creates a TCAutomaton from the arguments of the loadanim command:
+TCAnim *AutomatonLoader(int argc, char const *const *argv, byte *animSize = NULL);
+
+
+#endif
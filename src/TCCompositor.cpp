@@ -0,0 +1,325 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *                          TCCompositor Object  Source Code                           *
+ *                                      TRICLYSM                                       *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  This file contains the implementation of the TCCompositor class as defined by the  *
+ *  TCCompositor.h header file.  This class is an RGB animation which runs several     *
+ *  other animations as layers, and blends their colors together on every tick.        *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  Copyright (C) 2011 Brandon Castellano, Ryan Mantha. All rights reserved.           *
+ *  Triclysm is provided under the BSD-2-Clause license. This program uses the SDL     *
+ *  (Simple DirectMedia Layer) library, and the Lua scripting language. See the        *
+ *  included LICENSE file or <http://www.triclysm.com/> for more details.              *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+///
+/// \file  TCCompositor.cpp
+/// \brief This file contains the implementation of the TCCompositor class as defined by
+///        the TCCompositor.h header file.
+///
+
+#include "TCCompositor.h"
+#include "TCCubeChannel.h"  // Used to read and write the interleaved colors.
+#include "cube_kernels.h"   // Used for the blending kernels.
+#include <cassert>          // Used to validate the layer arguments.
+#include <cstring>          // Used for the memset function.
+
+
+///
+/// \brief Compositor Constructor
+///
+/// Creates an RGB animation of the passed size without any layers (so every voxel is off
+/// until a layer is added).
+///
+/// \param tccSize An array containing the x, y, and z sizes (in voxels).  Each layer must
+///                have the same size.
+///
+TCCompositor::TCCompositor(byte tccSize[3])
+    : TCAnim(tccSize, 3)
+{
+    layerGen      = 0;
+    layersChanged = false;
+}
+
+
+///
+/// \brief Destructor
+///
+/// Deletes the animation of each layer.
+///
+TCCompositor::~TCCompositor()
+{
+    for (size_t i = 0; i < layers.size(); i++)
+    {
+        delete layers[i].anim;
+    }
+}
+
+
+///
+/// \brief Add Layer
+///
+/// Adds an animation on top of the existing layers.  The compositor takes ownership of
+/// the animation, and deletes it along with the layer.
+///
+/// \param layer   The animation to add (which must be the same size as the compositor).
+/// \param blend   The blend mode of the layer (e.g. TC_BLEND_MAX).
+/// \param opacity The scale applied to the layer's colors (0xFF for none).
+///
+/// \returns The index of the new layer.
+///
+size_t TCCompositor::AddLayer(TCAnim *layer, byte blend, byte opacity)
+{
+    assert(layer != NULL && blend < TC_NUM_BLENDS);
+    for (byte axis = TC_X_AXIS; axis <= TC_Z_AXIS; axis++)
+    {
+        assert(layer->cubeState[0]->GetSize(axis) == sc[axis]);
+    }
+    Layer newLayer;
+    newLayer.anim    = layer;
+    newLayer.blend   = blend;
+    newLayer.opacity = opacity;
+    layers.push_back(newLayer);
+    layersChanged = true;
+    return layers.size() - 1;
+}
+
+
+///
+/// \brief Remove Layer
+///
+/// Removes a layer (and deletes its animation).  The layers above it move down by one.
+///
+/// \param index The index of the layer to remove.
+///
+void TCCompositor::RemoveLayer(size_t index)
+{
+    assert(index < layers.size());
+    delete layers[index].anim;
+    layers.erase(layers.begin() + index);
+    layersChanged = true;
+}
+
+
+///
+/// \brief Get Number of Layers
+///
+/// \returns The number of layers in the compositor.
+///
+size_t TCCompositor::GetNumLayers()
+{
+    return layers.size();
+}
+
+
+///
+/// \brief Get Layer
+///
+/// \param index The index of the layer.
+///
+/// \returns The animation of the layer (which is still owned by the compositor).
+///
+TCAnim *TCCompositor::GetLayer(size_t index)
+{
+    assert(index < layers.size());
+    return layers[index].anim;
+}
+
+
+///
+/// \brief Set Layer Blend Mode
+///
+/// \param index The index of the layer.
+/// \param blend The new blend mode of the layer (e.g. TC_BLEND_MULTIPLY).
+///
+void TCCompositor::SetLayerBlend(size_t index, byte blend)
+{
+    assert(index < layers.size() && blend < TC_NUM_BLENDS);
+    layers[index].blend = blend;
+    layersChanged = true;
+}
+
+
+///
+/// \brief Get Layer Blend Mode
+///
+/// \param index The index of the layer.
+///
+/// \returns The blend mode of the layer (e.g. TC_BLEND_MULTIPLY).
+///
+byte TCCompositor::GetLayerBlend(size_t index)
+{
+    assert(index < layers.size());
+    return layers[index].blend;
+}
+
+
+///
+/// \brief Set Layer Opacity
+///
+/// \param index   The index of the layer.
+/// \param opacity The scale applied to the layer's colors (from 0 for a hidden layer, to
+///                0xFF for the layer's own colors).
+///
+void TCCompositor::SetLayerOpacity(size_t index, byte opacity)
+{
+    assert(index < layers.size());
+    layers[index].opacity = opacity;
+    layersChanged = true;
+}
+
+
+///
+/// \brief Get Layer Opacity
+///
+/// \param index The index of the layer.
+///
+/// \returns The scale applied to the layer's colors (see \ref SetLayerOpacity).
+///
+byte TCCompositor::GetLayerOpacity(size_t index)
+{
+    assert(index < layers.size());
+    return layers[index].opacity;
+}
+
+
+///
+/// \brief Get Blend Mode Name
+///
+/// \param blend The blend mode (e.g. TC_BLEND_XOR).
+///
+/// \returns The name of the blend mode (as used by the layer console command).
+///
+const char *TCCompositor::GetBlendName(byte blend)
+{
+    switch (blend)
+    {
+        case TC_BLEND_ADD:      return "add";
+        case TC_BLEND_MAX:      return "max";
+        case TC_BLEND_MULTIPLY: return "multiply";
+        case TC_BLEND_ALPHA:    return "alpha";
+        case TC_BLEND_XOR:      return "xor";
+    }
+    return "unknown";
+}
+
+
+///
+/// \brief Update
+///
+/// Ticks the animation of each layer, and blends the layers together if any of them
+/// changed.  The iterations of the compositor are those of the bottom layer.
+///
+void TCCompositor::Update()
+{
+    uint64_t lastGen = 0;
+    for (size_t i = 0; i < layers.size(); i++)
+    {
+        layers[i].anim->Tick();
+        if (layers[i].anim->GetGeneration() > lastGen)
+        {
+            lastGen = layers[i].anim->GetGeneration();
+        }
+    }
+    iterations = layers.empty() ? 0 : layers[0].anim->GetIterations();
+    // Generations only ever increase, so the highest one only stays the same if none of
+    // the layers have changed since they were last blended.
+    if (!layersChanged && lastGen == layerGen) return;
+    Composite();
+    layerGen      = lastGen;
+    layersChanged = false;
+}
+
+
+///
+/// \brief Composite
+///
+/// Clears the animation's colors, and then blends each layer into them in order, with
+/// one call to the layer's blending kernel over the whole color buffer.
+///
+void TCCompositor::Composite()
+{
+    size_t    numBytes = cubeState[0]->GetNumVoxels() * sizeof(uint32_t);
+    uint32_t *pColors  = GetColorCube()->WriteColors();
+    memset(pColors, 0, numBytes);
+    for (size_t i = 0; i < layers.size(); i++)
+    {
+        TC_Kernels::BlendOp blendOp;
+        switch (layers[i].blend)
+        {
+            case TC_BLEND_ADD:      blendOp = TC_Kernels::BlendAdd;      break;
+            case TC_BLEND_MAX:      blendOp = TC_Kernels::BlendMax;      break;
+            case TC_BLEND_MULTIPLY: blendOp = TC_Kernels::BlendMultiply; break;
+            case TC_BLEND_ALPHA:    blendOp = TC_Kernels::BlendAlpha;    break;
+            default:                blendOp = TC_Kernels::BlendXor;      break;
+        }
+        // The unused byte of each color is zero in every buffer, and each blend mode
+        // leaves it as zero.
+        blendOp((byte *)pColors, (const byte *)GetLayerColors(*layers[i].anim),
+                layers[i].opacity, numBytes);
+    }
+}
+
+
+///
+/// \brief Get Layer Colors
+///
+/// Gets the color of each voxel of a layer in the same format as TCCubeChannel::GetColors.
+/// For RGB layers using the TC_STORAGE_DEFAULT mode, this is the layer's own buffer, and
+/// all others are converted into the \ref layerColors buffer.
+///
+/// \param anim The animation of the layer.
+///
+/// \returns A pointer to the 32-bit color (0xRRGGBB) of the first voxel, which is valid
+///          until the next call of this method.
+///
+const uint32_t *TCCompositor::GetLayerColors(TCAnim &anim)
+{
+    TCCubeChannel *colorCube = anim.GetColorCube();
+    if (colorCube != NULL) return colorCube->GetColors();
+
+    size_t numVoxels = anim.cubeState[0]->GetNumVoxels();
+    layerColors.resize(numVoxels);
+    uint32_t *pDst = &layerColors[0];
+    if (anim.GetNumColors() == 3)
+    {
+        const byte *pR = anim.cubeState[TC_COLOR_R]->GetData(),
+                   *pG = anim.cubeState[TC_COLOR_G]->GetData(),
+                   *pB = anim.cubeState[TC_COLOR_B]->GetData();
+        for (size_t i = 0; i < numVoxels; i++)
+        {
+            pDst[i] = ((uint32_t)pR[i] << 16) | ((uint32_t)pG[i] << 8) | pB[i];
+        }
+        return pDst;
+    }
+    const byte     *pState   = anim.cubeState[0]->GetData();
+    const uint32_t *pPalette = anim.GetPalette();
+    if (anim.GetNumColors() == 0)
+    {
+        for (size_t i = 0; i < numVoxels; i++)
+        {
+            pDst[i] = (pState[i] != 0x00) ? 0xFFFFFF : 0x000000;
+        }
+    }
+    else if (pPalette != NULL)
+    {
+        for (size_t i = 0; i < numVoxels; i++)
+        {
+            pDst[i] = pPalette[pState[i]];
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < numVoxels; i++)
+        {
+            pDst[i] = (uint32_t)pState[i] * 0x010101;
+        }
+    }
+    return pDst;
+}
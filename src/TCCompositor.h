@@ -0,0 +1,103 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *                          TCCompositor Object  Header File                           *
+ *                                      TRICLYSM                                       *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  This file contains the definition of the TCCompositor class as implemented by the  *
+ *  TCCompositor.cpp source file.  This class is an RGB animation which runs several   *
+ *  other animations as layers, and blends their colors together on every tick.        *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  Copyright (C) 2011 Brandon Castellano, Ryan Mantha. All rights reserved.           *
+ *  Triclysm is provided under the BSD-2-Clause license. This program uses the SDL     *
+ *  (Simple DirectMedia Layer) library, and the Lua scripting language. See the        *
+ *  included LICENSE file or <http://www.triclysm.com/> for more details.              *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+///
+/// \file  TCCompositor.h
+/// \brief This file contains the definition of the TCCompositor class as implemented by
+///        the TCCompositor.cpp source file.
+///
+
+#pragma once
+#ifndef TC_COMPOSITOR_
+#define TC_COMPOSITOR_
+
+#include "TCAnim.h"
+#include <vector>               // Used to hold the layers.
+#include <stdint.h>             // Used for the uint32_t and uint64_t types.
+
+// Blend Mode Definitions
+#define TC_BLEND_ADD      0     ///< The layer is added to the layers below it.
+#define TC_BLEND_MAX      1     ///< The brightest of the layer and the layers below it.
+#define TC_BLEND_MULTIPLY 2     ///< The layers below are multiplied by the layer.
+#define TC_BLEND_ALPHA    3     ///< The layer is drawn over the layers below it.
+#define TC_BLEND_XOR      4     ///< The layer is XORed with the layers below it.
+#define TC_NUM_BLENDS     5     ///< Number of blend modes.
+
+
+///
+/// \brief Triclysm Layered Animation Compositor Object
+///
+/// This class is an animation with 3 colors, which holds a stack of other animations (the
+/// layers).  Every tick, each layer is ticked, and the colors of the layers are blended
+/// together from the bottom layer (index 0) to the top one, starting with every voxel off.
+/// Each layer has its own blend mode (e.g. TC_BLEND_ADD), and an opacity, which scales
+/// its colors before they are blended.
+///
+/// \remarks The blending is done on whole interleaved color buffers with the blending
+///          kernels (see TC_Kernels::BlendAdd), and is skipped if no layer changed since
+///          the last tick.  Layers without RGB colors are converted first (a lit voxel of
+///          an animation without any colors is white, and a greyscale or palette voxel
+///          uses its color, see TCAnim::GetVoxelColor).
+///
+/// \see SetAnim | GetCompositor
+///
+class TCCompositor : public TCAnim
+{
+  public:
+    TCCompositor(byte tccSize[3]);  // Creates a compositor without any layers.
+    ~TCCompositor();                // Deletes each layer.
+
+    // Layer functions (each layer is identified by its index, from 0 at the bottom):
+    size_t  AddLayer(TCAnim *layer, byte blend = TC_BLEND_ADD, byte opacity = 0xFF);
+    void    RemoveLayer(size_t index);      // Deletes the layer's animation.
+    size_t  GetNumLayers();
+    TCAnim *GetLayer(size_t index);
+    void    SetLayerBlend(size_t index, byte blend);
+    byte    GetLayerBlend(size_t index);
+    void    SetLayerOpacity(size_t index, byte opacity);
+    byte    GetLayerOpacity(size_t index);
+
+    static const char *GetBlendName(byte blend);    // e.g. "add" for TC_BLEND_ADD.
+
+  protected:
+    void Update();                  // Ticks each layer, and blends their colors.
+
+  private:
+    /// \brief A single animation in the stack, and how it is blended.
+    struct Layer
+    {
+        TCAnim *anim;               ///< The animation (owned by the compositor).
+        byte    blend,              ///< The blend mode (e.g. TC_BLEND_ALPHA).
+                opacity;            ///< The scale applied to the layer's colors.
+    };
+
+    // Returns the interleaved colors of a layer (converting them if needed).
+    const uint32_t *GetLayerColors(TCAnim &anim);
+    // Blends every layer into the animation's color buffer.
+    void Composite();
+
+    std::vector<Layer>    layers;       ///< The layers, from the bottom to the top.
+    std::vector<uint32_t> layerColors;  ///< Colors of a converted layer (see above).
+    uint64_t              layerGen;     ///< Highest layer generation when last blended.
+    bool                  layersChanged;///< True if a layer was added, removed, or set.
+};
+
+
+#endif
@@ -26,7 +26,12 @@
 ///
 
 #include "TCCube.h"
+#include "cube_kernels.h" // Used for the bulk operations on the voxel buffer.
 #include <cassert>      // Used in the CheckVoxelBounds method.
+#include <cstring>      // Used for memset and memcpy on the voxel buffer.
+#include <algorithm>    // Used for std::rotate, std::min, and std::swap.
+
+uint64_t TCCube::lastGeneration = 0;
 
 
 ///
@@ -83,54 +88,97 @@ TCCube::TCCube(byte tccSize[3])
 }
 
 
+///
+/// \brief Derived Storage Constructor
+///
+/// Used by classes inheriting TCCube which store the voxels in their own format.  This
+/// sets the size and stride of each dimension, but only allocates the internal
+/// \ref pCubeState array if allocate is true.
+///
+/// \param sizeX    The size (in voxels) of the x-dimension.
+/// \param sizeY    The size (in voxels) of the y-dimension.
+/// \param sizeZ    The size (in voxels) of the z-dimension.
+/// \param allocate True to allocate the voxel buffer, false to leave it as NULL.
+/// \see   SetDimensions | AllocateCube
+///
+TCCube::TCCube(byte sizeX, byte sizeY, byte sizeZ, bool allocate)
+{
+    if (allocate)
+    {
+        AllocateCube(sizeX, sizeY, sizeZ);
+    }
+    else
+    {
+        SetDimensions(sizeX, sizeY, sizeZ);
+        pCubeState = pCubeAlloc = NULL;
+        denseState = false;
+    }
+}
+
+
 ///
 /// \brief Copy Constructor
 ///
-/// Creates a new TCCube object which is a clone of the passed one.
+/// Creates a new TCCube object which is a clone of the passed one.  The clone shares the
+/// voxel buffer of the passed cube (so the copy takes constant time), and whichever cube
+/// is modified first makes its own copy of the buffer.  If the passed object uses a
+/// different storage type, the clone holds the same voxel states in a new buffer.
 ///
 /// \param toCopy The TCCube object to duplicate.
-/// \see AllocateCube | pCubeState
+/// \see Clone | Detach | pCubeAlloc
 ///
 TCCube::TCCube(const TCCube &toCopy)
 {
-    // We first allocate enough memory by using the sizes of the passed cube.
-    AllocateCube(toCopy.sc[0], toCopy.sc[0], toCopy.sc[0]);
-    // Then, looping through each dimension, we copy all elements of the array from the
-    // toCopy object to this object.
-    for (int x = 0; x < sc[0]; x++)
+    SetDimensions(toCopy.sc[0], toCopy.sc[1], toCopy.sc[2]);
+    denseState = true;
+    if (toCopy.denseState)
     {
-        for (int y = 0; y < sc[1]; y++)
-        {
-            for (int z = 0; z < sc[2]; z++)
-            {
-                pCubeState[x][y][z] = toCopy.pCubeState[x][y][z];
-            }
-        }
+        // We just take another reference to the same buffer (with the same layout).
+        __atomic_add_fetch((int *)toCopy.pCubeAlloc, 1, __ATOMIC_RELAXED);
+        pCubeAlloc = toCopy.pCubeAlloc;
+        pCubeState = toCopy.pCubeState;
+        origin[0]  = toCopy.origin[0];
+        origin[1]  = toCopy.origin[1];
+        origin[2]  = toCopy.origin[2];
     }
+    else
+    {
+        // Otherwise, we unpack the voxels into a buffer of our own.
+        AllocateBuffer();
+        memcpy(pCubeState, toCopy.GetData(), numVoxels);
+    }
+    shiftMode  = toCopy.shiftMode;
+    generation = toCopy.generation;
+    memcpy(sliceGen, toCopy.sliceGen, sizeof(sliceGen));
 }
 
 
 ///
 /// \brief Destructor
 ///
-/// Deletes the dynamic array that the constructor allocated.
+/// Releases this cube's reference to the voxel buffer, which is deleted once no other
+/// cube shares it.
 ///
-/// \see AllocateCube | pCubeState
+/// \see AllocateCube | pCubeAlloc
 ///
 TCCube::~TCCube()
 {
-    for (int x = 0; x < sc[0]; x++)
-    {
-        for (int y = 0; y < sc[1]; y++)
-        {
-            // Delete the current array of booleans (z-dimension).
-            delete[] pCubeState[x][y];
-        }
-        // Delete the current array of pointers to booleans (y-dimension).
-        delete[] pCubeState[x];
-    }
-    // Finally, delete the array of pointers to pointers to booleans (x-dimension).
-    delete[] pCubeState;
+    ReleaseBuffer(pCubeAlloc);
+}
+
+
+///
+/// \brief Clone
+///
+/// Creates a copy of this cube with the same storage type (e.g. a TCCubeBits object is
+/// cloned into another TCCubeBits object).  For a TCCube, this uses the copy constructor,
+/// so the voxel buffer is shared until either cube is modified.
+///
+/// \returns A pointer to the new cube (which must be deleted by the caller).
+///
+TCCube *TCCube::Clone() const
+{
+    return new TCCube(*this);
 }
 
 
@@ -147,17 +195,10 @@ TCCube::~TCCube()
 ///
 void TCCube::ResetCubeState(byte state)
 {
-    // Looping through each voxel in the cube, we set them all to the passed state.
-    for (int x = 0; x < sc[0]; x++)
-    {
-        for (int y = 0; y < sc[1]; y++)
-        {
-            for (int z = 0; z < sc[2]; z++)
-            {
-                pCubeState[x][y][z] = state;
-            }
-        }
-    }
+    // Since the voxels are stored contiguously, we can set them all in a single pass.
+    Detach();
+    memset(pCubeState, state, numVoxels);
+    MarkChanged();
 }
 
 
@@ -178,7 +219,9 @@ void TCCube::SetVoxelState(byte x, byte y, byte z, byte state)
 {
     // After checking the cube bounds, we just set the state of that voxel.
     CheckVoxelBounds(x, y, z);
-    pCubeState[x][y][z] = state;
+    Detach();
+    pCubeState[VoxelIndex(x, y, z)] = state;
+    MarkChanged(x);
 }
 
 
@@ -195,9 +238,8 @@ void TCCube::SetVoxelState(byte x, byte y, byte z, byte state)
 ///
 void TCCube::SetVoxelState(byte cVoxel[3], byte state)
 {
-    // After checking the cube bounds, we just set the state of that voxel.
-    CheckVoxelBounds(cVoxel[0], cVoxel[1], cVoxel[2]);
-    pCubeState[cVoxel[0]][cVoxel[1]][cVoxel[2]] = state;
+    // We just pass the coordinates to the other overload (which checks the bounds).
+    SetVoxelState(cVoxel[0], cVoxel[1], cVoxel[2], state);
 }
 
 
@@ -218,7 +260,7 @@ byte TCCube::GetVoxelState(byte x, byte y, byte z)
 {
     // After checking the cube bounds, we just return the state of that voxel.
     CheckVoxelBounds(x, y, z);
-    return pCubeState[x][y][z];
+    return pCubeState[VoxelIndex(x, y, z)];
 }
 
 
@@ -235,9 +277,8 @@ byte TCCube::GetVoxelState(byte x, byte y, byte z)
 ///
 byte TCCube::GetVoxelState(byte cVoxel[3])
 {
-    // After checking the cube bounds, we just return the state of that voxel.
-    CheckVoxelBounds(cVoxel[0], cVoxel[1], cVoxel[2]);
-    return pCubeState[cVoxel[0]][cVoxel[1]][cVoxel[2]];
+    // We just pass the coordinates to the other overload (which checks the bounds).
+    return GetVoxelState(cVoxel[0], cVoxel[1], cVoxel[2]);
 }
 
 
@@ -261,30 +302,32 @@ void TCCube::SetColumnState(byte axis, byte dim1, byte dim2, byte state)
     // What we do here is first check if the passed dim1 and dim2 values are within their
     // proper ranges (depending on the axis of the column).  Then, we loop through the
     // passed axis, and set the state of each voxel in the column.
+    Detach();
     switch (axis)
     {
         case TC_X_AXIS:
             CheckVoxelBounds(0, dim1, dim2);
             for (int x = 0; x < sc[0]; x++)
             {
-                pCubeState[x][dim1][dim2] = state;
+                pCubeState[VoxelIndex(x, dim1, dim2)] = state;
             }
+            MarkChanged();
             break;
 
         case TC_Y_AXIS:
             CheckVoxelBounds(dim1, 0, dim2);
             for (int y = 0; y < sc[1]; y++)
             {
-                pCubeState[dim1][y][dim2] = state;
+                pCubeState[VoxelIndex(dim1, y, dim2)] = state;
             }
+            MarkChanged(dim1);
             break;
 
         case TC_Z_AXIS:
             CheckVoxelBounds(dim1, dim2, 0);
-            for (int z = 0; z < sc[2]; z++)
-            {
-                pCubeState[dim1][dim2][z] = state;
-            }
+            // Columns along the z-axis are contiguous, so we can fill them directly.
+            memset(pCubeState + RowIndex(dim1, dim2), state, sc[2]);
+            MarkChanged(dim1);
             break;
     }
 }
@@ -319,7 +362,7 @@ bool TCCube::GetColumnState(byte axis, byte dim1, byte dim2, byte cmpVal)
             CheckVoxelBounds(0, dim1, dim2);
             for (int x = 0; x < sc[0]; x++)
             {
-                if (cmpVal != pCubeState[x][dim1][dim2]) return false;
+                if (cmpVal != pCubeState[VoxelIndex(x, dim1, dim2)]) return false;
             }
             break;
 
@@ -327,17 +370,14 @@ bool TCCube::GetColumnState(byte axis, byte dim1, byte dim2, byte cmpVal)
             CheckVoxelBounds(dim1, 0, dim2);
             for (int y = 0; y < sc[1]; y++)
             {
-                if (cmpVal != pCubeState[dim1][y][dim2]) return false;
+                if (cmpVal != pCubeState[VoxelIndex(dim1, y, dim2)]) return false;
             }
             break;
 
         case TC_Z_AXIS:
             CheckVoxelBounds(dim1, dim2, 0);
-            for (int z = 0; z < sc[2]; z++)
-            {
-                if (cmpVal != pCubeState[dim1][dim2][z]) return false;
-            }
-            break;
+            // Columns along the z-axis are contiguous, so we can compare them directly.
+            return TC_Kernels::Equal(pCubeState + RowIndex(dim1, dim2), cmpVal, sc[2]);
     }
     return true;    // If the control gets to this point, then all voxels were valid.        
 }
@@ -361,6 +401,7 @@ void TCCube::SetPlaneState(byte plane, byte offset, byte state)
     // Similar to the SetColumnState method, what we do here is first check if the passed
     // offset value (depending on the passed plane) is within the proper range. Then, we
     // loop through the two dimensions on the plane, and set the state of each voxel.
+    Detach();
     switch (plane)
     {
         case TC_XY_PLANE:
@@ -369,31 +410,27 @@ void TCCube::SetPlaneState(byte plane, byte offset, byte state)
             {
                 for (int y = 0; y < sc[1]; y++)
                 {
-                    pCubeState[x][y][offset] = state;
+                    pCubeState[VoxelIndex(x, y, offset)] = state;
                 }
             }
+            MarkChanged();
             break;
 
         case TC_ZX_PLANE:
             CheckVoxelBounds(0, offset, 0);
+            // Each x-coordinate holds one contiguous z-column of this plane.
             for (int x = 0; x < sc[0]; x++)
             {
-                for (int z = 0; z < sc[2]; z++)
-                {
-                    pCubeState[x][offset][z] = state;
-                }
+                memset(pCubeState + RowIndex(x, offset), state, sc[2]);
             }
+            MarkChanged();
             break;
 
         case TC_YZ_PLANE:
             CheckVoxelBounds(offset, 0, 0);
-            for (int y = 0; y < sc[1]; y++)
-            {
-                for (int z = 0; z < sc[2]; z++)
-                {
-                    pCubeState[offset][y][z] = state;
-                }
-            }
+            // The whole yz-plane is one contiguous block of the voxel buffer.
+            memset(pCubeState + AxisIndex(TC_X_AXIS, offset) * stride[0], state, stride[0]);
+            MarkChanged(offset);
             break;
     }
 }
@@ -428,201 +465,549 @@ bool TCCube::GetPlaneState(byte plane, byte offset, byte cmpVal)
             {
                 for (int y = 0; y < sc[1]; y++)
                 {
-                    if (cmpVal != pCubeState[x][y][offset]) return false;
+                    if (cmpVal != pCubeState[VoxelIndex(x, y, offset)]) return false;
                 }
             }
             break;
 
         case TC_ZX_PLANE:
             CheckVoxelBounds(0, offset, 0);
+            // Each x-coordinate holds one contiguous z-column of this plane.
             for (int x = 0; x < sc[0]; x++)
             {
-                for (int z = 0; z < sc[2]; z++)
+                if (!TC_Kernels::Equal(pCubeState + RowIndex(x, offset), cmpVal, sc[2]))
                 {
-                    if (cmpVal != pCubeState[x][offset][z]) return false;
+                    return false;
                 }
             }
             break;
 
         case TC_YZ_PLANE:
             CheckVoxelBounds(offset, 0, 0);
-            for (int y = 0; y < sc[1]; y++)
-            {
-                for (int z = 0; z < sc[2]; z++)
-                {
-                    if (cmpVal != pCubeState[offset][y][z]) return false;
-                }
-            }
-            break;
+            // The whole yz-plane is one contiguous block of the voxel buffer.
+            return TC_Kernels::Equal(pCubeState + AxisIndex(TC_X_AXIS, offset) * stride[0],
+                                     cmpVal, stride[0]);
     }
     return true;    // If the control gets to this point, then all voxels were valid. 
 }
 
 
+///
+/// \brief Set Voxel States (Batch)
+///
+/// Sets the state of many voxels at once.  All of the passed coordinates are checked
+/// with the \ref CheckVoxelBounds method before any voxel is set.
+///
+/// \param pCoords Array of count (x, y, z) coordinate triples (3 * count bytes).
+/// \param pStates Array of count states, one for each voxel in pCoords.
+/// \param count   The number of voxels to set.
+///
+/// \see GetVoxelStates | SetVoxelUnchecked
+///
+void TCCube::SetVoxelStates(const byte *pCoords, const byte *pStates, size_t count)
+{
+    CheckVoxelBounds(pCoords, count);
+    for (size_t i = 0; i < count; i++, pCoords += 3)
+    {
+        SetVoxelUnchecked(pCoords[0], pCoords[1], pCoords[2], pStates[i]);
+    }
+}
+
+
+///
+/// \brief Set Voxel States (Batch, Single State)
+///
+/// Sets many voxels to the same state.  All of the passed coordinates are checked with
+/// the \ref CheckVoxelBounds method before any voxel is set.
+///
+/// \param pCoords Array of count (x, y, z) coordinate triples (3 * count bytes).
+/// \param state   The state to set each voxel to.
+/// \param count   The number of voxels to set.
+///
+/// \see GetVoxelStates | SetVoxelUnchecked
+///
+void TCCube::SetVoxelStates(const byte *pCoords, byte state, size_t count)
+{
+    CheckVoxelBounds(pCoords, count);
+    for (size_t i = 0; i < count; i++, pCoords += 3)
+    {
+        SetVoxelUnchecked(pCoords[0], pCoords[1], pCoords[2], state);
+    }
+}
+
+
+///
+/// \brief Get Voxel States (Batch)
+///
+/// Gets the state of many voxels at once.  All of the passed coordinates are checked
+/// with the \ref CheckVoxelBounds method before any voxel is read.
+///
+/// \param pCoords Array of count (x, y, z) coordinate triples (3 * count bytes).
+/// \param pStates Array of count bytes, which is filled with the state of each voxel.
+/// \param count   The number of voxels to get.
+///
+/// \see SetVoxelStates | GetVoxelUnchecked
+///
+void TCCube::GetVoxelStates(const byte *pCoords, byte *pStates, size_t count)
+{
+    CheckVoxelBounds(pCoords, count);
+    for (size_t i = 0; i < count; i++, pCoords += 3)
+    {
+        pStates[i] = GetVoxelUnchecked(pCoords[0], pCoords[1], pCoords[2]);
+    }
+}
+
+
 ///
 /// \brief Shift Cube State
 ///
 /// Shifts all of the voxels in the cube by the specified offset in the direction of the
 /// specified plane.  The new voxels that are shifted in take the passed state as well.
 ///
+/// In the TC_SHIFT_LINEAR mode, the voxels which remain in the cube are moved in blocks.
+/// In the TC_SHIFT_RING mode, only the origin of the shifted axis is moved, so only the
+/// voxels which are shifted in need to be set.
+///
 /// \param plane   The plane to shift of the voxels in (either TC_XY_PLANE, TC_ZX_PLANE,
 ///                or TC_YZ_PLANE).
 /// \param offset  The offset (positive or negative) to shift in the plane.
 /// \param shiftIn The value that the shifted in voxels take.
 ///
-/// \see   SetPlaneState
+/// \see   SetPlaneState | SetShiftMode
 ///
 void TCCube::Shift(byte plane, sbyte offset, byte shiftIn)
 {
-    switch (plane)
+    // Each plane is shifted along the axis with the same index (e.g. TC_YZ_PLANE along
+    // TC_X_AXIS), so we can use the plane as the axis below.
+    int dist = (offset > 0) ? offset : -offset,     // Number of layers to move.
+        size = sc[plane];                           // Number of layers on the axis.
+    if (dist == 0) return;
+    if (dist >= size)                               // If every layer is shifted out...
+    {
+        ResetCubeState(shiftIn);
+        return;
+    }
+
+    if (shiftMode == TC_SHIFT_RING)
+    {
+        // The voxel at coordinate v moves to v + offset, so the origin moves the other way.
+        origin[plane] = (byte)((origin[plane] + size - offset) % size);
+    }
+    else
+    {
+        // Each block of (layer * size) voxels holds the entire axis (e.g. a z-column for
+        // the z-axis, or the whole buffer for the x-axis), so we move the layers in each.
+        Detach();
+        size_t layer    = stride[plane],
+               blockLen = layer * size,
+               srcPos   = (offset > 0) ? 0 : dist * layer,
+               dstPos   = (offset > 0) ? dist * layer : 0;
+        for (byte *pBlock = pCubeState; pBlock < pCubeState + numVoxels; pBlock += blockLen)
+        {
+            memmove(pBlock + dstPos, pBlock + srcPos, (size - dist) * layer);
+        }
+    }
+    // Finally, shift in as many new layers as we need.
+    for (int i = 0; i < dist; i++)
+    {
+        SetPlaneState(plane, (offset > 0) ? i : size - 1 - i, shiftIn);
+    }
+    MarkChanged();
+}
+
+
+///
+/// \brief Set Shift Mode
+///
+/// Sets how the \ref Shift method moves the voxels in the cube.  When switching to the
+/// TC_SHIFT_LINEAR mode, the voxels are first moved back into linear order.
+///
+/// \param mode The shift mode (TC_SHIFT_LINEAR or TC_SHIFT_RING).
+///
+/// \see Shift | Linearize | origin
+///
+void TCCube::SetShiftMode(byte mode)
+{
+    assert(mode == TC_SHIFT_LINEAR || mode == TC_SHIFT_RING);
+    if (mode == TC_SHIFT_LINEAR) Linearize();
+    shiftMode = mode;
+}
+
+
+///
+/// \brief Get Shift Mode
+///
+/// \returns The current shift mode (TC_SHIFT_LINEAR or TC_SHIFT_RING).
+/// \see     SetShiftMode
+///
+byte TCCube::GetShiftMode() const
+{
+    return shiftMode;
+}
+
+
+///
+/// \brief Fill Box
+///
+/// Sets the state of every voxel in the box between the two passed corners (inclusive).
+/// The corners can be passed in any order, and the box is clipped to the cube.  Each
+/// z-column of the box is filled at once.
+///
+/// \param x1    The x-coordinate of the first corner.
+/// \param y1    The y-coordinate of the first corner.
+/// \param z1    The z-coordinate of the first corner.
+/// \param x2    The x-coordinate of the opposite corner.
+/// \param y2    The y-coordinate of the opposite corner.
+/// \param z2    The z-coordinate of the opposite corner.
+/// \param state The state to set the voxels in the box to.
+///
+/// \see CopyRegion | SetPlaneState
+///
+void TCCube::FillBox(byte x1, byte y1, byte z1, byte x2, byte y2, byte z2, byte state)
+{
+    byte lo[3] = { x1, y1, z1 },
+         hi[3] = { x2, y2, z2 };
+    for (int i = 0; i < 3; i++)
+    {
+        if (lo[i] > hi[i]) std::swap(lo[i], hi[i]);
+        if (lo[i] >= sc[i]) return;                 // The box is outside of the cube.
+        if (hi[i] >= sc[i]) hi[i] = sc[i] - 1;
+    }
+    for (int x = lo[0]; x <= hi[0]; x++)
     {
-        case TC_XY_PLANE:       // For the XY plane, we shift along the Z-axis.
-            if (offset > 0)
+        for (int y = lo[1]; y <= hi[1]; y++)
+        {
+            if (denseState)
             {
-                // Start at the top, and shift each layer up by the offset.
-                for (int z = sc[2] - 1; (z - offset) >= 0; z--)
-                {
-                    for (int x = 0; x < sc[0]; x++)
-                    {
-                        for (int y = 0; y < sc[1]; y++)
-                        {
-                            pCubeState[x][y][z] = pCubeState[x][y][z-offset];
-                        }
-                    }
-                }
-                // Finally, shift in as many new layers as we need.
-                for (int z = 0; (z < offset) && (z < sc[2]); z++)
-                {
-                    SetPlaneState(plane, z, shiftIn);
-                }
+                Detach();
+                FillRow(x, y, lo[2], hi[2] - lo[2] + 1, state);
+                continue;
             }
-            else if (offset < 0)
+            for (int z = lo[2]; z <= hi[2]; z++) SetVoxelState(x, y, z, state);
+        }
+        MarkChanged(x);
+    }
+}
+
+
+///
+/// \brief Copy Region
+///
+/// Copies a box of voxels from the source cube (which may be this cube) into this cube,
+/// either replacing the voxels or combining them with a boolean operation.  The box is
+/// clipped to the bounds of both cubes, and each z-column is copied at once.
+///
+/// \param src   The cube to copy the voxels from.
+/// \param srcX  The x-coordinate of the box's first voxel in the source cube.
+/// \param srcY  The y-coordinate of the box's first voxel in the source cube.
+/// \param srcZ  The z-coordinate of the box's first voxel in the source cube.
+/// \param dstX  The x-coordinate to copy the box's first voxel to in this cube.
+/// \param dstY  The y-coordinate to copy the box's first voxel to in this cube.
+/// \param dstZ  The z-coordinate to copy the box's first voxel to in this cube.
+/// \param sizeX The size (in voxels) of the box in the x-dimension.
+/// \param sizeY The size (in voxels) of the box in the y-dimension.
+/// \param sizeZ The size (in voxels) of the box in the z-dimension.
+/// \param op    How the voxels are combined (TC_BLIT_COPY, TC_BLIT_AND, TC_BLIT_OR, or
+///              TC_BLIT_XOR).  Defaults to TC_BLIT_COPY.
+///
+/// \see Blit | FillBox
+///
+void TCCube::CopyRegion(const TCCube &src, byte srcX, byte srcY, byte srcZ,
+                        byte dstX, byte dstY, byte dstZ, byte sizeX, byte sizeY, byte sizeZ,
+                        byte op)
+{
+    assert(op <= TC_BLIT_XOR);
+    byte srcPos[3] = { srcX,  srcY,  srcZ  },
+         dstPos[3] = { dstX,  dstY,  dstZ  },
+         size[3]   = { sizeX, sizeY, sizeZ };
+    // First, we clip the size of the box to both cubes.
+    for (int i = 0; i < 3; i++)
+    {
+        if (srcPos[i] >= src.sc[i] || dstPos[i] >= sc[i]) return;
+        size[i] = std::min(size[i], (byte)(src.sc[i] - srcPos[i]));
+        size[i] = std::min(size[i], (byte)(sc[i] - dstPos[i]));
+        if (size[i] == 0) return;
+    }
+    const byte *pSrc = src.GetData();
+    size_t srcStride[2] = { src.stride[0], src.stride[1] };
+    byte  *pTemp = NULL;
+    if (&src == this)
+    {
+        // If we're copying within this cube, the box may overlap itself, so we copy the
+        // source box into a temporary buffer first.
+        pTemp = new byte[size[0] * size[1] * size[2]];
+        for (int x = 0; x < size[0]; x++)
+        {
+            for (int y = 0; y < size[1]; y++)
             {
-                // Start at the bottom, and shift each layer down by the offset.
-                for (int z = 0; (z - offset) < sc[2]; z++)
-                {
-                    for (int x = 0; x < sc[0]; x++)
-                    {
-                        for (int y = 0; y < sc[1]; y++)
-                        {
-                            pCubeState[x][y][z] = pCubeState[x][y][z-offset];
-                        }
-                    }
-                }
-                // Finally, shift in as many new layers as we need.
-                for (int z = 1; (z <= (0 - offset)) && (z <= sc[2]); z++)
+                memcpy(pTemp + (x * size[1] + y) * size[2],
+                       pSrc + (srcPos[0] + x) * srcStride[0]
+                            + (srcPos[1] + y) * srcStride[1] + srcPos[2], size[2]);
+            }
+        }
+        pSrc         = pTemp;
+        srcStride[0] = size[1] * size[2];
+        srcStride[1] = size[2];
+        srcPos[0]    = srcPos[1] = srcPos[2] = 0;
+    }
+    Detach();
+    for (int x = 0; x < size[0]; x++)
+    {
+        for (int y = 0; y < size[1]; y++)
+        {
+            const byte *pSrcRow = pSrc + (srcPos[0] + x) * srcStride[0]
+                                       + (srcPos[1] + y) * srcStride[1] + srcPos[2];
+            if (denseState)
+            {
+                CombineRow(dstPos[0] + x, dstPos[1] + y, dstPos[2], size[2], pSrcRow, op);
+                continue;
+            }
+            for (int z = 0; z < size[2]; z++)
+            {
+                byte state = pSrcRow[z];
+                if (op != TC_BLIT_COPY)
                 {
-                    SetPlaneState(plane, sc[2] - z, shiftIn);
+                    byte curr = GetVoxelState(dstPos[0] + x, dstPos[1] + y, dstPos[2] + z);
+                    state = (op == TC_BLIT_AND) ? (curr & state) :
+                            (op == TC_BLIT_OR)  ? (curr | state) : (curr ^ state);
                 }
+                SetVoxelState(dstPos[0] + x, dstPos[1] + y, dstPos[2] + z, state);
+            }
+        }
+        MarkChanged(dstPos[0] + x);
+    }
+    delete[] pTemp;
+}
+
+
+///
+/// \brief Blit
+///
+/// Copies the entire source cube into this cube, with the source cube's (0, 0, 0) voxel
+/// placed at the passed position.  The position may be negative or past the end of this
+/// cube, in which case only the overlapping part of the source cube is copied.
+///
+/// \param src  The cube to copy the voxels from.
+/// \param dstX The x-coordinate to place the source cube's first voxel at.
+/// \param dstY The y-coordinate to place the source cube's first voxel at.
+/// \param dstZ The z-coordinate to place the source cube's first voxel at.
+/// \param op   How the voxels are combined (TC_BLIT_COPY, TC_BLIT_AND, TC_BLIT_OR, or
+///             TC_BLIT_XOR).  Defaults to TC_BLIT_COPY.
+///
+/// \see CopyRegion
+///
+void TCCube::Blit(const TCCube &src, int dstX, int dstY, int dstZ, byte op)
+{
+    int  dstPos[3] = { dstX, dstY, dstZ };
+    byte srcStart[3], dstStart[3], size[3];
+    for (int i = 0; i < 3; i++)
+    {
+        // Clip the part of the source cube which is before the start of this cube...
+        int start = (dstPos[i] < 0) ? -dstPos[i] : 0,
+            len   = src.sc[i] - start;
+        // ...and the part past the end of this cube.
+        if (dstPos[i] + start + len > sc[i]) len = sc[i] - (dstPos[i] + start);
+        if (len <= 0) return;
+        srcStart[i] = (byte)start;
+        dstStart[i] = (byte)(dstPos[i] + start);
+        size[i]     = (byte)len;
+    }
+    CopyRegion(src, srcStart[0], srcStart[1], srcStart[2],
+               dstStart[0], dstStart[1], dstStart[2], size[0], size[1], size[2], op);
+}
+
+
+///
+/// \brief Count Lit Voxels
+///
+/// \returns The number of voxels in the cube with a non-zero state.
+///
+/// \see SumVoxels | GetPlaneCounts | TC_Kernels::Count
+///
+size_t TCCube::CountLitVoxels() const
+{
+    return TC_Kernels::Count(pCubeState, numVoxels);
+}
+
+
+///
+/// \brief Sum Voxels
+///
+/// \returns The sum of the states of every voxel in the cube.
+///
+/// \see CountLitVoxels | TC_Kernels::Sum
+///
+uint64_t TCCube::SumVoxels() const
+{
+    return TC_Kernels::Sum(pCubeState, numVoxels);
+}
+
+
+///
+/// \brief Get Plane Counts
+///
+/// Counts the lit (non-zero) voxels in every plane of the passed orientation at once.
+///
+/// \param plane   The orientation of the planes (TC_XY_PLANE, TC_ZX_PLANE, or
+///                TC_YZ_PLANE).
+/// \param pCounts Array of GetSize(plane) elements, which is filled with the number of
+///                lit voxels in the plane at each offset.
+///
+/// \see GetColumnCounts | GetPlaneState
+///
+void TCCube::GetPlaneCounts(byte plane, size_t *pCounts) const
+{
+    switch (plane)
+    {
+        case TC_YZ_PLANE:
+            // Each yz-plane is one contiguous block of the voxel buffer.
+            for (int x = 0; x < sc[0]; x++)
+            {
+                pCounts[x] = TC_Kernels::Count(pCubeState + AxisIndex(TC_X_AXIS, x)
+                                               * stride[0], stride[0]);
             }
             break;
 
-        case TC_ZX_PLANE:       // For the XZ plane, we shift along the y-axis.
-            if (offset > 0)
+        case TC_ZX_PLANE:
+            // Each x-coordinate holds one contiguous z-column of each zx-plane.
+            for (int y = 0; y < sc[1]; y++)
             {
-                // Start at the top, and shift each layer up by the offset.
-                for (int y = sc[0] - 1; (y - offset) >= 0; y--)
+                pCounts[y] = 0;
+                for (int x = 0; x < sc[0]; x++)
                 {
-                    for (int x = 0; x < sc[0]; x++)
-                    {
-                        for (int z = 0; z < sc[2]; z++)
-                        {
-                            pCubeState[x][y][z] = pCubeState[x][y-offset][z];
-                        }
-                    }
-                }
-                // Finally, shift in as many new layers as we need.
-                for (int y = 0; (y < offset) && (y < sc[1]); y++)
-                {
-                    SetPlaneState(plane, y, shiftIn);
+                    pCounts[y] += TC_Kernels::Count(pCubeState + RowIndex(x, y), sc[2]);
                 }
             }
-            else if (offset < 0)
+            break;
+
+        case TC_XY_PLANE:
+            // Each xy-plane takes a single voxel from every z-column, so we add up the
+            // columns (by their position in the buffer) and then undo the z-axis origin.
+            for (int z = 0; z < sc[2]; z++) pCounts[z] = 0;
+            for (const byte *pRow = pCubeState; pRow < pCubeState + numVoxels;
+                 pRow += stride[1])
             {
-                // Start at the bottom, and shift each layer down by the offset.
-                for (int y = 0; (y - offset) < sc[1]; y++)
-                {
-                    for (int x = 0; x < sc[0]; x++)
-                    {
-                        for (int z = 0; z < sc[2]; z++)
-                        {
-                            pCubeState[x][y][z] = pCubeState[x][y-offset][z];
-                        }
-                    }
-                }
-                // Finally, shift in as many new layers as we need.
-                for (int y = 1; (y <= (0 - offset)) && (y <= sc[1]); y++)
-                {
-                    SetPlaneState(plane, sc[1] - y, shiftIn);
-                }
+                for (int z = 0; z < sc[2]; z++) pCounts[z] += (pRow[z] != 0);
             }
+            std::rotate(pCounts, pCounts + origin[2], pCounts + sc[2]);
             break;
+    }
+}
+
 
-        case TC_YZ_PLANE:       // For the YZ plane, we shift along the x-axis.
-            if (offset > 0)
+///
+/// \brief Get Column Counts
+///
+/// Counts the lit (non-zero) voxels in every column along the passed axis at once.
+///
+/// \param axis    The axis of the columns (TC_X_AXIS, TC_Y_AXIS, or TC_Z_AXIS).
+/// \param pCounts Array with one element for each column, which is filled with the
+///                number of lit voxels in each column.  The column at (dim1, dim2), in
+///                the same order as \ref SetColumnState, is at dim1 * size2 + dim2
+///                (where size2 is the size of the axis of dim2).
+///
+/// \see GetPlaneCounts | GetColumnState
+///
+void TCCube::GetColumnCounts(byte axis, size_t *pCounts) const
+{
+    switch (axis)
+    {
+        case TC_Z_AXIS:
+            // Columns along the z-axis are contiguous, so each one is counted at once.
+            for (int x = 0; x < sc[0]; x++)
             {
-                // Start at the top, and shift each layer up by the offset.
-                for (int x = sc[0] - 1; (x - offset) >= 0; x--)
-                {
-                    for (int y = 0; y < sc[1]; y++)
-                    {
-                        for (int z = 0; z < sc[2]; z++)
-                        {
-                            pCubeState[x][y][z] = pCubeState[x-offset][y][z];
-                        }
-                    }
-                }
-                // Finally, shift in as many new layers as we need.
-                for (int x = 0; (x < offset) && (x < sc[0]); x++)
+                for (int y = 0; y < sc[1]; y++)
                 {
-                    SetPlaneState(plane, x, shiftIn);
+                    pCounts[x * sc[1] + y] = TC_Kernels::Count(pCubeState + RowIndex(x, y),
+                                                               sc[2]);
                 }
             }
-            else if (offset < 0)
+            break;
+
+        case TC_X_AXIS:     // Columns are at (y, z).
+        case TC_Y_AXIS:     // Columns are at (x, z).
+        {
+            // Either way, we add the z-columns (by their position in the buffer) into the
+            // counts, and then undo the z-axis origin for each group of counts.
+            size_t numGroups = sc[(axis == TC_X_AXIS) ? TC_Y_AXIS : TC_X_AXIS];
+            for (size_t i = 0; i < numGroups * sc[2]; i++) pCounts[i] = 0;
+            for (int x = 0; x < sc[0]; x++)
             {
-                // Start at the bottom, and shift each layer down by the offset.
-                for (int x = 0; (x - offset) < sc[0]; x++)
-                {
-                    for (int y = 0; y < sc[1]; y++)
-                    {
-                        for (int z = 0; z < sc[2]; z++)
-                        {
-                            pCubeState[x][y][z] = pCubeState[x-offset][y][z];
-                        }
-                    }
-                }
-                // Finally, shift in as many new layers as we need.
-                for (int x = 1; (x <= (0 - offset)) && (x <= sc[0]); x++)
+                for (int y = 0; y < sc[1]; y++)
                 {
-                    SetPlaneState(plane, sc[0] - x, shiftIn);
+                    const byte *pRow   = pCubeState + RowIndex(x, y);
+                    size_t     *pGroup = pCounts + ((axis == TC_X_AXIS) ? y : x) * sc[2];
+                    for (int z = 0; z < sc[2]; z++) pGroup[z] += (pRow[z] != 0);
                 }
             }
+            for (size_t i = 0; i < numGroups; i++)
+            {
+                std::rotate(pCounts + i * sc[2], pCounts + i * sc[2] + origin[2],
+                            pCounts + (i + 1) * sc[2]);
+            }
             break;
+        }
     }
 }
 
 
 ///
-/// \brief AND Operator
+/// \brief Get Bounding Box
 ///
-/// Performs a logical AND of all elements in the current TCCube with the passed one.
+/// Finds the smallest box which contains every lit (non-zero) voxel in the cube.  Empty
+/// z-columns are skipped with a single comparison each.
 ///
-/// \param ref The reference TCCube object to AND the current object's voxels with.
-/// \remarks Note that this can be used to "mask off" certain voxels.
+/// \param lo Array set to the x, y, and z coordinates of the box's lowest corner.
+/// \param hi Array set to the x, y, and z coordinates of the box's highest corner.
 ///
-void TCCube::OP_AND(const TCCube &ref)
+/// \returns True if any voxel is lit, false otherwise (lo and hi are then unchanged).
+///
+/// \see FillBox | CountLitVoxels
+///
+bool TCCube::GetBoundingBox(byte lo[3], byte hi[3]) const
 {
-    assert( (sc[0] <= ref.sc[0]) && (sc[1] <= ref.sc[1]) && (sc[2] <= ref.sc[2]) );
+    int minPos[3] = { sc[0], sc[1], sc[2] },
+        maxPos[3] = { -1, -1, -1 };
     for (int x = 0; x < sc[0]; x++)
     {
         for (int y = 0; y < sc[1]; y++)
         {
-            for (int z = 0; z < sc[2]; z++)
+            const byte *pRow = pCubeState + RowIndex(x, y);
+            if (TC_Kernels::Equal(pRow, 0x00, sc[2])) continue;
+            minPos[0] = std::min(minPos[0], x); maxPos[0] = x;
+            minPos[1] = std::min(minPos[1], y); maxPos[1] = std::max(maxPos[1], y);
+            // We only need to look for z-coordinates outside of the box found so far.
+            for (int z = 0; z < minPos[2]; z++)
+            {
+                if (pRow[AxisIndex(TC_Z_AXIS, z)] != 0) { minPos[2] = z; break; }
+            }
+            for (int z = sc[2] - 1; z > maxPos[2]; z--)
             {
-                pCubeState[x][y][z] &= ref.pCubeState[x][y][z];
+                if (pRow[AxisIndex(TC_Z_AXIS, z)] != 0) { maxPos[2] = z; break; }
             }
         }
     }
+    if (maxPos[0] < 0) return false;
+    for (int i = 0; i < 3; i++)
+    {
+        lo[i] = (byte)minPos[i];
+        hi[i] = (byte)maxPos[i];
+    }
+    return true;
+}
+
+
+///
+/// \brief AND Operator
+///
+/// Performs a logical AND of all elements in the current TCCube with the passed one.
+///
+/// \param ref The reference TCCube object to AND the current object's voxels with.
+/// \remarks Note that this can be used to "mask off" certain voxels.
+///
+void TCCube::OP_AND(const TCCube &ref)
+{
+    ApplyOperator(ref, '&');
 }
 
 
@@ -636,17 +1021,7 @@ void TCCube::OP_AND(const TCCube &ref)
 ///
 void TCCube::OP_OR(const TCCube &ref)
 {
-    assert( (sc[0] <= ref.sc[0]) && (sc[1] <= ref.sc[1]) && (sc[2] <= ref.sc[2]) );
-    for (int x = 0; x < sc[0]; x++)
-    {
-        for (int y = 0; y < sc[1]; y++)
-        {
-            for (int z = 0; z < sc[2]; z++)
-            {
-                pCubeState[x][y][z] |= ref.pCubeState[x][y][z];
-            }
-        }
-    }
+    ApplyOperator(ref, '|');
 }
 
 
@@ -660,17 +1035,7 @@ void TCCube::OP_OR(const TCCube &ref)
 ///
 void TCCube::OP_XOR(const TCCube &ref)
 {
-    assert( (sc[0] <= ref.sc[0]) && (sc[1] <= ref.sc[1]) && (sc[2] <= ref.sc[2]) );
-    for (int x = 0; x < sc[0]; x++)
-    {
-        for (int y = 0; y < sc[1]; y++)
-        {
-            for (int z = 0; z < sc[2]; z++)
-            {
-                pCubeState[x][y][z] ^= ref.pCubeState[x][y][z];
-            }
-        }
-    }
+    ApplyOperator(ref, '^');
 }
 
 
@@ -683,52 +1048,292 @@ void TCCube::OP_XOR(const TCCube &ref)
 ///
 void TCCube::OP_NOT()
 {
-    for (int x = 0; x < sc[0]; x++)
+    Detach();
+    TC_Kernels::Not(pCubeState, numVoxels);
+    MarkChanged();
+}
+
+
+///
+/// \brief Get Voxel Data
+///
+/// Returns a pointer to the first voxel in the internal voxel buffer, which can be used
+/// to read or write many voxels without calling a method for each one.  The voxel at
+/// (x, y, z) is located at x * GetStride(TC_X_AXIS) + y * GetStride(TC_Y_AXIS) + z.
+///
+/// \returns A pointer to the voxel buffer (aligned to \ref TC_CUBE_ALIGN bytes).
+///
+/// \remarks The pointer is valid until the TCCube object is destroyed.  No bounds
+///          checking is performed on any access made through the returned pointer.
+///          In the TC_SHIFT_RING mode, the voxels are first moved into linear order, and
+///          the layout only remains linear until the next call to \ref Shift.
+/// \see     GetStride | GetNumVoxels | pCubeState
+///
+byte *TCCube::GetData() const
+{
+    Linearize();    // Consumers of the raw buffer always expect it in linear order.
+    return pCubeState;
+}
+
+
+///
+/// \brief Get Stride
+///
+/// Returns the distance (in voxels) between two adjacent voxels along the passed axis in
+/// the buffer returned by \ref GetData.
+///
+/// \param axis The axis to get the stride of (TC_X_AXIS, TC_Y_AXIS, or TC_Z_AXIS).
+///
+/// \returns The number of voxels between two neighbours on the passed axis.
+/// \see     GetData | stride
+///
+size_t TCCube::GetStride(byte axis) const
+{
+    assert(axis <= TC_Z_AXIS);
+    return stride[axis];
+}
+
+
+///
+/// \brief Get Size
+///
+/// Returns the number of voxels in the cube along the passed axis.
+///
+/// \param axis The axis to get the size of (TC_X_AXIS, TC_Y_AXIS, or TC_Z_AXIS).
+///
+/// \returns The size (in voxels) of the passed dimension.
+/// \see     sc
+///
+byte TCCube::GetSize(byte axis) const
+{
+    assert(axis <= TC_Z_AXIS);
+    return sc[axis];
+}
+
+
+///
+/// \brief Get Number of Voxels
+///
+/// Returns the total number of voxels in the cube, which is also the length (in bytes)
+/// of the buffer returned by \ref GetData.
+///
+/// \returns The number of voxels in the cube.
+/// \see     numVoxels
+///
+size_t TCCube::GetNumVoxels() const
+{
+    return numVoxels;
+}
+
+
+///
+/// \brief Get Generation
+///
+/// Returns the generation number of the last change made to the cube.  Generations only
+/// ever increase (and are unique between all cubes), so the state of the cube is known to
+/// be unchanged as long as this returns the same number.
+///
+/// \returns The generation of the last change made to any voxel in the cube.
+/// \see     GetSliceGeneration | GetChangedSlices | generation
+///
+uint64_t TCCube::GetGeneration() const
+{
+    return generation;
+}
+
+
+///
+/// \brief Get Slice Generation
+///
+/// Returns the generation number of the last change made to the yz-plane at x.
+///
+/// \param x The x-coordinate of the yz-plane.
+///
+/// \returns The generation of the last change made to any voxel in the yz-plane.
+/// \see     GetGeneration | sliceGen
+///
+uint64_t TCCube::GetSliceGeneration(byte x) const
+{
+    assert(x < sc[0]);
+    return sliceGen[x];
+}
+
+
+///
+/// \brief Get Changed Slices
+///
+/// Finds the range of yz-planes which were changed after the passed generation number
+/// (e.g. a value previously returned by \ref GetGeneration).
+///
+/// \param sinceGen The generation to compare the yz-planes to.
+/// \param firstX   Set to the x-coordinate of the first changed yz-plane.
+/// \param lastX    Set to the x-coordinate of the last changed yz-plane.
+///
+/// \returns True if any yz-plane has changed (in which case firstX and lastX are set),
+///          false if the cube is unchanged since the passed generation.
+/// \see     GetGeneration | GetSliceGeneration
+///
+bool TCCube::GetChangedSlices(uint64_t sinceGen, byte &firstX, byte &lastX) const
+{
+    if (generation <= sinceGen) return false;
+    int x = 0;
+    while (sliceGen[x] <= sinceGen) x++;    // At least one slice must be newer.
+    firstX = lastX = (byte)x;
+    for (; x < sc[0]; x++)
     {
-        for (int y = 0; y < sc[1]; y++)
-        {
-            for (int z = 0; z < sc[2]; z++)
-            {
-                pCubeState[x][y][z] = !pCubeState[x][y][z];
-            }
-        }
+        if (sliceGen[x] > sinceGen) lastX = (byte)x;
     }
+    return true;
+}
+
+
+///
+/// \brief New Generation
+///
+/// Takes a new generation number, for state which is not stored in a cube but is
+/// compared with cube generations (e.g. the palette of an animation, see
+/// TCAnim::SetPaletteColor).
+///
+/// \returns A generation number greater than any previously given to a cube.
+/// \see     GetGeneration | lastGeneration
+///
+uint64_t TCCube::NewGeneration()
+{
+    return __atomic_add_fetch(&lastGeneration, 1, __ATOMIC_RELAXED);
+}
+
+
+///
+/// \brief Set Dimensions
+///
+/// Stores each size into the private cube size attribute array \ref sc, and computes
+/// the stride of each axis (with the z-axis varying fastest, so columns along z are
+/// contiguous) and the total number of voxels.  This also resets the origin of each axis
+/// and the shift mode (to TC_SHIFT_LINEAR), and stamps every yz-plane with a new
+/// generation.  No memory is allocated.
+///
+/// \param sizeX The size (in voxels) of the x-dimension.
+/// \param sizeY The size (in voxels) of the y-dimension.
+/// \param sizeZ The size (in voxels) of the z-dimension.
+///
+/// \see sc | stride | numVoxels | origin | AllocateCube
+///
+void TCCube::SetDimensions(byte sizeX, byte sizeY, byte sizeZ)
+{
+    sc[0] = sizeX; sc[1] = sizeY; sc[2] = sizeZ;
+    stride[2] = 1;
+    stride[1] = stride[2] * sizeZ;
+    stride[0] = stride[1] * sizeY;
+    numVoxels = stride[0] * sizeX;
+    origin[0] = origin[1] = origin[2] = 0;
+    shiftMode = TC_SHIFT_LINEAR;
+    MarkChanged();
 }
 
 
 ///
 /// \brief Allocate Cube
 ///
-/// Called by the TCCube constructor.  This method allocates memory by iterating through
-/// each "dimension" in the \ref pCubeState array and allocating a new block of memory
-/// big enough to store the voxels for that dimension.
+/// Called by the TCCube constructor.  This method allocates a single block of memory big
+/// enough to store every voxel in the cube, and aligns the \ref pCubeState pointer within
+/// it to a \ref TC_CUBE_ALIGN byte boundary.
 ///
-/// When the memory is initialized, each size is stored into the private cube size
-/// attribute array \ref sc, and the \ref ResetCubeState method is called.
+/// Before the memory is allocated, the cube dimensions are stored by calling the
+/// \ref SetDimensions method.  Afterwards, the voxel buffer is allocated and cleared to
+/// zero by the \ref AllocateBuffer method.
 ///
 /// \param sizeX The size (in voxels) of the x-dimension.
 /// \param sizeY The size (in voxels) of the y-dimension.
 /// \param sizeZ The size (in voxels) of the z-dimension.
 ///
-/// \see pCubeState | ResetCubeState | sc
+/// \see pCubeState | pCubeAlloc | SetDimensions | AllocateBuffer
 ///
 void TCCube::AllocateCube(byte sizeX, byte sizeY, byte sizeZ)
 {
-    // Initially, pCubeState is an array of pointers to pointers of booleans.
-    // First, we need to initialize the x-dimension (pointers to pointers of booleans).
-    pCubeState = new byte**[sizeX];
-    for (int x = 0; x < sizeX; x++)
+    SetDimensions(sizeX, sizeY, sizeZ);             // First we store the cube dimensions,
+    AllocateBuffer();                               // then allocate the voxel buffer,
+    denseState = true;                              // which holds the voxel states.
+}
+
+
+///
+/// \brief Allocate Buffer
+///
+/// Allocates the voxel buffer for the dimensions already stored by \ref SetDimensions
+/// (which derived storage types may only need when \ref GetData is called), and clears
+/// every voxel state to zero.
+///
+/// \see pCubeState | pCubeAlloc | AllocateCube
+///
+void TCCube::AllocateBuffer()
+{
+    pCubeState = NewBuffer(numVoxels, pCubeAlloc);
+    memset(pCubeState, 0, numVoxels);               // Finally, we clear all voxel states.
+}
+
+
+///
+/// \brief New Buffer
+///
+/// Allocates a reference counted voxel buffer, with the reference count set to 1.  The
+/// block starts with the reference count, followed by the voxels (aligned to
+/// \ref TC_CUBE_ALIGN bytes).
+///
+/// \param size   The number of voxels in the buffer.
+/// \param pAlloc Set to the start of the allocated block (see \ref ReleaseBuffer).
+///
+/// \returns A pointer to the first (uncleared) voxel in the buffer.
+/// \see     pCubeAlloc | ReleaseBuffer
+///
+byte *TCCube::NewBuffer(size_t size, byte *&pAlloc)
+{
+    // We allocate enough extra bytes for the reference count, and to move the start of
+    // the buffer up to the next aligned address (TC_CUBE_ALIGN is a power of two, so we
+    // can just mask the address).
+    pAlloc = new byte[size + 2 * TC_CUBE_ALIGN];
+    *(int *)pAlloc = 1;
+    return (byte*)(((size_t)pAlloc + sizeof(int) + (TC_CUBE_ALIGN - 1))
+                   & ~(size_t)(TC_CUBE_ALIGN - 1));
+}
+
+
+///
+/// \brief Release Buffer
+///
+/// Releases one reference to a buffer allocated by \ref NewBuffer, and deletes the
+/// buffer if that was the last one.
+///
+/// \param pAlloc The start of the allocated block (may be NULL).
+///
+/// \remarks Copies of a cube may be released by a different thread than the one which
+///          modifies the cube, so the reference count is changed atomically.
+/// \see     pCubeAlloc | NewBuffer
+///
+void TCCube::ReleaseBuffer(byte *pAlloc)
+{
+    if (pAlloc != NULL && __atomic_sub_fetch((int *)pAlloc, 1, __ATOMIC_ACQ_REL) == 0)
     {
-        // Next, we initialize the y-dimension (pointers to booleans).
-        pCubeState[x] = new byte*[sizeY];
-        for (int y = 0; y < sizeY; y++)
-        {
-            // Finally, we initialize the z-dimension (booleans).
-            pCubeState[x][y] = new byte[sizeZ];
-        }
+        delete[] pAlloc;
     }
-    sc[0] = sizeX; sc[1] = sizeY; sc[2] = sizeZ;   // Finally we store the cube dimensions,
-    ResetCubeState();                              // and reset all of the voxel states.
+}
+
+
+///
+/// \brief Unshare
+///
+/// Copies the voxel buffer (which is shared with at least one other cube) into a new
+/// buffer owned by this cube only, and releases this cube's reference to the old one.
+/// This is called through \ref Detach before any voxel is modified.
+///
+/// \see Detach | IsShared | pCubeAlloc
+///
+void TCCube::Unshare() const
+{
+    byte *pOldAlloc = pCubeAlloc,
+         *pOldState = pCubeState;
+    pCubeState = NewBuffer(numVoxels, pCubeAlloc);
+    memcpy(pCubeState, pOldState, numVoxels);
+    ReleaseBuffer(pOldAlloc);
 }
 
 
@@ -746,9 +1351,196 @@ void TCCube::AllocateCube(byte sizeX, byte sizeY, byte sizeZ)
 ///
 /// \see sc
 ///
-void TCCube::CheckVoxelBounds(byte x, byte y, byte z)
+void TCCube::CheckVoxelBounds(byte x, byte y, byte z) const
 {
     // Since all dimensions are defined as byte-type (unsigned char), we don't need to
     // check the lower-bound.  So, we check if the passed sizes exceed the size bounds.
     assert( (x < sc[0]) && (y < sc[1]) && (z < sc[2]) );
 }
+
+
+///
+/// \brief Check Voxel Bounds (Batch)
+///
+/// Validates many coordinates at once, by finding the largest coordinate on each axis
+/// and checking it with the internally held cube size.
+///
+/// \param pCoords Array of count (x, y, z) coordinate triples (3 * count bytes).
+/// \param count   The number of coordinates to validate.
+///
+/// \see sc | SetVoxelStates | GetVoxelStates
+///
+void TCCube::CheckVoxelBounds(const byte *pCoords, size_t count) const
+{
+    byte maxCoord[3] = { 0, 0, 0 };
+    for (size_t i = 0; i < 3 * count; i += 3)
+    {
+        if (pCoords[i]   > maxCoord[0]) maxCoord[0] = pCoords[i];
+        if (pCoords[i+1] > maxCoord[1]) maxCoord[1] = pCoords[i+1];
+        if (pCoords[i+2] > maxCoord[2]) maxCoord[2] = pCoords[i+2];
+    }
+    CheckVoxelBounds(maxCoord[0], maxCoord[1], maxCoord[2]);
+}
+
+
+///
+/// \brief Linearize
+///
+/// Moves the voxels in the buffer so the origin of each axis is at 0 (i.e. the voxel at
+/// (x, y, z) is located at x * stride[0] + y * stride[1] + z).  This does nothing unless
+/// a shift was made in the TC_SHIFT_RING mode.
+///
+/// \remarks This method is const since the state of each voxel does not change, only the
+///          layout of the buffer (which is why the \ref origin array is mutable).
+/// \see     origin | GetData
+///
+void TCCube::Linearize() const
+{
+    if (origin[0] == 0 && origin[1] == 0 && origin[2] == 0) return;
+    Detach();       // Rotating the buffer would also move the voxels of any other cube.
+    // Each axis is rotated on its own, starting with the z-columns...
+    if (origin[2] != 0)
+    {
+        for (byte *pRow = pCubeState; pRow < pCubeState + numVoxels; pRow += stride[1])
+        {
+            std::rotate(pRow, pRow + origin[2], pRow + stride[1]);
+        }
+    }
+    // ...then the rows of each yz-plane...
+    if (origin[1] != 0)
+    {
+        for (byte *pPlane = pCubeState; pPlane < pCubeState + numVoxels;
+             pPlane += stride[0])
+        {
+            std::rotate(pPlane, pPlane + origin[1] * stride[1], pPlane + stride[0]);
+        }
+    }
+    // ...and finally the yz-planes themselves.
+    if (origin[0] != 0)
+    {
+        std::rotate(pCubeState, pCubeState + origin[0] * stride[0], pCubeState + numVoxels);
+    }
+    origin[0] = origin[1] = origin[2] = 0;
+}
+
+
+///
+/// \brief Apply Operator
+///
+/// Performs the AND ('&'), OR ('|'), or XOR ('^') operator between this cube and the
+/// passed one, using the currently selected cube kernel.  If both cubes have the same
+/// layout, the voxel buffers are combined in a single pass.  Otherwise, each z-column is
+/// combined on its own (in up to two parts, if the z-axis origin is not 0).
+///
+/// \param ref The reference cube object (at least as big as this one in each dimension).
+/// \param op  The operator to apply ('&', '|', or '^').
+///
+/// \see OP_AND | OP_OR | OP_XOR | TC_Kernels
+///
+void TCCube::ApplyOperator(const TCCube &ref, char op)
+{
+    assert( (sc[0] <= ref.sc[0]) && (sc[1] <= ref.sc[1]) && (sc[2] <= ref.sc[2]) );
+    TC_Kernels::BinaryOp kernel = (op == '&') ? TC_Kernels::And :
+                                  (op == '|') ? TC_Kernels::Or  : TC_Kernels::Xor;
+    Detach();                           // (before ref.GetData, in case ref is this cube)
+    const byte *pRef = ref.GetData();   // Note that the reference is now in linear order.
+    if (    numVoxels == ref.numVoxels  // If both cubes have the same layout...
+         && origin[0] == 0 && origin[1] == 0 && origin[2] == 0 )
+    {
+        // We can just walk both voxel buffers linearly.
+        kernel(pCubeState, pRef, numVoxels);
+        MarkChanged();
+        return;
+    }
+    // Otherwise, each column along the z-axis is still contiguous in both buffers (but
+    // the z-coordinate 0 is located at origin[2] in the columns of this cube).
+    size_t split = sc[2] - origin[2];
+    for (int x = 0; x < sc[0]; x++)
+    {
+        for (int y = 0; y < sc[1]; y++)
+        {
+            byte       *pRow    = pCubeState + RowIndex(x, y);
+            const byte *pRefRow = pRef + x * ref.stride[0] + y * ref.stride[1];
+            kernel(pRow + origin[2], pRefRow, split);
+            kernel(pRow, pRefRow + split, origin[2]);
+        }
+    }
+    MarkChanged();
+}
+
+
+///
+/// \brief Mark Changed
+///
+/// Takes a new generation number for the cube, and stamps every yz-plane with it.  This
+/// is called after any change which may affect more than a single yz-plane (changes to a
+/// single yz-plane use the inline MarkChanged(x) overload instead).
+///
+/// \remarks Each cube is only modified by one thread at a time, but cubes of different
+///          animations may be modified at once, so the shared \ref lastGeneration
+///          counter is incremented atomically (see \ref NewGeneration).
+/// \see     generation | sliceGen
+///
+void TCCube::MarkChanged()
+{
+    generation = NewGeneration();
+    for (int x = 0; x < sc[0]; x++)
+    {
+        sliceGen[x] = generation;
+    }
+}
+
+
+///
+/// \brief Fill Row
+///
+/// Sets the state of len voxels in the z-column at (x, y), starting at z.  If the z-axis
+/// origin is not 0, the voxels may wrap around the end of the column, so the fill is
+/// split into (at most) two parts.
+///
+/// \param x     The x-coordinate of the z-column.
+/// \param y     The y-coordinate of the z-column.
+/// \param z     The z-coordinate of the first voxel to set.
+/// \param len   The number of voxels to set (z + len must not exceed the cube size).
+/// \param state The state to set the voxels to.
+///
+void TCCube::FillRow(byte x, byte y, byte z, size_t len, byte state)
+{
+    byte  *pRow  = pCubeState + RowIndex(x, y);
+    size_t start = AxisIndex(TC_Z_AXIS, z),
+           first = std::min(len, sc[2] - start);
+    memset(pRow + start, state, first);
+    memset(pRow, state, len - first);
+}
+
+
+///
+/// \brief Combine Row
+///
+/// Combines len voxels in the z-column at (x, y), starting at z, with the voxels in the
+/// passed array, using one of the TC_BLIT_ operations (see \ref FillRow for how the
+/// z-axis origin is handled).
+///
+/// \param x    The x-coordinate of the z-column.
+/// \param y    The y-coordinate of the z-column.
+/// \param z    The z-coordinate of the first voxel to combine.
+/// \param len  The number of voxels to combine (z + len must not exceed the cube size).
+/// \param pSrc Array of len voxel states to combine with the column.
+/// \param op   The operation (TC_BLIT_COPY, TC_BLIT_AND, TC_BLIT_OR, or TC_BLIT_XOR).
+///
+void TCCube::CombineRow(byte x, byte y, byte z, size_t len, const byte *pSrc, byte op)
+{
+    byte  *pRow  = pCubeState + RowIndex(x, y);
+    size_t start = AxisIndex(TC_Z_AXIS, z),
+           first = std::min(len, sc[2] - start);
+    if (op == TC_BLIT_COPY)
+    {
+        memcpy(pRow + start, pSrc, first);
+        memcpy(pRow, pSrc + first, len - first);
+        return;
+    }
+    TC_Kernels::BinaryOp kernel = (op == TC_BLIT_AND) ? TC_Kernels::And :
+                                  (op == TC_BLIT_OR)  ? TC_Kernels::Or  : TC_Kernels::Xor;
+    kernel(pRow + start, pSrc, first);
+    kernel(pRow, pSrc + first, len - first);
+}
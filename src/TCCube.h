@@ -29,6 +29,9 @@
 #ifndef TC_CUBE_
 #define TC_CUBE_
 
+#include <cstddef>              // Used for the size_t type.
+#include <stdint.h>             // Used for the uint64_t type.
+
 // Axis Definitions
 #define TC_X_AXIS   0           ///< Specifies the x-axis.
 #define TC_Y_AXIS   1           ///< Specifies the y-axis.
@@ -39,6 +42,18 @@
 #define TC_ZX_PLANE 1           ///< Specifies the xz-plane.
 #define TC_XY_PLANE 2           ///< Specifies the xy-plane.
 
+// Shift Mode Definitions
+#define TC_SHIFT_LINEAR 0       ///< Shift moves every voxel in the voxel buffer.
+#define TC_SHIFT_RING   1       ///< Shift only moves the origin of the shifted axis.
+
+// Blit Operation Definitions
+#define TC_BLIT_COPY    0       ///< The source voxels replace the destination voxels.
+#define TC_BLIT_AND     1       ///< The source voxels are ANDed with the destination.
+#define TC_BLIT_OR      2       ///< The source voxels are ORed with the destination.
+#define TC_BLIT_XOR     3       ///< The source voxels are XORed with the destination.
+
+#define TC_CUBE_ALIGN 32         ///< Byte alignment of the voxel buffer (one AVX register).
+
 typedef unsigned char  byte;    ///< A single byte, defined as an unsigned char (0 - 255).
 typedef signed   char sbyte;    ///< A single byte, defined as a signed char (-127 - 128).
 
@@ -54,7 +69,8 @@ const byte TC_OAXIS[3][2] = { {TC_Y_AXIS, TC_Z_AXIS},
 /// discrete voxels, each with a particular state.
 ///
 /// \remarks The terms cube and rectangular prism may be interchanged, depending on
-///          the particular context.
+///          the particular context.  Other voxel storage types (e.g. TCCubeBits) inherit
+///          this class, and override the virtual state setting and getting methods.
 ///
 class TCCube
 {
@@ -63,45 +79,176 @@ class TCCube
     TCCube(byte cubeSize);                          // Literal cube constructor.
     TCCube(byte sizeX, byte sizeY, byte sizeZ);     // Arbitrary size constructor.
     TCCube(byte tccSize[3]);                        // Same as above, but with an array.
-    TCCube(const TCCube &toCopy);                   // Copy constructor.
-    ~TCCube();                                      // TCCube destructor.
+    TCCube(const TCCube &toCopy);                   // Copy constructor (shares voxels).
+    virtual ~TCCube();                              // TCCube destructor.
+    virtual TCCube *Clone() const;                  // Copies a cube of any storage type.
 
-    void ResetCubeState(byte state = 0);            // Resets all voxels in the cube.
+    virtual void ResetCubeState(byte state = 0);    // Resets all voxels in the cube.
 
     // State setting and getting methods:
-    void SetVoxelState(byte x, byte y, byte z, byte state);
-    void SetVoxelState(byte cVoxel[3], byte state);
-    byte GetVoxelState(byte x, byte y, byte z);
-    byte GetVoxelState(byte cVoxel[3]);
-    void SetColumnState(byte axis, byte dim1, byte dim2, byte state);
-    bool GetColumnState(byte axis, byte dim1, byte dim2, byte cmpVal);
-    void SetPlaneState(byte plane, byte offset, byte state);
-    bool GetPlaneState(byte plane, byte offset, byte cmpVal);
+    virtual void SetVoxelState(byte x, byte y, byte z, byte state);
+    void         SetVoxelState(byte cVoxel[3], byte state);
+    virtual byte GetVoxelState(byte x, byte y, byte z);
+    byte         GetVoxelState(byte cVoxel[3]);
+    virtual void SetColumnState(byte axis, byte dim1, byte dim2, byte state);
+    virtual bool GetColumnState(byte axis, byte dim1, byte dim2, byte cmpVal);
+    virtual void SetPlaneState(byte plane, byte offset, byte state);
+    virtual bool GetPlaneState(byte plane, byte offset, byte cmpVal);
+
+    // Batch methods for count (x, y, z) triples in pCoords (bounds are checked once):
+    void SetVoxelStates(const byte *pCoords, const byte *pStates, size_t count);
+    void SetVoxelStates(const byte *pCoords, byte state, size_t count);
+    void GetVoxelStates(const byte *pCoords, byte *pStates, size_t count);
+
+    // Unchecked voxel access, for loops which have already validated the coordinates:
+    byte GetVoxelUnchecked(byte x, byte y, byte z)
+        { return denseState ? pCubeState[VoxelIndex(x, y, z)] : GetVoxelState(x, y, z); }
+    void SetVoxelUnchecked(byte x, byte y, byte z, byte state)
+    {
+        if (!denseState) { SetVoxelState(x, y, z, state); return; }
+        Detach();
+        pCubeState[VoxelIndex(x, y, z)] = state;
+        MarkChanged(x);
+    }
     
     // Shifts contents of the cube in the specified plane by the specified axis.
-    void Shift(byte plane, sbyte offset, byte shiftIn = 0x00);
+    virtual void Shift(byte plane, sbyte offset, byte shiftIn = 0x00);
+    // Sets how the Shift method moves the voxels (TC_SHIFT_LINEAR or TC_SHIFT_RING).
+    virtual void SetShiftMode(byte mode);
+    byte         GetShiftMode() const;
+
+    // Region methods (each region is clipped to the bounds of the cube):
+    virtual void FillBox(byte x1, byte y1, byte z1, byte x2, byte y2, byte z2, byte state);
+    void CopyRegion(const TCCube &src, byte srcX, byte srcY, byte srcZ,
+                    byte dstX, byte dstY, byte dstZ, byte sizeX, byte sizeY, byte sizeZ,
+                    byte op = TC_BLIT_COPY);
+    void Blit(const TCCube &src, int dstX, int dstY, int dstZ, byte op = TC_BLIT_COPY);
+
+    // Reductions (a voxel is lit if its state is non-zero):
+    virtual size_t   CountLitVoxels() const;                    // Number of lit voxels.
+    virtual uint64_t SumVoxels() const;                         // Sum of all voxel states.
+    virtual void     GetPlaneCounts(byte plane, size_t *pCounts) const;
+    virtual void     GetColumnCounts(byte axis, size_t *pCounts) const;
+    virtual bool     GetBoundingBox(byte lo[3], byte hi[3]) const;
 
     // Cube operators:
-    void OP_AND(const TCCube &ref);
-    void OP_OR(const TCCube &ref);
-    void OP_XOR(const TCCube &ref);
-    void OP_NOT();
+    virtual void OP_AND(const TCCube &ref);
+    virtual void OP_OR(const TCCube &ref);
+    virtual void OP_XOR(const TCCube &ref);
+    virtual void OP_NOT();
 
-  private:
+    // Raw voxel buffer access (always in linear order, see SetShiftMode):
+    virtual byte *GetData() const;                  // Pointer to the first voxel.
+    size_t GetStride(byte axis) const;              // Distance between voxels on an axis.
+    byte   GetSize(byte axis) const;                // Number of voxels on an axis.
+    size_t GetNumVoxels() const;                    // Total number of voxels.
+
+    // Change tracking methods (see generation):
+    uint64_t GetGeneration() const;                 // Generation of the last change.
+    uint64_t GetSliceGeneration(byte x) const;      // Same, but for a single yz-plane.
+    bool     GetChangedSlices(uint64_t sinceGen, byte &firstX, byte &lastX) const;
+    static uint64_t NewGeneration();                // Number for a change outside a cube.
+
+  protected:
+    // Used by derived storage types, which may not need the voxel buffer allocated.
+    TCCube(byte sizeX, byte sizeY, byte sizeZ, bool allocate);
+
+    // Sets the sc, stride, numVoxels, and origin variables without allocating any memory.
+    void SetDimensions(byte x, byte y, byte z);
     // Dynamically allocates memory for the object, and sets the sx, sy, and sz variables.
     void AllocateCube(byte x, byte y, byte z);
+    // Allocates (and clears) the voxel buffer for the already set dimensions.
+    void AllocateBuffer();
+    // Allocates or releases a reference counted voxel buffer (see pCubeAlloc).
+    static byte *NewBuffer(size_t size, byte *&pAlloc);
+    static void  ReleaseBuffer(byte *pAlloc);
+    // True if another cube shares the voxel buffer (see the copy constructor).
+    bool IsShared() const
+    {
+        return    pCubeAlloc != NULL
+               && __atomic_load_n((int *)pCubeAlloc, __ATOMIC_ACQUIRE) > 1;
+    }
+    // Gives this cube its own copy of the voxel buffer, if it is shared.
+    void Detach() const { if (IsShared()) Unshare(); }
+    void Unshare() const;
+    // Stamps every yz-plane (or only the one at x) with a new generation number.
+    void MarkChanged();
+    void MarkChanged(byte x)
+    {
+        generation = sliceGen[x] = __atomic_add_fetch(&lastGeneration, 1, __ATOMIC_RELAXED);
+    }
     // Used whenever a dimension is passed to the object to prevent memory access errors.
-    void CheckVoxelBounds(byte x, byte y, byte z);
+    void CheckVoxelBounds(byte x, byte y, byte z) const;
+    // Same as above, but validates count (x, y, z) triples at once.
+    void CheckVoxelBounds(const byte *pCoords, size_t count) const;
+    // Moves the voxels in the buffer so the origin of each axis is at 0 again.
+    void Linearize() const;
+    // Converts a coordinate on one axis into its position in the buffer (see origin).
+    size_t AxisIndex(byte axis, byte v) const
+        { size_t p = v + origin[axis]; return (p >= sc[axis]) ? p - sc[axis] : p; }
+    // Returns the offset of the z-column at (x, y) in the buffer (rotated by origin[2]).
+    size_t RowIndex(byte x, byte y) const
+        { return AxisIndex(0, x) * stride[0] + AxisIndex(1, y) * stride[1]; }
+    // Converts a voxel coordinate into an offset into the pCubeState buffer.
+    size_t VoxelIndex(byte x, byte y, byte z) const
+        { return RowIndex(x, y) + AxisIndex(2, z); }
 
-    /// \brief Three-dimensional array holding the state of each voxel.
+    /// \brief Contiguous array holding the state of each voxel.
+    ///
+    /// Points into \ref pCubeAlloc, aligned to \ref TC_CUBE_ALIGN bytes.  Voxels are
+    /// stored with z varying fastest, then y, then x (see \ref stride).  Derived storage
+    /// types may leave this as NULL until \ref GetData is called.
+    mutable byte *pCubeState;
+    /// \brief True if \ref pCubeState holds the voxel states.
+    ///
+    /// False for derived storage types, where the voxel buffer is only an unpacked copy of
+    /// the state (see \ref GetData), so the unchecked accessors use the virtual methods.
+    bool denseState;
+    /// \brief The unaligned block of memory that \ref pCubeState points into.
+    ///
+    /// Dynamically allocated when the TCCube object constructor is called.  The block
+    /// starts with an int holding the number of cubes sharing it, so copies of a cube
+    /// share the same voxels until one of them is modified (see \ref Detach).
+    mutable byte *pCubeAlloc;
+    /// \brief Array holding the distance (in voxels) between adjacent voxels on each axis.
+    size_t stride[3];
+    /// \brief The total number of voxels in the cube (sc[0] * sc[1] * sc[2]).
+    size_t numVoxels;
+    /// \brief Array holding the position in the buffer of coordinate 0 on each axis.
     ///
-    /// Dynamically allocated when the TCCube object constructor is called.
-    byte ***pCubeState;
+    /// Always 0 in the TC_SHIFT_LINEAR mode.  In the TC_SHIFT_RING mode, the Shift method
+    /// moves the origin instead of the voxels, and each axis wraps around at its end.  The
+    /// \ref Linearize method (called by \ref GetData) moves the origins back to 0.
+    mutable byte origin[3];
+    /// \brief The current shift mode (TC_SHIFT_LINEAR or TC_SHIFT_RING).
+    byte shiftMode;
+    /// \brief The generation number of the last change made to the cube.
+    ///
+    /// Every method which modifies a voxel takes a new number from \ref lastGeneration,
+    /// so the generations of all cubes only ever increase, and are never reused.
+    uint64_t generation;
+    /// \brief Array holding the generation of the last change made to each yz-plane.
+    uint64_t sliceGen[256];
+    /// \brief The last generation number given to any cube (see \ref MarkChanged).
+    ///
+    /// Only modified atomically, since the animation slots modify cubes on several
+    /// threads at once (see TCSlotEngine).
+    static uint64_t lastGeneration;
     /// \brief Array holding the number of cube voxels in each dimension.
     ///
     /// Each dimension is consistent with the axis definitions (e.g. TC_X_AXIS) at the top
     /// of this file (also consistent with the remaining dimension from plane definitions).
     byte sc[3];
+
+  private:
+    // Not implemented (cubes are copied with the copy constructor or Clone).
+    TCCube &operator=(const TCCube &);
+    // Performs one of the AND/OR/XOR operators using the selected cube kernel.
+    void ApplyOperator(const TCCube &ref, char op);
+    // Fills, or combines (with a TC_BLIT_ operation) len voxels of the z-column at (x, y)
+    // starting at z, taking the z-axis origin into account.
+    void FillRow(byte x, byte y, byte z, size_t len, byte state);
+    void CombineRow(byte x, byte y, byte z, size_t len, const byte *pSrc, byte op);
 };
 
 
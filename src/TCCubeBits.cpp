@@ -0,0 +1,960 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *                          TCCubeBits Object  Source Code                             *
+ *                                      TRICLYSM                                       *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  This file contains the implementation of the TCCubeBits class as defined by the    *
+ *  TCCubeBits.h header file.  This class inherits the TCCube class, but only stores   *
+ *  a single bit (on or off) for each voxel, packed into 64-bit words.                 *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  Copyright (C) 2011 Brandon Castellano, Ryan Mantha. All rights reserved.           *
+ *  Triclysm is provided under the BSD-2-Clause license. This program uses the SDL     *
+ *  (Simple DirectMedia Layer) library, and the Lua scripting language. See the        *
+ *  included LICENSE file or <http://www.triclysm.com/> for more details.              *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+///
+/// \file  TCCubeBits.cpp
+/// \brief This file contains the implementation of the TCCubeBits class as defined by
+///        the TCCubeBits.h header file.
+///
+
+#include "TCCubeBits.h"
+#include <cassert>      // Used to validate the cube operator arguments.
+#include <cstring>      // Used for memmove and memcpy on the word array.
+#include <algorithm>    // Used for std::swap, std::min, and std::max.
+
+#define TC_BIT(z)   ((qword)1 << ((z) & 63))    ///< The bit of voxel z within its word.
+#define TC_WORD(z)  ((z) >> 6)                  ///< The word of voxel z within its row.
+
+
+///
+/// \brief Cubic Constructor
+///
+/// Creates a TCCubeBits object where the voxels in each dimension span from 0 to
+/// cubeSize-1.  This will also allocate the internal \ref pBits array.
+///
+/// \param cubeSize The size (in voxels) of each dimension.
+/// \see AllocateBits
+///
+TCCubeBits::TCCubeBits(byte cubeSize)
+    : TCCube(cubeSize, cubeSize, cubeSize, false)
+{
+    AllocateBits();
+}
+
+
+///
+/// \brief Rectangular Prism Constructor
+///
+/// Creates a TCCubeBits object where the voxels in each dimension span from 0 to each
+/// passed dimension minus 1.  This will also allocate the internal \ref pBits array.
+///
+/// \param sizeX The size (in voxels) of the x-dimension.
+/// \param sizeY The size (in voxels) of the y-dimension.
+/// \param sizeZ The size (in voxels) of the z-dimension.
+/// \see AllocateBits
+///
+TCCubeBits::TCCubeBits(byte sizeX, byte sizeY, byte sizeZ)
+    : TCCube(sizeX, sizeY, sizeZ, false)
+{
+    AllocateBits();
+}
+
+
+///
+/// \brief Rectangular Prism Constructor (Array)
+///
+/// Creates a TCCubeBits object where the voxels in each dimension span from 0 to each
+/// passed dimension minus 1.  This will also allocate the internal \ref pBits array.
+///
+/// \param tccSize An array containing the x, y, and z sizes (in voxels).
+/// \see AllocateBits
+///
+TCCubeBits::TCCubeBits(byte tccSize[3])
+    : TCCube(tccSize[0], tccSize[1], tccSize[2], false)
+{
+    AllocateBits();
+}
+
+
+///
+/// \brief Copy Constructor
+///
+/// Creates a new TCCubeBits object which is a clone of the passed one.  Unlike a TCCube,
+/// the packed words are copied right away (they are an eighth of the size of the voxel
+/// buffer, so sharing them is not worth it).
+///
+/// \param toCopy The TCCubeBits object to duplicate.
+///
+TCCubeBits::TCCubeBits(const TCCubeBits &toCopy)
+    : TCCube(toCopy.sc[0], toCopy.sc[1], toCopy.sc[2], false)
+{
+    AllocateBits();
+    memcpy(pBits, toCopy.pBits, numWords * sizeof(qword));
+    generation = toCopy.generation;
+    memcpy(sliceGen, toCopy.sliceGen, sizeof(sliceGen));
+}
+
+
+///
+/// \brief Destructor
+///
+/// Deletes the packed word array (the unpacked buffer is deleted by the base class).
+///
+TCCubeBits::~TCCubeBits()
+{
+    delete[] pBits;
+}
+
+
+///
+/// \brief Clone
+///
+/// \returns A new TCCubeBits object holding the same voxel states as this one.
+///
+TCCube *TCCubeBits::Clone() const
+{
+    return new TCCubeBits(*this);
+}
+
+
+///
+/// \brief Reset Cube State
+///
+/// Sets every voxel in the cube to the passed state.
+///
+/// \param state The state to set the voxels in the cube to (defaults to off).
+///
+void TCCubeBits::ResetCubeState(byte state)
+{
+    FillRows(pBits, numWords / wordsPerRow, state != 0x00);
+    MarkChanged();
+}
+
+
+///
+/// \brief Set Voxel State
+///
+/// Sets the state of a single voxel in the cube.  The passed coordinates are first
+/// checked with the \ref CheckVoxelBounds method.
+///
+/// \param x     The x-coordinate in three-space.
+/// \param y     The y-coordinate in three-space.
+/// \param z     The z-coordinate in three-space.
+/// \param state The state to set the voxel to (any non-zero value turns the voxel on).
+///
+void TCCubeBits::SetVoxelState(byte x, byte y, byte z, byte state)
+{
+    CheckVoxelBounds(x, y, z);
+    qword *pWord = Row(x, y) + TC_WORD(z);
+    if (state) *pWord |=  TC_BIT(z);
+    else       *pWord &= ~TC_BIT(z);
+    dataValid = false;
+    MarkChanged(x);
+}
+
+
+///
+/// \brief Get Voxel State
+///
+/// Gets the state of a single voxel in the cube.  The passed coordinates are first
+/// checked with the \ref CheckVoxelBounds method.
+///
+/// \param x The x-coordinate in three-space.
+/// \param y The y-coordinate in three-space.
+/// \param z The z-coordinate in three-space.
+///
+/// \returns 0x01 if the voxel at the passed coordinates is on, 0x00 otherwise.
+///
+byte TCCubeBits::GetVoxelState(byte x, byte y, byte z)
+{
+    CheckVoxelBounds(x, y, z);
+    return (Row(x, y)[TC_WORD(z)] & TC_BIT(z)) ? 0x01 : 0x00;
+}
+
+
+///
+/// \brief Set Column State
+///
+/// Sets the state of a single column in the cube.  Columns along the z-axis are set a
+/// whole word at a time, while columns along the x and y-axes set one bit per row.
+///
+/// \param axis  The axis to set the column (TC_X_AXIS, TC_Y_AXIS, or TC_Z_AXIS).
+/// \param dim1  The first remaining dimension.
+/// \param dim2  The second remaining dimension.
+/// \param state The state to set the voxels in the column to.
+///
+void TCCubeBits::SetColumnState(byte axis, byte dim1, byte dim2, byte state)
+{
+    switch (axis)
+    {
+        case TC_X_AXIS:
+            CheckVoxelBounds(0, dim1, dim2);
+            for (byte x = 0; x < sc[0]; x++)
+            {
+                qword *pWord = Row(x, dim1) + TC_WORD(dim2);
+                if (state) *pWord |=  TC_BIT(dim2);
+                else       *pWord &= ~TC_BIT(dim2);
+            }
+            MarkChanged();
+            break;
+
+        case TC_Y_AXIS:
+            CheckVoxelBounds(dim1, 0, dim2);
+            for (byte y = 0; y < sc[1]; y++)
+            {
+                qword *pWord = Row(dim1, y) + TC_WORD(dim2);
+                if (state) *pWord |=  TC_BIT(dim2);
+                else       *pWord &= ~TC_BIT(dim2);
+            }
+            MarkChanged(dim1);
+            break;
+
+        case TC_Z_AXIS:
+            CheckVoxelBounds(dim1, dim2, 0);
+            FillRows(Row(dim1, dim2), 1, state != 0x00);
+            MarkChanged(dim1);
+            break;
+    }
+    dataValid = false;
+}
+
+
+///
+/// \brief Get Column State
+///
+/// Compares the state of every voxel in a single column with the comparison value.
+///
+/// \param axis   The axis containing the column (TC_X_AXIS, TC_Y_AXIS, or TC_Z_AXIS).
+/// \param dim1   The first remaining dimension.
+/// \param dim2   The second remaining dimension.
+/// \param cmpVal The value to compare the voxels in the column to.
+///
+/// \returns True if all voxels in the column were equal to cmpVal, false otherwise.
+///
+bool TCCubeBits::GetColumnState(byte axis, byte dim1, byte dim2, byte cmpVal)
+{
+    if (cmpVal > 0x01) return false;    // No voxel can hold any other value.
+    qword match = cmpVal ? ~(qword)0 : 0;
+    switch (axis)
+    {
+        case TC_X_AXIS:
+            CheckVoxelBounds(0, dim1, dim2);
+            for (byte x = 0; x < sc[0]; x++)
+            {
+                if ((Row(x, dim1)[TC_WORD(dim2)] ^ match) & TC_BIT(dim2)) return false;
+            }
+            break;
+
+        case TC_Y_AXIS:
+            CheckVoxelBounds(dim1, 0, dim2);
+            for (byte y = 0; y < sc[1]; y++)
+            {
+                if ((Row(dim1, y)[TC_WORD(dim2)] ^ match) & TC_BIT(dim2)) return false;
+            }
+            break;
+
+        case TC_Z_AXIS:
+            CheckVoxelBounds(dim1, dim2, 0);
+            return CompareRows(Row(dim1, dim2), 1, cmpVal != 0x00);
+    }
+    return true;
+}
+
+
+///
+/// \brief Set Plane State
+///
+/// Sets the state of a single plane in the cube.  The yz and zx-planes are made up of
+/// whole rows, so they are filled one word at a time.
+///
+/// \param plane  The plane to set the state of the voxels in (either TC_XY_PLANE,
+///               TC_ZX_PLANE, or TC_YZ_PLANE).
+/// \param offset The offset from 0 to the size-1 of the remaining dimension.
+/// \param state  The state to set the voxels in the plane to.
+///
+void TCCubeBits::SetPlaneState(byte plane, byte offset, byte state)
+{
+    switch (plane)
+    {
+        case TC_XY_PLANE:
+        {
+            CheckVoxelBounds(0, 0, offset);
+            // The xy-plane holds a single bit from every row in the cube.
+            qword *pWord = pBits + TC_WORD(offset);
+            for (size_t r = numWords / wordsPerRow; r > 0; r--, pWord += wordsPerRow)
+            {
+                if (state) *pWord |=  TC_BIT(offset);
+                else       *pWord &= ~TC_BIT(offset);
+            }
+            MarkChanged();
+            break;
+        }
+
+        case TC_ZX_PLANE:
+            CheckVoxelBounds(0, offset, 0);
+            for (byte x = 0; x < sc[0]; x++)
+            {
+                FillRows(Row(x, offset), 1, state != 0x00);
+            }
+            MarkChanged();
+            break;
+
+        case TC_YZ_PLANE:
+            CheckVoxelBounds(offset, 0, 0);
+            FillRows(Row(offset, 0), sc[1], state != 0x00);
+            MarkChanged(offset);
+            break;
+    }
+    dataValid = false;
+}
+
+
+///
+/// \brief Get Plane State
+///
+/// Compares the state of every voxel in a single plane with the comparison value.
+///
+/// \param plane  The plane to compare the state of the voxels in (either TC_XY_PLANE,
+///               TC_ZX_PLANE, or TC_YZ_PLANE).
+/// \param offset The offset from 0 to the size-1 of the remaining dimension.
+/// \param cmpVal The value to compare the voxels in the plane to.
+///
+/// \returns True if all voxels in the plane were equal to cmpVal, false otherwise.
+///
+bool TCCubeBits::GetPlaneState(byte plane, byte offset, byte cmpVal)
+{
+    if (cmpVal > 0x01) return false;    // No voxel can hold any other value.
+    switch (plane)
+    {
+        case TC_XY_PLANE:
+        {
+            CheckVoxelBounds(0, 0, offset);
+            qword match = cmpVal ? ~(qword)0 : 0;
+            const qword *pWord = pBits + TC_WORD(offset);
+            for (size_t r = numWords / wordsPerRow; r > 0; r--, pWord += wordsPerRow)
+            {
+                if ((*pWord ^ match) & TC_BIT(offset)) return false;
+            }
+            break;
+        }
+
+        case TC_ZX_PLANE:
+            CheckVoxelBounds(0, offset, 0);
+            for (byte x = 0; x < sc[0]; x++)
+            {
+                if (!CompareRows(Row(x, offset), 1, cmpVal != 0x00)) return false;
+            }
+            break;
+
+        case TC_YZ_PLANE:
+            CheckVoxelBounds(offset, 0, 0);
+            return CompareRows(Row(offset, 0), sc[1], cmpVal != 0x00);
+    }
+    return true;
+}
+
+
+///
+/// \brief Shift Cube State
+///
+/// Shifts all of the voxels in the cube by the specified offset in the direction of the
+/// specified plane.  Shifts along the x and y-axes move whole rows of words, while
+/// shifts along the z-axis shift the bits within each row.
+///
+/// \param plane   The plane to shift of the voxels in (either TC_XY_PLANE, TC_ZX_PLANE,
+///                or TC_YZ_PLANE).
+/// \param offset  The offset (positive or negative) to shift in the plane.
+/// \param shiftIn The value that the shifted in voxels take.
+///
+void TCCubeBits::Shift(byte plane, sbyte offset, byte shiftIn)
+{
+    if (offset == 0) return;
+    byte   axis  = (plane == TC_XY_PLANE) ? TC_Z_AXIS :
+                   (plane == TC_ZX_PLANE) ? TC_Y_AXIS : TC_X_AXIS;
+    int    dist  = (offset > 0) ? offset : -offset;     // Number of layers to move.
+    int    kept  = (dist < sc[axis]) ? sc[axis] - dist : 0;
+    size_t rowsX = sc[1];                               // Rows in each yz-plane.
+
+    switch (plane)
+    {
+        case TC_YZ_PLANE:       // For the YZ plane, we move whole yz-planes of rows.
+            if (kept > 0)
+            {
+                qword *pDst = (offset > 0) ? Row(dist, 0) : Row(0, 0),
+                      *pSrc = (offset > 0) ? Row(0, 0)    : Row(dist, 0);
+                memmove(pDst, pSrc, kept * rowsX * wordsPerRow * sizeof(qword));
+            }
+            break;
+
+        case TC_ZX_PLANE:       // For the ZX plane, we move the rows in each yz-plane.
+            if (kept > 0)
+            {
+                for (byte x = 0; x < sc[0]; x++)
+                {
+                    qword *pDst = (offset > 0) ? Row(x, dist) : Row(x, 0),
+                          *pSrc = (offset > 0) ? Row(x, 0)    : Row(x, dist);
+                    memmove(pDst, pSrc, kept * wordsPerRow * sizeof(qword));
+                }
+            }
+            break;
+
+        case TC_XY_PLANE:       // For the XY plane, we shift the bits within each row.
+        {
+            int wordShift = dist >> 6,
+                bitShift  = dist & 63;
+            for (qword *pRow = pBits; pRow < pBits + numWords; pRow += wordsPerRow)
+            {
+                if (offset > 0)     // Towards higher z (i.e. towards higher bits).
+                {
+                    for (int i = (int)wordsPerRow - 1; i >= 0; i--)
+                    {
+                        int   src = i - wordShift;
+                        qword val = 0;
+                        if (src >= 0)
+                        {
+                            val = pRow[src] << bitShift;
+                            if (bitShift && src > 0) val |= pRow[src-1] >> (64 - bitShift);
+                        }
+                        pRow[i] = val;
+                    }
+                    pRow[wordsPerRow - 1] &= lastWordMask;
+                }
+                else                // Towards lower z (the padding bits are always zero).
+                {
+                    for (int i = 0; i < (int)wordsPerRow; i++)
+                    {
+                        int   src = i + wordShift;
+                        qword val = 0;
+                        if (src < (int)wordsPerRow)
+                        {
+                            val = pRow[src] >> bitShift;
+                            if (bitShift && src + 1 < (int)wordsPerRow)
+                            {
+                                val |= pRow[src+1] << (64 - bitShift);
+                            }
+                        }
+                        pRow[i] = val;
+                    }
+                }
+            }
+            // The bit shift already cleared the shifted in voxels, so we only need to
+            // set them if they are supposed to be on.
+            if (!shiftIn) dist = 0;
+            break;
+        }
+    }
+    // Finally, shift in as many new layers as we need.
+    for (int i = 0; (i < dist) && (i < sc[axis]); i++)
+    {
+        SetPlaneState(plane, (offset > 0) ? i : sc[axis] - 1 - i, shiftIn);
+    }
+    dataValid = false;
+    MarkChanged();
+}
+
+
+///
+/// \brief Set Shift Mode
+///
+/// The packed rows are already shifted a whole word at a time, so this storage type only
+/// supports the TC_SHIFT_LINEAR mode, and any other mode is ignored.
+///
+/// \param mode The shift mode (TC_SHIFT_LINEAR or TC_SHIFT_RING).
+///
+void TCCubeBits::SetShiftMode(byte mode)
+{
+    assert(mode == TC_SHIFT_LINEAR || mode == TC_SHIFT_RING);
+}
+
+
+///
+/// \brief Fill Box
+///
+/// Sets the state of every voxel in the box between the two passed corners, masking
+/// whole words of each row at once (see \ref TCCube::FillBox).
+///
+void TCCubeBits::FillBox(byte x1, byte y1, byte z1, byte x2, byte y2, byte z2, byte state)
+{
+    byte lo[3] = { x1, y1, z1 },
+         hi[3] = { x2, y2, z2 };
+    for (int i = 0; i < 3; i++)
+    {
+        if (lo[i] > hi[i]) std::swap(lo[i], hi[i]);
+        if (lo[i] >= sc[i]) return;
+        if (hi[i] >= sc[i]) hi[i] = sc[i] - 1;
+    }
+    size_t firstWord = TC_WORD(lo[2]),
+           lastWord  = TC_WORD(hi[2]);
+    for (int x = lo[0]; x <= hi[0]; x++)
+    {
+        for (int y = lo[1]; y <= hi[1]; y++)
+        {
+            qword *pRow = Row(x, y);
+            for (size_t w = firstWord; w <= lastWord; w++)
+            {
+                // Mask the bits of this word which lie between lo[2] and hi[2].
+                qword mask = ~(qword)0;
+                if (w == firstWord) mask &= ~(qword)0 << (lo[2] & 63);
+                if (w == lastWord)  mask &= ~(qword)0 >> (63 - (hi[2] & 63));
+                if (state) pRow[w] |=  mask;
+                else       pRow[w] &= ~mask;
+            }
+        }
+        MarkChanged(x);
+    }
+    dataValid = false;
+}
+
+
+///
+/// \brief Count Lit Voxels
+///
+/// \returns The number of voxels in the cube which are on.
+///
+size_t TCCubeBits::CountLitVoxels() const
+{
+    return CountRows(pBits, numWords / wordsPerRow);
+}
+
+
+///
+/// \brief Sum Voxels
+///
+/// \returns The sum of every voxel state (the same as \ref CountLitVoxels, since each
+///          state is either 0x00 or 0x01).
+///
+uint64_t TCCubeBits::SumVoxels() const
+{
+    return CountLitVoxels();
+}
+
+
+///
+/// \brief Get Plane Counts
+///
+/// Counts the voxels which are on in every plane of the passed orientation at once (see
+/// \ref TCCube::GetPlaneCounts).  Whole rows are counted with a population count, and
+/// xy-planes by walking the set bits of each row.
+///
+void TCCubeBits::GetPlaneCounts(byte plane, size_t *pCounts) const
+{
+    switch (plane)
+    {
+        case TC_YZ_PLANE:
+            for (byte x = 0; x < sc[0]; x++) pCounts[x] = CountRows(Row(x, 0), sc[1]);
+            break;
+
+        case TC_ZX_PLANE:
+            for (byte y = 0; y < sc[1]; y++)
+            {
+                pCounts[y] = 0;
+                for (byte x = 0; x < sc[0]; x++) pCounts[y] += CountRows(Row(x, y), 1);
+            }
+            break;
+
+        case TC_XY_PLANE:
+            for (int z = 0; z < sc[2]; z++) pCounts[z] = 0;
+            for (size_t i = 0; i < numWords; i++)
+            {
+                // Each set bit is one voxel which is on, at z = 64 * (word in row) + bit.
+                size_t zBase = (i % wordsPerRow) * 64;
+                for (qword word = pBits[i]; word != 0; word &= word - 1)
+                {
+                    pCounts[zBase + __builtin_ctzll(word)]++;
+                }
+            }
+            break;
+    }
+}
+
+
+///
+/// \brief Get Column Counts
+///
+/// Counts the voxels which are on in every column along the passed axis at once (see
+/// \ref TCCube::GetColumnCounts for the layout of the counts).
+///
+void TCCubeBits::GetColumnCounts(byte axis, size_t *pCounts) const
+{
+    if (axis == TC_Z_AXIS)
+    {
+        for (byte x = 0; x < sc[0]; x++)
+        {
+            for (byte y = 0; y < sc[1]; y++)
+            {
+                pCounts[x * sc[1] + y] = CountRows(Row(x, y), 1);
+            }
+        }
+        return;
+    }
+    // Otherwise, the columns are at (y, z) or (x, z), so we walk the set bits of each row.
+    size_t numGroups = sc[(axis == TC_X_AXIS) ? TC_Y_AXIS : TC_X_AXIS];
+    for (size_t i = 0; i < numGroups * sc[2]; i++) pCounts[i] = 0;
+    for (byte x = 0; x < sc[0]; x++)
+    {
+        for (byte y = 0; y < sc[1]; y++)
+        {
+            const qword *pRow   = Row(x, y);
+            size_t      *pGroup = pCounts + ((axis == TC_X_AXIS) ? y : x) * sc[2];
+            for (size_t w = 0; w < wordsPerRow; w++)
+            {
+                for (qword word = pRow[w]; word != 0; word &= word - 1)
+                {
+                    pGroup[w * 64 + __builtin_ctzll(word)]++;
+                }
+            }
+        }
+    }
+}
+
+
+///
+/// \brief Get Bounding Box
+///
+/// Finds the smallest box which contains every voxel which is on (see
+/// \ref TCCube::GetBoundingBox).  The z-bounds of each row come from its first and last
+/// non-zero words.
+///
+bool TCCubeBits::GetBoundingBox(byte lo[3], byte hi[3]) const
+{
+    int minPos[3] = { sc[0], sc[1], sc[2] },
+        maxPos[3] = { -1, -1, -1 };
+    for (int x = 0; x < sc[0]; x++)
+    {
+        for (int y = 0; y < sc[1]; y++)
+        {
+            const qword *pRow = Row(x, y);
+            int first = -1, last = -1;
+            for (int w = 0; w < (int)wordsPerRow; w++)
+            {
+                if (pRow[w] == 0) continue;
+                if (first < 0) first = w * 64 + __builtin_ctzll(pRow[w]);
+                last = w * 64 + 63 - __builtin_clzll(pRow[w]);
+            }
+            if (first < 0) continue;
+            minPos[0] = std::min(minPos[0], x);     maxPos[0] = x;
+            minPos[1] = std::min(minPos[1], y);     maxPos[1] = std::max(maxPos[1], y);
+            minPos[2] = std::min(minPos[2], first); maxPos[2] = std::max(maxPos[2], last);
+        }
+    }
+    if (maxPos[0] < 0) return false;
+    for (int i = 0; i < 3; i++)
+    {
+        lo[i] = (byte)minPos[i];
+        hi[i] = (byte)maxPos[i];
+    }
+    return true;
+}
+
+
+///
+/// \brief AND Operator
+///
+/// Performs a logical AND of all elements in the current TCCubeBits with the passed one.
+/// If the passed cube is also a TCCubeBits of the same size, this is done a word at a time.
+///
+/// \param ref The reference TCCube object to AND the current object's voxels with.
+///
+void TCCubeBits::OP_AND(const TCCube &ref)
+{
+    ApplyOperator(ref, '&');
+}
+
+
+///
+/// \brief OR Operator
+///
+/// Performs a logical OR of all elements in the current TCCubeBits with the passed one.
+/// If the passed cube is also a TCCubeBits of the same size, this is done a word at a time.
+///
+/// \param ref The reference TCCube object to OR the current object's voxels with.
+///
+void TCCubeBits::OP_OR(const TCCube &ref)
+{
+    ApplyOperator(ref, '|');
+}
+
+
+///
+/// \brief XOR Operator
+///
+/// Performs a logical XOR of all elements in the current TCCubeBits with the passed one.
+/// If the passed cube is also a TCCubeBits of the same size, this is done a word at a time.
+///
+/// \param ref The reference TCCube object to XOR the current object's voxels with.
+///
+void TCCubeBits::OP_XOR(const TCCube &ref)
+{
+    ApplyOperator(ref, '^');
+}
+
+
+///
+/// \brief NOT Operator
+///
+/// Inverts the state of every voxel in the cube, one word at a time.
+///
+void TCCubeBits::OP_NOT()
+{
+    for (size_t i = 0; i < numWords; i++)
+    {
+        pBits[i] = ~pBits[i];
+    }
+    // Finally, we clear the padding bits at the end of each row again.
+    for (size_t i = wordsPerRow - 1; i < numWords; i += wordsPerRow)
+    {
+        pBits[i] &= lastWordMask;
+    }
+    dataValid = false;
+    MarkChanged();
+}
+
+
+///
+/// \brief Get Voxel Data
+///
+/// Unpacks the state of every voxel into the base class' voxel buffer (one byte per
+/// voxel, in the same layout as a TCCube), and returns a pointer to it.  The buffer is
+/// only allocated the first time this is called, and only re-created after a change.
+///
+/// \returns A pointer to the unpacked voxel buffer.
+///
+/// \remarks Changes made through the returned pointer are not stored in the cube.
+///
+byte *TCCubeBits::GetData() const
+{
+    if (!dataValid)
+    {
+        if (pCubeState == NULL)
+        {
+            // The buffer is only a cache of the packed state, so we can allocate it
+            // from a const method.
+            const_cast<TCCubeBits*>(this)->AllocateBuffer();
+        }
+        byte *pVoxel = pCubeState;
+        for (const qword *pRow = pBits; pRow < pBits + numWords; pRow += wordsPerRow)
+        {
+            for (byte z = 0; z < sc[2]; z++)
+            {
+                *pVoxel++ = (pRow[TC_WORD(z)] >> (z & 63)) & 0x01;
+            }
+        }
+        dataValid = true;
+    }
+    return pCubeState;
+}
+
+
+///
+/// \brief Get Packed Bits
+///
+/// \returns A pointer to the packed state of every voxel, where the row at (x, y) starts
+///          at word (x * sizeY + y) * GetWordsPerRow(), and voxel z of a row is bit
+///          (z % 64) of word (z / 64).  The padding bits after the last voxel of each
+///          row are always zero.
+///
+const qword *TCCubeBits::GetBits() const
+{
+    return pBits;
+}
+
+
+///
+/// \brief Get Words per Row
+///
+/// \returns The number of 64-bit words used for each row of voxels along the z-axis.
+///
+size_t TCCubeBits::GetWordsPerRow() const
+{
+    return wordsPerRow;
+}
+
+
+///
+/// \brief Set Slice Bits
+///
+/// Replaces the packed state of every voxel in one yz-plane.  The plane is only marked
+/// as changed (see TCCube::GetSliceGeneration) if any of its voxels are different.
+///
+/// \param x      The x-coordinate of the plane.
+/// \param pSlice The packed rows of the plane, in the same layout as the rows of that
+///               plane in the array returned by \ref GetBits.
+///
+void TCCubeBits::SetSliceBits(byte x, const qword *pSlice)
+{
+    CheckVoxelBounds(x, 0, 0);
+    qword  *pRow     = Row(x, 0);
+    size_t  numSlice = sc[1] * wordsPerRow;
+    if (memcmp(pRow, pSlice, numSlice * sizeof(qword)) == 0) return;
+    memcpy(pRow, pSlice, numSlice * sizeof(qword));
+    for (size_t i = wordsPerRow - 1; i < numSlice; i += wordsPerRow)
+    {
+        pRow[i] &= lastWordMask;
+    }
+    dataValid = false;
+    MarkChanged(x);
+}
+
+
+///
+/// \brief Allocate Bits
+///
+/// Computes the number of words in each row and in total, as well as the mask of the
+/// valid bits in the last word of each row, and allocates the (cleared) word array.
+///
+/// \see pBits | wordsPerRow | lastWordMask
+///
+void TCCubeBits::AllocateBits()
+{
+    wordsPerRow  = (sc[2] + 63) / 64;
+    numWords     = (size_t)sc[0] * sc[1] * wordsPerRow;
+    lastWordMask = (sc[2] % 64) ? (TC_BIT(sc[2]) - 1) : ~(qword)0;
+    pBits        = new qword[numWords];
+    memset(pBits, 0, numWords * sizeof(qword));
+    dataValid    = false;
+}
+
+
+///
+/// \brief Apply Operator
+///
+/// Performs the AND ('&'), OR ('|'), or XOR ('^') operator between this cube and the
+/// passed one.  If the passed cube is a TCCubeBits object of the same size, the words
+/// are combined directly.  Otherwise, each voxel is combined with the reference cube's
+/// voxel buffer (see \ref GetData), in the same way the TCCube operators do.
+///
+/// \param ref The reference cube object (at least as big as this one in each dimension).
+/// \param op  The operator to apply ('&', '|', or '^').
+///
+void TCCubeBits::ApplyOperator(const TCCube &ref, char op)
+{
+    assert(    (sc[0] <= ref.GetSize(TC_X_AXIS)) && (sc[1] <= ref.GetSize(TC_Y_AXIS))
+            && (sc[2] <= ref.GetSize(TC_Z_AXIS)) );
+    const TCCubeBits *pRefBits = dynamic_cast<const TCCubeBits*>(&ref);
+    if (pRefBits != NULL && pRefBits->numWords == numWords
+                         && pRefBits->wordsPerRow == wordsPerRow)
+    {
+        const qword *pRef = pRefBits->pBits;
+        switch (op)
+        {
+            case '&': for (size_t i = 0; i < numWords; i++) pBits[i] &= pRef[i]; break;
+            case '|': for (size_t i = 0; i < numWords; i++) pBits[i] |= pRef[i]; break;
+            case '^': for (size_t i = 0; i < numWords; i++) pBits[i] ^= pRef[i]; break;
+        }
+    }
+    else
+    {
+        const byte *pRef = ref.GetData();
+        size_t refStride[3] = { ref.GetStride(TC_X_AXIS), ref.GetStride(TC_Y_AXIS),
+                                ref.GetStride(TC_Z_AXIS) };
+        for (byte x = 0; x < sc[0]; x++)
+        {
+            for (byte y = 0; y < sc[1]; y++)
+            {
+                qword      *pRow    = Row(x, y);
+                const byte *pRefRow = pRef + x * refStride[0] + y * refStride[1];
+                for (byte z = 0; z < sc[2]; z++)
+                {
+                    byte state = (pRow[TC_WORD(z)] >> (z & 63)) & 0x01,
+                         other = pRefRow[z * refStride[2]];
+                    switch (op)
+                    {
+                        case '&': state &= other; break;
+                        case '|': state |= other; break;
+                        case '^': state ^= other; break;
+                    }
+                    if (state) pRow[TC_WORD(z)] |=  TC_BIT(z);
+                    else       pRow[TC_WORD(z)] &= ~TC_BIT(z);
+                }
+            }
+        }
+    }
+    dataValid = false;
+    MarkChanged();
+}
+
+
+///
+/// \brief Fill Rows
+///
+/// Sets every voxel in a run of consecutive rows to the passed state, keeping the
+/// padding bits at the end of each row cleared.
+///
+/// \param pRow    Pointer to the first word of the first row to fill.
+/// \param numRows The number of consecutive rows to fill.
+/// \param state   True to turn the voxels on, false to turn them off.
+///
+void TCCubeBits::FillRows(qword *pRow, size_t numRows, bool state)
+{
+    if (!state)
+    {
+        memset(pRow, 0, numRows * wordsPerRow * sizeof(qword));
+    }
+    else
+    {
+        for (size_t i = 0; i < numRows * wordsPerRow; i++)
+        {
+            pRow[i] = ~(qword)0;
+        }
+        for (size_t i = wordsPerRow - 1; i < numRows * wordsPerRow; i += wordsPerRow)
+        {
+            pRow[i] = lastWordMask;
+        }
+    }
+    dataValid = false;
+}
+
+
+///
+/// \brief Compare Rows
+///
+/// Checks if every voxel in a run of consecutive rows matches the passed state.
+///
+/// \param pRow    Pointer to the first word of the first row to compare.
+/// \param numRows The number of consecutive rows to compare.
+/// \param state   True to check that the voxels are on, false to check they are off.
+///
+/// \returns True if all voxels in the rows match the state, false otherwise.
+///
+bool TCCubeBits::CompareRows(const qword *pRow, size_t numRows, bool state) const
+{
+    for (size_t r = 0; r < numRows; r++, pRow += wordsPerRow)
+    {
+        for (size_t i = 0; i < wordsPerRow; i++)
+        {
+            qword expected = !state ? 0 : (i == wordsPerRow - 1) ? lastWordMask
+                                                                 : ~(qword)0;
+            if (pRow[i] != expected) return false;
+        }
+    }
+    return true;
+}
+
+
+///
+/// \brief Count Rows
+///
+/// Counts the set bits in a run of whole rows (the padding bits are always zero, so each
+/// word can be counted as a whole).
+///
+/// \param pRow    Pointer to the first word of the first row.
+/// \param numRows The number of consecutive rows to count.
+///
+/// \returns The number of voxels which are on in the rows.
+///
+size_t TCCubeBits::CountRows(const qword *pRow, size_t numRows) const
+{
+    size_t numLit = 0;
+    for (const qword *pEnd = pRow + numRows * wordsPerRow; pRow < pEnd; pRow++)
+    {
+        numLit += __builtin_popcountll(*pRow);
+    }
+    return numLit;
+}
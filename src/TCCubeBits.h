@@ -0,0 +1,123 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *                          TCCubeBits Object  Header File                             *
+ *                                      TRICLYSM                                       *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  This file contains the definition of the TCCubeBits class as implemented by the    *
+ *  TCCubeBits.cpp source file.  This class inherits the TCCube class, but only stores  *
+ *  a single bit (on or off) for each voxel, packed into 64-bit words.  It is used by   *
+ *  animations which do not use any colors.                                            *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  Copyright (C) 2011 Brandon Castellano, Ryan Mantha. All rights reserved.           *
+ *  Triclysm is provided under the BSD-2-Clause license. This program uses the SDL     *
+ *  (Simple DirectMedia Layer) library, and the Lua scripting language. See the        *
+ *  included LICENSE file or <http://www.triclysm.com/> for more details.              *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+///
+/// \file  TCCubeBits.h
+/// \brief This file contains the definition of the TCCubeBits class as implemented by
+///        the TCCubeBits.cpp source file.
+///
+
+#pragma once
+#ifndef TC_CUBE_BITS_
+#define TC_CUBE_BITS_
+
+#include "TCCube.h"
+#include <stdint.h>             // Used for the uint64_t type.
+
+typedef uint64_t qword;         ///< A single 64-bit word of packed voxel states.
+
+
+///
+/// \brief Triclysm Bit-Packed Cube Object
+///
+/// This class represents the same three-dimensional rectangular prism as the TCCube
+/// class, but stores only one bit per voxel.  Each (x, y) row of voxels along the z-axis
+/// is packed into \ref wordsPerRow 64-bit words, so plane, shift, and cube operators can
+/// work on up to 64 voxels at once.
+///
+/// \remarks Any non-zero state passed to this object is stored as 0x01, so the state of
+///          a voxel read back from this object is always either 0x00 or 0x01.
+///
+class TCCubeBits : public TCCube
+{
+  public:
+    // Object constructors:
+    TCCubeBits(byte cubeSize);                          // Literal cube constructor.
+    TCCubeBits(byte sizeX, byte sizeY, byte sizeZ);     // Arbitrary size constructor.
+    TCCubeBits(byte tccSize[3]);                        // Same as above, with an array.
+    TCCubeBits(const TCCubeBits &toCopy);               // Copy constructor.
+    ~TCCubeBits();                                      // TCCubeBits destructor.
+    TCCube *Clone() const;                              // Copies the packed words.
+
+    void ResetCubeState(byte state = 0);
+
+    // State setting and getting methods:
+    void SetVoxelState(byte x, byte y, byte z, byte state);
+    byte GetVoxelState(byte x, byte y, byte z);
+    void SetColumnState(byte axis, byte dim1, byte dim2, byte state);
+    bool GetColumnState(byte axis, byte dim1, byte dim2, byte cmpVal);
+    void SetPlaneState(byte plane, byte offset, byte state);
+    bool GetPlaneState(byte plane, byte offset, byte cmpVal);
+
+    void Shift(byte plane, sbyte offset, byte shiftIn = 0x00);
+    void SetShiftMode(byte mode);
+
+    void FillBox(byte x1, byte y1, byte z1, byte x2, byte y2, byte z2, byte state);
+
+    // Reductions (using a population count on each word):
+    size_t   CountLitVoxels() const;
+    uint64_t SumVoxels() const;
+    void     GetPlaneCounts(byte plane, size_t *pCounts) const;
+    void     GetColumnCounts(byte axis, size_t *pCounts) const;
+    bool     GetBoundingBox(byte lo[3], byte hi[3]) const;
+
+    // Cube operators:
+    void OP_AND(const TCCube &ref);
+    void OP_OR(const TCCube &ref);
+    void OP_XOR(const TCCube &ref);
+    void OP_NOT();
+
+    // Raw voxel buffer access (unpacked into one byte per voxel when requested):
+    byte *GetData() const;
+
+    // Packed voxel access (used by animations which work on whole words at once):
+    const qword *GetBits() const;                       // Packed rows (see Row).
+    size_t       GetWordsPerRow() const;                // Number of words in each row.
+    void         SetSliceBits(byte x, const qword *pSlice);  // Replaces one yz-plane.
+
+  private:
+    // Allocates the packed word array, and computes the row size and padding mask.
+    void AllocateBits();
+    // Performs one of the AND/OR/XOR operators with a cube of any storage type.
+    void ApplyOperator(const TCCube &ref, char op);
+    // Returns a pointer to the first word of the row at (x, y).
+    qword *Row(byte x, byte y) const { return pBits + (x * sc[1] + y) * wordsPerRow; }
+    // Sets every word in a run of whole rows to all zeros or all ones.
+    void FillRows(qword *pRow, size_t numRows, bool state);
+    // Returns true if every voxel in a run of whole rows matches the passed state.
+    bool CompareRows(const qword *pRow, size_t numRows, bool state) const;
+    // Returns the number of set bits (lit voxels) in a run of whole rows.
+    size_t CountRows(const qword *pRow, size_t numRows) const;
+
+    qword  *pBits;          ///< Array holding the packed state of each voxel.
+    size_t  wordsPerRow,    ///< Number of 64-bit words used for each row along z.
+            numWords;       ///< Total number of words in the \ref pBits array.
+    qword   lastWordMask;   ///< Mask of the valid bits in the last word of each row.
+
+    /// \brief True if the unpacked voxel buffer (see \ref GetData) is up to date.
+    ///
+    /// Cleared whenever a voxel state is modified, so the buffer is only re-created
+    /// when it is requested after a change.
+    mutable bool dataValid;
+};
+
+
+#endif
@@ -0,0 +1,921 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *                         TCCubeChannel Object  Source Code                           *
+ *                                      TRICLYSM                                       *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  This file contains the implementation of the TCCubeChannel class as defined by     *
+ *  the TCCubeChannel.h header file.  This class inherits the TCCube class, but stores *
+ *  its voxels as one byte of a shared buffer of 32-bit RGBX colors.                   *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  Copyright (C) 2011 Brandon Castellano, Ryan Mantha. All rights reserved.           *
+ *  Triclysm is provided under the BSD-2-Clause license. This program uses the SDL     *
+ *  (Simple DirectMedia Layer) library, and the Lua scripting language. See the        *
+ *  included LICENSE file or <http://www.triclysm.com/> for more details.              *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+///
+/// \file  TCCubeChannel.cpp
+/// \brief This file contains the implementation of the TCCubeChannel class as defined by
+///        the TCCubeChannel.h header file.
+///
+
+#include "TCCubeChannel.h"
+#include <cassert>      // Used to validate the cube operator arguments.
+#include <cstring>      // Used for memset, memcpy, and memmove on the color buffer.
+#include <algorithm>    // Used for std::swap and std::fill.
+
+
+///
+/// \brief Buffer Constructor
+///
+/// Creates a TCCubeChannel object with a new (entirely off) color buffer, where the
+/// voxels in each dimension span from 0 to each passed dimension minus 1.  The object
+/// is a view of the red color of the buffer.
+///
+/// \param tccSize An array containing the x, y, and z sizes (in voxels).
+///
+TCCubeChannel::TCCubeChannel(byte tccSize[3])
+    : TCCube(tccSize[0], tccSize[1], tccSize[2], false)
+{
+    pShared           = new SharedColors;
+    pShared->pColors  = (uint32_t *)NewBuffer(numVoxels * sizeof(uint32_t),
+                                              pShared->pAlloc);
+    pShared->version  = 1;
+    pShared->numViews = 1;
+    memset(pShared->pColors, 0, numVoxels * sizeof(uint32_t));
+    color       = 0;
+    dataVersion = 0;
+}
+
+
+///
+/// \brief View Constructor
+///
+/// Creates a TCCubeChannel object which is a view of one color of the same buffer as
+/// the passed object.
+///
+/// \param share The object to share the color buffer of.
+/// \param color The color to view (0 for red, 1 for green, or 2 for blue).
+///
+TCCubeChannel::TCCubeChannel(TCCubeChannel &share, byte color)
+    : TCCube(share.sc[0], share.sc[1], share.sc[2], false)
+{
+    assert(color <= 2);
+    pShared = share.pShared;
+    pShared->numViews++;
+    this->color = color;
+    dataVersion = 0;
+}
+
+
+///
+/// \brief Destructor
+///
+/// Releases this object's view of the color buffer (the buffer is deleted once no view
+/// or frame is using it).
+///
+TCCubeChannel::~TCCubeChannel()
+{
+    if (--pShared->numViews == 0)
+    {
+        ReleaseBuffer(pShared->pAlloc);
+        delete pShared;
+    }
+}
+
+
+///
+/// \brief Clone
+///
+/// \returns A new TCCube object holding the same voxel states as this color.  The copy
+///          has its own buffer, so it is not a view of this object's color buffer.
+///
+TCCube *TCCubeChannel::Clone() const
+{
+    TCCube *pCopy = new TCCube(sc[0], sc[1], sc[2]);
+    pCopy->Blit(*this, 0, 0, 0);
+    return pCopy;
+}
+
+
+///
+/// \brief Reset Cube State
+///
+/// Sets every voxel of this color to the passed state (the other colors are unchanged).
+///
+/// \param state The state to set the voxels to (defaults to off).
+///
+void TCCubeChannel::ResetCubeState(byte state)
+{
+    byte *pCh = BeginChannelWrite();
+    for (size_t i = 0; i < numVoxels; i++) pCh[4 * i] = state;
+    MarkChanged();
+}
+
+
+///
+/// \brief Set Voxel State
+///
+/// \param x     The x-coordinate of the voxel.
+/// \param y     The y-coordinate of the voxel.
+/// \param z     The z-coordinate of the voxel.
+/// \param state The state to set this color of the voxel to.
+///
+void TCCubeChannel::SetVoxelState(byte x, byte y, byte z, byte state)
+{
+    CheckVoxelBounds(x, y, z);
+    BeginChannelWrite()[4 * (x * stride[0] + y * stride[1] + z)] = state;
+    MarkChanged(x);
+}
+
+
+///
+/// \brief Get Voxel State
+///
+/// \param x The x-coordinate of the voxel.
+/// \param y The y-coordinate of the voxel.
+/// \param z The z-coordinate of the voxel.
+///
+/// \returns The state of this color of the voxel at the passed coordinates.
+///
+byte TCCubeChannel::GetVoxelState(byte x, byte y, byte z)
+{
+    CheckVoxelBounds(x, y, z);
+    return Channel()[4 * (x * stride[0] + y * stride[1] + z)];
+}
+
+
+///
+/// \brief Set Column State
+///
+/// Sets this color of every voxel in a column along the passed axis to the passed state.
+///
+/// \param axis  The axis the column is parallel to (e.g. TC_X_AXIS).
+/// \param dim1  The first remaining coordinate of the column (in x, y, z order).
+/// \param dim2  The second remaining coordinate of the column (in x, y, z order).
+/// \param state The state to set the voxels to.
+///
+void TCCubeChannel::SetColumnState(byte axis, byte dim1, byte dim2, byte state)
+{
+    int lo[3], hi[3];
+    if (!ColumnRegion(axis, dim1, dim2, lo, hi)) return;
+    FillRegion(lo, hi, state);
+    if (axis == TC_X_AXIS) MarkChanged();
+    else                   MarkChanged(dim1);
+}
+
+
+///
+/// \brief Get Column State
+///
+/// \param axis   The axis the column is parallel to (e.g. TC_X_AXIS).
+/// \param dim1   The first remaining coordinate of the column (in x, y, z order).
+/// \param dim2   The second remaining coordinate of the column (in x, y, z order).
+/// \param cmpVal The state to compare this color of each voxel in the column with.
+///
+/// \returns True if every voxel in the column is equal to cmpVal, false otherwise.
+///
+bool TCCubeChannel::GetColumnState(byte axis, byte dim1, byte dim2, byte cmpVal)
+{
+    int lo[3], hi[3];
+    if (!ColumnRegion(axis, dim1, dim2, lo, hi)) return false;
+    return CompareRegion(lo, hi, cmpVal);
+}
+
+
+///
+/// \brief Set Plane State
+///
+/// Sets this color of every voxel in a plane to the passed state.
+///
+/// \param plane  The plane to set (e.g. TC_XY_PLANE).
+/// \param offset The position of the plane along the remaining axis.
+/// \param state  The state to set the voxels to.
+///
+void TCCubeChannel::SetPlaneState(byte plane, byte offset, byte state)
+{
+    int lo[3], hi[3];
+    PlaneRegion(plane, offset, lo, hi);
+    FillRegion(lo, hi, state);
+    if (plane == TC_YZ_PLANE) MarkChanged(offset);
+    else                      MarkChanged();
+}
+
+
+///
+/// \brief Get Plane State
+///
+/// \param plane  The plane to compare (e.g. TC_XY_PLANE).
+/// \param offset The position of the plane along the remaining axis.
+/// \param cmpVal The state to compare this color of each voxel in the plane with.
+///
+/// \returns True if every voxel in the plane is equal to cmpVal, false otherwise.
+///
+bool TCCubeChannel::GetPlaneState(byte plane, byte offset, byte cmpVal)
+{
+    int lo[3], hi[3];
+    PlaneRegion(plane, offset, lo, hi);
+    return CompareRegion(lo, hi, cmpVal);
+}
+
+
+///
+/// \brief Shift
+///
+/// Shifts this color of every voxel perpendicular to the passed plane (the other colors
+/// are not moved, see \ref ShiftColors to move every color at once).
+///
+/// \param plane   The plane to shift (e.g. TC_XY_PLANE).
+/// \param offset  The number of voxels to shift by (negative towards lower coordinates).
+/// \param shiftIn The state of the voxels shifted in (defaults to off).
+///
+void TCCubeChannel::Shift(byte plane, sbyte offset, byte shiftIn)
+{
+    if (offset == 0) return;
+    int    axis   = plane,                              // Plane == perpendicular axis.
+           dist   = (offset > 0) ? offset : -offset;
+    if (dist > sc[axis]) dist = sc[axis];
+    // The voxels are moved within runs of sc[axis] layers, each stride[axis] voxels long.
+    size_t layer  = stride[axis],
+           runLen = sc[axis] * layer,
+           moved  = (sc[axis] - dist) * layer,
+           step   = dist * layer;
+    byte  *pCh    = BeginChannelWrite();
+    for (byte *pRun = pCh; pRun < pCh + 4 * numVoxels; pRun += 4 * runLen)
+    {
+        if (offset > 0)
+        {
+            for (size_t i = moved; i > 0; i--) pRun[4 * (i - 1 + step)] = pRun[4 * (i - 1)];
+            for (size_t i = 0; i < step; i++)  pRun[4 * i] = shiftIn;
+        }
+        else
+        {
+            for (size_t i = 0; i < moved; i++) pRun[4 * i] = pRun[4 * (i + step)];
+            for (size_t i = moved; i < runLen; i++) pRun[4 * i] = shiftIn;
+        }
+    }
+    MarkChanged();
+}
+
+
+///
+/// \brief Set Shift Mode
+///
+/// The voxels are always moved by Shift, so the TC_SHIFT_RING mode has no effect on a
+/// TCCubeChannel object.
+///
+/// \param mode The shift mode (TC_SHIFT_LINEAR or TC_SHIFT_RING).
+///
+void TCCubeChannel::SetShiftMode(byte mode)
+{
+    assert(mode == TC_SHIFT_LINEAR || mode == TC_SHIFT_RING);
+}
+
+
+///
+/// \brief Fill Box
+///
+/// Sets this color of every voxel in the box between the two passed corners (inclusive)
+/// to the passed state.  The box is clipped to the cube.
+///
+/// \param x1    The x-coordinate of the first corner.
+/// \param y1    The y-coordinate of the first corner.
+/// \param z1    The z-coordinate of the first corner.
+/// \param x2    The x-coordinate of the opposite corner.
+/// \param y2    The y-coordinate of the opposite corner.
+/// \param z2    The z-coordinate of the opposite corner.
+/// \param state The state to set the voxels to.
+///
+void TCCubeChannel::FillBox(byte x1, byte y1, byte z1, byte x2, byte y2, byte z2, byte state)
+{
+    int lo[3] = { x1, y1, z1 },
+        hi[3] = { x2, y2, z2 };
+    for (int i = 0; i < 3; i++)
+    {
+        if (lo[i] > hi[i]) std::swap(lo[i], hi[i]);
+        if (lo[i] >= sc[i]) return;
+        if (hi[i] >= sc[i]) hi[i] = sc[i] - 1;
+    }
+    FillRegion(lo, hi, state);
+    for (int x = lo[0]; x <= hi[0]; x++) MarkChanged(x);
+}
+
+
+///
+/// \brief Count Lit Voxels
+///
+/// \returns The number of voxels where this color is not zero.
+///
+size_t TCCubeChannel::CountLitVoxels() const
+{
+    GetData();
+    return TCCube::CountLitVoxels();
+}
+
+
+///
+/// \brief Sum Voxels
+///
+/// \returns The sum of this color of every voxel in the cube.
+///
+uint64_t TCCubeChannel::SumVoxels() const
+{
+    GetData();
+    return TCCube::SumVoxels();
+}
+
+
+///
+/// \brief Get Plane Counts
+///
+/// \param plane   The plane to count (e.g. TC_XY_PLANE).
+/// \param pCounts Array of GetSize(plane) elements, which is filled with the number of
+///                voxels where this color is not zero in the plane at each offset.
+///
+/// \see TCCube::GetPlaneCounts
+///
+void TCCubeChannel::GetPlaneCounts(byte plane, size_t *pCounts) const
+{
+    GetData();
+    TCCube::GetPlaneCounts(plane, pCounts);
+}
+
+
+///
+/// \brief Get Column Counts
+///
+/// \param axis    The axis to count along (e.g. TC_Z_AXIS).
+/// \param pCounts Array which is filled with the number of voxels where this color is
+///                not zero in each column.
+///
+/// \see TCCube::GetColumnCounts
+///
+void TCCubeChannel::GetColumnCounts(byte axis, size_t *pCounts) const
+{
+    GetData();
+    TCCube::GetColumnCounts(axis, pCounts);
+}
+
+
+///
+/// \brief Get Bounding Box
+///
+/// \param lo Array which is set to the lowest x, y, and z coordinates of any lit voxel.
+/// \param hi Array which is set to the highest x, y, and z coordinates of any lit voxel.
+///
+/// \returns True if this color of any voxel is not zero, false otherwise.
+///
+/// \see TCCube::GetBoundingBox
+///
+bool TCCubeChannel::GetBoundingBox(byte lo[3], byte hi[3]) const
+{
+    GetData();
+    return TCCube::GetBoundingBox(lo, hi);
+}
+
+
+///
+/// \brief Operator AND
+///
+/// \param ref The cube to AND this color with (must be at least as large as this cube).
+///
+void TCCubeChannel::OP_AND(const TCCube &ref)
+{
+    ApplyOperator(ref, '&');
+}
+
+
+///
+/// \brief Operator OR
+///
+/// \param ref The cube to OR this color with (must be at least as large as this cube).
+///
+void TCCubeChannel::OP_OR(const TCCube &ref)
+{
+    ApplyOperator(ref, '|');
+}
+
+
+///
+/// \brief Operator XOR
+///
+/// \param ref The cube to XOR this color with (must be at least as large as this cube).
+///
+void TCCubeChannel::OP_XOR(const TCCube &ref)
+{
+    ApplyOperator(ref, '^');
+}
+
+
+///
+/// \brief Operator NOT
+///
+/// Performs a logical NOT on this color of each voxel (so it becomes either 0x00 or 0x01).
+///
+void TCCubeChannel::OP_NOT()
+{
+    byte *pCh = BeginChannelWrite();
+    for (size_t i = 0; i < numVoxels; i++) pCh[4 * i] = !pCh[4 * i];
+    MarkChanged();
+}
+
+
+///
+/// \brief Get Data
+///
+/// Unpacks this color of each voxel into the voxel buffer (allocating it the first time),
+/// if any color has been modified since the last time this was called.
+///
+/// \returns A pointer to the unpacked voxel buffer (see TCCube::GetData).
+///
+byte *TCCubeChannel::GetData() const
+{
+    if (dataVersion != pShared->version)
+    {
+        if (pCubeState == NULL)
+        {
+            // The buffer is only a cache of this color, so we can allocate it from a
+            // const method.
+            const_cast<TCCubeChannel*>(this)->AllocateBuffer();
+        }
+        const byte *pCh = Channel();
+        for (size_t i = 0; i < numVoxels; i++) pCubeState[i] = pCh[4 * i];
+        dataVersion = pShared->version;
+    }
+    return pCubeState;
+}
+
+
+///
+/// \brief Get Voxel Color
+///
+/// Gets every color of a voxel with a single load.
+///
+/// \param x The x-coordinate of the voxel.
+/// \param y The y-coordinate of the voxel.
+/// \param z The z-coordinate of the voxel.
+///
+/// \returns The 24-bit color of the voxel (0xRRGGBB).
+///
+uint32_t TCCubeChannel::GetVoxelColor(byte x, byte y, byte z) const
+{
+    CheckVoxelBounds(x, y, z);
+    return pShared->pColors[x * stride[0] + y * stride[1] + z];
+}
+
+
+///
+/// \brief Set Voxel Color
+///
+/// Sets every color of a voxel with a single store.
+///
+/// \param x             The x-coordinate of the voxel.
+/// \param y             The y-coordinate of the voxel.
+/// \param z             The z-coordinate of the voxel.
+/// \param rgbColorValue The 24-bit color to set the voxel to (0xRRGGBB).
+///
+void TCCubeChannel::SetVoxelColor(byte x, byte y, byte z, uint32_t rgbColorValue)
+{
+    CheckVoxelBounds(x, y, z);
+    BeginWrite()[x * stride[0] + y * stride[1] + z] = rgbColorValue & 0xFFFFFF;
+    MarkChanged(x);
+}
+
+
+///
+/// \brief Set Column Color
+///
+/// Sets every color of each voxel in a column along the passed axis in one pass.
+///
+/// \param axis          The axis the column is parallel to (e.g. TC_X_AXIS).
+/// \param dim1          The first remaining coordinate of the column (in x, y, z order).
+/// \param dim2          The second remaining coordinate of the column (in x, y, z order).
+/// \param rgbColorValue The 24-bit color to set the voxels to (0xRRGGBB).
+///
+void TCCubeChannel::SetColumnColor(byte axis, byte dim1, byte dim2, uint32_t rgbColorValue)
+{
+    int lo[3], hi[3];
+    if (!ColumnRegion(axis, dim1, dim2, lo, hi)) return;
+    FillColorRegion(lo, hi, rgbColorValue);
+    if (axis == TC_X_AXIS) MarkChanged();
+    else                   MarkChanged(dim1);
+}
+
+
+///
+/// \brief Compare Column Color
+///
+/// \param axis          The axis the column is parallel to (e.g. TC_X_AXIS).
+/// \param dim1          The first remaining coordinate of the column (in x, y, z order).
+/// \param dim2          The second remaining coordinate of the column (in x, y, z order).
+/// \param rgbColorValue The 24-bit color to compare each voxel in the column with.
+///
+/// \returns True if every voxel in the column has the passed color, false otherwise.
+///
+bool TCCubeChannel::CompareColumnColor(byte axis, byte dim1, byte dim2,
+                                       uint32_t rgbColorValue) const
+{
+    int lo[3], hi[3];
+    if (!ColumnRegion(axis, dim1, dim2, lo, hi)) return false;
+    return CompareColorRegion(lo, hi, rgbColorValue);
+}
+
+
+///
+/// \brief Set Plane Color
+///
+/// Sets every color of each voxel in a plane in one pass.
+///
+/// \param plane         The plane to set (e.g. TC_XY_PLANE).
+/// \param offset        The position of the plane along the remaining axis.
+/// \param rgbColorValue The 24-bit color to set the voxels to (0xRRGGBB).
+///
+void TCCubeChannel::SetPlaneColor(byte plane, byte offset, uint32_t rgbColorValue)
+{
+    int lo[3], hi[3];
+    PlaneRegion(plane, offset, lo, hi);
+    FillColorRegion(lo, hi, rgbColorValue);
+    if (plane == TC_YZ_PLANE) MarkChanged(offset);
+    else                      MarkChanged();
+}
+
+
+///
+/// \brief Compare Plane Color
+///
+/// \param plane         The plane to compare (e.g. TC_XY_PLANE).
+/// \param offset        The position of the plane along the remaining axis.
+/// \param rgbColorValue The 24-bit color to compare each voxel in the plane with.
+///
+/// \returns True if every voxel in the plane has the passed color, false otherwise.
+///
+bool TCCubeChannel::ComparePlaneColor(byte plane, byte offset, uint32_t rgbColorValue) const
+{
+    int lo[3], hi[3];
+    PlaneRegion(plane, offset, lo, hi);
+    return CompareColorRegion(lo, hi, rgbColorValue);
+}
+
+
+///
+/// \brief Fill Color Box
+///
+/// Sets every color of each voxel in the box between the two passed corners (inclusive)
+/// to the passed color.  The box is clipped to the cube.
+///
+/// \param x1            The x-coordinate of the first corner.
+/// \param y1            The y-coordinate of the first corner.
+/// \param z1            The z-coordinate of the first corner.
+/// \param x2            The x-coordinate of the opposite corner.
+/// \param y2            The y-coordinate of the opposite corner.
+/// \param z2            The z-coordinate of the opposite corner.
+/// \param rgbColorValue The 24-bit color to set the voxels to (0xRRGGBB).
+///
+void TCCubeChannel::FillColorBox(byte x1, byte y1, byte z1, byte x2, byte y2, byte z2,
+                                 uint32_t rgbColorValue)
+{
+    int lo[3] = { x1, y1, z1 },
+        hi[3] = { x2, y2, z2 };
+    for (int i = 0; i < 3; i++)
+    {
+        if (lo[i] > hi[i]) std::swap(lo[i], hi[i]);
+        if (lo[i] >= sc[i]) return;
+        if (hi[i] >= sc[i]) hi[i] = sc[i] - 1;
+    }
+    FillColorRegion(lo, hi, rgbColorValue);
+    for (int x = lo[0]; x <= hi[0]; x++)
+    {
+        MarkChanged(x);
+    }
+}
+
+
+///
+/// \brief Shift Colors
+///
+/// Shifts every color of every voxel perpendicular to the passed plane at once, moving
+/// whole runs of colors (the voxels shifted in are off).
+///
+/// \param plane  The plane to shift (e.g. TC_XY_PLANE).
+/// \param offset The number of voxels to shift by (negative towards lower coordinates).
+///
+void TCCubeChannel::ShiftColors(byte plane, sbyte offset)
+{
+    if (offset == 0) return;
+    int    axis   = plane,
+           dist   = (offset > 0) ? offset : -offset;
+    if (dist > sc[axis]) dist = sc[axis];
+    size_t layer  = stride[axis],
+           runLen = sc[axis] * layer,
+           moved  = (sc[axis] - dist) * layer,
+           step   = dist * layer;
+    uint32_t *pColors = BeginWrite();
+    for (uint32_t *pRun = pColors; pRun < pColors + numVoxels; pRun += runLen)
+    {
+        if (offset > 0)
+        {
+            memmove(pRun + step, pRun, moved * sizeof(uint32_t));
+            memset(pRun, 0, step * sizeof(uint32_t));
+        }
+        else
+        {
+            memmove(pRun, pRun + step, moved * sizeof(uint32_t));
+            memset(pRun + moved, 0, step * sizeof(uint32_t));
+        }
+    }
+    MarkChanged();
+}
+
+
+///
+/// \brief Get Colors
+///
+/// \returns A pointer to the 32-bit color of the first voxel, where the voxel at
+///          (x, y, z) is at x * GetStride(TC_X_AXIS) + y * GetStride(TC_Y_AXIS) + z.
+///          The pointer is only valid until any color of the cube is modified.
+///
+const uint32_t *TCCubeChannel::GetColors() const
+{
+    return pShared->pColors;
+}
+
+
+///
+/// \brief Write Colors
+///
+/// Prepares the color buffer to be rewritten by the caller (e.g. when combining the
+/// colors of other animations, see TCCompositor), and marks every voxel as changed.
+///
+/// \returns A pointer to the 32-bit color of the first voxel (in the same order as the
+///          buffer from \ref GetColors), which is only valid until any other method
+///          modifies the cube.  The remaining byte of each color must be left as zero.
+///
+uint32_t *TCCubeChannel::WriteColors()
+{
+    uint32_t *pColors = BeginWrite();
+    MarkChanged();
+    return pColors;
+}
+
+
+///
+/// \brief Retain Colors
+///
+/// Takes a reference to the current color buffer, so it is not modified or deleted
+/// until the reference is released.  The next modification of any color of this cube
+/// copies the buffer first.
+///
+/// \returns The reference counted block holding the buffer returned by \ref GetColors,
+///          which must be passed to \ref ReleaseColors once it is no longer needed.
+///
+byte *TCCubeChannel::RetainColors() const
+{
+    __atomic_add_fetch((int *)pShared->pAlloc, 1, __ATOMIC_RELAXED);
+    return pShared->pAlloc;
+}
+
+
+///
+/// \brief Release Colors
+///
+/// Releases a reference taken with \ref RetainColors (deleting the buffer if it was the
+/// last one).
+///
+/// \param pAlloc The block returned by \ref RetainColors.
+///
+void TCCubeChannel::ReleaseColors(byte *pAlloc)
+{
+    ReleaseBuffer(pAlloc);
+}
+
+
+///
+/// \brief Begin Write
+///
+/// Prepares the color buffer to be modified.  If a frame holds a reference to it, the
+/// buffer is copied first (and every view of it uses the copy from now on).  This also
+/// invalidates the unpacked buffer of every view.
+///
+/// \returns A pointer to the color buffer, which can be modified by the caller.
+///
+uint32_t *TCCubeChannel::BeginWrite()
+{
+    if (__atomic_load_n((int *)pShared->pAlloc, __ATOMIC_ACQUIRE) > 1)
+    {
+        byte     *pOldAlloc  = pShared->pAlloc;
+        uint32_t *pOldColors = pShared->pColors;
+        pShared->pColors = (uint32_t *)NewBuffer(numVoxels * sizeof(uint32_t),
+                                                 pShared->pAlloc);
+        memcpy(pShared->pColors, pOldColors, numVoxels * sizeof(uint32_t));
+        ReleaseBuffer(pOldAlloc);
+    }
+    pShared->version++;
+    return pShared->pColors;
+}
+
+
+///
+/// \brief Fill Region
+///
+/// \param lo    The lowest x, y, and z coordinates of the box (already clipped).
+/// \param hi    The highest x, y, and z coordinates of the box (already clipped).
+/// \param state The state to set this color of each voxel in the box to.
+///
+void TCCubeChannel::FillRegion(const int lo[3], const int hi[3], byte state)
+{
+    byte *pCh = BeginChannelWrite();
+    for (int x = lo[0]; x <= hi[0]; x++)
+    {
+        for (int y = lo[1]; y <= hi[1]; y++)
+        {
+            byte *pRow = pCh + 4 * (x * stride[0] + y * stride[1]);
+            for (int z = lo[2]; z <= hi[2]; z++) pRow[4 * z] = state;
+        }
+    }
+}
+
+
+///
+/// \brief Compare Region
+///
+/// \param lo     The lowest x, y, and z coordinates of the box (already clipped).
+/// \param hi     The highest x, y, and z coordinates of the box (already clipped).
+/// \param cmpVal The state to compare this color of each voxel in the box with.
+///
+/// \returns True if every voxel in the box is equal to cmpVal, false otherwise.
+///
+bool TCCubeChannel::CompareRegion(const int lo[3], const int hi[3], byte cmpVal) const
+{
+    const byte *pCh = Channel();
+    for (int x = lo[0]; x <= hi[0]; x++)
+    {
+        for (int y = lo[1]; y <= hi[1]; y++)
+        {
+            const byte *pRow = pCh + 4 * (x * stride[0] + y * stride[1]);
+            for (int z = lo[2]; z <= hi[2]; z++)
+            {
+                if (pRow[4 * z] != cmpVal) return false;
+            }
+        }
+    }
+    return true;
+}
+
+
+///
+/// \brief Fill Color Region
+///
+/// \param lo            The lowest x, y, and z coordinates of the box (already clipped).
+/// \param hi            The highest x, y, and z coordinates of the box (already clipped).
+/// \param rgbColorValue The 24-bit color to set each voxel in the box to.
+///
+void TCCubeChannel::FillColorRegion(const int lo[3], const int hi[3],
+                                    uint32_t rgbColorValue)
+{
+    uint32_t *pColors = BeginWrite();
+    for (int x = lo[0]; x <= hi[0]; x++)
+    {
+        for (int y = lo[1]; y <= hi[1]; y++)
+        {
+            uint32_t *pRow = pColors + x * stride[0] + y * stride[1];
+            std::fill(pRow + lo[2], pRow + hi[2] + 1, rgbColorValue & 0xFFFFFF);
+        }
+    }
+}
+
+
+///
+/// \brief Compare Color Region
+///
+/// \param lo            The lowest x, y, and z coordinates of the box (already clipped).
+/// \param hi            The highest x, y, and z coordinates of the box (already clipped).
+/// \param rgbColorValue The 24-bit color to compare each voxel in the box with.
+///
+/// \returns True if every voxel in the box has the passed color, false otherwise.
+///
+bool TCCubeChannel::CompareColorRegion(const int lo[3], const int hi[3],
+                                       uint32_t rgbColorValue) const
+{
+    const uint32_t *pColors = pShared->pColors;
+    uint32_t        cmpVal  = rgbColorValue & 0xFFFFFF;
+    for (int x = lo[0]; x <= hi[0]; x++)
+    {
+        for (int y = lo[1]; y <= hi[1]; y++)
+        {
+            const uint32_t *pRow = pColors + x * stride[0] + y * stride[1];
+            for (int z = lo[2]; z <= hi[2]; z++)
+            {
+                if (pRow[z] != cmpVal) return false;
+            }
+        }
+    }
+    return true;
+}
+
+
+///
+/// \brief Column Region
+///
+/// Validates a column (once for every color), and sets the box holding it.
+///
+/// \param axis The axis the column is parallel to (e.g. TC_X_AXIS).
+/// \param dim1 The first remaining coordinate of the column (in x, y, z order).
+/// \param dim2 The second remaining coordinate of the column (in x, y, z order).
+/// \param lo   Set to the lowest x, y, and z coordinates of the column.
+/// \param hi   Set to the highest x, y, and z coordinates of the column.
+///
+/// \returns True if the axis is valid (otherwise lo and hi are not set).
+///
+bool TCCubeChannel::ColumnRegion(byte axis, byte dim1, byte dim2,
+                                 int lo[3], int hi[3]) const
+{
+    switch (axis)
+    {
+        case TC_X_AXIS:
+            CheckVoxelBounds(0, dim1, dim2);
+            lo[0] = 0;    hi[0] = sc[0] - 1;
+            lo[1] = hi[1] = dim1;
+            lo[2] = hi[2] = dim2;
+            return true;
+
+        case TC_Y_AXIS:
+            CheckVoxelBounds(dim1, 0, dim2);
+            lo[0] = hi[0] = dim1;
+            lo[1] = 0;    hi[1] = sc[1] - 1;
+            lo[2] = hi[2] = dim2;
+            return true;
+
+        case TC_Z_AXIS:
+            CheckVoxelBounds(dim1, dim2, 0);
+            lo[0] = hi[0] = dim1;
+            lo[1] = hi[1] = dim2;
+            lo[2] = 0;    hi[2] = sc[2] - 1;
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+
+///
+/// \brief Plane Region
+///
+/// Validates a plane, and sets the box holding it.
+///
+/// \param plane  The plane (e.g. TC_XY_PLANE).
+/// \param offset The position of the plane along the remaining axis.
+/// \param lo     Set to the lowest x, y, and z coordinates of the plane.
+/// \param hi     Set to the highest x, y, and z coordinates of the plane.
+///
+void TCCubeChannel::PlaneRegion(byte plane, byte offset, int lo[3], int hi[3]) const
+{
+    // Each plane definition is equal to the axis it is perpendicular to.
+    assert(plane <= TC_XY_PLANE);
+    assert(offset < sc[plane]);
+    for (int i = 0; i < 3; i++)
+    {
+        lo[i] = 0;
+        hi[i] = sc[i] - 1;
+    }
+    lo[plane] = hi[plane] = offset;
+}
+
+
+///
+/// \brief Apply Operator
+///
+/// Performs one of the AND, OR, or XOR operators between this color and the voxel
+/// buffer of the passed cube.
+///
+/// \param ref The cube to combine with this color.
+/// \param op  The operator to perform ('&', '|', or '^').
+///
+void TCCubeChannel::ApplyOperator(const TCCube &ref, char op)
+{
+    assert(    (sc[0] <= ref.GetSize(TC_X_AXIS)) && (sc[1] <= ref.GetSize(TC_Y_AXIS))
+            && (sc[2] <= ref.GetSize(TC_Z_AXIS)) );
+    const byte *pRef = ref.GetData();   // (before BeginWrite, in case ref is this cube)
+    size_t refStride[2] = { ref.GetStride(TC_X_AXIS), ref.GetStride(TC_Y_AXIS) };
+    byte  *pCh = BeginChannelWrite();
+    for (int x = 0; x < sc[0]; x++)
+    {
+        for (int y = 0; y < sc[1]; y++)
+        {
+            byte       *pRow    = pCh + 4 * (x * stride[0] + y * stride[1]);
+            const byte *pRefRow = pRef + x * refStride[0] + y * refStride[1];
+            switch (op)
+            {
+                case '&': for (int z = 0; z < sc[2]; z++) pRow[4 * z] &= pRefRow[z]; break;
+                case '|': for (int z = 0; z < sc[2]; z++) pRow[4 * z] |= pRefRow[z]; break;
+                case '^': for (int z = 0; z < sc[2]; z++) pRow[4 * z] ^= pRefRow[z]; break;
+            }
+        }
+    }
+    MarkChanged();
+}
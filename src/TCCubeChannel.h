@@ -0,0 +1,153 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *                         TCCubeChannel Object  Header File                           *
+ *                                      TRICLYSM                                       *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  This file contains the definition of the TCCubeChannel class as implemented by     *
+ *  the TCCubeChannel.cpp source file.  This class inherits the TCCube class, but      *
+ *  stores its voxels as one byte of a shared buffer of 32-bit RGBX colors, so the     *
+ *  red, green, and blue cubes of an animation can be read with a single load.         *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  Copyright (C) 2011 Brandon Castellano, Ryan Mantha. All rights reserved.           *
+ *  Triclysm is provided under the BSD-2-Clause license. This program uses the SDL     *
+ *  (Simple DirectMedia Layer) library, and the Lua scripting language. See the        *
+ *  included LICENSE file or <http://www.triclysm.com/> for more details.              *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+///
+/// \file  TCCubeChannel.h
+/// \brief This file contains the definition of the TCCubeChannel class as implemented by
+///        the TCCubeChannel.cpp source file.
+///
+
+#pragma once
+#ifndef TC_CUBE_CHANNEL_
+#define TC_CUBE_CHANNEL_
+
+#include "TCCube.h"
+#include <stdint.h>             // Used for the uint32_t and uint64_t types.
+
+// Each color is stored so a 32-bit load of a voxel gives the same 0xRRGGBB value as
+// TCAnim::GetVoxelColor (the remaining byte is always zero).
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    #define TC_CHANNEL_BYTE(color) (1 + (color))    ///< Byte of a color in each voxel.
+#else
+    #define TC_CHANNEL_BYTE(color) (2 - (color))    ///< Byte of a color in each voxel.
+#endif
+
+
+///
+/// \brief Triclysm Color Channel Cube Object
+///
+/// This class represents the same three-dimensional rectangular prism as the TCCube
+/// class, but is a view of one color (red, green, or blue) of an interleaved buffer of
+/// 32-bit colors.  The three views of a buffer are used as the cubeState objects of an
+/// animation with 3 colors, so the existing per-color methods keep working, while the
+/// color methods (e.g. \ref GetVoxelColor) read or write all three colors at once.
+///
+/// \remarks The views of a buffer share it (and delete it along with the last view).
+///          A TCFrame can also hold a reference to the buffer (see \ref RetainColors), in
+///          which case the next modification copies the buffer first.
+///
+class TCCubeChannel : public TCCube
+{
+  public:
+    // Object constructors:
+    TCCubeChannel(byte tccSize[3]);                     // New buffer, red color view.
+    TCCubeChannel(TCCubeChannel &share, byte color);    // Another color of share's buffer.
+    ~TCCubeChannel();                                   // TCCubeChannel destructor.
+    TCCube *Clone() const;                              // Copies this color into a TCCube.
+
+    void ResetCubeState(byte state = 0);
+
+    // State setting and getting methods:
+    void SetVoxelState(byte x, byte y, byte z, byte state);
+    byte GetVoxelState(byte x, byte y, byte z);
+    void SetColumnState(byte axis, byte dim1, byte dim2, byte state);
+    bool GetColumnState(byte axis, byte dim1, byte dim2, byte cmpVal);
+    void SetPlaneState(byte plane, byte offset, byte state);
+    bool GetPlaneState(byte plane, byte offset, byte cmpVal);
+
+    void Shift(byte plane, sbyte offset, byte shiftIn = 0x00);
+    void SetShiftMode(byte mode);
+
+    void FillBox(byte x1, byte y1, byte z1, byte x2, byte y2, byte z2, byte state);
+
+    // Reductions (performed on the unpacked voxel buffer):
+    size_t   CountLitVoxels() const;
+    uint64_t SumVoxels() const;
+    void     GetPlaneCounts(byte plane, size_t *pCounts) const;
+    void     GetColumnCounts(byte axis, size_t *pCounts) const;
+    bool     GetBoundingBox(byte lo[3], byte hi[3]) const;
+
+    // Cube operators:
+    void OP_AND(const TCCube &ref);
+    void OP_OR(const TCCube &ref);
+    void OP_XOR(const TCCube &ref);
+    void OP_NOT();
+
+    // Raw voxel buffer access (this color is unpacked into one byte per voxel):
+    byte *GetData() const;
+
+    // Color methods (these read or write every color of a voxel at once):
+    uint32_t GetVoxelColor(byte x, byte y, byte z) const;
+    void     SetVoxelColor(byte x, byte y, byte z, uint32_t rgbColorValue);
+    void     SetColumnColor(byte axis, byte dim1, byte dim2, uint32_t rgbColorValue);
+    bool     CompareColumnColor(byte axis, byte dim1, byte dim2,
+                                uint32_t rgbColorValue) const;
+    void     SetPlaneColor(byte plane, byte offset, uint32_t rgbColorValue);
+    bool     ComparePlaneColor(byte plane, byte offset, uint32_t rgbColorValue) const;
+    void     FillColorBox(byte x1, byte y1, byte z1, byte x2, byte y2, byte z2,
+                          uint32_t rgbColorValue);
+    void     ShiftColors(byte plane, sbyte offset);
+
+    // Interleaved buffer access (in the same order as the buffer from GetData):
+    const uint32_t *GetColors() const;
+    uint32_t       *WriteColors();                      // For rewriting every color.
+    byte           *RetainColors() const;               // Takes a reference to the buffer.
+    static void     ReleaseColors(byte *pAlloc);        // Releases the above reference.
+
+  private:
+    /// \brief The interleaved color buffer shared by the views of each color.
+    struct SharedColors
+    {
+        byte     *pAlloc;       ///< Reference counted block (see TCCube::NewBuffer).
+        uint32_t *pColors;      ///< The 32-bit color of each voxel, inside pAlloc.
+        uint64_t  version;      ///< Incremented whenever any color is modified.
+        int       numViews;     ///< Number of TCCubeChannel objects using this struct.
+    };
+
+    TCCubeChannel(const TCCubeChannel &);   // Not implemented (see Clone).
+
+    // Copies the buffer if a frame holds it, and returns it for writing.
+    uint32_t *BeginWrite();
+    // Same as above, but returns the first byte of this view's color.
+    byte *BeginChannelWrite() { return (byte *)BeginWrite() + TC_CHANNEL_BYTE(color); }
+    // Returns the first byte of this view's color (each voxel is 4 bytes apart).
+    const byte *Channel() const
+        { return (const byte *)pShared->pColors + TC_CHANNEL_BYTE(color); }
+    // Sets or compares every voxel in a clipped (lo <= hi) box.
+    void FillRegion(const int lo[3], const int hi[3], byte state);
+    bool CompareRegion(const int lo[3], const int hi[3], byte cmpVal) const;
+    // Same as above, but for every color of each voxel at once.
+    void FillColorRegion(const int lo[3], const int hi[3], uint32_t rgbColorValue);
+    bool CompareColorRegion(const int lo[3], const int hi[3], uint32_t rgbColorValue) const;
+    // Sets the box holding a column (returns false for an invalid axis).
+    bool ColumnRegion(byte axis, byte dim1, byte dim2, int lo[3], int hi[3]) const;
+    // Sets the box holding a plane.
+    void PlaneRegion(byte plane, byte offset, int lo[3], int hi[3]) const;
+    // Performs one of the AND/OR/XOR operators with a cube of any storage type.
+    void ApplyOperator(const TCCube &ref, char op);
+
+    SharedColors *pShared;              ///< The buffer this object is a view of.
+    byte          color;                ///< The color of this view (e.g. TC_COLOR_G).
+    mutable uint64_t dataVersion;       ///< Buffer version when GetData last unpacked it.
+};
+
+
+#endif
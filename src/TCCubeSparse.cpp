@@ -0,0 +1,1122 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *                         TCCubeSparse Object  Source Code                            *
+ *                                      TRICLYSM                                       *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  This file contains the implementation of the TCCubeSparse class as defined by the  *
+ *  TCCubeSparse.h header file.  This class inherits the TCCube class, but only stores *
+ *  the 8x8x8 bricks of voxels which are not entirely off, in a hash table.            *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  Copyright (C) 2011 Brandon Castellano, Ryan Mantha. All rights reserved.           *
+ *  Triclysm is provided under the BSD-2-Clause license. This program uses the SDL     *
+ *  (Simple DirectMedia Layer) library, and the Lua scripting language. See the        *
+ *  included LICENSE file or <http://www.triclysm.com/> for more details.              *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+///
+/// \file  TCCubeSparse.cpp
+/// \brief This file contains the implementation of the TCCubeSparse class as defined by
+///        the TCCubeSparse.h header file.
+///
+
+#include "TCCubeSparse.h"
+#include "cube_kernels.h"
+#include <cassert>      // Used to validate the cube operator arguments.
+#include <cstring>      // Used for memset and memcpy on the bricks.
+#include <algorithm>    // Used for std::swap, std::min, and std::max.
+
+#define TC_SPARSE_TABLE_BITS 6      ///< Log2 of the initial number of hash table slots.
+
+// Each brick key holds the brick coordinates on the x, y, and z axes in separate bytes.
+#define TC_KEY_X(key) ((int)((key) >> 16)          << TC_BRICK_SHIFT)
+#define TC_KEY_Y(key) ((int)(((key) >> 8) & 0xFF)  << TC_BRICK_SHIFT)
+#define TC_KEY_Z(key) ((int)((key) & 0xFF)         << TC_BRICK_SHIFT)
+
+
+///
+/// \brief Cubic Constructor
+///
+/// Creates a TCCubeSparse object where the voxels in each dimension span from 0 to
+/// cubeSize-1.  No bricks are allocated until a voxel is turned on.
+///
+/// \param cubeSize The size (in voxels) of each dimension.
+///
+TCCubeSparse::TCCubeSparse(byte cubeSize)
+    : TCCube(cubeSize, cubeSize, cubeSize, false),
+      pTable(NULL), numBricks(0), tableBits(0), dataValid(false)
+{
+    ResizeTable(TC_SPARSE_TABLE_BITS);
+}
+
+
+///
+/// \brief Rectangular Prism Constructor
+///
+/// Creates a TCCubeSparse object where the voxels in each dimension span from 0 to each
+/// passed dimension minus 1.  No bricks are allocated until a voxel is turned on.
+///
+/// \param sizeX The size (in voxels) of the x-dimension.
+/// \param sizeY The size (in voxels) of the y-dimension.
+/// \param sizeZ The size (in voxels) of the z-dimension.
+///
+TCCubeSparse::TCCubeSparse(byte sizeX, byte sizeY, byte sizeZ)
+    : TCCube(sizeX, sizeY, sizeZ, false),
+      pTable(NULL), numBricks(0), tableBits(0), dataValid(false)
+{
+    ResizeTable(TC_SPARSE_TABLE_BITS);
+}
+
+
+///
+/// \brief Rectangular Prism Constructor (Array)
+///
+/// Creates a TCCubeSparse object where the voxels in each dimension span from 0 to each
+/// passed dimension minus 1.  No bricks are allocated until a voxel is turned on.
+///
+/// \param tccSize An array containing the x, y, and z sizes (in voxels).
+///
+TCCubeSparse::TCCubeSparse(byte tccSize[3])
+    : TCCube(tccSize[0], tccSize[1], tccSize[2], false),
+      pTable(NULL), numBricks(0), tableBits(0), dataValid(false)
+{
+    ResizeTable(TC_SPARSE_TABLE_BITS);
+}
+
+
+///
+/// \brief Copy Constructor
+///
+/// Creates a new TCCubeSparse object which is a clone of the passed one, copying each
+/// allocated brick (and keeping the same hash table size).
+///
+/// \param toCopy The TCCubeSparse object to duplicate.
+///
+TCCubeSparse::TCCubeSparse(const TCCubeSparse &toCopy)
+    : TCCube(toCopy.sc[0], toCopy.sc[1], toCopy.sc[2], false),
+      pTable(NULL), numBricks(toCopy.numBricks), tableBits(toCopy.tableBits),
+      dataValid(false)
+{
+    size_t tableSize = (size_t)1 << tableBits;
+    pTable = new Brick*[tableSize];
+    for (size_t s = 0; s < tableSize; s++)
+    {
+        pTable[s] = (toCopy.pTable[s] != NULL) ? new Brick(*toCopy.pTable[s]) : NULL;
+    }
+    generation = toCopy.generation;
+    memcpy(sliceGen, toCopy.sliceGen, sizeof(sliceGen));
+}
+
+
+///
+/// \brief Destructor
+///
+/// Deletes every brick and the hash table (the unpacked buffer is deleted by the base
+/// class).
+///
+TCCubeSparse::~TCCubeSparse()
+{
+    FreeBricks();
+    delete[] pTable;
+}
+
+
+///
+/// \brief Clone
+///
+/// \returns A new TCCubeSparse object holding the same voxel states as this one.
+///
+TCCube *TCCubeSparse::Clone() const
+{
+    return new TCCubeSparse(*this);
+}
+
+
+///
+/// \brief Reset Cube State
+///
+/// Sets every voxel in the cube to the passed state.  Resetting the cube to off deletes
+/// every brick, while any other state allocates all of them.
+///
+/// \param state The state to set the voxels in the cube to (defaults to off).
+///
+void TCCubeSparse::ResetCubeState(byte state)
+{
+    FreeBricks();
+    if (state)
+    {
+        int lo[3] = { 0, 0, 0 },
+            hi[3] = { sc[0] - 1, sc[1] - 1, sc[2] - 1 };
+        FillRegion(lo, hi, state);
+    }
+    dataValid = false;
+    MarkChanged();
+}
+
+
+///
+/// \brief Set Voxel State
+///
+/// Sets the voxel at the passed coordinates to the passed state, allocating its brick if
+/// the voxel is the first one in it to be turned on.
+///
+/// \param x     The x-coordinate of the voxel.
+/// \param y     The y-coordinate of the voxel.
+/// \param z     The z-coordinate of the voxel.
+/// \param state The state to set the voxel to.
+///
+void TCCubeSparse::SetVoxelState(byte x, byte y, byte z, byte state)
+{
+    CheckVoxelBounds(x, y, z);
+    SetRaw(x, y, z, state);
+    dataValid = false;
+    MarkChanged(x);
+}
+
+
+///
+/// \brief Get Voxel State
+///
+/// \param x The x-coordinate of the voxel.
+/// \param y The y-coordinate of the voxel.
+/// \param z The z-coordinate of the voxel.
+///
+/// \returns The state of the voxel at the passed coordinates (0x00 if its brick has not
+///          been allocated).
+///
+byte TCCubeSparse::GetVoxelState(byte x, byte y, byte z)
+{
+    CheckVoxelBounds(x, y, z);
+    const Brick *pBrick = FindBrick(BrickKey(x >> TC_BRICK_SHIFT, y >> TC_BRICK_SHIFT,
+                                             z >> TC_BRICK_SHIFT));
+    return (pBrick != NULL) ? pBrick->voxels[BrickOffset(x, y, z)] : 0x00;
+}
+
+
+///
+/// \brief Set Column State
+///
+/// Sets every voxel in a column along the passed axis to the passed state.
+///
+/// \param axis  The axis the column is parallel to (e.g. TC_X_AXIS).
+/// \param dim1  The first remaining coordinate of the column (in x, y, z order).
+/// \param dim2  The second remaining coordinate of the column (in x, y, z order).
+/// \param state The state to set the voxels to.
+///
+void TCCubeSparse::SetColumnState(byte axis, byte dim1, byte dim2, byte state)
+{
+    int lo[3], hi[3];
+    switch (axis)
+    {
+        case TC_X_AXIS:
+            CheckVoxelBounds(0, dim1, dim2);
+            lo[0] = 0;    hi[0] = sc[0] - 1;
+            lo[1] = hi[1] = dim1;
+            lo[2] = hi[2] = dim2;
+            FillRegion(lo, hi, state);
+            MarkChanged();
+            break;
+
+        case TC_Y_AXIS:
+            CheckVoxelBounds(dim1, 0, dim2);
+            lo[0] = hi[0] = dim1;
+            lo[1] = 0;    hi[1] = sc[1] - 1;
+            lo[2] = hi[2] = dim2;
+            FillRegion(lo, hi, state);
+            MarkChanged(dim1);
+            break;
+
+        case TC_Z_AXIS:
+            CheckVoxelBounds(dim1, dim2, 0);
+            lo[0] = hi[0] = dim1;
+            lo[1] = hi[1] = dim2;
+            lo[2] = 0;    hi[2] = sc[2] - 1;
+            FillRegion(lo, hi, state);
+            MarkChanged(dim1);
+            break;
+    }
+    dataValid = false;
+}
+
+
+///
+/// \brief Get Column State
+///
+/// \param axis   The axis the column is parallel to (e.g. TC_X_AXIS).
+/// \param dim1   The first remaining coordinate of the column (in x, y, z order).
+/// \param dim2   The second remaining coordinate of the column (in x, y, z order).
+/// \param cmpVal The state to compare each voxel in the column with.
+///
+/// \returns True if every voxel in the column is equal to cmpVal, false otherwise.
+///
+bool TCCubeSparse::GetColumnState(byte axis, byte dim1, byte dim2, byte cmpVal)
+{
+    int lo[3], hi[3];
+    switch (axis)
+    {
+        case TC_X_AXIS:
+            CheckVoxelBounds(0, dim1, dim2);
+            lo[0] = 0;    hi[0] = sc[0] - 1;
+            lo[1] = hi[1] = dim1;
+            lo[2] = hi[2] = dim2;
+            break;
+
+        case TC_Y_AXIS:
+            CheckVoxelBounds(dim1, 0, dim2);
+            lo[0] = hi[0] = dim1;
+            lo[1] = 0;    hi[1] = sc[1] - 1;
+            lo[2] = hi[2] = dim2;
+            break;
+
+        case TC_Z_AXIS:
+            CheckVoxelBounds(dim1, dim2, 0);
+            lo[0] = hi[0] = dim1;
+            lo[1] = hi[1] = dim2;
+            lo[2] = 0;    hi[2] = sc[2] - 1;
+            break;
+
+        default:
+            return false;
+    }
+    return CompareRegion(lo, hi, cmpVal);
+}
+
+
+///
+/// \brief Set Plane State
+///
+/// Sets every voxel in a plane to the passed state.
+///
+/// \param plane  The plane to set (e.g. TC_XY_PLANE).
+/// \param offset The position of the plane along the remaining axis.
+/// \param state  The state to set the voxels to.
+///
+void TCCubeSparse::SetPlaneState(byte plane, byte offset, byte state)
+{
+    // Each plane definition is equal to the axis it is perpendicular to.
+    int lo[3] = { 0, 0, 0 },
+        hi[3] = { sc[0] - 1, sc[1] - 1, sc[2] - 1 };
+    assert(plane <= TC_XY_PLANE);
+    assert(offset < sc[plane]);
+    lo[plane] = hi[plane] = offset;
+    FillRegion(lo, hi, state);
+    if (plane == TC_YZ_PLANE) MarkChanged(offset);
+    else                      MarkChanged();
+    dataValid = false;
+}
+
+
+///
+/// \brief Get Plane State
+///
+/// \param plane  The plane to compare (e.g. TC_XY_PLANE).
+/// \param offset The position of the plane along the remaining axis.
+/// \param cmpVal The state to compare each voxel in the plane with.
+///
+/// \returns True if every voxel in the plane is equal to cmpVal, false otherwise.
+///
+bool TCCubeSparse::GetPlaneState(byte plane, byte offset, byte cmpVal)
+{
+    int lo[3] = { 0, 0, 0 },
+        hi[3] = { sc[0] - 1, sc[1] - 1, sc[2] - 1 };
+    assert(plane <= TC_XY_PLANE);
+    assert(offset < sc[plane]);
+    lo[plane] = hi[plane] = offset;
+    return CompareRegion(lo, hi, cmpVal);
+}
+
+
+///
+/// \brief Shift
+///
+/// Shifts every voxel in the cube perpendicular to the passed plane.  Since the bricks do
+/// not line up after most shifts, the lit voxels are moved into a new hash table, so the
+/// time taken depends on the number of allocated bricks (not the size of the cube).
+///
+/// \param plane   The plane to shift (e.g. TC_XY_PLANE).
+/// \param offset  The number of voxels to shift by (negative towards lower coordinates).
+/// \param shiftIn The state of the voxels shifted in (defaults to off).
+///
+void TCCubeSparse::Shift(byte plane, sbyte offset, byte shiftIn)
+{
+    if (offset == 0) return;
+    int axis = plane,                                   // Plane == perpendicular axis.
+        dist = (offset > 0) ? offset : -offset;         // Number of layers to move.
+
+    Brick **pOldTable = pTable;
+    size_t  oldSize   = (size_t)1 << tableBits;
+    pTable    = NULL;
+    numBricks = 0;
+    tableBits = 0;
+    ResizeTable(TC_SPARSE_TABLE_BITS);
+
+    for (size_t s = 0; s < oldSize; s++)
+    {
+        Brick *pBrick = pOldTable[s];
+        if (pBrick == NULL) continue;
+        int base[3] = { TC_KEY_X(pBrick->key), TC_KEY_Y(pBrick->key),
+                        TC_KEY_Z(pBrick->key) };
+        for (int i = 0; i < TC_BRICK_VOXELS; i++)
+        {
+            if (!pBrick->voxels[i]) continue;
+            int pos[3] = { base[0] + (i >> (2 * TC_BRICK_SHIFT)),
+                           base[1] + ((i >> TC_BRICK_SHIFT) & TC_BRICK_MASK),
+                           base[2] + (i & TC_BRICK_MASK) };
+            pos[axis] += offset;
+            if (pos[axis] >= 0 && pos[axis] < sc[axis])
+            {
+                SetRaw(pos[0], pos[1], pos[2], pBrick->voxels[i]);
+            }
+        }
+        delete pBrick;
+    }
+    delete[] pOldTable;
+
+    // Finally, shift in as many new layers as we need.
+    if (shiftIn)
+    {
+        int lo[3] = { 0, 0, 0 },
+            hi[3] = { sc[0] - 1, sc[1] - 1, sc[2] - 1 };
+        if (offset > 0) hi[axis] = std::min(dist, (int)sc[axis]) - 1;
+        else            lo[axis] = std::max(sc[axis] - dist, 0);
+        FillRegion(lo, hi, shiftIn);
+    }
+    dataValid = false;
+    MarkChanged();
+}
+
+
+///
+/// \brief Set Shift Mode
+///
+/// The bricks are always moved by Shift, so the TC_SHIFT_RING mode has no effect on a
+/// TCCubeSparse object.
+///
+/// \param mode The shift mode (TC_SHIFT_LINEAR or TC_SHIFT_RING).
+///
+void TCCubeSparse::SetShiftMode(byte mode)
+{
+    assert(mode == TC_SHIFT_LINEAR || mode == TC_SHIFT_RING);
+}
+
+
+///
+/// \brief Fill Box
+///
+/// Sets every voxel in the box between the two passed corners (inclusive) to the passed
+/// state.  Only the bricks overlapping the box are visited, and filling with the off
+/// state never allocates a brick.
+///
+/// \param x1    The x-coordinate of the first corner.
+/// \param y1    The y-coordinate of the first corner.
+/// \param z1    The z-coordinate of the first corner.
+/// \param x2    The x-coordinate of the opposite corner.
+/// \param y2    The y-coordinate of the opposite corner.
+/// \param z2    The z-coordinate of the opposite corner.
+/// \param state The state to set the voxels to.
+///
+void TCCubeSparse::FillBox(byte x1, byte y1, byte z1, byte x2, byte y2, byte z2, byte state)
+{
+    int lo[3] = { x1, y1, z1 },
+        hi[3] = { x2, y2, z2 };
+    for (int i = 0; i < 3; i++)
+    {
+        if (lo[i] > hi[i]) std::swap(lo[i], hi[i]);
+        if (lo[i] >= sc[i]) return;
+        if (hi[i] >= sc[i]) hi[i] = sc[i] - 1;
+    }
+    FillRegion(lo, hi, state);
+    for (int x = lo[0]; x <= hi[0]; x++) MarkChanged(x);
+    dataValid = false;
+}
+
+
+///
+/// \brief Count Lit Voxels
+///
+/// \returns The number of voxels which are not off (the sum of each brick's count).
+///
+size_t TCCubeSparse::CountLitVoxels() const
+{
+    size_t numLit    = 0,
+           tableSize = (size_t)1 << tableBits;
+    for (size_t s = 0; s < tableSize; s++)
+    {
+        if (pTable[s] != NULL) numLit += pTable[s]->numLit;
+    }
+    return numLit;
+}
+
+
+///
+/// \brief Sum Voxels
+///
+/// \returns The sum of the state of every voxel in the cube.
+///
+uint64_t TCCubeSparse::SumVoxels() const
+{
+    uint64_t sum       = 0;
+    size_t   tableSize = (size_t)1 << tableBits;
+    for (size_t s = 0; s < tableSize; s++)
+    {
+        if (pTable[s] != NULL) sum += TC_Kernels::Sum(pTable[s]->voxels, TC_BRICK_VOXELS);
+    }
+    return sum;
+}
+
+
+///
+/// \brief Get Plane Counts
+///
+/// Counts the number of lit voxels in every plane parallel to the passed one.
+///
+/// \param plane   The plane to count (e.g. TC_XY_PLANE).
+/// \param pCounts Array of GetSize(plane) elements, which is filled with the number of
+///                lit voxels in the plane at each offset.
+///
+void TCCubeSparse::GetPlaneCounts(byte plane, size_t *pCounts) const
+{
+    assert(plane <= TC_XY_PLANE);
+    size_t tableSize = (size_t)1 << tableBits;
+    for (int i = 0; i < sc[plane]; i++) pCounts[i] = 0;
+    for (size_t s = 0; s < tableSize; s++)
+    {
+        const Brick *pBrick = pTable[s];
+        if (pBrick == NULL) continue;
+        int base[3] = { TC_KEY_X(pBrick->key), TC_KEY_Y(pBrick->key),
+                        TC_KEY_Z(pBrick->key) };
+        for (int i = 0; i < TC_BRICK_VOXELS; i++)
+        {
+            if (!pBrick->voxels[i]) continue;
+            int pos[3] = { base[0] + (i >> (2 * TC_BRICK_SHIFT)),
+                           base[1] + ((i >> TC_BRICK_SHIFT) & TC_BRICK_MASK),
+                           base[2] + (i & TC_BRICK_MASK) };
+            pCounts[pos[plane]]++;
+        }
+    }
+}
+
+
+///
+/// \brief Get Column Counts
+///
+/// Counts the number of lit voxels in every column parallel to the passed axis.
+///
+/// \param axis    The axis to count along (e.g. TC_Z_AXIS).
+/// \param pCounts Array which is filled with the number of lit voxels in each column, in
+///                the same order as the dim1 and dim2 arguments of SetColumnState (the
+///                column at (dim1, dim2) is at dim1 * size of dim2 + dim2).
+///
+void TCCubeSparse::GetColumnCounts(byte axis, size_t *pCounts) const
+{
+    assert(axis <= TC_Z_AXIS);
+    int    dim1 = (axis == TC_X_AXIS) ? TC_Y_AXIS : TC_X_AXIS,
+           dim2 = (axis == TC_Z_AXIS) ? TC_Y_AXIS : TC_Z_AXIS;
+    size_t tableSize = (size_t)1 << tableBits;
+    for (size_t i = 0; i < (size_t)sc[dim1] * sc[dim2]; i++) pCounts[i] = 0;
+    for (size_t s = 0; s < tableSize; s++)
+    {
+        const Brick *pBrick = pTable[s];
+        if (pBrick == NULL) continue;
+        int base[3] = { TC_KEY_X(pBrick->key), TC_KEY_Y(pBrick->key),
+                        TC_KEY_Z(pBrick->key) };
+        for (int i = 0; i < TC_BRICK_VOXELS; i++)
+        {
+            if (!pBrick->voxels[i]) continue;
+            int pos[3] = { base[0] + (i >> (2 * TC_BRICK_SHIFT)),
+                           base[1] + ((i >> TC_BRICK_SHIFT) & TC_BRICK_MASK),
+                           base[2] + (i & TC_BRICK_MASK) };
+            pCounts[pos[dim1] * sc[dim2] + pos[dim2]]++;
+        }
+    }
+}
+
+
+///
+/// \brief Get Bounding Box
+///
+/// Finds the smallest box containing every lit voxel in the cube.
+///
+/// \param lo Array which is set to the lowest x, y, and z coordinates of any lit voxel.
+/// \param hi Array which is set to the highest x, y, and z coordinates of any lit voxel.
+///
+/// \returns True if any voxel is lit, false otherwise (lo and hi are left unchanged).
+///
+bool TCCubeSparse::GetBoundingBox(byte lo[3], byte hi[3]) const
+{
+    int    minPos[3] = { sc[0], sc[1], sc[2] },
+           maxPos[3] = { -1, -1, -1 };
+    size_t tableSize = (size_t)1 << tableBits;
+    for (size_t s = 0; s < tableSize; s++)
+    {
+        const Brick *pBrick = pTable[s];
+        if (pBrick == NULL) continue;
+        int base[3] = { TC_KEY_X(pBrick->key), TC_KEY_Y(pBrick->key),
+                        TC_KEY_Z(pBrick->key) };
+        for (int i = 0; i < TC_BRICK_VOXELS; i++)
+        {
+            if (!pBrick->voxels[i]) continue;
+            int pos[3] = { base[0] + (i >> (2 * TC_BRICK_SHIFT)),
+                           base[1] + ((i >> TC_BRICK_SHIFT) & TC_BRICK_MASK),
+                           base[2] + (i & TC_BRICK_MASK) };
+            for (int a = 0; a < 3; a++)
+            {
+                minPos[a] = std::min(minPos[a], pos[a]);
+                maxPos[a] = std::max(maxPos[a], pos[a]);
+            }
+        }
+    }
+    if (maxPos[0] < 0) return false;
+    for (int i = 0; i < 3; i++)
+    {
+        lo[i] = (byte)minPos[i];
+        hi[i] = (byte)maxPos[i];
+    }
+    return true;
+}
+
+
+///
+/// \brief Operator AND
+///
+/// Performs a bitwise AND with each voxel in the passed cube.  Only the allocated bricks
+/// of this cube need to be visited.
+///
+/// \param ref The cube to AND with (must be at least as large as this cube).
+///
+void TCCubeSparse::OP_AND(const TCCube &ref)
+{
+    ApplyOperator(ref, '&');
+}
+
+
+///
+/// \brief Operator OR
+///
+/// Performs a bitwise OR with each voxel in the passed cube.
+///
+/// \param ref The cube to OR with (must be at least as large as this cube).
+///
+void TCCubeSparse::OP_OR(const TCCube &ref)
+{
+    ApplyOperator(ref, '|');
+}
+
+
+///
+/// \brief Operator XOR
+///
+/// Performs a bitwise XOR with each voxel in the passed cube.
+///
+/// \param ref The cube to XOR with (must be at least as large as this cube).
+///
+void TCCubeSparse::OP_XOR(const TCCube &ref)
+{
+    ApplyOperator(ref, '^');
+}
+
+
+///
+/// \brief Operator NOT
+///
+/// Performs a logical NOT on each voxel (so every voxel becomes either 0x00 or 0x01).
+/// Every voxel which was off is turned on, so this allocates every brick in the cube.
+///
+void TCCubeSparse::OP_NOT()
+{
+    int numBricksOn[3];
+    for (int a = 0; a < 3; a++)
+    {
+        numBricksOn[a] = (sc[a] + TC_BRICK_MASK) >> TC_BRICK_SHIFT;
+    }
+    for (int bx = 0; bx < numBricksOn[0]; bx++)
+    {
+        for (int by = 0; by < numBricksOn[1]; by++)
+        {
+            for (int bz = 0; bz < numBricksOn[2]; bz++)
+            {
+                Brick *pBrick = GetBrick(BrickKey(bx, by, bz));
+                int    xEnd   = std::min((int)sc[0] - (bx << TC_BRICK_SHIFT), TC_BRICK_SIZE),
+                       yEnd   = std::min((int)sc[1] - (by << TC_BRICK_SHIFT), TC_BRICK_SIZE),
+                       zEnd   = std::min((int)sc[2] - (bz << TC_BRICK_SHIFT), TC_BRICK_SIZE);
+                pBrick->numLit = 0;
+                for (int x = 0; x < xEnd; x++)
+                {
+                    for (int y = 0; y < yEnd; y++)
+                    {
+                        byte *pVoxel = pBrick->voxels + BrickOffset(x, y, 0);
+                        TC_Kernels::Not(pVoxel, zEnd);
+                        pBrick->numLit += (unsigned short)TC_Kernels::Count(pVoxel, zEnd);
+                    }
+                }
+            }
+        }
+    }
+    // Any brick which was entirely on is now entirely off, so we remove those bricks.
+    ResizeTable(tableBits);
+    dataValid = false;
+    MarkChanged();
+}
+
+
+///
+/// \brief Get Data
+///
+/// Unpacks the bricks into the voxel buffer (allocating it the first time), if the cube
+/// has been modified since the last time this was called.
+///
+/// \returns A pointer to the unpacked voxel buffer (see TCCube::GetData).
+///
+byte *TCCubeSparse::GetData() const
+{
+    if (!dataValid)
+    {
+        if (pCubeState == NULL)
+        {
+            // The buffer is only a cache of the bricks, so we can allocate it from a
+            // const method.
+            const_cast<TCCubeSparse*>(this)->AllocateBuffer();
+        }
+        memset(pCubeState, 0, numVoxels);
+        size_t tableSize = (size_t)1 << tableBits;
+        for (size_t s = 0; s < tableSize; s++)
+        {
+            const Brick *pBrick = pTable[s];
+            if (pBrick == NULL) continue;
+            int x0   = TC_KEY_X(pBrick->key),
+                y0   = TC_KEY_Y(pBrick->key),
+                z0   = TC_KEY_Z(pBrick->key),
+                xEnd = std::min((int)sc[0] - x0, TC_BRICK_SIZE),
+                yEnd = std::min((int)sc[1] - y0, TC_BRICK_SIZE),
+                zEnd = std::min((int)sc[2] - z0, TC_BRICK_SIZE);
+            for (int x = 0; x < xEnd; x++)
+            {
+                for (int y = 0; y < yEnd; y++)
+                {
+                    memcpy(pCubeState + (x0 + x) * stride[0] + (y0 + y) * stride[1] + z0,
+                           pBrick->voxels + BrickOffset(x, y, 0), zEnd);
+                }
+            }
+        }
+        dataValid = true;
+    }
+    return pCubeState;
+}
+
+
+///
+/// \brief Get Number of Bricks
+///
+/// \returns The number of 8x8x8 bricks currently allocated (i.e. which have at least one
+///          voxel which is not off).
+///
+size_t TCCubeSparse::GetNumBricks() const
+{
+    return numBricks;
+}
+
+
+///
+/// \brief Find Slot
+///
+/// Looks up the passed key in the hash table using linear probing.
+///
+/// \param key The brick key to look for (see BrickKey).
+///
+/// \returns The slot holding the brick with the passed key, or the first empty slot
+///          found (where the brick would be inserted) if it is not allocated.
+///
+size_t TCCubeSparse::FindSlot(uint32_t key) const
+{
+    size_t mask = ((size_t)1 << tableBits) - 1,
+           slot = HashSlot(key);
+    while (pTable[slot] != NULL && pTable[slot]->key != key)
+    {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+
+///
+/// \brief Get Brick
+///
+/// Looks up the brick with the passed key, allocating a new (entirely off) brick if it
+/// does not exist yet.  The hash table is doubled in size whenever it is half full.
+///
+/// \param key The brick key to look for (see BrickKey).
+///
+/// \returns A pointer to the brick with the passed key.
+///
+TCCubeSparse::Brick *TCCubeSparse::GetBrick(uint32_t key)
+{
+    size_t slot = FindSlot(key);
+    if (pTable[slot] != NULL) return pTable[slot];
+    if ((numBricks + 1) * 2 > ((size_t)1 << tableBits))
+    {
+        ResizeTable(tableBits + 1);
+        slot = FindSlot(key);
+    }
+    Brick *pBrick = new Brick;
+    memset(pBrick->voxels, 0, sizeof(pBrick->voxels));
+    pBrick->key    = key;
+    pBrick->numLit = 0;
+    pTable[slot]   = pBrick;
+    numBricks++;
+    return pBrick;
+}
+
+
+///
+/// \brief Remove Brick
+///
+/// Deletes the brick in the passed slot, and then moves any bricks after it (which were
+/// placed further along because of a collision) back, so no lookup crosses an empty slot
+/// before reaching the brick it is looking for.
+///
+/// \param slot The hash table slot of the brick to delete.
+///
+void TCCubeSparse::RemoveBrick(size_t slot)
+{
+    size_t mask = ((size_t)1 << tableBits) - 1,
+           next = slot;
+    delete pTable[slot];
+    pTable[slot] = NULL;
+    numBricks--;
+    for (;;)
+    {
+        next = (next + 1) & mask;
+        if (pTable[next] == NULL) break;
+        // The brick can be moved into the empty slot unless its home slot lies
+        // (cyclically) between the empty slot and its current slot.
+        size_t home = HashSlot(pTable[next]->key);
+        bool   stays = (slot <= next) ? (slot < home && home <= next)
+                                      : (slot < home || home <= next);
+        if (!stays)
+        {
+            pTable[slot] = pTable[next];
+            pTable[next] = NULL;
+            slot = next;
+        }
+    }
+}
+
+
+///
+/// \brief Free Bricks
+///
+/// Deletes every allocated brick, and shrinks the hash table back to its initial size.
+///
+void TCCubeSparse::FreeBricks()
+{
+    size_t tableSize = (size_t)1 << tableBits;
+    for (size_t s = 0; s < tableSize; s++) delete pTable[s];
+    delete[] pTable;
+    pTable    = NULL;
+    numBricks = 0;
+    ResizeTable(TC_SPARSE_TABLE_BITS);
+}
+
+
+///
+/// \brief Resize Table
+///
+/// Allocates a new hash table, and re-inserts each brick from the current one.  Any brick
+/// with no lit voxels is deleted instead, so this is also used to remove the bricks left
+/// empty by operators which modify many bricks at once.
+///
+/// \param bits Log2 of the number of slots in the new hash table.
+///
+void TCCubeSparse::ResizeTable(int bits)
+{
+    Brick **pOldTable = pTable;
+    size_t  oldSize   = (pOldTable != NULL) ? ((size_t)1 << tableBits) : 0;
+    pTable    = new Brick*[(size_t)1 << bits];
+    tableBits = bits;
+    numBricks = 0;
+    memset(pTable, 0, ((size_t)1 << bits) * sizeof(Brick*));
+    for (size_t s = 0; s < oldSize; s++)
+    {
+        Brick *pBrick = pOldTable[s];
+        if (pBrick == NULL) continue;
+        if (pBrick->numLit == 0)
+        {
+            delete pBrick;
+            continue;
+        }
+        pTable[FindSlot(pBrick->key)] = pBrick;
+        numBricks++;
+    }
+    delete[] pOldTable;
+}
+
+
+///
+/// \brief Set Raw Voxel
+///
+/// Sets the voxel at the passed coordinates, allocating its brick if needed, or deleting
+/// it if this turned off the last lit voxel in it.  The coordinates are not validated.
+///
+/// \param x     The x-coordinate of the voxel.
+/// \param y     The y-coordinate of the voxel.
+/// \param z     The z-coordinate of the voxel.
+/// \param state The state to set the voxel to.
+///
+void TCCubeSparse::SetRaw(int x, int y, int z, byte state)
+{
+    uint32_t key  = BrickKey(x >> TC_BRICK_SHIFT, y >> TC_BRICK_SHIFT, z >> TC_BRICK_SHIFT);
+    size_t   slot = FindSlot(key);
+    if (pTable[slot] == NULL)
+    {
+        if (!state) return;             // Already off, so we don't need the brick.
+        Brick *pBrick = GetBrick(key);
+        pBrick->voxels[BrickOffset(x, y, z)] = state;
+        pBrick->numLit = 1;
+        return;
+    }
+    Brick *pBrick = pTable[slot];
+    byte  &voxel  = pBrick->voxels[BrickOffset(x, y, z)];
+    if (voxel && !state)
+    {
+        voxel = 0x00;
+        if (--pBrick->numLit == 0) RemoveBrick(slot);
+        return;
+    }
+    if (!voxel && state) pBrick->numLit++;
+    voxel = state;
+}
+
+
+///
+/// \brief Fill Region
+///
+/// Sets every voxel in the passed box to the passed state, brick by brick.  Filling with
+/// the off state skips the bricks which are not allocated, and deletes any brick which is
+/// left entirely off.
+///
+/// \param lo    The lowest x, y, and z coordinates of the box (already clipped).
+/// \param hi    The highest x, y, and z coordinates of the box (already clipped).
+/// \param state The state to set the voxels to.
+///
+void TCCubeSparse::FillRegion(const int lo[3], const int hi[3], byte state)
+{
+    for (int bx = lo[0] >> TC_BRICK_SHIFT; bx <= (hi[0] >> TC_BRICK_SHIFT); bx++)
+    {
+        for (int by = lo[1] >> TC_BRICK_SHIFT; by <= (hi[1] >> TC_BRICK_SHIFT); by++)
+        {
+            for (int bz = lo[2] >> TC_BRICK_SHIFT; bz <= (hi[2] >> TC_BRICK_SHIFT); bz++)
+            {
+                uint32_t key    = BrickKey(bx, by, bz);
+                Brick   *pBrick = state ? GetBrick(key) : FindBrick(key);
+                if (pBrick == NULL) continue;
+
+                // Clip the box to this brick, in coordinates within the brick.
+                int x1 = std::max(lo[0] - (bx << TC_BRICK_SHIFT), 0),
+                    y1 = std::max(lo[1] - (by << TC_BRICK_SHIFT), 0),
+                    z1 = std::max(lo[2] - (bz << TC_BRICK_SHIFT), 0),
+                    x2 = std::min(hi[0] - (bx << TC_BRICK_SHIFT), TC_BRICK_MASK),
+                    y2 = std::min(hi[1] - (by << TC_BRICK_SHIFT), TC_BRICK_MASK),
+                    z2 = std::min(hi[2] - (bz << TC_BRICK_SHIFT), TC_BRICK_MASK);
+                for (int x = x1; x <= x2; x++)
+                {
+                    for (int y = y1; y <= y2; y++)
+                    {
+                        byte *pVoxel = pBrick->voxels + BrickOffset(x, y, z1);
+                        size_t len   = z2 - z1 + 1;
+                        pBrick->numLit -= (unsigned short)TC_Kernels::Count(pVoxel, len);
+                        memset(pVoxel, state, len);
+                        if (state) pBrick->numLit += (unsigned short)len;
+                    }
+                }
+                if (pBrick->numLit == 0) RemoveBrick(FindSlot(key));
+            }
+        }
+    }
+}
+
+
+///
+/// \brief Compare Region
+///
+/// \param lo     The lowest x, y, and z coordinates of the box (already clipped).
+/// \param hi     The highest x, y, and z coordinates of the box (already clipped).
+/// \param cmpVal The state to compare each voxel in the box with.
+///
+/// \returns True if every voxel in the box is equal to cmpVal, false otherwise.
+///
+bool TCCubeSparse::CompareRegion(const int lo[3], const int hi[3], byte cmpVal) const
+{
+    for (int bx = lo[0] >> TC_BRICK_SHIFT; bx <= (hi[0] >> TC_BRICK_SHIFT); bx++)
+    {
+        for (int by = lo[1] >> TC_BRICK_SHIFT; by <= (hi[1] >> TC_BRICK_SHIFT); by++)
+        {
+            for (int bz = lo[2] >> TC_BRICK_SHIFT; bz <= (hi[2] >> TC_BRICK_SHIFT); bz++)
+            {
+                const Brick *pBrick = FindBrick(BrickKey(bx, by, bz));
+                if (pBrick == NULL)
+                {
+                    // A brick which is not allocated only holds voxels which are off.
+                    if (cmpVal) return false;
+                    continue;
+                }
+                int x1 = std::max(lo[0] - (bx << TC_BRICK_SHIFT), 0),
+                    y1 = std::max(lo[1] - (by << TC_BRICK_SHIFT), 0),
+                    z1 = std::max(lo[2] - (bz << TC_BRICK_SHIFT), 0),
+                    x2 = std::min(hi[0] - (bx << TC_BRICK_SHIFT), TC_BRICK_MASK),
+                    y2 = std::min(hi[1] - (by << TC_BRICK_SHIFT), TC_BRICK_MASK),
+                    z2 = std::min(hi[2] - (bz << TC_BRICK_SHIFT), TC_BRICK_MASK);
+                for (int x = x1; x <= x2; x++)
+                {
+                    for (int y = y1; y <= y2; y++)
+                    {
+                        if (!TC_Kernels::Equal(pBrick->voxels + BrickOffset(x, y, z1),
+                                               cmpVal, z2 - z1 + 1))
+                        {
+                            return false;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+
+///
+/// \brief Apply Operator
+///
+/// Performs one of the AND, OR, or XOR operators with the passed cube.  If the passed cube
+/// is also a TCCubeSparse, the operator is performed brick by brick (so only the bricks
+/// allocated in either cube are visited), otherwise the passed cube's voxel buffer is used.
+///
+/// \param ref The cube to combine with this one.
+/// \param op  The operator to perform ('&', '|', or '^').
+///
+void TCCubeSparse::ApplyOperator(const TCCube &ref, char op)
+{
+    assert(    (sc[0] <= ref.GetSize(TC_X_AXIS)) && (sc[1] <= ref.GetSize(TC_Y_AXIS))
+            && (sc[2] <= ref.GetSize(TC_Z_AXIS)) );
+    if (&ref == this)
+    {
+        // AND and OR with itself leave the cube unchanged, and XOR turns it off.
+        if (op == '^') FreeBricks();
+        dataValid = false;
+        MarkChanged();
+        return;
+    }
+    size_t tableSize = (size_t)1 << tableBits;
+    const TCCubeSparse *pRefSparse = dynamic_cast<const TCCubeSparse*>(&ref);
+
+    if (op == '&')
+    {
+        // Voxels which are off stay off, so only our own bricks need to be visited.
+        const byte *pRef = (pRefSparse == NULL) ? ref.GetData() : NULL;
+        size_t refStride[3] = { ref.GetStride(TC_X_AXIS), ref.GetStride(TC_Y_AXIS),
+                                ref.GetStride(TC_Z_AXIS) };
+        for (size_t s = 0; s < tableSize; s++)
+        {
+            Brick *pBrick = pTable[s];
+            if (pBrick == NULL) continue;
+            if (pRefSparse != NULL)
+            {
+                const Brick *pRefBrick = pRefSparse->FindBrick(pBrick->key);
+                if (pRefBrick == NULL)
+                {
+                    pBrick->numLit = 0;
+                    continue;
+                }
+                TC_Kernels::And(pBrick->voxels, pRefBrick->voxels, TC_BRICK_VOXELS);
+            }
+            else
+            {
+                int x0 = TC_KEY_X(pBrick->key),
+                    y0 = TC_KEY_Y(pBrick->key),
+                    z0 = TC_KEY_Z(pBrick->key);
+                for (int i = 0; i < TC_BRICK_VOXELS; i++)
+                {
+                    if (!pBrick->voxels[i]) continue;
+                    pBrick->voxels[i] &= pRef[  (x0 + (i >> (2 * TC_BRICK_SHIFT))) * refStride[0]
+                                              + (y0 + ((i >> TC_BRICK_SHIFT) & TC_BRICK_MASK))
+                                                    * refStride[1]
+                                              + (z0 + (i & TC_BRICK_MASK)) * refStride[2] ];
+                }
+            }
+            pBrick->numLit = (unsigned short)TC_Kernels::Count(pBrick->voxels,
+                                                               TC_BRICK_VOXELS);
+        }
+        // Finally, we remove any bricks which were turned off entirely.
+        ResizeTable(tableBits);
+    }
+    else if (pRefSparse != NULL)
+    {
+        // Only the voxels which are on in the other cube change this one.
+        size_t refSize = (size_t)1 << pRefSparse->tableBits;
+        for (size_t s = 0; s < refSize; s++)
+        {
+            const Brick *pRefBrick = pRefSparse->pTable[s];
+            if (pRefBrick == NULL) continue;
+            int x0 = TC_KEY_X(pRefBrick->key),
+                y0 = TC_KEY_Y(pRefBrick->key),
+                z0 = TC_KEY_Z(pRefBrick->key);
+            if (x0 >= sc[0] || y0 >= sc[1] || z0 >= sc[2]) continue;
+            Brick *pBrick = GetBrick(pRefBrick->key);
+            if (x0 + TC_BRICK_SIZE <= sc[0] && y0 + TC_BRICK_SIZE <= sc[1]
+                                            && z0 + TC_BRICK_SIZE <= sc[2])
+            {
+                if (op == '|') TC_Kernels::Or(pBrick->voxels, pRefBrick->voxels,
+                                              TC_BRICK_VOXELS);
+                else           TC_Kernels::Xor(pBrick->voxels, pRefBrick->voxels,
+                                               TC_BRICK_VOXELS);
+            }
+            else
+            {
+                // The other cube is larger, so we skip the voxels outside of this one.
+                for (int i = 0; i < TC_BRICK_VOXELS; i++)
+                {
+                    if (   x0 + (i >> (2 * TC_BRICK_SHIFT)) >= sc[0]
+                        || y0 + ((i >> TC_BRICK_SHIFT) & TC_BRICK_MASK) >= sc[1]
+                        || z0 + (i & TC_BRICK_MASK) >= sc[2] ) continue;
+                    if (op == '|') pBrick->voxels[i] |= pRefBrick->voxels[i];
+                    else           pBrick->voxels[i] ^= pRefBrick->voxels[i];
+                }
+            }
+            pBrick->numLit = (unsigned short)TC_Kernels::Count(pBrick->voxels,
+                                                               TC_BRICK_VOXELS);
+        }
+        ResizeTable(tableBits);
+    }
+    else
+    {
+        // For any other storage type, we skip every row which is entirely off.
+        const byte *pRef = ref.GetData();
+        size_t refStride[3] = { ref.GetStride(TC_X_AXIS), ref.GetStride(TC_Y_AXIS),
+                                ref.GetStride(TC_Z_AXIS) };
+        assert(refStride[2] == 1);
+        for (int x = 0; x < sc[0]; x++)
+        {
+            for (int y = 0; y < sc[1]; y++)
+            {
+                const byte *pRefRow = pRef + x * refStride[0] + y * refStride[1];
+                if (TC_Kernels::Equal(pRefRow, 0x00, sc[2])) continue;
+                for (int z = 0; z < sc[2]; z++)
+                {
+                    if (!pRefRow[z]) continue;
+                    const Brick *pBrick = FindBrick(BrickKey(x >> TC_BRICK_SHIFT,
+                                                             y >> TC_BRICK_SHIFT,
+                                                             z >> TC_BRICK_SHIFT));
+                    byte state = (pBrick != NULL) ? pBrick->voxels[BrickOffset(x, y, z)]
+                                                  : 0x00;
+                    SetRaw(x, y, z, (op == '|') ? (state | pRefRow[z])
+                                                : (state ^ pRefRow[z]));
+                }
+            }
+        }
+    }
+    dataValid = false;
+    MarkChanged();
+}
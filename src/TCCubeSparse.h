@@ -0,0 +1,154 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *                         TCCubeSparse Object  Header File                            *
+ *                                      TRICLYSM                                       *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  This file contains the definition of the TCCubeSparse class as implemented by the  *
+ *  TCCubeSparse.cpp source file.  This class inherits the TCCube class, but only      *
+ *  stores the 8x8x8 bricks of voxels which are not entirely off, in a hash table.  It  *
+ *  is used by animations with large cubes where most of the voxels are off.           *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  Copyright (C) 2011 Brandon Castellano, Ryan Mantha. All rights reserved.           *
+ *  Triclysm is provided under the BSD-2-Clause license. This program uses the SDL     *
+ *  (Simple DirectMedia Layer) library, and the Lua scripting language. See the        *
+ *  included LICENSE file or <http://www.triclysm.com/> for more details.              *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+///
+/// \file  TCCubeSparse.h
+/// \brief This file contains the definition of the TCCubeSparse class as implemented by
+///        the TCCubeSparse.cpp source file.
+///
+
+#pragma once
+#ifndef TC_CUBE_SPARSE_
+#define TC_CUBE_SPARSE_
+
+#include "TCCube.h"
+#include <stdint.h>             // Used for the uint32_t type.
+
+#define TC_BRICK_SHIFT  3                       ///< Log2 of the brick size.
+#define TC_BRICK_SIZE   (1 << TC_BRICK_SHIFT)   ///< Voxels along each side of a brick.
+#define TC_BRICK_MASK   (TC_BRICK_SIZE - 1)     ///< Mask of a coordinate within a brick.
+#define TC_BRICK_VOXELS (TC_BRICK_SIZE * TC_BRICK_SIZE * TC_BRICK_SIZE)
+
+
+///
+/// \brief Triclysm Sparse Cube Object
+///
+/// This class represents the same three-dimensional rectangular prism as the TCCube
+/// class, but divides it into bricks of 8x8x8 voxels.  A brick is only allocated when
+/// one of its voxels is first turned on, and is deleted again once all of its voxels
+/// are off, so the memory used (and the time taken by most operations) depends on the
+/// number of lit voxels instead of the size of the cube.
+///
+/// \remarks Operations which turn on most of the cube (e.g. OP_NOT, or resetting the cube
+///          to a non-zero state) allocate every brick, so they are slower than with a
+///          TCCube object.  The voxel buffer returned by \ref GetData is only created when
+///          it is requested.
+///
+class TCCubeSparse : public TCCube
+{
+  public:
+    // Object constructors:
+    TCCubeSparse(byte cubeSize);                        // Literal cube constructor.
+    TCCubeSparse(byte sizeX, byte sizeY, byte sizeZ);   // Arbitrary size constructor.
+    TCCubeSparse(byte tccSize[3]);                      // Same as above, with an array.
+    TCCubeSparse(const TCCubeSparse &toCopy);           // Copy constructor.
+    ~TCCubeSparse();                                    // TCCubeSparse destructor.
+    TCCube *Clone() const;                              // Copies the allocated bricks.
+
+    void ResetCubeState(byte state = 0);
+
+    // State setting and getting methods:
+    void SetVoxelState(byte x, byte y, byte z, byte state);
+    byte GetVoxelState(byte x, byte y, byte z);
+    void SetColumnState(byte axis, byte dim1, byte dim2, byte state);
+    bool GetColumnState(byte axis, byte dim1, byte dim2, byte cmpVal);
+    void SetPlaneState(byte plane, byte offset, byte state);
+    bool GetPlaneState(byte plane, byte offset, byte cmpVal);
+
+    void Shift(byte plane, sbyte offset, byte shiftIn = 0x00);
+    void SetShiftMode(byte mode);
+
+    void FillBox(byte x1, byte y1, byte z1, byte x2, byte y2, byte z2, byte state);
+
+    // Reductions (only the allocated bricks are visited):
+    size_t   CountLitVoxels() const;
+    uint64_t SumVoxels() const;
+    void     GetPlaneCounts(byte plane, size_t *pCounts) const;
+    void     GetColumnCounts(byte axis, size_t *pCounts) const;
+    bool     GetBoundingBox(byte lo[3], byte hi[3]) const;
+
+    // Cube operators:
+    void OP_AND(const TCCube &ref);
+    void OP_OR(const TCCube &ref);
+    void OP_XOR(const TCCube &ref);
+    void OP_NOT();
+
+    // Raw voxel buffer access (unpacked from the bricks when requested):
+    byte *GetData() const;
+
+    size_t GetNumBricks() const;                        // Number of allocated bricks.
+
+  private:
+    /// \brief A single 8x8x8 block of voxels, stored with z varying fastest.
+    struct Brick
+    {
+        byte     voxels[TC_BRICK_VOXELS];   ///< The state of each voxel in the brick.
+        uint32_t key;                       ///< The brick position (see BrickKey).
+        unsigned short numLit;              ///< Number of voxels which are not off.
+    };
+
+    // Returns the hash table key of the brick at brick coordinates (bx, by, bz).
+    static uint32_t BrickKey(int bx, int by, int bz) { return (bx << 16) | (by << 8) | bz; }
+    // Returns the offset of voxel (x, y, z) within its brick.
+    static size_t BrickOffset(int x, int y, int z)
+    {
+        return (((x & TC_BRICK_MASK) << TC_BRICK_SHIFT | (y & TC_BRICK_MASK))
+                << TC_BRICK_SHIFT) | (z & TC_BRICK_MASK);
+    }
+    // Returns the first hash table slot to probe for the passed key.
+    size_t HashSlot(uint32_t key) const
+        { return (size_t)((key * 2654435761u) >> (32 - tableBits)); }
+
+    // Returns the slot holding the brick with the passed key, or the empty slot where it
+    // would be inserted.
+    size_t FindSlot(uint32_t key) const;
+    // Returns the brick with the passed key, or NULL if it is not allocated.
+    Brick *FindBrick(uint32_t key) const { return pTable[FindSlot(key)]; }
+    // Same as above, but allocates (and clears) the brick if it does not exist yet.
+    Brick *GetBrick(uint32_t key);
+    // Deletes the brick in the passed hash table slot, and closes the gap it leaves.
+    void RemoveBrick(size_t slot);
+    // Deletes every brick, and shrinks the hash table back to its initial size.
+    void FreeBricks();
+    // Allocates a new hash table with 2^bits slots, and moves the bricks into it (any
+    // bricks left with no lit voxels are deleted instead).
+    void ResizeTable(int bits);
+    // Sets a voxel without bounds checking or marking the cube as changed.
+    void SetRaw(int x, int y, int z, byte state);
+    // Sets or compares every voxel in a clipped (lo <= hi) box.
+    void FillRegion(const int lo[3], const int hi[3], byte state);
+    bool CompareRegion(const int lo[3], const int hi[3], byte cmpVal) const;
+    // Performs one of the AND/OR/XOR operators with a cube of any storage type.
+    void ApplyOperator(const TCCube &ref, char op);
+
+    Brick **pTable;         ///< Hash table of brick pointers (NULL for an empty slot).
+    size_t  numBricks;      ///< Number of bricks in the \ref pTable hash table.
+    int     tableBits;      ///< Log2 of the number of slots in \ref pTable.
+
+    /// \brief True if the unpacked voxel buffer (see \ref GetData) is up to date.
+    ///
+    /// Cleared whenever a voxel state is modified, so the buffer is only re-created
+    /// when it is requested after a change.
+    mutable bool dataValid;
+};
+
+
+#endif
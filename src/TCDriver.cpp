@@ -26,6 +26,7 @@
 
 #include "SDL.h"
 #include "TCDriver.h"
+#include "TCFrame.h"
 #include <string>
 
 
@@ -41,6 +42,7 @@
 ///
 TCDriver::TCDriver(Uint32 rate)
 {
+    driverFailed = false;
     if (!rate)
     {
         driverType = TC_DRIVER_TYPE_SYNCHRONOUS;
@@ -78,6 +80,29 @@ void TCDriver::Poll()
 }
 
 
+///
+/// \brief Send Frame
+///
+/// Called by the driver thread of a synchronous driver with each frame published by the
+/// animation thread, in the order they were published (see TCFrameQueue).  Drivers which
+/// do not override this method are polled instead.
+///
+/// \param frame The frame to send.  The driver takes over the caller's reference, and
+///              must release it once the frame was sent.
+///
+/// \remarks The global driver mutex is locked while this method is called for the loaded
+///          driver (see SetDriver).  Drivers owned by an animation slot (see TCSlotEngine)
+///          are called by the slot's worker thread without it, so this method may only
+///          use the driver's own state, and globals which are safe to read from any
+///          thread (e.g. GetLedOnColor).  Errors are reported with \ref HasFailed.
+///
+void TCDriver::SendFrame(TCFrame *frame)
+{
+    frame->Release();
+    Poll();
+}
+
+
 ///
 /// \brief Send Command
 ///
@@ -138,3 +163,18 @@ Uint8 TCDriver::GetDriverType()
 {
     return driverType;
 }
+
+
+///
+/// \brief Has Failed
+///
+/// Used to check if the driver stopped sending frames (e.g. if the remote device uses an
+/// unknown frame format).  The thread running the driver unloads it (or stops sending
+/// frames to it) once this returns true.
+///
+/// \returns True if the driver failed, false otherwise.
+///
+bool TCDriver::HasFailed()
+{
+    return driverFailed;
+}
@@ -35,6 +35,8 @@
 #define TC_DRIVER_TYPE_ASYNCHRONOUS 0x00
 #define TC_DRIVER_TYPE_SYNCHRONOUS  0x01
 
+class TCFrame;
+
 
 ///
 /// \brief Triclysm Driver Base Object
@@ -54,15 +56,18 @@ class TCDriver
     virtual ~TCDriver();                // Destructor.
 
     virtual void Poll();                // Driver poll method.
+    virtual void SendFrame(TCFrame *frame); // Sends a published frame (if synchronous).
     virtual int  SendCommand(const std::string &toSend);
 
     void   SetPollRate(Uint32 rate);    // Need to keep these as discrete
     Uint32 GetPollRate();               // functions because of threading.
     Uint8  GetDriverType();             // Gets the driver type.
+    bool   HasFailed();                 // True once the driver can not send any frames.
 
   protected:
     Uint8  driverType;  ///< Type of driver (see TC_DRIVER_TYPE_ defines).
     Uint32 driverRate;  ///< Poll rate for asynchronous drivers.
+    bool   driverFailed; ///< Set by the driver when it stops sending frames.
 };
 
 
@@ -0,0 +1,448 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *                         TCEffectChain Object  Source Code                           *
+ *                                      TRICLYSM                                       *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  This file contains the implementation of the TCEffectChain class as defined by the *
+ *  TCEffectChain.h header file.  This class holds the post-processing effects of an   *
+ *  animation (e.g. trails and blurs), which are applied to each frame it publishes.   *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  Copyright (C) 2011 Brandon Castellano, Ryan Mantha. All rights reserved.           *
+ *  Triclysm is provided under the BSD-2-Clause license. This program uses the SDL     *
+ *  (Simple DirectMedia Layer) library, and the Lua scripting language. See the        *
+ *  included LICENSE file or <http://www.triclysm.com/> for more details.              *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+///
+/// \file  TCEffectChain.cpp
+/// \brief This file contains the implementation of the TCEffectChain class as defined by
+///        the TCEffectChain.h header file.
+///
+
+#include "TCEffectChain.h"
+#include "TCThreadPool.h"   // Used to split each effect across several threads.
+#include "cube_kernels.h"   // Used for the effect kernels.
+#include <cassert>          // Used to validate the effect arguments.
+#include <cstring>          // Used for the memcpy and memset functions.
+#include <cmath>            // Used for the pow function.
+
+#define TC_EFFECT_BLOCK 256     ///< Bytes of each row summed at once by a blur.
+#define TC_EFFECT_GRAIN 16384   ///< Bytes processed by each chunk of a parallel effect.
+
+
+///
+/// \brief Blur Task
+///
+/// The data passed to the parallel parts of a blur (see BlurRows and BlurLines).  The
+/// buffer is seen as outer groups of n rows of inner bytes, where the rows are the
+/// positions on the blurred axis.
+///
+struct TCBlurTask
+{
+    const byte *pSrc;       ///< The buffer being blurred.
+    byte       *pDst;       ///< The buffer the blurred voxels are written to.
+    size_t      n,          ///< The number of voxels on the blurred axis.
+                inner,      ///< The number of bytes in each row.
+                blocks;     ///< The number of TC_EFFECT_BLOCK blocks in each row.
+    byte        voxelBytes; ///< The number of bytes in each voxel.
+    int         radius;     ///< The radius of the blur.
+};
+
+
+///
+/// \brief Kernel Task
+///
+/// The data passed to the parallel parts of the effects applied to each byte separately.
+///
+struct TCKernelTask
+{
+    byte       *pData;      ///< The buffer the effect is applied to.
+    byte       *pHistory;   ///< The last output of the buffer (for decays).
+    byte        type;       ///< The effect type (e.g. TC_EFFECT_SCALE).
+    uint16_t    value;      ///< The effect parameter, converted for the kernel.
+};
+
+
+///
+/// \brief Blur Rows
+///
+/// Blurs blocks of the rows of a buffer along an axis where each row is at least one
+/// voxel apart (the x and y axes).  A sum of the rows in the window is kept for each
+/// byte of the block, and updated by adding the row entering the window and removing
+/// the row leaving it.
+///
+/// \param pData A pointer to the TCBlurTask.
+/// \param first The first block (counted over every outer group).
+/// \param last  One past the last block.
+///
+static void BlurRows(void *pData, size_t first, size_t last)
+{
+    const TCBlurTask &task = *(const TCBlurTask *)pData;
+    uint16_t sum[TC_EFFECT_BLOCK];
+    int      n = (int)task.n, r = task.radius;
+    for (size_t item = first; item < last; item++)
+    {
+        size_t      block  = item % task.blocks,
+                    offset = (item / task.blocks) * task.n * task.inner
+                             + block * TC_EFFECT_BLOCK,
+                    len    = task.inner - block * TC_EFFECT_BLOCK;
+        if (len > TC_EFFECT_BLOCK) len = TC_EFFECT_BLOCK;
+        const byte *pSrc = task.pSrc + offset;
+        byte       *pDst = task.pDst + offset;
+        // The window of the first row holds the rows from 0 to the radius.
+        memset(sum, 0, len * sizeof(uint16_t));
+        for (int k = 0; k <= r && k < n; k++)
+        {
+            TC_Kernels::WindowAdd(sum, pSrc + k * task.inner, len);
+        }
+        for (int x = 0; x < n; x++)
+        {
+            int lo = (x - r < 0) ? 0 : x - r,
+                hi = (x + r >= n) ? n - 1 : x + r;
+            TC_Kernels::WindowAverage(pDst + x * task.inner, sum, (byte)(hi - lo + 1), len);
+            if (x + r + 1 < n) TC_Kernels::WindowAdd(sum, pSrc + (x + r + 1) * task.inner, len);
+            if (x - r >= 0)    TC_Kernels::WindowSub(sum, pSrc + (x - r) * task.inner, len);
+        }
+    }
+}
+
+
+///
+/// \brief Blur Lines
+///
+/// Blurs whole lines of a buffer along the z axis (where the voxels of a line are next
+/// to each other).  The line is added to its sum once for each offset in the window
+/// (shifted by that offset), and the sums are then averaged in runs of voxels which
+/// have the same number of voxels in their window.
+///
+/// \param pData A pointer to the TCBlurTask.
+/// \param first The first line.
+/// \param last  One past the last line.
+///
+static void BlurLines(void *pData, size_t first, size_t last)
+{
+    const TCBlurTask &task = *(const TCBlurTask *)pData;
+    uint16_t sum[255 * 4];
+    int      n = (int)task.n, r = task.radius, vb = task.voxelBytes;
+    for (size_t line = first; line < last; line++)
+    {
+        const byte *pSrc = task.pSrc + line * task.inner;
+        byte       *pDst = task.pDst + line * task.inner;
+        memset(sum, 0, task.inner * sizeof(uint16_t));
+        for (int k = -r; k <= r; k++)
+        {
+            // Voxel z gets the voxel at z + k, for each z where it is inside the line.
+            int lo = (k < 0) ? -k : 0,
+                hi = (k > 0) ? n - k : n;
+            if (hi > lo) TC_Kernels::WindowAdd(sum + lo * vb, pSrc + (lo + k) * vb,
+                                               (hi - lo) * vb);
+        }
+        int runStart = 0, runCount = 0;
+        for (int z = 0; z <= n; z++)
+        {
+            int count = 0;
+            if (z < n)
+            {
+                count = ((z + r >= n) ? n - 1 : z + r) - ((z - r < 0) ? 0 : z - r) + 1;
+            }
+            if (count != runCount)
+            {
+                if (z > runStart)
+                {
+                    TC_Kernels::WindowAverage(pDst + runStart * vb, sum + runStart * vb,
+                                              (byte)runCount, (z - runStart) * vb);
+                }
+                runStart = z;
+                runCount = count;
+            }
+        }
+    }
+}
+
+
+///
+/// \brief Apply Kernel
+///
+/// Applies an effect which works on each byte separately (a decay, scale, or threshold)
+/// to a range of the buffer.
+///
+/// \param pData A pointer to the TCKernelTask.
+/// \param first The first byte.
+/// \param last  One past the last byte.
+///
+static void ApplyKernel(void *pData, size_t first, size_t last)
+{
+    const TCKernelTask &task = *(const TCKernelTask *)pData;
+    byte  *pDst  = task.pData + first;
+    size_t count = last - first;
+    switch (task.type)
+    {
+        case TC_EFFECT_DECAY:
+            // The output is the brighter of each voxel and its decayed last output, and
+            // becomes the last output for the next frame.
+            TC_Kernels::BlendMax(pDst, task.pHistory + first, (byte)task.value, count);
+            memcpy(task.pHistory + first, pDst, count);
+            break;
+        case TC_EFFECT_SCALE:
+            TC_Kernels::Scale(pDst, task.value, count);
+            break;
+        case TC_EFFECT_THRESHOLD:
+            TC_Kernels::Threshold(pDst, (byte)task.value, count);
+            break;
+    }
+}
+
+
+///
+/// \brief Effect Chain Constructor
+///
+/// Creates a chain without any effects (so frames are published unchanged).
+///
+TCEffectChain::TCEffectChain()
+{
+}
+
+
+///
+/// \brief Add Effect
+///
+/// Adds an effect to the end of the chain.
+///
+/// \param type  The type of the effect (e.g. TC_EFFECT_GAUSSIAN).
+/// \param param The parameter of the effect (see \ref TCEffectChain for the range of each
+///              effect type).
+///
+/// \returns The index of the new effect.
+///
+size_t TCEffectChain::AddEffect(byte type, float param)
+{
+    assert(type < TC_NUM_EFFECTS);
+    Effect newEffect;
+    newEffect.type  = type;
+    newEffect.param = param;
+    for (byte i = 0; i < 3; i++)
+    {
+        newEffect.lastTick[i] = 0;
+    }
+    effects.push_back(newEffect);
+    return effects.size() - 1;
+}
+
+
+///
+/// \brief Remove Effect
+///
+/// Removes an effect from the chain.  The effects after it move up by one.
+///
+/// \param index The index of the effect to remove.
+///
+void TCEffectChain::RemoveEffect(size_t index)
+{
+    assert(index < effects.size());
+    effects.erase(effects.begin() + index);
+}
+
+
+///
+/// \brief Clear Effects
+///
+/// Removes every effect from the chain (and the last output kept for decays).
+///
+void TCEffectChain::ClearEffects()
+{
+    effects.clear();
+}
+
+
+///
+/// \brief Get Number of Effects
+///
+/// \returns The number of effects in the chain.
+///
+size_t TCEffectChain::GetNumEffects()
+{
+    return effects.size();
+}
+
+
+///
+/// \brief Get Effect Type
+///
+/// \param index The index of the effect.
+///
+/// \returns The type of the effect (e.g. TC_EFFECT_DECAY).
+///
+byte TCEffectChain::GetEffectType(size_t index)
+{
+    assert(index < effects.size());
+    return effects[index].type;
+}
+
+
+///
+/// \brief Get Effect Parameter
+///
+/// \param index The index of the effect.
+///
+/// \returns The parameter of the effect (see \ref TCEffectChain).
+///
+float TCEffectChain::GetEffectParam(size_t index)
+{
+    assert(index < effects.size());
+    return effects[index].param;
+}
+
+
+///
+/// \brief Get Effect Name
+///
+/// \param type The effect type (e.g. TC_EFFECT_SCALE).
+///
+/// \returns The name of the effect type (as used by the effect console command).
+///
+const char *TCEffectChain::GetEffectName(byte type)
+{
+    switch (type)
+    {
+        case TC_EFFECT_DECAY:     return "decay";
+        case TC_EFFECT_BLUR:      return "blur";
+        case TC_EFFECT_GAUSSIAN:  return "gaussian";
+        case TC_EFFECT_SCALE:     return "scale";
+        case TC_EFFECT_THRESHOLD: return "threshold";
+    }
+    return "unknown";
+}
+
+
+///
+/// \brief Apply
+///
+/// Applies every effect in the chain, in order, to one voxel buffer of a frame.
+///
+/// \param pData      The voxel buffer, in the same layout as the buffer returned by
+///                   TCCube::GetData (with voxelBytes bytes for each voxel).
+/// \param sc         The number of voxels in each dimension.
+/// \param voxelBytes The number of bytes in each voxel (1, or 4 for interleaved colors).
+/// \param buffer     The index of the buffer in the frame (e.g. TC_COLOR_G), which
+///                   selects the last output used by decays.
+/// \param tick       The tick count of the animation the frame was captured from (see
+///                   TCAnim::GetTicks), so decays fade by the ticks since their last
+///                   output, instead of once for each frame.
+///
+void TCEffectChain::Apply(byte *pData, const byte sc[3], byte voxelBytes, byte buffer,
+                          unsigned int tick)
+{
+    assert(buffer < 3 && (voxelBytes == 1 || voxelBytes == 4));
+    size_t numBytes = (size_t)sc[0] * sc[1] * sc[2] * voxelBytes;
+    for (size_t i = 0; i < effects.size(); i++)
+    {
+        TCKernelTask task;
+        task.pData    = pData;
+        task.pHistory = NULL;
+        task.type     = effects[i].type;
+        float param   = effects[i].param;
+        switch (task.type)
+        {
+            case TC_EFFECT_DECAY:
+            {
+                std::vector<byte> &history = effects[i].history[buffer];
+                unsigned int       steps   = tick - effects[i].lastTick[buffer];
+                effects[i].lastTick[buffer] = tick;
+                if (history.size() != numBytes)
+                {
+                    // The first frame (or a frame of a different size) has no trail yet.
+                    history.assign(pData, pData + numBytes);
+                    continue;
+                }
+                // The last output fades once for each tick since it was stored (frames
+                // published again in the same tick keep it as it is).
+                float kept    = (param <= 0.0f) ? 0.0f : (param >= 1.0f) ? 1.0f :
+                                (float)pow((double)param, (double)steps);
+                task.pHistory = &history[0];
+                task.value    = (uint16_t)(kept * 255.0f + 0.5f);
+                break;
+            }
+            case TC_EFFECT_BLUR:
+            case TC_EFFECT_GAUSSIAN:
+            {
+                int radius = (int)(param + 0.5f);
+                if (radius > TC_EFFECT_MAX_RADIUS) radius = TC_EFFECT_MAX_RADIUS;
+                if (radius >= 1)
+                {
+                    Blur(pData, sc, voxelBytes, radius,
+                         (task.type == TC_EFFECT_GAUSSIAN) ? 3 : 1);
+                }
+                continue;
+            }
+            case TC_EFFECT_SCALE:
+                task.value = (param <= 0.0f)   ? 0x0000 :
+                             (param >= 127.0f) ? 0x7F00 : (uint16_t)(param * 256.0f + 0.5f);
+                break;
+            case TC_EFFECT_THRESHOLD:
+                task.value = (param <= 0.0f)   ? 0x00 :
+                             (param >= 255.0f) ? 0xFF : (uint16_t)(param + 0.5f);
+                break;
+        }
+        TCThreadPool::GetShared()->Run(ApplyKernel, &task, numBytes, TC_EFFECT_GRAIN);
+    }
+}
+
+
+///
+/// \brief Blur
+///
+/// Blurs a voxel buffer along the x, y, and z axes in turn, each time from the buffer to
+/// the scratch buffer and back (so each pass only reads voxels it does not write).  The
+/// rows of each x-slice (or the blocks of each row, for the x axis) are split across
+/// the shared thread pool.
+///
+/// \param pData      The voxel buffer.
+/// \param sc         The number of voxels in each dimension.
+/// \param voxelBytes The number of bytes in each voxel.
+/// \param radius     The radius of the blur (from 1 to TC_EFFECT_MAX_RADIUS).
+/// \param passes     The number of times the whole buffer is blurred.
+///
+void TCEffectChain::Blur(byte *pData, const byte sc[3], byte voxelBytes, int radius,
+                         int passes)
+{
+    size_t numBytes = (size_t)sc[0] * sc[1] * sc[2] * voxelBytes;
+    scratch.resize(numBytes);
+    TCThreadPool *pool = TCThreadPool::GetShared();
+    for (int pass = 0; pass < passes; pass++)
+    {
+        for (byte axis = TC_X_AXIS; axis <= TC_Z_AXIS; axis++)
+        {
+            if (sc[axis] < 2) continue;     // Blurring a single voxel leaves it unchanged.
+            TCBlurTask task;
+            task.pSrc       = pData;
+            task.pDst       = &scratch[0];
+            task.n          = sc[axis];
+            task.voxelBytes = voxelBytes;
+            task.radius     = radius;
+            task.inner      = voxelBytes;
+            for (byte a = axis + 1; a <= TC_Z_AXIS; a++)
+            {
+                task.inner *= sc[a];
+            }
+            size_t outer = numBytes / (task.n * task.inner),
+                   grain = TC_EFFECT_GRAIN / (task.n * (task.inner < TC_EFFECT_BLOCK ?
+                                                        task.inner : TC_EFFECT_BLOCK)) + 1;
+            if (axis == TC_Z_AXIS)
+            {
+                task.inner = task.n * voxelBytes;
+                pool->Run(BlurLines, &task, outer, grain);
+            }
+            else
+            {
+                task.blocks = (task.inner + TC_EFFECT_BLOCK - 1) / TC_EFFECT_BLOCK;
+                pool->Run(BlurRows, &task, outer * task.blocks, grain);
+            }
+            memcpy(pData, &scratch[0], numBytes);
+        }
+    }
+}
@@ -0,0 +1,108 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *                         TCEffectChain Object  Header File                           *
+ *                                      TRICLYSM                                       *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  This file contains the definition of the TCEffectChain class as implemented by the *
+ *  TCEffectChain.cpp source file.  This class holds the post-processing effects of an *
+ *  animation (e.g. trails and blurs), which are applied to each frame it publishes.   *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  Copyright (C) 2011 Brandon Castellano, Ryan Mantha. All rights reserved.           *
+ *  Triclysm is provided under the BSD-2-Clause license. This program uses the SDL     *
+ *  (Simple DirectMedia Layer) library, and the Lua scripting language. See the        *
+ *  included LICENSE file or <http://www.triclysm.com/> for more details.              *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+///
+/// \file  TCEffectChain.h
+/// \brief This file contains the definition of the TCEffectChain class as implemented by
+///        the TCEffectChain.cpp source file.
+///
+
+#pragma once
+#ifndef TC_EFFECT_CHAIN_
+#define TC_EFFECT_CHAIN_
+
+#include "TCCube.h"
+#include <vector>               // Used to hold the effects and their buffers.
+#include <stdint.h>             // Used for the uint16_t type.
+
+// Effect Type Definitions
+#define TC_EFFECT_DECAY     0   ///< Voxels fade out over several ticks (trails).
+#define TC_EFFECT_BLUR      1   ///< Box blur (the average of a cube of voxels).
+#define TC_EFFECT_GAUSSIAN  2   ///< Three box blurs (close to a gaussian blur).
+#define TC_EFFECT_SCALE     3   ///< Scales the brightness of every voxel.
+#define TC_EFFECT_THRESHOLD 4   ///< Turns off the voxels below a brightness.
+#define TC_NUM_EFFECTS      5   ///< Number of effect types.
+
+#define TC_EFFECT_MAX_RADIUS 7  ///< Largest blur radius (in voxels).
+
+
+///
+/// \brief Triclysm Effect Chain Object
+///
+/// This class holds a list of effects, which are applied in order to the voxels of each
+/// frame published from an animation (see PublishFrame), without modifying the animation
+/// itself.  The parameter of each effect depends on its type:
+///
+///   - TC_EFFECT_DECAY:     The fraction of the last output kept each tick (0.0 to 1.0).
+///                          Each voxel is the brighter of itself and the decayed output.
+///                          Each decay keeps its own last output, which is decayed once
+///                          for every tick since it was stored (so a frame published
+///                          twice in one tick, or after several ticks, fades the same).
+///   - TC_EFFECT_BLUR:      The radius of the blur (1 to TC_EFFECT_MAX_RADIUS), where each
+///                          voxel becomes the average of the voxels within the radius on
+///                          every axis (only counting the voxels inside the cube).
+///   - TC_EFFECT_GAUSSIAN:  The radius of each of the three box blurs.
+///   - TC_EFFECT_SCALE:     The brightness scale (0.0 to 127.0, clamped to full brightness).
+///   - TC_EFFECT_THRESHOLD: The lowest brightness (0 to 255) which is left on.
+///
+/// \remarks Each effect works on every byte of the voxel buffers with the effect kernels
+///          (see TC_Kernels::WindowAdd), split across the shared TCThreadPool.  Blurs are
+///          separable, and run one axis at a time with a sliding window.
+///
+/// \see TCAnim::GetEffects | TCFrame
+///
+class TCEffectChain
+{
+  public:
+    TCEffectChain();
+
+    // Effect list functions (each effect is identified by its index, in the order applied):
+    size_t AddEffect(byte type, float param);
+    void   RemoveEffect(size_t index);
+    void   ClearEffects();
+    size_t GetNumEffects();
+    byte   GetEffectType(size_t index);
+    float  GetEffectParam(size_t index);
+
+    static const char *GetEffectName(byte type);   // e.g. "decay" for TC_EFFECT_DECAY.
+
+    // Applies every effect to one voxel buffer of a frame:
+    void Apply(byte *pData, const byte sc[3], byte voxelBytes, byte buffer,
+               unsigned int tick);
+
+  private:
+    /// \brief A single effect in the chain.
+    struct Effect
+    {
+        byte  type;         ///< The effect type (e.g. TC_EFFECT_BLUR).
+        float param;        ///< The effect parameter (see above).
+        std::vector<byte> history[3];   ///< The last output of each buffer (for decays).
+        unsigned int      lastTick[3];  ///< The animation tick of each history buffer.
+    };
+
+    // Blurs every axis of the buffer passes times (see TC_EFFECT_BLUR).
+    void Blur(byte *pData, const byte sc[3], byte voxelBytes, int radius, int passes);
+
+    std::vector<Effect> effects;        ///< The effects, in the order they are applied.
+    std::vector<byte>   scratch;        ///< The output of each blur pass.
+};
+
+
+#endif
@@ -0,0 +1,475 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *                            TCFrame Object  Source Code                              *
+ *                                      TRICLYSM                                       *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  This file contains the implementation of the TCFrame class as defined by the       *
+ *  TCFrame.h header file.  This class holds an immutable, reference counted copy of   *
+ *  an animation's state, which can be read without locking the animation mutex.       *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  Copyright (C) 2011 Brandon Castellano, Ryan Mantha. All rights reserved.           *
+ *  Triclysm is provided under the BSD-2-Clause license. This program uses the SDL     *
+ *  (Simple DirectMedia Layer) library, and the Lua scripting language. See the        *
+ *  included LICENSE file or <http://www.triclysm.com/> for more details.              *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+///
+/// \file  TCFrame.cpp
+/// \brief This file contains the implementation of the TCFrame class as defined by the
+///        TCFrame.h header file.
+///
+
+#include "TCFrame.h"
+#include "cube_kernels.h"   // Used to crossfade the voxels of two frames.
+#include "TCEffectChain.h"  // Used to apply the effects of an animation to a frame.
+#include <cassert>      // Used to validate the color arguments.
+#include <cstdlib>      // Used for pointer NULL define value.
+#include <cstring>      // Used for the memcpy function.
+
+
+///
+/// \brief Frame Constructor
+///
+/// Captures the current state of each color of the passed animation, with a reference
+/// count of 1.  The caller must hold the animation mutex while the frame is created.
+///
+/// \param anim      The animation to capture the state of.
+/// \param frameTime The time the state was captured (see \ref GetTime).
+///
+/// \remarks Each color is copied with TCCube::Clone, and the linear voxel buffer of each
+///          copy is requested right away, so reading the frame never modifies it.  If
+///          the colors are stored in one interleaved buffer (see TCAnim::GetColorCube),
+///          the frame holds a reference to that buffer instead.  If the animation is in
+///          the palette mode (see TCAnim::SetPaletteMode), the frame has 3 colors, and
+///          holds a copy of the palette along with the voxel indices.
+///
+TCFrame::TCFrame(TCAnim &anim, uint32_t frameTime)
+{
+    numColors = anim.GetNumColors();
+    byte numCubes = (numColors == 0) ? 1 : numColors;
+    TCCubeChannel *colorCube = anim.GetColorCube();
+    pColorAlloc = (colorCube != NULL) ? colorCube->RetainColors() : NULL;
+    pColors     = (colorCube != NULL) ? colorCube->GetColors()    : NULL;
+    pPalette    = NULL;
+    if (anim.GetPalette() != NULL)
+    {
+        pPalette = new uint32_t[TC_PALETTE_SIZE];
+        memcpy(pPalette, anim.GetPalette(), TC_PALETTE_SIZE * sizeof(uint32_t));
+        numColors = 3;
+    }
+    for (byte i = 0; i < 3; i++)
+    {
+        if (colorCube == NULL && i < numCubes)
+        {
+            cubeState[i] = anim.cubeState[i]->Clone();
+            pData[i]     = cubeState[i]->GetData();
+        }
+        else
+        {
+            cubeState[i] = NULL;
+            pData[i]     = NULL;
+        }
+    }
+    for (byte axis = TC_X_AXIS; axis <= TC_Z_AXIS; axis++)
+    {
+        sc[axis]     = anim.cubeState[0]->GetSize(axis);
+        stride[axis] = anim.cubeState[0]->GetStride(axis);
+    }
+    generation = anim.GetGeneration();
+    time       = frameTime;
+    refCount   = 1;
+}
+
+
+///
+/// \brief Crossfade Constructor
+///
+/// Creates a frame part of the way between two frames of the same size and number of
+/// colors, with a reference count of 1.  Each color of each voxel is blended with the
+/// TC_Kernels::BlendAlpha kernel, over the whole voxel buffer at once.
+///
+/// \param from      The frame at a weight of 0.
+/// \param to        The frame at a weight of 0xFF.
+/// \param weight    How far the new frame is from the first frame to the second.
+/// \param frameTime The time of the new frame (see \ref GetTime).
+///
+/// \remarks Animations without any colors cannot be blended.  The new frame stores its
+///          colors the same way as both frames, or in one interleaved buffer if they
+///          store them differently (e.g. in the palette mode, see \ref GetPalette).
+///
+TCFrame::TCFrame(const TCFrame &from, const TCFrame &to, byte weight, uint32_t frameTime)
+{
+    assert(from.numColors == to.numColors && to.numColors != 0);
+    for (byte axis = TC_X_AXIS; axis <= TC_Z_AXIS; axis++)
+    {
+        assert(from.sc[axis] == to.sc[axis]);
+        sc[axis]     = to.sc[axis];
+        stride[axis] = to.stride[axis];
+    }
+    size_t numVoxels = sc[TC_X_AXIS] * stride[TC_X_AXIS];
+    numColors   = to.numColors;
+    pColorAlloc = NULL;
+    pColors     = NULL;
+    pPalette    = NULL;
+    for (byte i = 0; i < 3; i++)
+    {
+        cubeState[i] = NULL;
+        pData[i]     = NULL;
+    }
+    if (   from.pColors == NULL && from.pPalette == NULL
+        && to.pColors   == NULL && to.pPalette   == NULL )
+    {
+        // Both frames have a voxel buffer for each color, so each color is blended into
+        // a new TCCube of its own.
+        for (byte i = 0; i < numColors; i++)
+        {
+            cubeState[i] = new TCCube(sc);
+            byte *pDst   = cubeState[i]->GetData();
+            memcpy(pDst, from.pData[i], numVoxels);
+            TC_Kernels::BlendAlpha(pDst, to.pData[i], weight, numVoxels);
+            pData[i] = pDst;
+        }
+    }
+    else
+    {
+        // Otherwise, both frames are blended as interleaved colors (the unused byte of
+        // each color stays zero).
+        TCCubeChannel colorCube(sc);
+        uint32_t     *pDst = colorCube.WriteColors();
+        from.CopyColors(pDst);
+        if (to.pColors != NULL)
+        {
+            TC_Kernels::BlendAlpha((byte *)pDst, (const byte *)to.pColors, weight,
+                                   numVoxels * sizeof(uint32_t));
+        }
+        else
+        {
+            uint32_t *pTo = new uint32_t[numVoxels];
+            to.CopyColors(pTo);
+            TC_Kernels::BlendAlpha((byte *)pDst, (const byte *)pTo, weight,
+                                   numVoxels * sizeof(uint32_t));
+            delete[] pTo;
+        }
+        // The frame keeps its own reference to the buffer after colorCube is deleted.
+        pColorAlloc = colorCube.RetainColors();
+        pColors     = colorCube.GetColors();
+    }
+    generation = TCCube::NewGeneration();
+    time       = frameTime;
+    refCount   = 1;
+}
+
+
+///
+/// \brief Effect Constructor
+///
+/// Creates a copy of a frame with every effect of an effect chain applied to it, with a
+/// reference count of 1.  The effects are applied to each voxel buffer of the copy.
+///
+/// \param source  The frame to apply the effects to.
+/// \param effects The effect chain of the animation the frame was captured from.
+/// \param tick    The tick count of the animation (see TCEffectChain::Apply).
+///
+/// \remarks The new frame has the same time as the source frame, but a new generation.
+///          Frames without any colors become frames with 1 color (where lit voxels are
+///          at full brightness), so the effects can fade them.  Frames which store their
+///          colors in one interleaved buffer (or in the palette mode) have the effects
+///          applied to an interleaved buffer.
+///
+TCFrame::TCFrame(const TCFrame &source, TCEffectChain &effects, unsigned int tick)
+{
+    for (byte axis = TC_X_AXIS; axis <= TC_Z_AXIS; axis++)
+    {
+        sc[axis]     = source.sc[axis];
+        stride[axis] = source.stride[axis];
+    }
+    size_t numVoxels = sc[TC_X_AXIS] * stride[TC_X_AXIS];
+    numColors   = (source.numColors == 0) ? 1 : source.numColors;
+    pColorAlloc = NULL;
+    pColors     = NULL;
+    pPalette    = NULL;
+    for (byte i = 0; i < 3; i++)
+    {
+        cubeState[i] = NULL;
+        pData[i]     = NULL;
+    }
+    if (source.pColors == NULL && source.pPalette == NULL)
+    {
+        // Each color has a voxel buffer of its own, so each is copied into a new TCCube.
+        for (byte i = 0; i < numColors; i++)
+        {
+            cubeState[i] = new TCCube(sc);
+            byte *pDst   = cubeState[i]->GetData();
+            if (source.numColors == 0)
+            {
+                for (size_t v = 0; v < numVoxels; v++)
+                {
+                    pDst[v] = (source.pData[0][v] != 0x00) ? 0xFF : 0x00;
+                }
+            }
+            else
+            {
+                memcpy(pDst, source.pData[i], numVoxels);
+            }
+            effects.Apply(pDst, sc, 1, i, tick);
+            pData[i] = pDst;
+        }
+    }
+    else
+    {
+        // Otherwise, the effects are applied to the interleaved colors (the unused byte
+        // of each color stays zero).
+        TCCubeChannel colorCube(sc);
+        uint32_t     *pDst = colorCube.WriteColors();
+        source.CopyColors(pDst);
+        effects.Apply((byte *)pDst, sc, sizeof(uint32_t), 0, tick);
+        pColorAlloc = colorCube.RetainColors();
+        pColors     = colorCube.GetColors();
+    }
+    generation = TCCube::NewGeneration();
+    time       = source.time;
+    refCount   = 1;
+}
+
+
+///
+/// \brief Destructor
+///
+/// Deletes the copy of each color (releasing the voxel buffers they share), or releases
+/// the reference to the interleaved color buffer.
+///
+TCFrame::~TCFrame()
+{
+    for (byte i = 0; i < 3; i++)
+    {
+        delete cubeState[i];
+    }
+    TCCubeChannel::ReleaseColors(pColorAlloc);
+    delete[] pPalette;
+}
+
+
+///
+/// \brief Retain
+///
+/// Takes another reference to the frame, which must be released with \ref Release.
+///
+void TCFrame::Retain()
+{
+    __atomic_add_fetch(&refCount, 1, __ATOMIC_RELAXED);
+}
+
+
+///
+/// \brief Release
+///
+/// Releases a reference to the frame.  When the last reference is released, the frame
+/// is deleted, so the frame must not be used by the caller after calling this method.
+///
+void TCFrame::Release()
+{
+    if (__atomic_sub_fetch(&refCount, 1, __ATOMIC_ACQ_REL) == 0)
+    {
+        delete this;
+    }
+}
+
+
+///
+/// \brief Get Number of Colors
+///
+/// \returns The number of colors in the captured animation (0, 1, or 3).  Animations in
+///          the palette mode have 3 colors (see \ref GetPalette).
+///
+byte TCFrame::GetNumColors() const
+{
+    return numColors;
+}
+
+
+///
+/// \brief Get Size
+///
+/// \param axis The axis to get the size of (TC_X_AXIS, TC_Y_AXIS, or TC_Z_AXIS).
+///
+/// \returns The number of voxels on the passed axis.
+///
+byte TCFrame::GetSize(byte axis) const
+{
+    return sc[axis];
+}
+
+
+///
+/// \brief Get Stride
+///
+/// \param axis The axis to get the stride of (TC_X_AXIS, TC_Y_AXIS, or TC_Z_AXIS).
+///
+/// \returns The number of voxels between two neighbours on the passed axis in the buffer
+///          returned by \ref GetData.
+///
+size_t TCFrame::GetStride(byte axis) const
+{
+    return stride[axis];
+}
+
+
+///
+/// \brief Get Generation
+///
+/// \returns The generation of the animation's state when the frame was captured (see
+///          TCAnim::GetGeneration).  Two frames with the same generation hold the same
+///          voxels.
+///
+uint64_t TCFrame::GetGeneration() const
+{
+    return generation;
+}
+
+
+///
+/// \brief Get Time
+///
+/// \returns The time the frame was captured, in milliseconds (e.g. from SDL_GetTicks), or
+///          0 if the time was not passed to the constructor.
+///
+uint32_t TCFrame::GetTime() const
+{
+    return time;
+}
+
+
+///
+/// \brief Get Voxel Data
+///
+/// \param color The color to get the voxels of (0 for animations with 0 or 1 colors, or
+///              TC_COLOR_R, TC_COLOR_G, or TC_COLOR_B).
+///
+/// \returns A pointer to the first voxel of the color, in the same layout as the buffer
+///          returned by TCCube::GetData.
+///
+/// \remarks This can only be used if \ref GetColorData and \ref GetPalette return NULL
+///          (otherwise the colors are only available interleaved, or through the palette).
+///
+const byte *TCFrame::GetData(byte color) const
+{
+    assert(pData[color] != NULL && pPalette == NULL);
+    return pData[color];
+}
+
+
+///
+/// \brief Get Color Data
+///
+/// \returns A pointer to the 32-bit color (0xRRGGBB) of the first voxel, in the same
+///          layout as the buffer returned by TCCube::GetData, or NULL if the colors of
+///          the animation were not stored in one interleaved buffer (see GetData).
+///
+const uint32_t *TCFrame::GetColorData() const
+{
+    return pColors;
+}
+
+
+///
+/// \brief Get Palette
+///
+/// \returns A pointer to the 24-bit color of each of the TC_PALETTE_SIZE palette indices,
+///          or NULL if the animation was not in the palette mode (see
+///          TCAnim::SetPaletteMode).  The color of each voxel is the palette color of
+///          its index (see \ref GetIndexData).
+///
+const uint32_t *TCFrame::GetPalette() const
+{
+    return pPalette;
+}
+
+
+///
+/// \brief Get Index Data
+///
+/// \returns A pointer to the palette index of the first voxel, in the same layout as the
+///          buffer returned by TCCube::GetData.
+///
+/// \remarks This can only be used if \ref GetPalette does not return NULL.
+///
+const byte *TCFrame::GetIndexData() const
+{
+    assert(pPalette != NULL);
+    return pData[0];
+}
+
+
+///
+/// \brief Get Voxel Color
+///
+/// Gets the color of a voxel in the same format as TCAnim::GetVoxelColor.
+///
+/// \param x The x-coordinate of the voxel.
+/// \param y The y-coordinate of the voxel.
+/// \param z The z-coordinate of the voxel.
+///
+/// \returns 0x00 or 0x01 if numColors is 0, otherwise the 24-bit RGB color value.
+///
+ulint TCFrame::GetVoxelColor(byte x, byte y, byte z) const
+{
+    byte   voxelValue;
+    size_t voxelIndex;
+    switch (numColors)
+    {
+        case 0:
+            return (GetVoxelState(0, x, y, z) == 0x00) ? 0x00 : 0x01;
+        case 1:
+            voxelValue = GetVoxelState(0, x, y, z);
+            return voxelValue | (voxelValue << 8) | (voxelValue << 16);
+        case 3:
+            voxelIndex = x * stride[0] + y * stride[1] + z;
+            if (pColors  != NULL) return pColors[voxelIndex];
+            if (pPalette != NULL) return pPalette[pData[0][voxelIndex]];
+            return   ((ulint)GetVoxelState(TC_COLOR_R, x, y, z) << 16)
+                   | ((ulint)GetVoxelState(TC_COLOR_G, x, y, z) <<  8)
+                   |  (ulint)GetVoxelState(TC_COLOR_B, x, y, z);
+        default:
+            return 0;
+    }
+}
+
+
+///
+/// \brief Copy Colors
+///
+/// Writes the color of each voxel in the same format as the buffer returned by
+/// \ref GetColorData (for frames with 3 colors, or in the palette mode).
+///
+/// \param pDst The buffer to write the colors to (one 32-bit color per voxel).
+///
+void TCFrame::CopyColors(uint32_t *pDst) const
+{
+    assert(numColors == 3);
+    size_t numVoxels = sc[TC_X_AXIS] * stride[TC_X_AXIS];
+    if (pColors != NULL)
+    {
+        memcpy(pDst, pColors, numVoxels * sizeof(uint32_t));
+    }
+    else if (pPalette != NULL)
+    {
+        for (size_t i = 0; i < numVoxels; i++)
+        {
+            pDst[i] = pPalette[pData[0][i]];
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < numVoxels; i++)
+        {
+            pDst[i] =   ((uint32_t)pData[TC_COLOR_R][i] << 16)
+                      | ((uint32_t)pData[TC_COLOR_G][i] <<  8)
+                      |  (uint32_t)pData[TC_COLOR_B][i];
+        }
+    }
+}
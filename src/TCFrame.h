@@ -0,0 +1,105 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *                            TCFrame Object  Header File                              *
+ *                                      TRICLYSM                                       *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  This file contains the definition of the TCFrame class as implemented by the       *
+ *  TCFrame.cpp source file.  This class holds an immutable, reference counted copy    *
+ *  of an animation's state, which can be read without locking the animation mutex.    *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  Copyright (C) 2011 Brandon Castellano, Ryan Mantha. All rights reserved.           *
+ *  Triclysm is provided under the BSD-2-Clause license. This program uses the SDL     *
+ *  (Simple DirectMedia Layer) library, and the Lua scripting language. See the        *
+ *  included LICENSE file or <http://www.triclysm.com/> for more details.              *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+///
+/// \file  TCFrame.h
+/// \brief This file contains the definition of the TCFrame class as implemented by the
+///        TCFrame.cpp source file.
+///
+
+#pragma once
+#ifndef TC_FRAME_
+#define TC_FRAME_
+
+#include "TCAnim.h"
+#include "TCCubeChannel.h"
+
+class TCEffectChain;
+
+
+///
+/// \brief Triclysm Frame Object
+///
+/// This class holds a snapshot of the state of every color of an animation at the time
+/// it was created.  Since TCCube copies share their voxel buffer until one of them is
+/// modified, creating a frame only copies the voxels of a color if the animation changes
+/// it while the frame still exists.
+///
+/// \remarks Frames are reference counted, and are deleted when the last reference is
+///          released.  A frame is never modified after it is created, so any number of
+///          threads can read the same frame at once.
+///
+/// \see PublishFrame | AcquireFrame
+///
+class TCFrame
+{
+  public:
+    TCFrame(TCAnim &anim, uint32_t frameTime = 0);  // Captures the animation's state.
+    TCFrame(const TCFrame &from, const TCFrame &to, // Crossfade between two frames.
+            byte weight, uint32_t frameTime);
+    TCFrame(const TCFrame &source,                  // Applies an animation's effects.
+            TCEffectChain &effects, unsigned int tick);
+
+    void Retain();                  // Takes another reference to the frame.
+    void Release();                 // Releases a reference (deleting the frame if last).
+
+    byte        GetNumColors() const;       // Number of colors in the animation.
+    byte        GetSize(byte axis) const;   // Number of voxels on an axis.
+    size_t      GetStride(byte axis) const; // Distance between voxels on an axis.
+    uint64_t    GetGeneration() const;      // Generation of the animation's state.
+    uint32_t    GetTime() const;            // Time the frame was captured (in ms).
+    const byte *GetData(byte color) const;  // Voxel buffer of one color (linear order).
+    const uint32_t *GetColorData() const;   // Interleaved colors (NULL if not captured).
+    const uint32_t *GetPalette() const;     // Palette colors (NULL if not captured).
+    const byte *GetIndexData() const;       // Palette index of each voxel (linear order).
+
+    // Voxel access (without any bounds checking):
+    byte  GetVoxelState(byte color, byte x, byte y, byte z) const
+    {
+        size_t i = x * stride[0] + y * stride[1] + z;
+        if (pColors  != NULL) return ((const byte *)(pColors + i))[TC_CHANNEL_BYTE(color)];
+        if (pPalette != NULL) return ((const byte *)(pPalette + pData[0][i]))
+                                         [TC_CHANNEL_BYTE(color)];
+        return pData[color][i];
+    }
+    ulint GetVoxelColor(byte x, byte y, byte z) const;
+
+  private:
+    ~TCFrame();                     // Only called by Release.
+    TCFrame(const TCFrame &);       // Not implemented (frames are shared by reference).
+
+    // Writes the color of each voxel, in the same format as GetColorData.
+    void CopyColors(uint32_t *pDst) const;
+
+    TCCube     *cubeState[3];       ///< Copies of each color's TCCube (see TCCube::Clone).
+    const byte *pData[3];           ///< The linear voxel buffer of each copied TCCube.
+    byte       *pColorAlloc;        ///< Reference to the interleaved color buffer (or NULL).
+    const uint32_t *pColors;        ///< The interleaved color of each voxel (or NULL).
+    uint32_t   *pPalette;           ///< Copy of the animation's palette (or NULL).
+    byte        numColors,          ///< Number of colors in the animation.
+                sc[3];              ///< Number of voxels in each dimension.
+    size_t      stride[3];          ///< Distance between adjacent voxels on each axis.
+    uint64_t    generation;         ///< Generation of the animation when captured.
+    uint32_t    time;               ///< Time the frame was captured (see GetTime).
+    int         refCount;           ///< Number of references held to this frame.
+};
+
+
+#endif
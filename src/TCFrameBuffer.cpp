@@ -0,0 +1,122 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *                         TCFrameBuffer Object  Source Code                           *
+ *                                      TRICLYSM                                       *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  This file contains the implementation of the TCFrameBuffer class as defined by     *
+ *  the TCFrameBuffer.h header file.  This class is a triple buffer, which passes the  *
+ *  frames published by the animation thread to one reader without any locking.       *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  Copyright (C) 2011 Brandon Castellano, Ryan Mantha. All rights reserved.           *
+ *  Triclysm is provided under the BSD-2-Clause license. This program uses the SDL     *
+ *  (Simple DirectMedia Layer) library, and the Lua scripting language. See the        *
+ *  included LICENSE file or <http://www.triclysm.com/> for more details.              *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+///
+/// \file  TCFrameBuffer.cpp
+/// \brief This file contains the implementation of the TCFrameBuffer class as defined by
+///        the TCFrameBuffer.h header file.
+///
+
+#include "TCFrameBuffer.h"
+#include <cstdlib>      // Used for pointer NULL define value.
+
+
+///
+/// \brief Frame Buffer Constructor
+///
+/// Creates a triple buffer without any frames, so \ref Acquire returns NULL until the
+/// first frame is published.
+///
+TCFrameBuffer::TCFrameBuffer()
+{
+    slots[0] = slots[1] = slots[2] = NULL;
+    back   = 0;
+    middle = 1;
+    front  = 2;
+}
+
+
+///
+/// \brief Destructor
+///
+/// Releases the frames still held by the buffer (see \ref Clear).
+///
+TCFrameBuffer::~TCFrameBuffer()
+{
+    Clear();
+}
+
+
+///
+/// \brief Publish
+///
+/// Makes the passed frame the latest frame of the buffer.  If the reader did not take
+/// the previous frame, it is released, since the reader will never see it.
+///
+/// \param frame The frame to publish.  The buffer takes over one reference to the frame,
+///              which it releases once the reader has moved on to a newer frame.
+///
+/// \remarks Only one thread can call this method at a time.
+///
+void TCFrameBuffer::Publish(TCFrame *frame)
+{
+    slots[back] = frame;
+    // The release half of the exchange makes the frame visible before its index, and
+    // the acquire half ensures the reader is done with the slot we get back.
+    back = __atomic_exchange_n(&middle, back | TC_FRAME_FRESH, __ATOMIC_ACQ_REL)
+         & ~TC_FRAME_FRESH;
+    if (slots[back] != NULL)
+    {
+        slots[back]->Release();
+        slots[back] = NULL;
+    }
+}
+
+
+///
+/// \brief Acquire
+///
+/// Gets the latest frame published to the buffer.  If a new frame was published since
+/// the last call, the reader's previous frame is handed back to the writer.
+///
+/// \returns A pointer to the frame (or NULL if no frame has been published yet).  The
+///          frame is valid until the next call to this method (or to \ref Clear), and
+///          can be retained with TCFrame::Retain to keep it longer.
+///
+/// \remarks Only one thread can call this method at a time.
+///
+TCFrame *TCFrameBuffer::Acquire()
+{
+    if (__atomic_load_n(&middle, __ATOMIC_RELAXED) & TC_FRAME_FRESH)
+    {
+        front = __atomic_exchange_n(&middle, front, __ATOMIC_ACQ_REL) & ~TC_FRAME_FRESH;
+    }
+    return slots[front];
+}
+
+
+///
+/// \brief Clear
+///
+/// Releases every frame held by the buffer, and returns it to its initial state.
+///
+/// \remarks No other thread may publish or acquire frames while this method runs.
+///
+void TCFrameBuffer::Clear()
+{
+    for (int i = 0; i < 3; i++)
+    {
+        if (slots[i] != NULL) slots[i]->Release();
+        slots[i] = NULL;
+    }
+    back   = 0;
+    middle = 1;
+    front  = 2;
+}
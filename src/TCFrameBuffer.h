@@ -0,0 +1,72 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *                         TCFrameBuffer Object  Header File                           *
+ *                                      TRICLYSM                                       *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  This file contains the definition of the TCFrameBuffer class as implemented by     *
+ *  the TCFrameBuffer.cpp source file.  This class is a triple buffer, which passes    *
+ *  the frames published by the animation thread to one reader without any locking.   *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  Copyright (C) 2011 Brandon Castellano, Ryan Mantha. All rights reserved.           *
+ *  Triclysm is provided under the BSD-2-Clause license. This program uses the SDL     *
+ *  (Simple DirectMedia Layer) library, and the Lua scripting language. See the        *
+ *  included LICENSE file or <http://www.triclysm.com/> for more details.              *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+///
+/// \file  TCFrameBuffer.h
+/// \brief This file contains the definition of the TCFrameBuffer class as implemented by
+///        the TCFrameBuffer.cpp source file.
+///
+
+#pragma once
+#ifndef TC_FRAME_BUFFER_
+#define TC_FRAME_BUFFER_
+
+#include "TCFrame.h"
+
+#define TC_FRAME_FRESH 0x04     ///< Set in the middle index until the reader takes it.
+
+
+///
+/// \brief Triclysm Frame Triple Buffer Object
+///
+/// This class holds three frame slots: the back slot (owned by the writer), the front
+/// slot (owned by the reader), and the middle slot, which holds the latest complete
+/// frame.  The writer publishes a frame by swapping the back and middle slots, and the
+/// reader takes it by swapping the middle and front slots, each with a single atomic
+/// exchange.  Neither side ever waits for the other, and the reader always gets the
+/// latest frame which was completely published.
+///
+/// \remarks Only one thread can publish frames at a time (the animation mutex is held
+///          while publishing), and only one thread can acquire them at a time.  Frames
+///          which are replaced before the reader takes them are released right away.
+///
+/// \see PublishFrame | AcquireFrame
+///
+class TCFrameBuffer
+{
+  public:
+    TCFrameBuffer();                // Creates an empty triple buffer.
+    ~TCFrameBuffer();               // Releases any frames still held.
+
+    void     Publish(TCFrame *frame);   // Takes over a reference to the passed frame.
+    TCFrame *Acquire();                 // Gets the latest frame (or NULL if none).
+    void     Clear();                   // Releases every frame held by the buffer.
+
+  private:
+    TCFrameBuffer(const TCFrameBuffer &);   // Not implemented.
+
+    TCFrame *slots[3];      ///< The frame in each slot (or NULL), holding one reference.
+    int      back,          ///< Slot the writer fills next (only used by the writer).
+             middle,        ///< Slot holding the latest frame, OR'd with TC_FRAME_FRESH.
+             front;         ///< Slot the reader is using (only used by the reader).
+};
+
+
+#endif
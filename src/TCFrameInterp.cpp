@@ -0,0 +1,172 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *                         TCFrameInterp Object  Source Code                           *
+ *                                      TRICLYSM                                       *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  This file contains the implementation of the TCFrameInterp class as defined by the *
+ *  TCFrameInterp.h header file.  This class produces the frames read between two      *
+ *  animation ticks, by blending the last two frames published by the animation thread. *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  Copyright (C) 2011 Brandon Castellano, Ryan Mantha. All rights reserved.           *
+ *  Triclysm is provided under the BSD-2-Clause license. This program uses the SDL     *
+ *  (Simple DirectMedia Layer) library, and the Lua scripting language. See the        *
+ *  included LICENSE file or <http://www.triclysm.com/> for more details.              *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+///
+/// \file  TCFrameInterp.cpp
+/// \brief This file contains the implementation of the TCFrameInterp class as defined by
+///        the TCFrameInterp.h header file.
+///
+
+#include "TCFrameInterp.h"
+#include <cassert>          // Used to validate the interpolation mode.
+#include <cstdlib>          // Used for pointer NULL define value.
+
+byte TCFrameInterp::mode = TC_INTERP_NONE;
+
+
+///
+/// \brief Frame Interpolation Constructor
+///
+/// Creates an object without any stored frames.
+///
+TCFrameInterp::TCFrameInterp()
+{
+    prevFrame  = NULL;
+    currFrame  = NULL;
+    lastOutput = NULL;
+    lastWeight = 0;
+}
+
+
+///
+/// \brief Destructor
+///
+/// Releases the references to each stored frame.
+///
+TCFrameInterp::~TCFrameInterp()
+{
+    Clear();
+}
+
+
+///
+/// \brief Interpolate
+///
+/// Stores the last published frame (if it is a new one), and returns the frame to read
+/// at the passed time, depending on the interpolation mode.
+///
+/// \param latest The last published frame (see AcquireFrame), or NULL.  The reference
+///               to the frame is taken over by this object.
+/// \param now    The current time (in milliseconds).
+/// \param period The time between two animation ticks (in milliseconds).
+///
+/// \returns A reference to the frame to read (which must be released with
+///          TCFrame::Release), or NULL if latest is NULL.
+///
+TCFrame *TCFrameInterp::Interpolate(TCFrame *latest, uint32_t now, uint32_t period)
+{
+    byte currMode = GetMode();
+    if (latest == NULL || currMode == TC_INTERP_NONE)
+    {
+        Clear();
+        return latest;
+    }
+    // The same frame is returned by AcquireFrame until a new one is published, so a
+    // different frame is always the next tick.
+    if (latest != currFrame)
+    {
+        if (prevFrame  != NULL) prevFrame->Release();
+        if (lastOutput != NULL) lastOutput->Release();
+        prevFrame  = currFrame;
+        currFrame  = latest;
+        lastOutput = NULL;
+    }
+    else
+    {
+        latest->Release();
+    }
+    // Next, we find how far we are between the two frames, from 0 to 0xFF.
+    byte weight = 0xFF;
+    if (prevFrame != NULL && period > 0 && now - currFrame->GetTime() < period)
+    {
+        weight = (byte)((now - currFrame->GetTime()) * 0xFF / period);
+    }
+    bool canBlend = (prevFrame != NULL && currFrame->GetNumColors() != 0
+                     && prevFrame->GetNumColors() == currFrame->GetNumColors());
+    for (byte axis = TC_X_AXIS; canBlend && axis <= TC_Z_AXIS; axis++)
+    {
+        canBlend = (prevFrame->GetSize(axis) == currFrame->GetSize(axis));
+    }
+    TCFrame *toReturn;
+    if (weight == 0xFF || prevFrame == NULL)
+    {
+        toReturn = currFrame;
+    }
+    else if (currMode == TC_INTERP_NEAREST || !canBlend || weight == 0x00)
+    {
+        toReturn = (weight < 0x80) ? prevFrame : currFrame;
+    }
+    else
+    {
+        // The blended frame is kept, so readers faster than the clock resolution (or
+        // polling twice at the same time) do not blend the frames again.
+        if (lastOutput == NULL || lastWeight != weight)
+        {
+            if (lastOutput != NULL) lastOutput->Release();
+            lastOutput = new TCFrame(*prevFrame, *currFrame, weight, now);
+            lastWeight = weight;
+        }
+        toReturn = lastOutput;
+    }
+    toReturn->Retain();
+    return toReturn;
+}
+
+
+///
+/// \brief Set Mode
+///
+/// Sets how the frames between two animation ticks are produced.
+///
+/// \param newMode The new interpolation mode (e.g. TC_INTERP_LINEAR).
+///
+void TCFrameInterp::SetMode(byte newMode)
+{
+    assert(newMode <= TC_INTERP_LINEAR);
+    __atomic_store_n(&mode, newMode, __ATOMIC_RELAXED);
+}
+
+
+///
+/// \brief Get Mode
+///
+/// \returns The current interpolation mode (see \ref SetMode).
+///
+byte TCFrameInterp::GetMode()
+{
+    return __atomic_load_n(&mode, __ATOMIC_RELAXED);
+}
+
+
+///
+/// \brief Clear
+///
+/// Releases the references to each stored frame (so the next frame passed to
+/// \ref Interpolate is not blended with an old one).
+///
+void TCFrameInterp::Clear()
+{
+    if (prevFrame  != NULL) prevFrame->Release();
+    if (currFrame  != NULL) currFrame->Release();
+    if (lastOutput != NULL) lastOutput->Release();
+    prevFrame  = NULL;
+    currFrame  = NULL;
+    lastOutput = NULL;
+}
@@ -0,0 +1,78 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *                         TCFrameInterp Object  Header File                           *
+ *                                      TRICLYSM                                       *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  This file contains the definition of the TCFrameInterp class as implemented by the *
+ *  TCFrameInterp.cpp source file.  This class produces the frames read between two    *
+ *  animation ticks, by blending the last two frames published by the animation thread. *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  Copyright (C) 2011 Brandon Castellano, Ryan Mantha. All rights reserved.           *
+ *  Triclysm is provided under the BSD-2-Clause license. This program uses the SDL     *
+ *  (Simple DirectMedia Layer) library, and the Lua scripting language. See the        *
+ *  included LICENSE file or <http://www.triclysm.com/> for more details.              *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+///
+/// \file  TCFrameInterp.h
+/// \brief This file contains the definition of the TCFrameInterp class as implemented by
+///        the TCFrameInterp.cpp source file.
+///
+
+#pragma once
+#ifndef TC_FRAME_INTERP_
+#define TC_FRAME_INTERP_
+
+#include "TCFrame.h"
+#include <stdint.h>             // Used for the uint32_t type.
+
+// Interpolation Mode Definitions
+#define TC_INTERP_NONE    0     ///< Each reader gets the last published frame.
+#define TC_INTERP_NEAREST 1     ///< The closer of the last two frames (in time).
+#define TC_INTERP_LINEAR  2     ///< A crossfade between the last two frames.
+
+
+///
+/// \brief Triclysm Frame Interpolation Object
+///
+/// This class keeps the last two frames passed to \ref Interpolate by a frame reader,
+/// and returns the frame to read at the current time, so the renderer and asynchronous
+/// drivers can refresh the cube faster than the animation ticks.  The output runs one
+/// tick behind the animation: the previous frame is shown when a new frame arrives, and
+/// the new frame is reached one tick period later.
+///
+/// \remarks The interpolation mode is shared by every TCFrameInterp object, but each
+///          reader needs its own object (see AcquireFrame), since the frames are stored
+///          in the object.  Animations without any colors are never blended (the
+///          nearest frame is used instead).
+///
+class TCFrameInterp
+{
+  public:
+    TCFrameInterp();
+    ~TCFrameInterp();               // Releases the stored frames.
+
+    // Gets the frame to read at the passed time (from the last published frame):
+    TCFrame *Interpolate(TCFrame *latest, uint32_t now, uint32_t period);
+    void     Clear();               // Releases the stored frames.
+
+    // Interpolation mode (shared by every TCFrameInterp object):
+    static void SetMode(byte newMode);
+    static byte GetMode();
+
+  private:
+    TCFrame *prevFrame,             ///< The frame published before currFrame (or NULL).
+            *currFrame,             ///< The last frame passed to Interpolate (or NULL).
+            *lastOutput;            ///< The last blend of the two frames (or NULL).
+    byte     lastWeight;            ///< The weight lastOutput was blended with.
+
+    static byte mode;               ///< The interpolation mode (e.g. TC_INTERP_LINEAR).
+};
+
+
+#endif
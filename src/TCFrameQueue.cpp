@@ -0,0 +1,368 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *                          TCFrameQueue Object  Source Code                           *
+ *                                      TRICLYSM                                       *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  This file contains the implementation of the TCFrameQueue class as defined by the  *
+ *  TCFrameQueue.h header file.  This class passes every published frame, in order,    *
+ *  from the animation thread to the thread sending them to a synchronous driver.      *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  Copyright (C) 2011 Brandon Castellano, Ryan Mantha. All rights reserved.           *
+ *  Triclysm is provided under the BSD-2-Clause license. This program uses the SDL     *
+ *  (Simple DirectMedia Layer) library, and the Lua scripting language. See the        *
+ *  included LICENSE file or <http://www.triclysm.com/> for more details.              *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+///
+/// \file  TCFrameQueue.cpp
+/// \brief This file contains the implementation of the TCFrameQueue class as defined by
+///        the TCFrameQueue.h header file.
+///
+
+#include "TCFrameQueue.h"
+#include <cassert>      // Used to validate the settings.
+#include <cstdlib>      // Used for pointer NULL define value.
+
+
+///
+/// \brief Frame Queue Constructor
+///
+/// Creates an empty queue, which releases any frames pushed to it until it is opened.
+///
+TCFrameQueue::TCFrameQueue()
+{
+    for (int i = 0; i < TC_FRAME_QUEUE_SLOTS; i++)
+    {
+        slots[i] = NULL;
+    }
+    head       = tail = numDropped = 0;
+    depth      = TC_FRAME_QUEUE_DEPTH;
+    policy     = TC_QUEUE_DROP_OLDEST;
+    closed     = 1;
+    numWaiting = 0;
+    mutex      = SDL_CreateMutex();
+    changed    = SDL_CreateCond();
+}
+
+
+///
+/// \brief Destructor
+///
+/// Releases the frames still queued.  No other thread may be using the queue.
+///
+TCFrameQueue::~TCFrameQueue()
+{
+    Clear();
+    SDL_DestroyCond(changed);
+    SDL_DestroyMutex(mutex);
+}
+
+
+///
+/// \brief Push
+///
+/// Adds a frame to the end of the queue.  If the queue already holds as many frames as
+/// its depth, the oldest frame is dropped, or this method waits until the driver takes
+/// one, depending on the back-pressure policy (see \ref SetPolicy).
+///
+/// \param frame The frame to queue.  The caller's reference is taken over by the queue
+///              (and is released right away if the queue is closed).
+///
+/// \remarks Only one thread may push at a time.
+///
+void TCFrameQueue::Push(TCFrame *frame)
+{
+    assert(frame != NULL);
+    uint64_t t = __atomic_load_n(&tail, __ATOMIC_RELAXED);  // Only written by us.
+    for (;;)
+    {
+        if (__atomic_load_n(&closed, __ATOMIC_ACQUIRE))
+        {
+            frame->Release();
+            return;
+        }
+        uint64_t h = __atomic_load_n(&head, __ATOMIC_SEQ_CST);
+        if (t - h < __atomic_load_n(&depth, __ATOMIC_RELAXED)) break;
+        if (__atomic_load_n(&policy, __ATOMIC_RELAXED) == TC_QUEUE_DROP_OLDEST)
+        {
+            // We take the oldest frame the same way as the driver thread, so only one of
+            // us gets it (if the driver took it first, we just check again).
+            TCFrame *oldest;
+            if (TakeFrame(h, &oldest))
+            {
+                oldest->Release();
+                __atomic_add_fetch(&numDropped, 1, __ATOMIC_RELAXED);
+            }
+        }
+        else
+        {
+            Wait(h, t, TC_FRAME_QUEUE_WAIT);
+        }
+    }
+    // The slot is written before the tail is moved past it, so the driver thread never
+    // takes a frame before it was stored.
+    __atomic_store_n(&slots[t % TC_FRAME_QUEUE_SLOTS], frame, __ATOMIC_RELEASE);
+    __atomic_store_n(&tail, t + 1, __ATOMIC_SEQ_CST);
+    Notify();
+}
+
+
+///
+/// \brief Pop
+///
+/// Takes the oldest frame from the queue, waiting for one to be pushed if it is empty.
+///
+/// \param timeout The longest time to wait for a frame (in milliseconds).
+///
+/// \returns The oldest frame (which must be released with TCFrame::Release once the
+///          caller is done with it), or NULL if no frame was pushed before the timeout,
+///          or if the queue was closed.
+///
+/// \remarks Only one thread may take frames at a time.
+///
+TCFrame *TCFrameQueue::Pop(Uint32 timeout)
+{
+    bool waited = false;
+    for (;;)
+    {
+        uint64_t h = __atomic_load_n(&head, __ATOMIC_SEQ_CST),
+                 t = __atomic_load_n(&tail, __ATOMIC_SEQ_CST);
+        if (h != t)
+        {
+            TCFrame *frame;
+            if (TakeFrame(h, &frame))
+            {
+                Notify();       // The publishing thread may be waiting for a free slot.
+                return frame;
+            }
+            continue;           // The frame was dropped, so we try the next one.
+        }
+        if (waited || __atomic_load_n(&closed, __ATOMIC_ACQUIRE)) return NULL;
+        Wait(h, t, timeout);
+        waited = true;
+    }
+}
+
+
+///
+/// \brief Open
+///
+/// Releases any frames left in the queue, and starts accepting new frames.
+///
+/// \remarks No thread may be taking frames while the queue is opened.
+///
+void TCFrameQueue::Open()
+{
+    Clear();
+    __atomic_store_n(&numDropped, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&closed, 0, __ATOMIC_RELEASE);
+}
+
+
+///
+/// \brief Close
+///
+/// Stops accepting new frames (they are released as soon as they are pushed), and wakes
+/// any thread waiting in \ref Push or \ref Pop.  The frames already queued can still be
+/// taken, or released with \ref Clear.
+///
+void TCFrameQueue::Close()
+{
+    SDL_mutexP(mutex);
+    __atomic_store_n(&closed, 1, __ATOMIC_SEQ_CST);
+    SDL_CondBroadcast(changed);
+    SDL_mutexV(mutex);
+}
+
+
+///
+/// \brief Clear
+///
+/// Releases every frame in the queue.
+///
+/// \remarks No thread may be taking frames while the queue is cleared (since this method
+///          takes them itself), but a frame may still be pushed.
+///
+void TCFrameQueue::Clear()
+{
+    for (;;)
+    {
+        uint64_t h = __atomic_load_n(&head, __ATOMIC_SEQ_CST),
+                 t = __atomic_load_n(&tail, __ATOMIC_SEQ_CST);
+        if (h == t) break;
+        TCFrame *frame;
+        if (TakeFrame(h, &frame)) frame->Release();
+    }
+    Notify();
+}
+
+
+///
+/// \brief Set Back-pressure Policy
+///
+/// Sets what \ref Push does when the queue is full.
+///
+/// \param newPolicy The new policy (TC_QUEUE_DROP_OLDEST or TC_QUEUE_BLOCK).
+///
+void TCFrameQueue::SetPolicy(byte newPolicy)
+{
+    assert(newPolicy == TC_QUEUE_DROP_OLDEST || newPolicy == TC_QUEUE_BLOCK);
+    __atomic_store_n(&policy, newPolicy, __ATOMIC_RELAXED);
+}
+
+
+///
+/// \brief Get Back-pressure Policy
+///
+/// \returns The current back-pressure policy (e.g. TC_QUEUE_BLOCK).
+///
+byte TCFrameQueue::GetPolicy()
+{
+    return __atomic_load_n(&policy, __ATOMIC_RELAXED);
+}
+
+
+///
+/// \brief Set Depth
+///
+/// Sets the number of frames which can be queued before the back-pressure policy is
+/// applied.  A smaller depth keeps the driver closer to the animation, and a larger one
+/// absorbs longer delays of the driver.
+///
+/// \param newDepth The new depth (from 1 to TC_FRAME_QUEUE_SLOTS).  If the queue holds
+///                 more frames than this, the next push applies the policy until it
+///                 holds fewer.
+///
+void TCFrameQueue::SetDepth(unsigned int newDepth)
+{
+    assert(newDepth >= 1 && newDepth <= TC_FRAME_QUEUE_SLOTS);
+    __atomic_store_n(&depth, newDepth, __ATOMIC_RELAXED);
+}
+
+
+///
+/// \brief Get Depth
+///
+/// \returns The number of frames which can be queued (see \ref SetDepth).
+///
+unsigned int TCFrameQueue::GetDepth()
+{
+    return __atomic_load_n(&depth, __ATOMIC_RELAXED);
+}
+
+
+///
+/// \brief Get Number of Queued Frames
+///
+/// \returns The number of frames pushed, but not yet taken or dropped.
+///
+unsigned int TCFrameQueue::GetNumQueued()
+{
+    uint64_t h = __atomic_load_n(&head, __ATOMIC_SEQ_CST),
+             t = __atomic_load_n(&tail, __ATOMIC_SEQ_CST);
+    return (t > h) ? (unsigned int)(t - h) : 0;
+}
+
+
+///
+/// \brief Get Number of Dropped Frames
+///
+/// \returns The number of frames dropped because the queue was full (with the
+///          TC_QUEUE_DROP_OLDEST policy) since the queue was last opened.
+///
+uint64_t TCFrameQueue::GetNumDropped()
+{
+    return __atomic_load_n(&numDropped, __ATOMIC_RELAXED);
+}
+
+
+///
+/// \brief Get Back-pressure Policy Name
+///
+/// \param policy The back-pressure policy (e.g. TC_QUEUE_BLOCK).
+///
+/// \returns The name of the policy (as used by the driverqueue console command).
+///
+const char *TCFrameQueue::GetPolicyName(byte policy)
+{
+    switch (policy)
+    {
+        case TC_QUEUE_DROP_OLDEST: return "drop";
+        case TC_QUEUE_BLOCK:       return "block";
+    }
+    return "unknown";
+}
+
+
+///
+/// \brief Take Frame
+///
+/// Takes the frame at the passed index, by moving the head past it.  Since the head is
+/// only moved with a compare-and-swap, only one thread gets each frame.
+///
+/// \param h      The index of the frame (the head, as last read by the caller).
+/// \param pFrame Set to the frame if it was taken.
+///
+/// \returns True if the frame was taken, false if the head was moved by another thread.
+///
+/// \remarks The slot is read before the head is moved, since it can be reused as soon as
+///          it is.  If it was already reused, the head has moved, so the frame read is
+///          ignored.
+///
+bool TCFrameQueue::TakeFrame(uint64_t h, TCFrame **pFrame)
+{
+    *pFrame = __atomic_load_n(&slots[h % TC_FRAME_QUEUE_SLOTS], __ATOMIC_ACQUIRE);
+    return __atomic_compare_exchange_n(&head, &h, h + 1, false,
+                                       __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+
+///
+/// \brief Wait
+///
+/// Sleeps until another thread moves the head or tail away from the passed indices, the
+/// queue is closed, or the timeout expires.
+///
+/// \param h       The head index last read by the caller.
+/// \param t       The tail index last read by the caller.
+/// \param timeout The longest time to wait (in milliseconds).
+///
+/// \remarks The waiting thread is counted before the indices are checked again, and the
+///          other thread moves an index before checking the count (see \ref Notify), so
+///          at least one of them sees the other and no wakeup is missed.
+///
+void TCFrameQueue::Wait(uint64_t h, uint64_t t, Uint32 timeout)
+{
+    SDL_mutexP(mutex);
+    __atomic_add_fetch(&numWaiting, 1, __ATOMIC_SEQ_CST);
+    if (    __atomic_load_n(&head, __ATOMIC_SEQ_CST) == h
+         && __atomic_load_n(&tail, __ATOMIC_SEQ_CST) == t
+         && !__atomic_load_n(&closed, __ATOMIC_SEQ_CST) )
+    {
+        SDL_CondWaitTimeout(changed, mutex, timeout);
+    }
+    __atomic_sub_fetch(&numWaiting, 1, __ATOMIC_SEQ_CST);
+    SDL_mutexV(mutex);
+}
+
+
+///
+/// \brief Notify
+///
+/// Wakes any thread waiting in \ref Wait.  The mutex is only locked if a thread is
+/// waiting, so neither side locks it while the driver keeps up with the animation.
+///
+void TCFrameQueue::Notify()
+{
+    if (__atomic_load_n(&numWaiting, __ATOMIC_SEQ_CST) > 0)
+    {
+        SDL_mutexP(mutex);
+        SDL_CondBroadcast(changed);
+        SDL_mutexV(mutex);
+    }
+}
@@ -0,0 +1,111 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *                          TCFrameQueue Object  Header File                           *
+ *                                      TRICLYSM                                       *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  This file contains the definition of the TCFrameQueue class as implemented by the  *
+ *  TCFrameQueue.cpp source file.  This class passes every published frame, in order,  *
+ *  from the animation thread to the thread sending them to a synchronous driver.      *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  Copyright (C) 2011 Brandon Castellano, Ryan Mantha. All rights reserved.           *
+ *  Triclysm is provided under the BSD-2-Clause license. This program uses the SDL     *
+ *  (Simple DirectMedia Layer) library, and the Lua scripting language. See the        *
+ *  included LICENSE file or <http://www.triclysm.com/> for more details.              *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+///
+/// \file  TCFrameQueue.h
+/// \brief This file contains the definition of the TCFrameQueue class as implemented by
+///        the TCFrameQueue.cpp source file.
+///
+
+#pragma once
+#ifndef TC_FRAME_QUEUE_
+#define TC_FRAME_QUEUE_
+
+#include "TCFrame.h"
+#include "SDL.h"
+#include "SDL_thread.h"         // Used for the mutex and condition variable.
+#include <stdint.h>             // Used for the uint64_t type.
+
+// Back-pressure Policy Definitions (what Push does when the queue is full)
+#define TC_QUEUE_DROP_OLDEST 0  ///< The oldest queued frame is dropped (the default).
+#define TC_QUEUE_BLOCK       1  ///< Push waits until the driver takes a frame.
+
+#define TC_FRAME_QUEUE_SLOTS 16 ///< Most frames which can be queued at once.
+#define TC_FRAME_QUEUE_DEPTH 4  ///< Default number of frames which can be queued.
+#define TC_FRAME_QUEUE_WAIT  20 ///< Longest time Push waits before checking again (ms).
+
+
+///
+/// \brief Triclysm Frame Queue Object
+///
+/// This class is a bounded ring of frames, written by the thread publishing frames and
+/// read by the thread sending them to a synchronous driver, so a slow driver no longer
+/// delays the next tick.  Frames are taken in the same order they were pushed.  When the
+/// queue is full, the back-pressure policy decides whether the oldest frame is dropped
+/// (so the driver stays close to the animation), or the publishing thread waits (so
+/// every frame is sent).
+///
+/// \remarks Only one thread may push at a time (the animation mutex is held while
+///          publishing), and only one thread may take frames at a time.  Taking a frame
+///          and dropping one are both a single compare-and-swap of the head index, so a
+///          frame is never both sent and dropped.  Neither side locks the mutex unless
+///          the other one is waiting.
+///
+/// \see PublishFrame | UpdateSyncDriver
+///
+class TCFrameQueue
+{
+  public:
+    TCFrameQueue();                 // Creates an empty, closed queue.
+    ~TCFrameQueue();                // Releases any frames still queued.
+
+    void     Push(TCFrame *frame);  // Takes over a reference to the passed frame.
+    TCFrame *Pop(Uint32 timeout);   // Takes the oldest frame (or NULL after timeout ms).
+
+    void Open();                    // Starts accepting frames (see Push).
+    void Close();                   // Releases frames pushed from now on, and wakes Pop.
+    void Clear();                   // Releases every queued frame.
+
+    // Settings (can be changed while the queue is used):
+    void         SetPolicy(byte newPolicy);
+    byte         GetPolicy();
+    void         SetDepth(unsigned int newDepth);
+    unsigned int GetDepth();
+
+    // Statistics:
+    unsigned int GetNumQueued();    // Frames waiting to be taken.
+    uint64_t     GetNumDropped();   // Frames dropped since the queue was opened.
+
+    static const char *GetPolicyName(byte policy);  // e.g. "drop" for TC_QUEUE_DROP_OLDEST.
+
+  private:
+    TCFrameQueue(const TCFrameQueue &);     // Not implemented.
+
+    // Takes the frame at index h if h is still the head (returns false if it is not).
+    bool TakeFrame(uint64_t h, TCFrame **pFrame);
+    // Waits until the head or tail is no longer h or t (or the queue is closed).
+    void Wait(uint64_t h, uint64_t t, Uint32 timeout);
+    // Wakes the threads in Wait (after the head or tail was moved).
+    void Notify();
+
+    TCFrame     *slots[TC_FRAME_QUEUE_SLOTS];   ///< The queued frames (index % SLOTS).
+    uint64_t     head,          ///< Index of the oldest queued frame (atomic).
+                 tail,          ///< Index the next frame is pushed to (atomic).
+                 numDropped;    ///< See GetNumDropped (atomic).
+    unsigned int depth;         ///< Most frames queued at once (atomic, see SetDepth).
+    byte         policy;        ///< The back-pressure policy (atomic, see SetPolicy).
+    int          closed,        ///< Non-zero once the queue is closed (atomic).
+                 numWaiting;    ///< Threads sleeping in Wait (atomic).
+    SDL_mutex   *mutex;         ///< Held while a thread starts to wait, or is woken.
+    SDL_cond    *changed;       ///< Signalled after the head or tail was moved.
+};
+
+
+#endif
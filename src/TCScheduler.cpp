@@ -0,0 +1,337 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *                          TCScheduler Object  Source Code                            *
+ *                                      TRICLYSM                                       *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  This file contains the implementation of the TCScheduler class as defined by the   *
+ *  TCScheduler.h header file.  This class decides when each animation tick is run,    *
+ *  using a monotonic nanosecond clock, and reports the tick rate actually achieved.   *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  Copyright (C) 2011 Brandon Castellano, Ryan Mantha. All rights reserved.           *
+ *  Triclysm is provided under the BSD-2-Clause license. This program uses the SDL     *
+ *  (Simple DirectMedia Layer) library, and the Lua scripting language. See the        *
+ *  included LICENSE file or <http://www.triclysm.com/> for more details.              *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+///
+/// \file  TCScheduler.cpp
+/// \brief This file contains the implementation of the TCScheduler class as defined by
+///        the TCScheduler.h header file.
+///
+
+#include "TCScheduler.h"
+#include <cassert>          // Used to validate the settings.
+#include <cerrno>           // Used to retry a sleep after a signal.
+#include <time.h>           // Used for the clock_gettime and clock_nanosleep functions.
+
+
+///
+/// \brief Scheduler Constructor
+///
+/// Creates a scheduler where the first tick is due one tick period from now.
+///
+/// \param ticksPerSecond The tick rate (see \ref SetRate).
+///
+TCScheduler::TCScheduler(double ticksPerSecond)
+{
+    assert(ticksPerSecond > 0.0);
+    rate           = ticksPerSecond;
+    catchUp        = TC_CATCHUP_SKIP;
+    version        = 0;
+    appliedVersion = 0;
+    periodNs       = 1e9 / rate;
+    achievedRate   = meanLateness = maxLateness = 0.0;
+    skippedTicks   = 0;
+    Restart(Now());
+}
+
+
+///
+/// \brief Wait
+///
+/// Sleeps until the next tick is due (for at most TC_MAX_SLEEP_NS), and returns the
+/// number of ticks which should be run now.  If the deadlines of later ticks have also
+/// passed, the missed ticks are either skipped or included in the returned number,
+/// depending on the catch-up policy (see \ref SetCatchUp).
+///
+/// \returns The number of ticks to run (from 0 to TC_MAX_BURST).  This is 0 if the tick
+///          is not due yet after sleeping for TC_MAX_SLEEP_NS (so the caller can check
+///          whether it should stop), or 1 when the scheduler is on time.
+///
+/// \remarks If the rate was changed (see \ref SetRate), the next tick is due one new tick
+///          period after the last tick's deadline.
+///
+unsigned int TCScheduler::Wait()
+{
+    uint64_t deadline = GetDeadline(),
+             now      = Now();
+    if (now < deadline)
+    {
+        // We sleep until the absolute deadline (so the time taken to get here does not
+        // add up), but never for so long that a new rate or shutdown is missed.
+        uint64_t wakeTime = (deadline - now > TC_MAX_SLEEP_NS) ? now + TC_MAX_SLEEP_NS
+                                                                : deadline;
+        struct timespec ts;
+        ts.tv_sec  = (time_t)(wakeTime / 1000000000ull);
+        ts.tv_nsec = (long)(wakeTime % 1000000000ull);
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+        {
+            // The sleep was interrupted by a signal, so we sleep again.
+        }
+        now = Now();
+    }
+    return TakeTicks(now);
+}
+
+
+///
+/// \brief Get Deadline
+///
+/// Gets the time the next tick is due.  If the rate was changed (see \ref SetRate), the
+/// new rate is applied first, so the next tick is due one new tick period after the last
+/// tick's deadline.
+///
+/// \returns The deadline of the next tick, on the same clock as \ref Now.
+///
+uint64_t TCScheduler::GetDeadline()
+{
+    unsigned int newVersion = __atomic_load_n(&version, __ATOMIC_ACQUIRE);
+    if (newVersion != appliedVersion)
+    {
+        double newRate;
+        __atomic_load(&rate, &newRate, __ATOMIC_RELAXED);
+        appliedVersion = newVersion;
+        uint64_t lastDeadline = Deadline(nextTick - 1);
+        periodNs = 1e9 / newRate;
+        Restart(lastDeadline);
+        __atomic_store_n(&skippedTicks, 0, __ATOMIC_RELAXED);
+    }
+    return Deadline(nextTick);
+}
+
+
+///
+/// \brief Take Ticks
+///
+/// Returns the number of ticks due at the passed time, in the same way as \ref Wait, but
+/// without sleeping.  This is used when one thread runs the ticks of several schedulers
+/// (see TCSlotEngine), which waits for the earliest of their deadlines itself.
+///
+/// \param now The current time (see \ref Now).
+///
+/// \returns The number of ticks to run (from 0 to TC_MAX_BURST), which is 0 if the next
+///          tick is not due yet.
+///
+unsigned int TCScheduler::TakeTicks(uint64_t now)
+{
+    uint64_t deadline = GetDeadline();
+    if (now < deadline) return 0;
+    // Every tick from nextTick up to the last deadline which passed is now due.
+    uint64_t     due   = (uint64_t)((now - epoch) / periodNs) + 1;
+    unsigned int ticks = 1;
+    if (due <= nextTick) due = nextTick + 1;    // In case of a rounding error.
+    due -= nextTick;
+    if (__atomic_load_n(&catchUp, __ATOMIC_RELAXED) == TC_CATCHUP_BURST)
+    {
+        ticks = (due > TC_MAX_BURST) ? TC_MAX_BURST : (unsigned int)due;
+    }
+    if (due > ticks)
+    {
+        __atomic_add_fetch(&skippedTicks, due - ticks, __ATOMIC_RELAXED);
+    }
+    nextTick += due;
+    UpdateStats(now, now - deadline, ticks);
+    return ticks;
+}
+
+
+///
+/// \brief Set Rate
+///
+/// Sets the number of ticks per second.  The thread calling \ref Wait starts using the
+/// new rate on its next call.
+///
+/// \param ticksPerSecond The new tick rate (which does not have to be an integer).
+///
+void TCScheduler::SetRate(double ticksPerSecond)
+{
+    assert(ticksPerSecond > 0.0);
+    __atomic_store(&rate, &ticksPerSecond, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&version, 1, __ATOMIC_RELEASE);
+}
+
+
+///
+/// \brief Get Rate
+///
+/// \returns The number of ticks per second set with \ref SetRate.
+///
+double TCScheduler::GetRate()
+{
+    double toReturn;
+    __atomic_load(&rate, &toReturn, __ATOMIC_RELAXED);
+    return toReturn;
+}
+
+
+///
+/// \brief Set Catch-up Policy
+///
+/// Sets what happens to the ticks whose deadlines are missed (see \ref Wait).
+///
+/// \param policy The new policy (TC_CATCHUP_SKIP or TC_CATCHUP_BURST).
+///
+void TCScheduler::SetCatchUp(byte policy)
+{
+    assert(policy == TC_CATCHUP_SKIP || policy == TC_CATCHUP_BURST);
+    __atomic_store_n(&catchUp, policy, __ATOMIC_RELAXED);
+}
+
+
+///
+/// \brief Get Catch-up Policy
+///
+/// \returns The current catch-up policy (e.g. TC_CATCHUP_SKIP).
+///
+byte TCScheduler::GetCatchUp()
+{
+    return __atomic_load_n(&catchUp, __ATOMIC_RELAXED);
+}
+
+
+///
+/// \brief Get Achieved Rate
+///
+/// \returns The number of ticks run per second, measured over the last TC_STATS_NS.
+///
+double TCScheduler::GetAchievedRate()
+{
+    double toReturn;
+    __atomic_load(&achievedRate, &toReturn, __ATOMIC_RELAXED);
+    return toReturn;
+}
+
+
+///
+/// \brief Get Mean Lateness
+///
+/// \returns The average time from the deadline of a tick to when it was run, measured
+///          over the last TC_STATS_NS (in milliseconds).
+///
+double TCScheduler::GetMeanLateness()
+{
+    double toReturn;
+    __atomic_load(&meanLateness, &toReturn, __ATOMIC_RELAXED);
+    return toReturn;
+}
+
+
+///
+/// \brief Get Max Lateness
+///
+/// \returns The longest time from the deadline of a tick to when it was run, measured
+///          over the last TC_STATS_NS (in milliseconds).
+///
+double TCScheduler::GetMaxLateness()
+{
+    double toReturn;
+    __atomic_load(&maxLateness, &toReturn, __ATOMIC_RELAXED);
+    return toReturn;
+}
+
+
+///
+/// \brief Get Skipped Ticks
+///
+/// \returns The number of ticks skipped to catch up since the rate was last set.
+///
+uint64_t TCScheduler::GetSkippedTicks()
+{
+    return __atomic_load_n(&skippedTicks, __ATOMIC_RELAXED);
+}
+
+
+///
+/// \brief Now
+///
+/// \returns The current time of the monotonic clock, in nanoseconds.  The clock never
+///          goes backwards (even if the system time is changed).
+///
+uint64_t TCScheduler::Now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+
+///
+/// \brief Get Catch-up Policy Name
+///
+/// \param policy The catch-up policy (e.g. TC_CATCHUP_BURST).
+///
+/// \returns The name of the policy (as used by the tickrate console command).
+///
+const char *TCScheduler::GetCatchUpName(byte policy)
+{
+    switch (policy)
+    {
+        case TC_CATCHUP_SKIP:  return "skip";
+        case TC_CATCHUP_BURST: return "burst";
+    }
+    return "unknown";
+}
+
+
+///
+/// \brief Restart
+///
+/// Makes the passed time the deadline of tick 0, so the next tick (tick 1) is due one
+/// tick period later.  The statistics are measured again from the same time.
+///
+/// \param start The new time of tick 0.
+///
+void TCScheduler::Restart(uint64_t start)
+{
+    epoch             = start;
+    nextTick          = 1;
+    windowStart       = start;
+    windowTicks       = windowWaits = 0;
+    windowLateness    = windowMaxLateness = 0;
+}
+
+
+///
+/// \brief Update Statistics
+///
+/// Adds the ticks run by a call of \ref Wait to the statistics, and publishes them once
+/// they were measured for TC_STATS_NS.
+///
+/// \param now      The current time.
+/// \param lateness How long after its deadline the first tick was run.
+/// \param ticks    The number of ticks run.
+///
+void TCScheduler::UpdateStats(uint64_t now, uint64_t lateness, unsigned int ticks)
+{
+    windowTicks    += ticks;
+    windowWaits    += 1;
+    windowLateness += lateness;
+    if (lateness > windowMaxLateness) windowMaxLateness = lateness;
+    if (now - windowStart >= TC_STATS_NS)
+    {
+        double newRate = windowTicks * 1e9 / (double)(now - windowStart),
+               newMean = windowLateness / 1e6 / (double)windowWaits,
+               newMax  = windowMaxLateness / 1e6;
+        __atomic_store(&achievedRate, &newRate, __ATOMIC_RELAXED);
+        __atomic_store(&meanLateness, &newMean, __ATOMIC_RELAXED);
+        __atomic_store(&maxLateness,  &newMax,  __ATOMIC_RELAXED);
+        windowStart       = now;
+        windowTicks       = windowWaits = 0;
+        windowLateness    = windowMaxLateness = 0;
+    }
+}
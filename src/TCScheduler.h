@@ -0,0 +1,122 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *                          TCScheduler Object  Header File                            *
+ *                                      TRICLYSM                                       *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  This file contains the definition of the TCScheduler class as implemented by the   *
+ *  TCScheduler.cpp source file.  This class decides when each animation tick is run,  *
+ *  using a monotonic nanosecond clock, and reports the tick rate actually achieved.   *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  Copyright (C) 2011 Brandon Castellano, Ryan Mantha. All rights reserved.           *
+ *  Triclysm is provided under the BSD-2-Clause license. This program uses the SDL     *
+ *  (Simple DirectMedia Layer) library, and the Lua scripting language. See the        *
+ *  included LICENSE file or <http://www.triclysm.com/> for more details.              *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+///
+/// \file  TCScheduler.h
+/// \brief This file contains the definition of the TCScheduler class as implemented by
+///        the TCScheduler.cpp source file.
+///
+
+#pragma once
+#ifndef TC_SCHEDULER_
+#define TC_SCHEDULER_
+
+#include "TCCube.h"             // Used for the byte type.
+#include <stdint.h>             // Used for the uint64_t type.
+
+// Catch-up Policy Definitions (what happens to the ticks missed when running late)
+#define TC_CATCHUP_SKIP  0      ///< Missed ticks are skipped (the default).
+#define TC_CATCHUP_BURST 1      ///< Missed ticks are run at once (see TC_MAX_BURST).
+
+#define TC_MIN_TICK_RATE 0.01           ///< Lowest tick rate (ticks per second).
+#define TC_MAX_TICK_RATE 10000.0        ///< Highest tick rate (ticks per second).
+#define TC_MAX_BURST     16             ///< Most ticks run at once to catch up.
+#define TC_MAX_SLEEP_NS  50000000ull    ///< Longest time Wait sleeps for (50 ms).
+#define TC_STATS_NS      1000000000ull  ///< Time the statistics are measured over (1 s).
+
+
+///
+/// \brief Triclysm Tick Scheduler Object
+///
+/// This class gives each tick an absolute deadline on a monotonic nanosecond clock,
+/// where tick n is due exactly n tick periods after the rate was set.  Since each
+/// deadline is computed from the start instead of from the last tick, the rate does not
+/// drift (even for fractional rates, e.g. 29.97 ticks per second), and the ticks stay in
+/// phase with anything started at the same time (e.g. music).
+///
+/// When a tick is run late enough that later deadlines were also missed, the catch-up
+/// policy decides whether the missed ticks are skipped (keeping the animation on time)
+/// or run at once (keeping the number of ticks).  Either way, the following deadlines
+/// stay on the same grid.
+///
+/// \remarks Only one thread at a time may call \ref Wait, \ref GetDeadline, or
+///          \ref TakeTicks.  The settings can be changed, and the statistics read, by any
+///          thread.
+///
+/// \see UpdateAnim | SetTickRate | TCSlotEngine
+///
+class TCScheduler
+{
+  public:
+    TCScheduler(double ticksPerSecond);
+
+    unsigned int Wait();            // Sleeps until a tick is due (returns ticks to run).
+    uint64_t     GetDeadline();     // The time the next tick is due (see Now).
+    unsigned int TakeTicks(uint64_t now);   // Same as Wait, but never sleeps.
+
+    // Settings (can be changed while another thread waits):
+    void   SetRate(double ticksPerSecond);
+    double GetRate();
+    void   SetCatchUp(byte policy);
+    byte   GetCatchUp();
+
+    // Statistics (measured over about TC_STATS_NS, and readable by any thread):
+    double   GetAchievedRate();     // Ticks run per second.
+    double   GetMeanLateness();     // Average time a tick was late (in milliseconds).
+    double   GetMaxLateness();      // Longest time a tick was late (in milliseconds).
+    uint64_t GetSkippedTicks();     // Ticks skipped since the rate was last set.
+
+    static uint64_t    Now();                       // Monotonic clock (in nanoseconds).
+    static const char *GetCatchUpName(byte policy); // e.g. "skip" for TC_CATCHUP_SKIP.
+
+  private:
+    // Returns the deadline of the tick with the passed index.
+    uint64_t Deadline(uint64_t tick) const
+        { return epoch + (uint64_t)(tick * periodNs + 0.5); }
+    // Restarts the deadlines (with the current rate) from the passed time.
+    void Restart(uint64_t start);
+    // Adds a tick run late by lateness to the statistics.
+    void UpdateStats(uint64_t now, uint64_t lateness, unsigned int ticks);
+
+    // Settings (written by any thread, see SetRate):
+    double       rate;              ///< The requested number of ticks per second.
+    byte         catchUp;           ///< The catch-up policy (e.g. TC_CATCHUP_BURST).
+    unsigned int version;           ///< Incremented whenever the rate is set.
+
+    // State (only used by the thread calling Wait):
+    unsigned int appliedVersion;    ///< The version of the rate used for periodNs.
+    double       periodNs;          ///< Nanoseconds between two deadlines.
+    uint64_t     epoch,             ///< The time of tick 0 (when the rate was set).
+                 nextTick;          ///< The index of the next tick to run.
+    uint64_t     windowStart,       ///< When the statistics were last published.
+                 windowTicks,       ///< Ticks run since windowStart.
+                 windowWaits,       ///< Calls of Wait which ran ticks since windowStart.
+                 windowLateness,    ///< Sum of the lateness of those calls.
+                 windowMaxLateness; ///< Longest lateness of those calls.
+
+    // Statistics (written by the thread calling Wait, see UpdateStats):
+    double       achievedRate,      ///< See GetAchievedRate.
+                 meanLateness,      ///< See GetMeanLateness.
+                 maxLateness;       ///< See GetMaxLateness.
+    uint64_t     skippedTicks;      ///< See GetSkippedTicks.
+};
+
+
+#endif
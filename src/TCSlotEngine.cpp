@@ -0,0 +1,488 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *                          TCSlotEngine Object  Source Code                           *
+ *                                      TRICLYSM                                       *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  This file contains the implementation of the TCSlotEngine class as defined by the  *
+ *  TCSlotEngine.h header file.  This class runs several independent animations,       *
+ *  each with its own cube size, tick rate, and driver, on a fixed pool of worker      *
+ *  threads.                                                                           *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  Copyright (C) 2011 Brandon Castellano, Ryan Mantha. All rights reserved.           *
+ *  Triclysm is provided under the BSD-2-Clause license. This program uses the SDL     *
+ *  (Simple DirectMedia Layer) library, and the Lua scripting language. See the        *
+ *  included LICENSE file or <http://www.triclysm.com/> for more details.              *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+///
+/// \file  TCSlotEngine.cpp
+/// \brief This file contains the implementation of the TCSlotEngine class as defined by
+///        the TCSlotEngine.h header file.
+///
+
+#include "TCSlotEngine.h"
+#include "TCFrame.h"
+#include "TCEffectChain.h"
+#include <cstdlib>          // Used for pointer NULL define value.
+#include <cstring>          // Used to copy the slot sizes.
+#include <unistd.h>         // Used for the sysconf function.
+
+
+///
+/// \brief Slot Constructor
+///
+/// Creates an empty slot (without an animation or driver), which is running.
+///
+TCSlotEngine::Slot::Slot(const std::string &slotName, const byte slotSize[3],
+                         double tickRate)
+    : name(slotName), anim(NULL), driver(NULL), scheduler(tickRate), ticks(0),
+      numWaiting(0), running(true), busy(false)
+{
+    memcpy(size, slotSize, sizeof(size));
+}
+
+
+///
+/// \brief Slot Engine Constructor
+///
+/// Creates an engine without any slots, and starts the worker threads (which wait until
+/// a slot is added).
+///
+/// \param numWorkers The number of worker threads.  If 0, one worker is started for each
+///                   processor (the workers only use a processor while ticking a slot).
+///
+TCSlotEngine::TCSlotEngine(int numWorkers)
+{
+    mutex   = SDL_CreateMutex();
+    changed = SDL_CreateCond();
+    idle    = SDL_CreateCond();
+    quit    = false;
+    if (numWorkers <= 0)
+    {
+        long numCpus = sysconf(_SC_NPROCESSORS_ONLN);
+        numWorkers = (numCpus > 1) ? (int)numCpus : 1;
+    }
+    for (int i = 0; i < numWorkers; i++)
+    {
+        SDL_Thread *worker = SDL_CreateThread(WorkerMain, this);
+        if (worker == NULL) break;      // The slots just share fewer workers.
+        workers.push_back(worker);
+    }
+}
+
+
+///
+/// \brief Destructor
+///
+/// Stops the worker threads (waiting for each of them to finish the slot it is running),
+/// and deletes every slot, along with its animation and driver.
+///
+TCSlotEngine::~TCSlotEngine()
+{
+    SDL_mutexP(mutex);
+    quit = true;
+    SDL_CondBroadcast(changed);
+    SDL_mutexV(mutex);
+    for (size_t i = 0; i < workers.size(); i++)
+    {
+        SDL_WaitThread(workers[i], NULL);
+    }
+    for (size_t i = 0; i < slots.size(); i++)
+    {
+        delete slots[i]->anim;
+        delete slots[i]->driver;
+        delete slots[i];
+    }
+    SDL_DestroyCond(idle);
+    SDL_DestroyCond(changed);
+    SDL_DestroyMutex(mutex);
+}
+
+
+///
+/// \brief Add Slot
+///
+/// Adds a new, empty slot.  The slot starts running once an animation is loaded into it
+/// (see \ref SetAnim), and its first tick is due one tick period after it was added.
+///
+/// \param name     The name of the new slot.
+/// \param size     The cube size of the animations loaded into the slot.
+/// \param tickRate The tick rate of the slot (see TCScheduler::SetRate).
+///
+/// \returns True if the slot was added, false if a slot with the same name exists.
+///
+bool TCSlotEngine::AddSlot(const std::string &name, const byte size[3], double tickRate)
+{
+    SDL_mutexP(mutex);
+    bool added = (FindSlot(name) == NULL);
+    if (added)
+    {
+        slots.push_back(new Slot(name, size, tickRate));
+        SDL_CondBroadcast(changed);
+    }
+    SDL_mutexV(mutex);
+    return added;
+}
+
+
+///
+/// \brief Remove Slot
+///
+/// Removes a slot, and deletes its animation and driver.  If a worker is running the
+/// slot, this method waits until it is done.
+///
+/// \param name The name of the slot.
+///
+/// \returns True if the slot was removed, false if it did not exist.
+///
+bool TCSlotEngine::RemoveSlot(const std::string &name)
+{
+    Slot *slot = LockIdleSlot(name);
+    if (slot == NULL) return false;
+    for (size_t i = 0; i < slots.size(); i++)
+    {
+        if (slots[i] == slot)
+        {
+            slots.erase(slots.begin() + i);
+            break;
+        }
+    }
+    // Any other thread waiting to modify the slot finds it removed once woken, and the
+    // slot is only deleted after they stopped using it.
+    SDL_CondBroadcast(idle);
+    while (slot->numWaiting > 0)
+    {
+        SDL_CondWait(idle, mutex);
+    }
+    SDL_mutexV(mutex);
+    // No worker can find the slot any more, so it can be deleted without the mutex.
+    delete slot->anim;
+    delete slot->driver;
+    delete slot;
+    return true;
+}
+
+
+///
+/// \brief Get Size
+///
+/// \param name The name of the slot.
+/// \param size Set to the cube size of the slot (the size to load its animations with).
+///
+/// \returns True if the slot exists, false otherwise (in which case size is unchanged).
+///
+bool TCSlotEngine::GetSize(const std::string &name, byte size[3])
+{
+    SDL_mutexP(mutex);
+    Slot *slot = FindSlot(name);
+    if (slot != NULL) memcpy(size, slot->size, sizeof(slot->size));
+    SDL_mutexV(mutex);
+    return (slot != NULL);
+}
+
+
+///
+/// \brief Set Animation
+///
+/// Replaces the animation of a slot (deleting the previous one).  If a worker is running
+/// the slot, this method waits until it is done.
+///
+/// \param name    The name of the slot.
+/// \param newAnim The new animation, which must have the slot's size (see \ref GetSize).
+///                The slot takes over the object (which is deleted right away if the slot
+///                does not exist).  If NULL, the slot's animation is just removed.
+///
+/// \returns True if the animation was set, false if the slot did not exist.
+///
+bool TCSlotEngine::SetAnim(const std::string &name, TCAnim *newAnim)
+{
+    Slot *slot = LockIdleSlot(name);
+    if (slot == NULL)
+    {
+        delete newAnim;
+        return false;
+    }
+    TCAnim *oldAnim = slot->anim;
+    slot->anim  = newAnim;
+    slot->ticks = 0;
+    SDL_CondBroadcast(changed);
+    SDL_mutexV(mutex);
+    delete oldAnim;
+    return true;
+}
+
+
+///
+/// \brief Set Driver
+///
+/// Replaces the driver of a slot (deleting the previous one), which is then sent every
+/// frame of the slot.  If a worker is running the slot, this method waits until it is
+/// done.
+///
+/// \param name      The name of the slot.
+/// \param newDriver The new driver (or NULL to remove the slot's driver).  The slot takes
+///                  over the object (which is deleted right away if the slot does not
+///                  exist).
+///
+/// \returns True if the driver was set, false if the slot did not exist.
+///
+bool TCSlotEngine::SetDriver(const std::string &name, TCDriver *newDriver)
+{
+    Slot *slot = LockIdleSlot(name);
+    if (slot == NULL)
+    {
+        delete newDriver;
+        return false;
+    }
+    TCDriver *oldDriver = slot->driver;
+    slot->driver = newDriver;
+    SDL_mutexV(mutex);
+    delete oldDriver;
+    return true;
+}
+
+
+///
+/// \brief Set Tick Rate
+///
+/// Sets the tick rate of a slot (see TCScheduler::SetRate).  This does not wait for a
+/// worker running the slot.
+///
+/// \param name    The name of the slot.
+/// \param newRate The new tick rate (ticks per second).
+///
+/// \returns True if the rate was set, false if the slot did not exist.
+///
+bool TCSlotEngine::SetTickRate(const std::string &name, double newRate)
+{
+    SDL_mutexP(mutex);
+    Slot *slot = FindSlot(name);
+    if (slot != NULL)
+    {
+        slot->scheduler.SetRate(newRate);
+        SDL_CondBroadcast(changed);     // The next deadline may now be sooner.
+    }
+    SDL_mutexV(mutex);
+    return (slot != NULL);
+}
+
+
+///
+/// \brief Set Running
+///
+/// Starts or stops ticking the animation of a slot.
+///
+/// \param name The name of the slot.
+/// \param run  True to tick the slot's animation, false to stop it.
+///
+/// \returns True if the slot was changed, false if it did not exist.
+///
+bool TCSlotEngine::SetRunning(const std::string &name, bool run)
+{
+    SDL_mutexP(mutex);
+    Slot *slot = FindSlot(name);
+    if (slot != NULL)
+    {
+        slot->running = run;
+        SDL_CondBroadcast(changed);
+    }
+    SDL_mutexV(mutex);
+    return (slot != NULL);
+}
+
+
+///
+/// \brief Get Status
+///
+/// Copies the state of every slot, in the order they were added.
+///
+/// \param status Set to the state of each slot (any previous contents are removed).
+///
+void TCSlotEngine::GetStatus(std::vector<TCSlotStatus> &status)
+{
+    status.clear();
+    SDL_mutexP(mutex);
+    for (size_t i = 0; i < slots.size(); i++)
+    {
+        Slot        *slot = slots[i];
+        TCSlotStatus slotStatus;
+        slotStatus.name         = slot->name;
+        memcpy(slotStatus.size, slot->size, sizeof(slot->size));
+        slotStatus.tickRate     = slot->scheduler.GetRate();
+        slotStatus.achievedRate = slot->scheduler.GetAchievedRate();
+        slotStatus.maxLateness  = slot->scheduler.GetMaxLateness();
+        slotStatus.ticks        = slot->ticks;
+        slotStatus.running      = slot->running;
+        slotStatus.hasAnim      = (slot->anim != NULL);
+        slotStatus.hasDriver    = (slot->driver != NULL);
+        status.push_back(slotStatus);
+    }
+    SDL_mutexV(mutex);
+}
+
+
+///
+/// \brief Get Number of Workers
+///
+/// \returns The number of worker threads, which is the most slots run at once.
+///
+int TCSlotEngine::GetNumWorkers()
+{
+    return (int)workers.size();
+}
+
+
+///
+/// \brief Find Slot
+///
+/// \param name The name of the slot.
+///
+/// \returns The slot with the passed name, or NULL if it does not exist.
+///
+/// \remarks The mutex must be held by the caller.
+///
+TCSlotEngine::Slot *TCSlotEngine::FindSlot(const std::string &name)
+{
+    for (size_t i = 0; i < slots.size(); i++)
+    {
+        if (slots[i]->name == name) return slots[i];
+    }
+    return NULL;
+}
+
+
+///
+/// \brief Lock Idle Slot
+///
+/// Locks the mutex, and waits until no worker is running the named slot, so it can be
+/// modified by the caller.  The workers do not start running the slot again while a
+/// thread is waiting for it (otherwise a slot which is always due could be taken again
+/// before the waiting thread gets the mutex).
+///
+/// \param name The name of the slot.
+///
+/// \returns The slot (with the mutex still held, so it must be unlocked by the caller),
+///          or NULL if the slot does not exist (in which case the mutex is unlocked).
+///
+TCSlotEngine::Slot *TCSlotEngine::LockIdleSlot(const std::string &name)
+{
+    SDL_mutexP(mutex);
+    for (;;)
+    {
+        // The slot is found again after each wait, since it may have been removed.
+        Slot *slot = FindSlot(name);
+        if (slot == NULL)
+        {
+            SDL_mutexV(mutex);
+            return NULL;
+        }
+        if (!slot->busy) return slot;
+        slot->numWaiting++;
+        SDL_CondWait(idle, mutex);
+        slot->numWaiting--;
+        // If the slot was removed meanwhile, RemoveSlot waits for us to stop using it.
+        if (slot->numWaiting == 0 && FindSlot(name) != slot) SDL_CondBroadcast(idle);
+    }
+}
+
+
+///
+/// \brief Run Slot
+///
+/// Runs the ticks due for a slot (see TCScheduler::TakeTicks), and sends a frame of the
+/// slot's animation (with its effects applied) to the slot's driver.
+///
+/// \param slot The slot to run, which was marked as busy by the caller (so no other
+///             thread uses it until this method returns).
+///
+/// \remarks This method is called without the mutex held.
+///
+void TCSlotEngine::RunSlot(Slot *slot)
+{
+    unsigned int ticks = slot->scheduler.TakeTicks(TCScheduler::Now());
+    if (ticks == 0) return;
+    for (unsigned int i = 0; i < ticks; i++)
+    {
+        slot->anim->Tick();
+    }
+    if (slot->driver == NULL || slot->driver->HasFailed()) return;
+    TCFrame *frame = new TCFrame(*slot->anim, SDL_GetTicks());
+    if (slot->anim->HasEffects())
+    {
+        TCFrame *processed = new TCFrame(*frame, *slot->anim->GetEffects(),
+                                         slot->anim->GetTicks());
+        frame->Release();
+        frame = processed;
+    }
+    slot->driver->SendFrame(frame);     // The driver releases the frame.
+}
+
+
+///
+/// \brief Run Worker
+///
+/// Repeatedly runs the idle slot whose next tick is due first, or sleeps until it is due
+/// (or until the slots are changed), until the engine is deleted.
+///
+void TCSlotEngine::RunWorker()
+{
+    SDL_mutexP(mutex);
+    while (!quit)
+    {
+        Slot    *next     = NULL;
+        uint64_t deadline = 0;
+        for (size_t i = 0; i < slots.size(); i++)
+        {
+            Slot *slot = slots[i];
+            if (    slot->busy || slot->numWaiting > 0 || !slot->running
+                 || slot->anim == NULL ) continue;
+            uint64_t slotDeadline = slot->scheduler.GetDeadline();
+            if (next == NULL || slotDeadline < deadline)
+            {
+                next     = slot;
+                deadline = slotDeadline;
+            }
+        }
+        uint64_t now = TCScheduler::Now();
+        if (next != NULL && deadline <= now)
+        {
+            next->busy = true;
+            SDL_mutexV(mutex);
+            RunSlot(next);
+            SDL_mutexP(mutex);
+            next->ticks = next->anim->GetTicks();
+            next->busy  = false;
+            SDL_CondBroadcast(idle);
+            continue;
+        }
+        // We sleep until the earliest deadline (rounded up to the next millisecond).
+        Uint32 waitTime = TC_SLOT_MAX_WAIT;
+        if (next != NULL && (deadline - now) / 1000000 < TC_SLOT_MAX_WAIT)
+        {
+            waitTime = (Uint32)((deadline - now) / 1000000) + 1;
+        }
+        SDL_CondWaitTimeout(changed, mutex, waitTime);
+    }
+    SDL_mutexV(mutex);
+}
+
+
+///
+/// \brief Worker Main
+///
+/// The function run by each worker thread.
+///
+/// \param pEngine The engine the worker belongs to.
+///
+/// \returns Unused return value.
+///
+int TCSlotEngine::WorkerMain(void *pEngine)
+{
+    ((TCSlotEngine *)pEngine)->RunWorker();
+    return 0;
+}
@@ -0,0 +1,140 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *                          TCSlotEngine Object  Header File                           *
+ *                                      TRICLYSM                                       *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  This file contains the definition of the TCSlotEngine class as implemented by      *
+ *  the TCSlotEngine.cpp source file.  This class runs several independent             *
+ *  animations, each with its own cube size, tick rate, and driver, on a fixed pool    *
+ *  of worker threads.                                                                 *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  Copyright (C) 2011 Brandon Castellano, Ryan Mantha. All rights reserved.           *
+ *  Triclysm is provided under the BSD-2-Clause license. This program uses the SDL     *
+ *  (Simple DirectMedia Layer) library, and the Lua scripting language. See the        *
+ *  included LICENSE file or <http://www.triclysm.com/> for more details.              *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+///
+/// \file  TCSlotEngine.h
+/// \brief This file contains the definition of the TCSlotEngine class as implemented by
+///        the TCSlotEngine.cpp source file.
+///
+
+#pragma once
+#ifndef TC_SLOT_ENGINE_
+#define TC_SLOT_ENGINE_
+
+#include "TCAnim.h"
+#include "TCDriver.h"
+#include "TCScheduler.h"        // Decides when each slot's next tick is due.
+#include "SDL.h"
+#include "SDL_thread.h"         // Used for the worker threads and their mutex.
+#include <string>
+#include <vector>
+
+#define TC_SLOT_MAX_WAIT 50     ///< Longest time an idle worker sleeps (in milliseconds).
+
+
+///
+/// \brief Animation Slot Status
+///
+/// A copy of the state of one slot (see TCSlotEngine::GetStatus).
+///
+struct TCSlotStatus
+{
+    std::string  name;          ///< The name of the slot.
+    byte         size[3];       ///< The cube size of the slot.
+    double       tickRate,      ///< The requested tick rate (ticks per second).
+                 achievedRate,  ///< The tick rate achieved over the last second.
+                 maxLateness;   ///< Longest time a tick was late (in milliseconds).
+    unsigned int ticks;         ///< Ticks of the slot's animation after its last update.
+    bool         running,       ///< True if the slot's animation is being ticked.
+                 hasAnim,       ///< True if an animation is loaded in the slot.
+                 hasDriver;     ///< True if a driver is loaded in the slot.
+};
+
+
+///
+/// \brief Triclysm Animation Slot Engine Object
+///
+/// This class owns any number of named slots, each holding an animation, the cube size
+/// it was loaded with, its own tick scheduler, and optionally a driver (e.g. one slot for
+/// each physical cube).  A fixed number of worker threads run the slots: each worker
+/// takes the idle slot whose next tick is due first, runs its due ticks, and sends the
+/// resulting frame to the slot's driver.  Since a slot is only run by one worker at a
+/// time, animations and drivers need no locks for their own state, and a slow slot only
+/// delays the other slots if every worker is busy.
+///
+/// \remarks The slots are independent of the current animation (currAnim), which is
+///          still run by the animation thread and drawn on the screen.  Slot drivers are
+///          always sent every frame (see TCDriver::SendFrame), even if they were created
+///          with a poll rate, without the driver mutex (so they may not change any
+///          globals), and are no longer sent frames once they fail (TCDriver::HasFailed).
+///          Workers wake up with a precision of one millisecond.
+///
+/// \see TCScheduler | GetSlotEngine
+///
+class TCSlotEngine
+{
+  public:
+    TCSlotEngine(int numWorkers = 0);   // Starts the workers (0 for one per processor).
+    ~TCSlotEngine();                    // Stops the workers, and deletes every slot.
+
+    // Slot methods (each returns false if there is no slot with the passed name):
+    bool AddSlot(const std::string &name, const byte size[3], double tickRate);
+    bool RemoveSlot(const std::string &name);
+    bool GetSize(const std::string &name, byte size[3]);
+    bool SetAnim(const std::string &name, TCAnim *newAnim);        // Takes over newAnim.
+    bool SetDriver(const std::string &name, TCDriver *newDriver);  // Takes over newDriver.
+    bool SetTickRate(const std::string &name, double newRate);
+    bool SetRunning(const std::string &name, bool run);
+
+    void GetStatus(std::vector<TCSlotStatus> &status);  // Copies the state of each slot.
+    int  GetNumWorkers();                               // Number of worker threads.
+
+  private:
+    /// \brief A named animation, with its own size, scheduler, and driver.
+    struct Slot
+    {
+        Slot(const std::string &slotName, const byte slotSize[3], double tickRate);
+
+        std::string  name;          ///< The name the slot is addressed by.
+        byte         size[3];       ///< The size of the animations loaded in the slot.
+        TCAnim      *anim;          ///< The slot's animation (or NULL).
+        TCDriver    *driver;        ///< The slot's driver (or NULL).
+        TCScheduler  scheduler;     ///< Decides when the slot's next tick is due.
+        unsigned int ticks;         ///< Ticks of the animation after it was last run.
+        int          numWaiting;    ///< Threads waiting for the slot (see LockIdleSlot).
+        bool         running,       ///< True if the animation should be ticked.
+                     busy;          ///< True while a worker runs the slot.
+    };
+
+    TCSlotEngine(const TCSlotEngine &);     // Not implemented.
+
+    // Returns the slot with the passed name, or NULL (the mutex must be held).
+    Slot *FindSlot(const std::string &name);
+    // Locks the mutex, and waits until the named slot is idle.  If there is no such slot,
+    // NULL is returned (and the mutex is unlocked again).
+    Slot *LockIdleSlot(const std::string &name);
+    // Runs the ticks due for a slot, and sends the new frame to its driver.
+    void RunSlot(Slot *slot);
+    // The main loop of each worker thread.
+    void RunWorker();
+    // The main function of each worker thread (passed the engine).
+    static int WorkerMain(void *pEngine);
+
+    std::vector<Slot *>       slots;    ///< Every slot, in the order they were added.
+    std::vector<SDL_Thread *> workers;  ///< The worker threads.
+    SDL_mutex   *mutex;                 ///< Protects the slots (except a busy slot's).
+    SDL_cond    *changed,               ///< Signalled when the workers should look again.
+                *idle;                  ///< Signalled when a worker is done with a slot.
+    bool         quit;                  ///< Set to stop the worker threads.
+};
+
+
+#endif
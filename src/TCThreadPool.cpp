@@ -0,0 +1,371 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *                          TCThreadPool Object  Source Code                           *
+ *                                      TRICLYSM                                       *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  This file contains the implementation of the TCThreadPool class as defined by the  *
+ *  TCThreadPool.h header file.  This class runs the independent parts of a task       *
+ *  (e.g. the slices of a cube) on several threads at once, and waits for all of them. *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  Copyright (C) 2011 Brandon Castellano, Ryan Mantha. All rights reserved.           *
+ *  Triclysm is provided under the BSD-2-Clause license. This program uses the SDL     *
+ *  (Simple DirectMedia Layer) library, and the Lua scripting language. See the        *
+ *  included LICENSE file or <http://www.triclysm.com/> for more details.              *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+///
+/// \file  TCThreadPool.cpp
+/// \brief This file contains the implementation of the TCThreadPool class as defined by
+///        the TCThreadPool.h header file.
+///
+
+#include "TCThreadPool.h"
+#include <cstdlib>          // Used for pointer NULL define value, and posix_memalign.
+#include <cassert>          // Used to check the number of chunks in a task.
+#include <unistd.h>         // Used for the sysconf function.
+
+TCThreadPool *TCThreadPool::shared = NULL;
+
+// Packs the first chunk and one past the last chunk of a range into its bounds (and the
+// other way around), so both ends of a range are changed with a single atomic operation.
+#define TC_RANGE(first, last)  (((uint64_t)(first) << 32) | (uint32_t)(last))
+#define TC_RANGE_FIRST(bounds) ((uint32_t)((bounds) >> 32))
+#define TC_RANGE_LAST(bounds)  ((uint32_t)(bounds))
+
+
+///
+/// \brief Thread Pool Constructor
+///
+/// Creates the mutex and condition variables, and starts the worker threads (which wait
+/// until a task is passed to \ref Run).
+///
+/// \param numWorkers The number of worker threads (in addition to the thread calling
+///                   Run).  If 0, every task is run on the calling thread.
+///
+TCThreadPool::TCThreadPool(int numWorkers)
+{
+    mutex      = SDL_CreateMutex();
+    taskCond   = SDL_CreateCond();
+    doneCond   = SDL_CreateCond();
+    pFirstTask = pLastTask = NULL;
+    numStarted = 0;
+    quit       = false;
+    // The workers take their index (the range they start each task with) once they are
+    // running, so the threads are all created before any of them uses the vector.
+    SDL_mutexP(mutex);
+    for (int i = 0; i < numWorkers; i++)
+    {
+        SDL_Thread *worker = SDL_CreateThread(WorkerMain, this);
+        if (worker == NULL) break;      // Tasks just use fewer threads.
+        workers.push_back(worker);
+    }
+    SDL_mutexV(mutex);
+}
+
+
+///
+/// \brief Destructor
+///
+/// Stops the worker threads (waiting for each of them to exit), and destroys the mutex
+/// and condition variables.  No task may be running.
+///
+TCThreadPool::~TCThreadPool()
+{
+    SDL_mutexP(mutex);
+    assert(pFirstTask == NULL);
+    quit = true;
+    SDL_CondBroadcast(taskCond);
+    SDL_mutexV(mutex);
+    for (size_t i = 0; i < workers.size(); i++)
+    {
+        SDL_WaitThread(workers[i], NULL);
+    }
+    SDL_DestroyCond(doneCond);
+    SDL_DestroyCond(taskCond);
+    SDL_DestroyMutex(mutex);
+}
+
+
+///
+/// \brief Run
+///
+/// Calls the passed function on every item of a task, and waits until all of them were
+/// processed.  The items are split into chunks of grain items, and each thread (the
+/// workers which join the task, and the calling thread) starts with an equal share of
+/// the chunks, stealing more from the other threads once it runs out.
+///
+/// \param func  The function processing a range of items.
+/// \param pData The data passed to each call of func.
+/// \param count The number of items in the task.
+/// \param grain The number of items in each chunk (more items per chunk reduce the
+///              overhead of small items, but may leave some threads idle).
+///
+/// \remarks This may be called by several threads at once, and by the task function
+///          itself (the calling thread always works on its own task until it is done).
+///
+void TCThreadPool::Run(TCTaskFunc func, void *pData, size_t count, size_t grain)
+{
+    if (grain == 0) grain = 1;
+    // Small tasks use the calling thread only.
+    if (workers.empty() || count <= grain)
+    {
+        if (count > 0) func(pData, 0, count);
+        return;
+    }
+    size_t numChunks  = (count - 1) / grain + 1;
+    int    numThreads = GetNumThreads();
+    assert(numChunks <= 0xFFFFFFFFu);
+    Task task;
+    task.func     = func;
+    task.pData    = pData;
+    task.count    = count;
+    task.grain    = grain;
+    void *pRanges = NULL;
+    if (posix_memalign(&pRanges, TC_POOL_LINE, numThreads * sizeof(Range)) != 0)
+    {
+        func(pData, 0, count);          // Without memory for the ranges, run it here.
+        return;
+    }
+    task.ranges   = (Range *)pRanges;
+    task.numUsers = 1;                  // The calling thread.
+    task.open     = true;
+    task.pNext    = NULL;
+    for (int i = 0; i < numThreads; i++)
+    {
+        task.ranges[i].bounds = TC_RANGE(numChunks * i / numThreads,
+                                         numChunks * (i + 1) / numThreads);
+    }
+    SDL_mutexP(mutex);
+    if (pLastTask != NULL) pLastTask->pNext = &task;
+    else                   pFirstTask       = &task;
+    pLastTask = &task;
+    SDL_CondBroadcast(taskCond);
+    SDL_mutexV(mutex);
+    // The calling thread uses the last range, and then waits for the workers which are
+    // still processing a chunk (the task stays in the list until then, but is closed).
+    RunTask(task, numThreads - 1);
+    SDL_mutexP(mutex);
+    task.open = false;
+    task.numUsers--;
+    while (task.numUsers > 0)
+    {
+        SDL_CondWait(doneCond, mutex);
+    }
+    Task **ppTask = &pFirstTask, *pPrev = NULL;
+    while (*ppTask != &task)
+    {
+        pPrev  = *ppTask;
+        ppTask = &pPrev->pNext;
+    }
+    *ppTask = task.pNext;
+    if (pLastTask == &task) pLastTask = pPrev;
+    SDL_mutexV(mutex);
+    free(task.ranges);
+}
+
+
+///
+/// \brief Get Number of Threads
+///
+/// \returns The number of threads a task passed to \ref Run is split across (the worker
+///          threads, and the thread calling Run).
+///
+int TCThreadPool::GetNumThreads()
+{
+    return (int)workers.size() + 1;
+}
+
+
+///
+/// \brief Get Shared Pool
+///
+/// Gets the pool shared by the whole program, creating it on the first call with one
+/// worker thread for each processor after the first (which runs the calling thread).
+///
+/// \returns A pointer to the shared pool.
+///
+/// \remarks If the first call is made by several threads at once (e.g. the workers of a
+///          TCSlotEngine), only one of the pools they create is kept.
+///
+TCThreadPool *TCThreadPool::GetShared()
+{
+    TCThreadPool *pool = __atomic_load_n(&shared, __ATOMIC_ACQUIRE);
+    if (pool == NULL)
+    {
+        long numCpus = sysconf(_SC_NPROCESSORS_ONLN);
+        TCThreadPool *newPool = new TCThreadPool((numCpus > 1) ? (int)numCpus - 1 : 0);
+        if (__atomic_compare_exchange_n(&shared, &pool, newPool, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            pool = newPool;
+        }
+        else delete newPool;            // pool now holds the one created first.
+    }
+    return pool;
+}
+
+
+///
+/// \brief Close Shared Pool
+///
+/// Stops the threads of the shared pool (if it was created).  A new pool is created by
+/// the next call to \ref GetShared.  No thread may be using the shared pool.
+///
+void TCThreadPool::CloseShared()
+{
+    delete shared;
+    shared = NULL;
+}
+
+
+///
+/// \brief Run Task
+///
+/// Processes the chunks of the passed thread's range in order, and then the chunks it
+/// steals from the other threads, until no chunks are left in any range.
+///
+/// \param task The task to process.
+/// \param self The index of the range of this thread.
+///
+void TCThreadPool::RunTask(Task &task, int self)
+{
+    uint32_t chunk;
+    while (TakeChunk(task.ranges[self], chunk) || StealChunks(task, self, chunk))
+    {
+        size_t first = chunk * task.grain,
+               last  = first + task.grain;
+        task.func(task.pData, first, (last < task.count) ? last : task.count);
+    }
+}
+
+
+///
+/// \brief Take Chunk
+///
+/// Removes the first chunk from the passed range.
+///
+/// \param range The range to take the chunk from.
+/// \param chunk Set to the index of the chunk taken.
+///
+/// \returns True if a chunk was taken, false if the range is empty.
+///
+bool TCThreadPool::TakeChunk(Range &range, uint32_t &chunk)
+{
+    uint64_t bounds = __atomic_load_n(&range.bounds, __ATOMIC_ACQUIRE);
+    do
+    {
+        if (TC_RANGE_FIRST(bounds) >= TC_RANGE_LAST(bounds)) return false;
+        chunk = TC_RANGE_FIRST(bounds);
+    }
+    while (!__atomic_compare_exchange_n(&range.bounds, &bounds,
+                                        TC_RANGE(chunk + 1, TC_RANGE_LAST(bounds)), true,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+    return true;
+}
+
+
+///
+/// \brief Steal Chunks
+///
+/// Looks through the ranges of the other threads (starting after this thread's own),
+/// and takes the second half of the first range which is not empty.  The first chunk
+/// taken is returned, and the rest are placed in this thread's (empty) range, where the
+/// other threads can steal them again.
+///
+/// \param task  The task to steal the chunks from.
+/// \param self  The index of the range of this thread (which must be empty).
+/// \param chunk Set to the index of the first chunk stolen.
+///
+/// \returns True if any chunks were stolen, false if every range is empty.
+///
+/// \remarks The values of a range never repeat (the chunks are only ever taken once), so
+///          a compare-and-swap of its bounds can not succeed on an outdated value.
+///
+bool TCThreadPool::StealChunks(Task &task, int self, uint32_t &chunk)
+{
+    int numThreads = GetNumThreads();
+    for (int i = 1; i < numThreads; i++)
+    {
+        Range   &victim = task.ranges[(self + i) % numThreads];
+        uint64_t bounds = __atomic_load_n(&victim.bounds, __ATOMIC_ACQUIRE);
+        uint32_t first, last, half = 0;
+        do
+        {
+            first = TC_RANGE_FIRST(bounds);
+            last  = TC_RANGE_LAST(bounds);
+            if (first >= last) break;
+            half  = (last - first + 1) / 2;
+        }
+        while (!__atomic_compare_exchange_n(&victim.bounds, &bounds,
+                                            TC_RANGE(first, last - half), true,
+                                            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+        if (first >= last) continue;
+        chunk = last - half;
+        __atomic_store_n(&task.ranges[self].bounds, TC_RANGE(chunk + 1, last),
+                         __ATOMIC_RELEASE);
+        return true;
+    }
+    return false;
+}
+
+
+///
+/// \brief Find Open Task
+///
+/// \returns The oldest task in the list which is still open, or NULL if there is none.
+///          The mutex must be locked by the calling thread.
+///
+TCThreadPool::Task *TCThreadPool::FindOpenTask()
+{
+    Task *pTask = pFirstTask;
+    while (pTask != NULL && !pTask->open)
+    {
+        pTask = pTask->pNext;
+    }
+    return pTask;
+}
+
+
+///
+/// \brief Worker Main
+///
+/// The function run by each worker thread.  While any task is open, the worker joins
+/// the oldest one, and processes its chunks (starting with the range of the worker's
+/// index).  Once no chunks are left, the task is closed, and the thread running it is
+/// signalled if this was its last worker.
+///
+/// \param pPool A pointer to the TCThreadPool object.
+///
+/// \returns Unused return value.
+///
+int TCThreadPool::WorkerMain(void *pPool)
+{
+    TCThreadPool *pool = (TCThreadPool *)pPool;
+    SDL_mutexP(pool->mutex);
+    int   index = pool->numStarted++;
+    Task *pTask;
+    while (true)
+    {
+        while (!pool->quit && (pTask = pool->FindOpenTask()) == NULL)
+        {
+            SDL_CondWait(pool->taskCond, pool->mutex);
+        }
+        if (pool->quit) break;
+        pTask->numUsers++;
+        SDL_mutexV(pool->mutex);
+        pool->RunTask(*pTask, index);
+        SDL_mutexP(pool->mutex);
+        pTask->open = false;
+        if (--pTask->numUsers == 0)
+        {
+            SDL_CondBroadcast(pool->doneCond);
+        }
+    }
+    SDL_mutexV(pool->mutex);
+    return 0;
+}
@@ -0,0 +1,132 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *                          TCThreadPool Object  Header File                           *
+ *                                      TRICLYSM                                       *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  This file contains the definition of the TCThreadPool class as implemented by the  *
+ *  TCThreadPool.cpp source file.  This class runs the independent parts of a task     *
+ *  (e.g. the slices of a cube) on several threads at once, and waits for all of them. *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  Copyright (C) 2011 Brandon Castellano, Ryan Mantha. All rights reserved.           *
+ *  Triclysm is provided under the BSD-2-Clause license. This program uses the SDL     *
+ *  (Simple DirectMedia Layer) library, and the Lua scripting language. See the        *
+ *  included LICENSE file or <http://www.triclysm.com/> for more details.              *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+///
+/// \file  TCThreadPool.h
+/// \brief This file contains the definition of the TCThreadPool class as implemented by
+///        the TCThreadPool.cpp source file.
+///
+
+#pragma once
+#ifndef TC_THREAD_POOL_
+#define TC_THREAD_POOL_
+
+#include "SDL.h"
+#include "SDL_thread.h"         // Used for the worker threads and their mutex.
+#include <cstddef>              // Used for the size_t type.
+#include <stdint.h>             // Used for the uint32_t and uint64_t types.
+#include <vector>               // Used to hold the worker threads.
+
+#define TC_POOL_LINE 64         ///< Cache line size (each thread's range is on its own).
+
+///
+/// \brief Task Function
+///
+/// A function run by \ref TCThreadPool::Run on a range of the task's items.
+///
+/// \param pData The data passed to TCThreadPool::Run.
+/// \param first The first item to process.
+/// \param last  One past the last item to process.
+///
+typedef void (*TCTaskFunc)(void *pData, size_t first, size_t last);
+
+
+///
+/// \brief Triclysm Thread Pool Object
+///
+/// This class holds a fixed number of worker threads, which wait until a task is passed
+/// to \ref Run.  The chunks of the task are split evenly between the workers and the
+/// calling thread, and each thread takes its own chunks in order.  A thread which runs
+/// out of chunks steals half of the chunks left to another thread (from the end of its
+/// range), so the threads stay busy even if some of the chunks take longer than others.
+/// Run only returns once every item was processed (so a task may write its results
+/// anywhere, as long as each item writes to a different place).
+///
+/// \remarks Several tasks can run at once (e.g. the animation slots of TCSlotEngine, or
+///          a task which calls Run itself), in which case the idle workers join the
+///          oldest task with chunks left.  Which thread processes an item depends on the
+///          timing of the threads, so tasks must not depend on it (the results are the
+///          same as long as each item only writes to its own place).
+///
+class TCThreadPool
+{
+  public:
+    TCThreadPool(int numWorkers);   // Starts the worker threads.
+    ~TCThreadPool();                // Waits for the worker threads to finish.
+
+    // Calls func on every item from 0 to count, grain items at a time:
+    void Run(TCTaskFunc func, void *pData, size_t count, size_t grain = 1);
+    int  GetNumThreads();           // Number of threads running a task (with the caller).
+
+    static TCThreadPool *GetShared();   // The pool shared by the whole program.
+    static void          CloseShared(); // Stops the shared pool's threads.
+
+  private:
+    /// \brief The chunks left to one thread of a task, padded to a cache line.
+    ///
+    /// The ranges of a task are allocated aligned to TC_POOL_LINE bytes (see Run), so
+    /// each thread's range is on a cache line of its own.
+    struct Range
+    {
+        uint64_t bounds;                    ///< First chunk (high 32 bits), and one past
+                                            ///  the last chunk (low 32 bits).
+        char     pad[TC_POOL_LINE - 8];     ///< Pads the range to a whole cache line.
+    };
+
+    /// \brief A task passed to Run, which the workers can join while it has chunks left.
+    struct Task
+    {
+        TCTaskFunc func;        ///< The function processing each chunk.
+        void      *pData;       ///< The data passed to func.
+        size_t     count,       ///< The number of items in the task.
+                   grain;       ///< The number of items in each chunk.
+        Range     *ranges;      ///< The chunks left to each thread (see GetNumThreads).
+        int        numUsers;    ///< Threads working on the task (protected by mutex).
+        bool       open;        ///< False once a thread found no chunks left.
+        Task      *pNext;       ///< The next (newer) task in the list.
+    };
+
+    TCThreadPool(const TCThreadPool &);     // Not implemented.
+
+    // Processes chunks of the passed task (using the range of thread self) until none
+    // are left to take or steal.
+    void RunTask(Task &task, int self);
+    // Takes the first chunk of a range, or steals half of another thread's chunks.
+    static bool TakeChunk(Range &range, uint32_t &chunk);
+    bool        StealChunks(Task &task, int self, uint32_t &chunk);
+    // Returns the oldest task which is still open (or NULL).  The mutex must be locked.
+    Task *FindOpenTask();
+    // The main function of each worker thread (passed the pool).
+    static int WorkerMain(void *pPool);
+
+    std::vector<SDL_Thread *> workers;  ///< The worker threads.
+    SDL_mutex   *mutex;                 ///< Protects the variables below.
+    SDL_cond    *taskCond,              ///< Signalled when a task (or quit) is posted.
+                *doneCond;              ///< Signalled when a task has no users left.
+    Task        *pFirstTask,            ///< The oldest running task (or NULL).
+                *pLastTask;             ///< The newest running task (or NULL).
+    int          numStarted;            ///< Workers which have taken their index.
+    bool         quit;                  ///< Set to stop the worker threads.
+
+    static TCThreadPool *shared;        ///< The pool returned by GetShared (or NULL).
+};
+
+
+#endif
@@ -0,0 +1,315 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *                           TCToneMap Object  Source Code                             *
+ *                                      TRICLYSM                                       *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  This file contains the implementation of the TCToneMap class as defined by the     *
+ *  TCToneMap.h header file.  This class converts the colors of a frame to the         *
+ *  brightness levels sent to a device (or drawn on the screen), applying the output   *
+ *  gain and gamma, and quantizing each color to the number of bits the device uses.   *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  Copyright (C) 2011 Brandon Castellano, Ryan Mantha. All rights reserved.           *
+ *  Triclysm is provided under the BSD-2-Clause license. This program uses the SDL     *
+ *  (Simple DirectMedia Layer) library, and the Lua scripting language. See the        *
+ *  included LICENSE file or <http://www.triclysm.com/> for more details.              *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+///
+/// \file  TCToneMap.cpp
+/// \brief This file contains the implementation of the TCToneMap class as defined by the
+///        TCToneMap.h header file.
+///
+
+#include "TCToneMap.h"
+#include "cube_kernels.h"   // Used for the averaging and quantization kernels.
+#include <cassert>          // Used to validate the output arguments.
+#include <cmath>            // Used for the pow function.
+
+float        TCToneMap::gain    = 1.0f;
+float        TCToneMap::gamma   = 1.0f;
+unsigned int TCToneMap::version = 1;
+
+
+///
+/// \brief Tone Map Constructor
+///
+/// Creates a tone map without any output (the level tables are built by the first call
+/// to \ref Map).
+///
+TCToneMap::TCToneMap()
+{
+    levelTint[0] = levelTint[1] = levelTint[2] = 1.0f;
+    levelVersion = 0;
+}
+
+
+///
+/// \brief Map
+///
+/// Converts each voxel of the passed frame to the levels of the requested output colors,
+/// which can then be read with \ref GetOutput.
+///
+/// \param frame     The frame to map.
+/// \param outColors The number of output colors, either 1 (the brightness of each voxel)
+///                  or 3 (the red, green, and blue levels of each voxel).
+/// \param bits      The number of bits of each output level (from 1 to 8).
+/// \param pTint     An optional array of 3 scales for the red, green, and blue outputs
+///                  (e.g. the LED color used for animations without RGB colors).  Only
+///                  used if outColors is 3.
+///
+/// \remarks A voxel which is on in an animation without any colors has full brightness.
+///
+void TCToneMap::Map(const TCFrame &frame, byte outColors, byte bits, const float *pTint)
+{
+    assert(outColors == 1 || outColors == 3);
+    assert(bits >= 1 && bits <= 8);
+    static const float noTint[3] = { 1.0f, 1.0f, 1.0f };
+    UpdateLevels((outColors == 3 && pTint != NULL) ? pTint : noTint);
+    if (frame.GetPalette() != NULL)
+    {
+        MapPalette(frame, outColors, bits);
+        return;
+    }
+
+    size_t numVoxels = frame.GetSize(TC_X_AXIS) * frame.GetStride(TC_X_AXIS);
+    byte   numColors = frame.GetNumColors();
+    for (byte c = 0; c < 3; c++)
+    {
+        linear[c].resize(numVoxels);
+    }
+    // First, each voxel is converted to a 16-bit level with the tables (each output
+    // color uses its own table, since the tint may differ between them).
+    const uint32_t *pColors = frame.GetColorData();
+    if (numColors == 3)
+    {
+        for (byte c = 0; c < 3; c++)
+        {
+            const uint16_t *pLevels = levels[(outColors == 3) ? c : 0];
+            uint16_t       *pLinear = &linear[c][0];
+            if (pColors != NULL)
+            {
+                int shift = 16 - 8 * c;     // The color's byte in each 0xRRGGBB value.
+                for (size_t i = 0; i < numVoxels; i++)
+                {
+                    pLinear[i] = pLevels[(pColors[i] >> shift) & 0xFF];
+                }
+            }
+            else
+            {
+                const byte *pData = frame.GetData(c);
+                for (size_t i = 0; i < numVoxels; i++)
+                {
+                    pLinear[i] = pLevels[pData[i]];
+                }
+            }
+        }
+    }
+    else
+    {
+        const byte *pData = frame.GetData(0);
+        for (byte c = 0; c < outColors; c++)
+        {
+            const uint16_t *pLevels = levels[c];
+            uint16_t       *pLinear = &linear[c][0];
+            if (numColors == 0)
+            {
+                for (size_t i = 0; i < numVoxels; i++)
+                {
+                    pLinear[i] = pLevels[(pData[i] != 0x00) ? 0xFF : 0x00];
+                }
+            }
+            else
+            {
+                for (size_t i = 0; i < numVoxels; i++)
+                {
+                    pLinear[i] = pLevels[pData[i]];
+                }
+            }
+        }
+    }
+    // Next, an RGB frame mapped to a single color uses the average of the three levels.
+    if (numColors == 3 && outColors == 1)
+    {
+        TC_Kernels::Average(&linear[0][0], &linear[0][0], &linear[1][0], &linear[2][0],
+                            numVoxels);
+    }
+    // Finally, each level is rounded to the requested number of bits.
+    for (byte c = 0; c < outColors; c++)
+    {
+        output[c].resize(numVoxels);
+        TC_Kernels::Quantize(&output[c][0], &linear[c][0], (uint16_t)((1 << bits) - 1),
+                             numVoxels);
+    }
+}
+
+
+///
+/// \brief Map Palette
+///
+/// Performs the same passes as \ref Map on each palette color of a frame (see
+/// TCFrame::GetPalette), and then sets the output of each voxel to the mapped color of
+/// its palette index, so each output color only takes one lookup per voxel.
+///
+/// \param frame     The frame to map (which must have a palette).
+/// \param outColors The number of output colors (1 or 3).
+/// \param bits      The number of bits of each output level (from 1 to 8).
+///
+/// \remarks The level tables must already be up to date (see \ref UpdateLevels).
+///
+void TCToneMap::MapPalette(const TCFrame &frame, byte outColors, byte bits)
+{
+    const uint32_t *pPalette = frame.GetPalette();
+    uint16_t entryLinear[3][TC_PALETTE_SIZE];
+    byte     entryOutput[3][TC_PALETTE_SIZE];
+    for (byte c = 0; c < 3; c++)
+    {
+        const uint16_t *pLevels = levels[(outColors == 3) ? c : 0];
+        int shift = 16 - 8 * c;     // The color's byte in each 0xRRGGBB value.
+        for (int i = 0; i < TC_PALETTE_SIZE; i++)
+        {
+            entryLinear[c][i] = pLevels[(pPalette[i] >> shift) & 0xFF];
+        }
+    }
+    if (outColors == 1)
+    {
+        TC_Kernels::Average(entryLinear[0], entryLinear[0], entryLinear[1], entryLinear[2],
+                            TC_PALETTE_SIZE);
+    }
+    size_t      numVoxels = frame.GetSize(TC_X_AXIS) * frame.GetStride(TC_X_AXIS);
+    const byte *pIndex    = frame.GetIndexData();
+    for (byte c = 0; c < outColors; c++)
+    {
+        TC_Kernels::Quantize(entryOutput[c], entryLinear[c], (uint16_t)((1 << bits) - 1),
+                             TC_PALETTE_SIZE);
+        output[c].resize(numVoxels);
+        byte       *pOutput  = &output[c][0];
+        const byte *pEntries = entryOutput[c];
+        for (size_t i = 0; i < numVoxels; i++)
+        {
+            pOutput[i] = pEntries[pIndex[i]];
+        }
+    }
+}
+
+
+///
+/// \brief Get Output
+///
+/// \param color The output color to get (0 if a single output color was mapped).
+///
+/// \returns A pointer to the output level of each voxel of the last mapped frame, in the
+///          same order as the frame's voxel buffers (see TCFrame::GetStride).
+///
+const byte *TCToneMap::GetOutput(byte color) const
+{
+    assert(color < 3 && !output[color].empty());
+    return &output[color][0];
+}
+
+
+///
+/// \brief Update Levels
+///
+/// Builds the level table of each output color, if the gain, gamma, or passed tint have
+/// changed since the tables were last built.
+///
+/// \param tint The scale of each output color (1.0 for no tint).
+///
+void TCToneMap::UpdateLevels(const float tint[3])
+{
+    unsigned int currVersion = GetSettingsVersion();
+    if (    currVersion == levelVersion && tint[0] == levelTint[0]
+         && tint[1] == levelTint[1] && tint[2] == levelTint[2] )
+    {
+        return;
+    }
+    float currGain  = GetGain(),
+          currGamma = GetGamma();
+    for (byte c = 0; c < 3; c++)
+    {
+        for (int v = 0; v < 256; v++)
+        {
+            float level = currGain * tint[c] * powf(v / 255.0f, currGamma) * 65535.0f;
+            if (level < 0.0f)     level = 0.0f;
+            if (level > 65535.0f) level = 65535.0f;
+            levels[c][v] = (uint16_t)(level + 0.5f);
+        }
+        levelTint[c] = tint[c];
+    }
+    levelVersion = currVersion;
+}
+
+
+///
+/// \brief Set Gain
+///
+/// Sets the scale applied to the level of every color (e.g. 0.5 to halve the brightness
+/// of the cube).  Levels above full brightness are clamped.
+///
+/// \param newGain The new gain (must not be negative).
+///
+void TCToneMap::SetGain(float newGain)
+{
+    assert(newGain >= 0.0f);
+    __atomic_store(&gain, &newGain, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&version, 1, __ATOMIC_RELEASE);
+}
+
+
+///
+/// \brief Set Gamma
+///
+/// Sets the exponent applied to the level of every color (e.g. 2.2 to correct for the
+/// non-linear brightness of the LEDs).
+///
+/// \param newGamma The new gamma (must be greater than zero).
+///
+void TCToneMap::SetGamma(float newGamma)
+{
+    assert(newGamma > 0.0f);
+    __atomic_store(&gamma, &newGamma, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&version, 1, __ATOMIC_RELEASE);
+}
+
+
+///
+/// \brief Get Gain
+///
+/// \returns The current output gain (see \ref SetGain).
+///
+float TCToneMap::GetGain()
+{
+    float toReturn;
+    __atomic_load(&gain, &toReturn, __ATOMIC_RELAXED);
+    return toReturn;
+}
+
+
+///
+/// \brief Get Gamma
+///
+/// \returns The current output gamma (see \ref SetGamma).
+///
+float TCToneMap::GetGamma()
+{
+    float toReturn;
+    __atomic_load(&gamma, &toReturn, __ATOMIC_RELAXED);
+    return toReturn;
+}
+
+
+///
+/// \brief Get Settings Version
+///
+/// \returns A number which is incremented every time the gain or gamma is changed, so
+///          drivers can tell if a frame they already encoded needs to be encoded again.
+///
+unsigned int TCToneMap::GetSettingsVersion()
+{
+    return __atomic_load_n(&version, __ATOMIC_ACQUIRE);
+}
@@ -0,0 +1,93 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *                           TCToneMap Object  Header File                             *
+ *                                      TRICLYSM                                       *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  This file contains the definition of the TCToneMap class as implemented by the     *
+ *  TCToneMap.cpp source file.  This class converts the colors of a frame to the       *
+ *  brightness levels sent to a device (or drawn on the screen), applying the output   *
+ *  gain and gamma, and quantizing each color to the number of bits the device uses.   *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  Copyright (C) 2011 Brandon Castellano, Ryan Mantha. All rights reserved.           *
+ *  Triclysm is provided under the BSD-2-Clause license. This program uses the SDL     *
+ *  (Simple DirectMedia Layer) library, and the Lua scripting language. See the        *
+ *  included LICENSE file or <http://www.triclysm.com/> for more details.              *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+///
+/// \file  TCToneMap.h
+/// \brief This file contains the definition of the TCToneMap class as implemented by the
+///        TCToneMap.cpp source file.
+///
+
+#pragma once
+#ifndef TC_TONE_MAP_
+#define TC_TONE_MAP_
+
+#include "TCFrame.h"
+#include <vector>               // Used to hold the levels and output of each color.
+#include <stdint.h>             // Used for the uint16_t type.
+
+
+///
+/// \brief Triclysm Tone Map Object
+///
+/// This class is the output stage shared by the drivers and the renderer.  Each frame is
+/// mapped once, in three passes over the whole frame:
+///
+///   1. Each color is converted to a 16-bit level with a table built from the output
+///      gain and gamma (and the per-color tint passed to \ref Map).
+///   2. If a single output color is requested from an RGB frame, the three levels are
+///      averaged (see TC_Kernels::Average).
+///   3. Each level is rounded to the requested number of bits (see TC_Kernels::Quantize).
+///
+/// The 16-bit levels keep the precision lost by truncating each 8-bit color separately
+/// (e.g. the average of an RGB voxel is rounded once, after the gamma is applied).  For
+/// frames of animations in the palette mode, the passes are only performed on the
+/// palette colors, and each voxel is then mapped with one lookup of its index.
+///
+/// \remarks The gain and gamma are shared by every TCToneMap object, but each thread
+///          needs its own object, since the output buffers are stored in the object.
+///
+class TCToneMap
+{
+  public:
+    TCToneMap();
+
+    // Maps each voxel of the frame to outColors colors (1 or 3) of the passed bits each:
+    void        Map(const TCFrame &frame, byte outColors, byte bits,
+                    const float *pTint = NULL);
+    const byte *GetOutput(byte color) const;    // Output of a color (same order as frame).
+
+    // Output settings (shared by every TCToneMap object):
+    static void         SetGain(float newGain);
+    static void         SetGamma(float newGamma);
+    static float        GetGain();
+    static float        GetGamma();
+    static unsigned int GetSettingsVersion();   // Incremented when a setting changes.
+
+  private:
+    // Re-builds the level tables if the settings or tint changed since the last build.
+    void UpdateLevels(const float tint[3]);
+    // Maps a frame with a palette, by mapping the palette colors first (see Map).
+    void MapPalette(const TCFrame &frame, byte outColors, byte bits);
+
+    uint16_t     levels[3][256];    ///< The 16-bit level of each 8-bit value of a color.
+    float        levelTint[3];      ///< The tint the level tables were built with.
+    unsigned int levelVersion;      ///< The settings version the tables were built with.
+
+    std::vector<uint16_t> linear[3];    ///< The 16-bit level of each voxel of a color.
+    std::vector<byte>     output[3];    ///< The quantized level of each voxel of a color.
+
+    static float        gain,       ///< Scale applied to every level (1.0 by default).
+                        gamma;      ///< Exponent applied to every level (1.0 by default).
+    static unsigned int version;    ///< Incremented whenever the gain or gamma changes.
+};
+
+
+#endif
@@ -72,6 +72,14 @@ unsigned int waitMode,                  ///< The current wait mode (0 to run).
              waitAmount,                ///< The current wait amount.
              waitInitAmount;            ///< The initial value of the wait condition.
 
+/// \brief A line of output posted by another thread (see PostOutput).
+struct PostedOutput
+{
+    std::string   text;                 ///< The output to write.
+    PostedOutput *next;                 ///< The output posted before this one (or NULL).
+};
+PostedOutput *postedOutput = NULL;      ///< Output not yet written, newest first.
+
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
  *                                FUNCTION DEFINITIONS                                 *
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
@@ -125,6 +133,55 @@ void WriteOutput(std::string const& outputStr)
 }
 
 
+///
+/// \brief Post Output
+///
+/// Queues the passed string to be written to the console output by the console's own
+/// thread (see \ref WritePostedOutput).  Unlike \ref WriteOutput, this can be called from
+/// any thread (e.g. by a task posted to the animation thread), and never blocks.
+///
+/// \param outputStr The string to append to the output list.
+///
+void PostOutput(std::string const& outputStr)
+{
+    PostedOutput *posted = new PostedOutput;
+    posted->text = outputStr;
+    posted->next = __atomic_load_n(&postedOutput, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&postedOutput, &posted->next, posted, true,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+    {
+        // Another thread posted output first (posted->next was updated to it), so retry.
+    }
+}
+
+
+///
+/// \brief Write Posted Output
+///
+/// Writes all of the output queued by \ref PostOutput, in the order it was posted.
+///
+void WritePostedOutput()
+{
+    PostedOutput *posted  = __atomic_exchange_n(&postedOutput, (PostedOutput *)NULL,
+                                                __ATOMIC_ACQUIRE),
+                 *ordered = NULL;
+    while (posted != NULL)      // The output was taken newest first, so reverse it.
+    {
+        PostedOutput *next = posted->next;
+        posted->next = ordered;
+        ordered      = posted;
+        posted       = next;
+    }
+    while (ordered != NULL)
+    {
+        PostedOutput *next = ordered->next;
+        WriteOutput(ordered->text);
+        delete ordered;
+        ordered = next;
+    }
+}
+
+
 ///
 /// \brief Write History
 ///
@@ -632,6 +689,7 @@ bool LoadScript(char const *fileName)
 ///
 void RunCommandQueue()
 {
+    WritePostedOutput();    // Output from the commands run by the animation thread.
     while (!commandQueue.empty())
     {
         CheckWaitMode();    // First, we check the wait condition and update the wait mode.
@@ -677,25 +735,22 @@ void CheckWaitMode()
         
         case 3:         // Mode 3: Wait Ticks
         {
-            LockAnimMutex();        // First, we lock the animation mutex.
-            // So, if the current animation's tick count is large enough...
-            if ((currAnim->GetTicks() - waitInitAmount) >= waitAmount)
+            // So, if the current animation's tick count is large enough (this is read
+            // without locking the animation mutex, see GetAnimTicks)...
+            if ((GetAnimTicks() - waitInitAmount) >= waitAmount)
             {
                 waitMode = 0;           // We can reset the wait mode.
             }
-            UnlockAnimMutex();      // Finally, we unlock the mutex.
             break;
         }
         
         case 4:         // Mode 4: Wait Iterations
         {
-            LockAnimMutex();        // First, we lock the animation mutex.
             // So, if the current animation's iteration count is large enough...
-            if ((currAnim->GetIterations() - waitInitAmount) >= waitAmount)
+            if ((GetAnimIterations() - waitInitAmount) >= waitAmount)
             {
                 waitMode = 0;           // We can reset the wait mode.
             }
-            UnlockAnimMutex();      // Finally, we unlock the mutex.
             break;
         }
         
@@ -735,17 +790,13 @@ void SetWaitMode(unsigned int mode, unsigned int delay)
             break;
 
         case 3:     // Mode 3: Wait Ticks
-            LockAnimMutex();        // First, we lock the animation mutex.
-            // Next, we store the animation's current tick count.
-            waitInitAmount = currAnim->GetTicks();
-            UnlockAnimMutex();      // Finally, we unlock the mutex.
+            // We store the animation's current tick count.
+            waitInitAmount = GetAnimTicks();
             break;
     
         case 4:     // Mode 4: Wait Iterations
-            LockAnimMutex();        // First, we lock the animation mutex.
-            // Next, we store the animation's current iteration count.
-            waitInitAmount = currAnim->GetIterations();
-            UnlockAnimMutex();      // Finally, we unlock the mutex.
+            // We store the animation's current iteration count.
+            waitInitAmount = GetAnimIterations();
             break;
 
         default:    // There should be no other modes, so reset the mode.
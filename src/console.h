@@ -83,6 +83,8 @@ bool cmpStrNoCase(std::string const& first, std::string const& second);
 void StripWhitespaceLT(std::string &toTrim);
 
 void WriteOutput(std::string const& outputStr);
+void PostOutput(std::string const& outputStr);     // Same as above, from any thread.
+void WritePostedOutput();
 void WriteHistory(std::string const& historyStr);
 void ClearOutput();
 void ClearHistory();
@@ -37,6 +37,10 @@
 #include "main.h"
 #include "TCAnim.h"
 #include "TCAnimLua.h"
+#include "TCAutomaton.h"
+#include "cube_kernels.h"
+#include "TCToneMap.h"
+#include "TCEffectChain.h"
 #include "SDL_net.h"
 #include "drivers/netdrv.h"
 
@@ -64,9 +68,293 @@ namespace TC_Console_Error
 }
 
 
+///
+/// \brief Parse Animation Arguments
+///
+/// Converts the arguments passed to an animation (from argv[first] onwards) into their
+/// integer values, where each argument is either a constant or an integer.
+///
+/// \param argv    The arguments passed to the console command.
+/// \param first   The index of the first animation argument in argv.
+/// \param argVals The vector to store the value of each argument in.
+///
+/// \returns True if every argument was converted, false otherwise (after writing an error).
+///
+static bool ParseAnimArgs(vectStr const& argv, size_t first, std::vector<int> &argVals)
+{
+    argVals.clear();
+    for (size_t i = first; i < argv.size(); i++)    // So, looping through each argument...
+    {
+        // First, we determine if the argument represents a constant.
+        int argVal;
+        if (!StringToConst(argv[i], argVal))    // If it doesn't, we try to convert it
+        {                                       // into an integer instead...
+            std::stringstream argStr(argv[i]);
+            if (!(argStr >> argVal))            // So if we could not convert it...
+            {
+                WriteOutput(TC_Console_Error::INVALID_ARG_VALUE);
+                return false;
+            }
+        }
+        argVals.push_back(argVal);
+    }
+    return true;
+}
+
+
+///
+/// \brief Load Animation
+///
+/// Loads the animation named by an argument, passing it the arguments after its name.
+/// Native animations (e.g. TC_AUTOMATON_NAME) are passed the arguments as strings, and
+/// any other name is loaded as a Lua animation (see LuaAnimLoader).
+///
+/// \param argv     The arguments of the command.
+/// \param first    The index of the argument holding the animation name.
+/// \param animSize The size of the animation (or NULL to use the current cube size).
+///
+/// \returns The new animation, or NULL if it could not be loaded (in which case an error
+///          was written to the console).
+///
+static TCAnim *LoadAnimation(vectStr const& argv, size_t first, byte *animSize = NULL)
+{
+    if (argv[first] == TC_AUTOMATON_NAME)
+    {
+        std::vector<const char *> args;
+        for (size_t i = first + 1; i < argv.size(); i++)
+        {
+            args.push_back(argv[i].c_str());
+        }
+        return AutomatonLoader((int)args.size(), args.empty() ? NULL : &args[0],
+                               animSize);
+    }
+    std::vector<int> argVals;   // Vector holding the values of each argument.
+    if (!ParseAnimArgs(argv, first + 1, argVals)) return NULL;
+    return LuaAnimLoader(argv[first].c_str(), (int)argVals.size(),
+                         argVals.empty() ? NULL : &argVals[0], animSize);
+}
+
+
+///
+/// \brief Effect Task
+///
+/// Changes (or lists) the effects of the animation, as requested by the effect command.
+/// The arguments were already checked by the command, except for the effect index.
+///
+/// \param anim  The current animation.
+/// \param pData A copy of the command's arguments (deleted by this function).
+///
+static void EffectTask(TCAnim *anim, void *pData)
+{
+    vectStr *pArgv = (vectStr *)pData;
+    vectStr const& argv = *pArgv;
+    if (argv.size() == 0)           // If there were no arguments, list the effects.
+    {
+        if (!anim->HasEffects())
+        {
+            PostOutput("The current animation does not have any effects.");
+        }
+        else
+        {
+            TCEffectChain *effects = anim->GetEffects();
+            for (size_t i = 0; i < effects->GetNumEffects(); i++)
+            {
+                std::stringstream ssOutput;
+                ssOutput << "  " << i << ": "
+                         << TCEffectChain::GetEffectName(effects->GetEffectType(i))
+                         << " " << effects->GetEffectParam(i);
+                PostOutput(ssOutput.str());
+            }
+        }
+    }
+    else if (argv[0] == "clear")
+    {
+        if (anim->HasEffects()) anim->GetEffects()->ClearEffects();
+    }
+    else if (argv[0] == "add")
+    {
+        byte  type;
+        float param;
+        for (type = 0; argv[1] != TCEffectChain::GetEffectName(type); type++) ;
+        std::stringstream(argv[2]) >> param;
+        anim->GetEffects()->AddEffect(type, param);
+    }
+    else
+    {
+        unsigned int index;
+        std::stringstream(argv[1]) >> index;
+        if (!anim->HasEffects() || index >= anim->GetEffects()->GetNumEffects())
+        {
+            PostOutput(TC_Console_Error::INVALID_ARG_VALUE);
+        }
+        else
+        {
+            anim->GetEffects()->RemoveEffect(index);
+        }
+    }
+    delete pArgv;
+}
+
+
+///
+/// \brief Layer Task
+///
+/// Changes (or lists) the layers of the animation, as requested by the layer command.
+/// The arguments were already checked by the command, except for the layer index.
+///
+/// \param anim  The current animation.
+/// \param pData A copy of the command's arguments (deleted by this function).
+///
+static void LayerTask(TCAnim *anim, void *pData)
+{
+    vectStr *pArgv = (vectStr *)pData;
+    vectStr const& argv = *pArgv;
+    TCCompositor *compositor = dynamic_cast<TCCompositor *>(anim);
+    unsigned int index = 0;
+    if (argv.size() > 1) std::stringstream(argv[1]) >> index;
+    if (argv.size() == 0)           // If there were no arguments, list the layers.
+    {
+        if (compositor == NULL || compositor->GetNumLayers() == 0)
+        {
+            PostOutput("The current animation does not have any layers.");
+        }
+        for (size_t i = 0; compositor != NULL && i < compositor->GetNumLayers(); i++)
+        {
+            std::stringstream ssOutput;
+            ssOutput << "  " << i << ": "
+                     << TCCompositor::GetBlendName(compositor->GetLayerBlend(i))
+                     << ", opacity " << (int)compositor->GetLayerOpacity(i);
+            PostOutput(ssOutput.str());
+        }
+    }
+    else if (compositor == NULL || index >= compositor->GetNumLayers())
+    {
+        PostOutput(TC_Console_Error::INVALID_ARG_VALUE);
+    }
+    else if (argv[0] == "remove")
+    {
+        compositor->RemoveLayer(index);
+    }
+    else if (argv[0] == "blend")
+    {
+        byte newBlend;
+        for (newBlend = 0; argv[2] != TCCompositor::GetBlendName(newBlend); newBlend++) ;
+        compositor->SetLayerBlend(index, newBlend);
+    }
+    else
+    {
+        int newOpacity;
+        std::stringstream(argv[2]) >> newOpacity;
+        compositor->SetLayerOpacity(index, (byte)newOpacity);
+    }
+    // The compositor blends the layers again on its next tick.
+    delete pArgv;
+}
+
+
+///
+/// \brief Add Layer Task
+///
+/// Adds an animation loaded by the layer command as the top layer of the compositor
+/// (making the current animation a compositor first, see GetCompositor).  The layer was
+/// loaded at the cube size when the command ran, so it is deleted (and an error is
+/// written) if the cube was resized before this task was run.
+///
+/// \param anim  The current animation (unused, see GetCompositor).
+/// \param pData The animation to add as a layer.
+///
+static void AddLayerTask(TCAnim * /*anim*/, void *pData)
+{
+    TCAnim       *layer      = (TCAnim *)pData;
+    TCCompositor *compositor = GetCompositor();
+    for (byte axis = TC_X_AXIS; axis <= TC_Z_AXIS; axis++)
+    {
+        if (layer->cubeState[0]->GetSize(axis) != compositor->cubeState[0]->GetSize(axis))
+        {
+            PostOutput("Error - the cube was resized before the layer could be added.");
+            delete layer;
+            return;
+        }
+    }
+    compositor->AddLayer(layer);
+}
+
+
+///
+/// \brief Tick Task
+///
+/// Ticks the animation as requested by the tick command, and publishes its new state.
+///
+/// \param anim  The current animation.
+/// \param pData The number of ticks (an int, deleted by this function).
+///
+static void TickTask(TCAnim *anim, void *pData)
+{
+    int *pTicks = (int *)pData;
+    for (int i = 0; i < *pTicks; i++)
+    {
+        anim->Tick();
+    }
+    PublishFrame();
+    delete pTicks;
+}
+
+
 namespace TC_Console_Commands
 {
 
+void benchcube(vectStr const& argv)
+{
+    if (argv.size() > 0)
+    {
+        WriteOutput(TC_Console_Error::INVALID_NUM_ARGS_MORE);
+        return;
+    }
+    int origKernels = TC_Kernels::GetSelected();
+    // Write the table header, with one column for each supported kernel set.
+    std::stringstream ssOutput;
+    ssOutput << "Cube operator benchmark (ms, speedup over scalar):\n    size   ";
+    for (int k = 0; k < TC_KERNELS_COUNT; k++)
+    {
+        if (TC_Kernels::IsSupported(k)) ssOutput << TC_Kernels::GetName(k) << "\t\t";
+    }
+    WriteOutput(ssOutput.str());
+    // Each cube size is run enough times to process the same total number of voxels.
+    for (int size = 4; size <= 128; size *= 2)
+    {
+        TCCube cubeA((byte)size), cubeB((byte)size);
+        size_t numReps = (1 << 26) / cubeA.GetNumVoxels();
+        Uint32 scalarTime = 0;
+        ssOutput.str("");
+        ssOutput << "    " << size << "^3\t";
+        for (int k = 0; k < TC_KERNELS_COUNT; k++)
+        {
+            if (!TC_Kernels::Select(k)) continue;
+            Uint32 startTime = SDL_GetTicks();
+            for (size_t i = 0; i < numReps; i++)
+            {
+                cubeA.OP_OR(cubeB);
+                cubeA.OP_AND(cubeB);
+                cubeA.OP_XOR(cubeB);
+                cubeA.OP_NOT();
+                // The cube is all ones here, so each comparison checks every voxel.
+                cubeA.GetPlaneState(TC_YZ_PLANE, 0, 0x01);
+                cubeA.GetPlaneState(TC_ZX_PLANE, 0, 0x01);
+            }
+            Uint32 runTime = SDL_GetTicks() - startTime;
+            if (k == TC_KERNELS_SCALAR) scalarTime = runTime;
+            ssOutput << runTime;
+            if (k != TC_KERNELS_SCALAR && runTime > 0)
+            {
+                ssOutput << " (" << (float)scalarTime / runTime << "x)";
+            }
+            ssOutput << "\t\t";
+        }
+        WriteOutput(ssOutput.str());
+    }
+    TC_Kernels::Select(origKernels);
+}
+
 void bind(vectStr const& argv)
 {
     switch (argv.size())
@@ -244,10 +532,11 @@ void color(vectStr const& argv)
             }
             else
             {
-                for (int i = 0; i < numColors; i++)
-                {
-                    colLedOn[i] = newColor[i] / 255.0f;
-                }
+                // The drivers read the colour from other threads, so it is set at once.
+                Uint8 rgb[3] = { (Uint8)newColor[0], (Uint8)newColor[1],
+                                 (Uint8)newColor[2] };
+                SetLedOnColor(rgb);
+                if (numColors == 4) colLedOn[3] = newColor[3] / 255.0f;
             }
         }
         else
@@ -281,7 +570,7 @@ void cubesize(vectStr const& argv)
         {
             std::stringstream strSize(argv[0]);
             Uint16 newSize;
-            if (!(strSize >> newSize) || newSize == 0 || newSize > 100)
+            if (!(strSize >> newSize) || newSize == 0 || newSize > 255)
             {
                 WriteOutput(TC_Console_Error::INVALID_ARG_VALUE);
             }
@@ -297,9 +586,9 @@ void cubesize(vectStr const& argv)
                               strSizeY(argv[1]),
                               strSizeZ(argv[2]);
             Uint16 newSize[3];
-            if (    !(strSizeX >> newSize[0]) || newSize[0] == 0 || newSize[0] > 100
-                 || !(strSizeY >> newSize[1]) || newSize[1] == 0 || newSize[1] > 100
-                 || !(strSizeZ >> newSize[2]) || newSize[2] == 0 || newSize[2] > 100 )
+            if (    !(strSizeX >> newSize[0]) || newSize[0] == 0 || newSize[0] > 255
+                 || !(strSizeY >> newSize[1]) || newSize[1] == 0 || newSize[1] > 255
+                 || !(strSizeZ >> newSize[2]) || newSize[2] == 0 || newSize[2] > 255 )
             {
                 WriteOutput(TC_Console_Error::INVALID_ARG_VALUE);
             }
@@ -315,6 +604,46 @@ void cubesize(vectStr const& argv)
     }
 }
 
+void driverqueue(vectStr const& argv)
+{
+    TCFrameQueue *queue = GetDriverQueue();
+    if (argv.size() == 0)
+    {
+        std::stringstream ssOutput;
+        ssOutput << "Driver queue: " << queue->GetNumQueued() << " of "
+                 << queue->GetDepth() << " frames queued ("
+                 << TCFrameQueue::GetPolicyName(queue->GetPolicy()) << " when full), "
+                 << queue->GetNumDropped() << " frames dropped.";
+        WriteOutput(ssOutput.str());
+    }
+    else if (argv.size() == 1)
+    {
+        std::stringstream strDepth(argv[0]);
+        unsigned int newDepth;
+        if (argv[0] == "drop")
+        {
+            queue->SetPolicy(TC_QUEUE_DROP_OLDEST);
+        }
+        else if (argv[0] == "block")
+        {
+            queue->SetPolicy(TC_QUEUE_BLOCK);
+        }
+        else if (   !(strDepth >> newDepth) || !strDepth.eof()
+                 || newDepth == 0 || newDepth > TC_FRAME_QUEUE_SLOTS)
+        {
+            WriteOutput(TC_Console_Error::INVALID_ARG_VALUE);
+        }
+        else
+        {
+            queue->SetDepth(newDepth);
+        }
+    }
+    else
+    {
+        WriteOutput(TC_Console_Error::INVALID_NUM_ARGS_MORE);
+    }
+}
+
 void echo(vectStr const& argv)
 {
     // So, as long as we have some arguments...
@@ -359,6 +688,58 @@ void echo(vectStr const& argv)
     }
 }
 
+void effect(vectStr const& argv)
+{
+    // The arguments are checked here, and the effects are changed (or listed) by a task
+    // run on the animation thread (see EffectTask).
+    if (argv.size() == 0 || argv[0] == "clear")
+    {
+        if (argv.size() > 1)
+        {
+            TC_Console_Error::WrongArgCount(argv.size(), 1);
+            return;
+        }
+    }
+    else if (argv[0] == "add" || argv[0] == "remove")
+    {
+        if (argv.size() != (argv[0] == "remove" ? 2u : 3u))
+        {
+            TC_Console_Error::WrongArgCount(argv.size(), argv[0] == "remove" ? 2 : 3);
+            return;
+        }
+        bool validArg;
+        if (argv[0] == "add")
+        {
+            byte  type;
+            float param;
+            for (type = 0; type < TC_NUM_EFFECTS; type++)
+            {
+                if (argv[1] == TCEffectChain::GetEffectName(type)) break;
+            }
+            std::stringstream ssParam(argv[2]);
+            validArg =    type < TC_NUM_EFFECTS && !(ssParam >> param).fail()
+                       && param >= 0.0f;
+        }
+        else
+        {
+            unsigned int index;
+            std::stringstream ssIndex(argv[1]);
+            validArg = !(ssIndex >> index).fail();
+        }
+        if (!validArg)
+        {
+            WriteOutput(TC_Console_Error::INVALID_ARG_VALUE);
+            return;
+        }
+    }
+    else
+    {
+        WriteOutput(TC_Console_Error::INVALID_ARG_VALUE);
+        return;
+    }
+    PostAnimTask(EffectTask, new vectStr(argv));
+}
+
 void fpsmax(vectStr const& argv)
 {
     switch (argv.size())
@@ -429,6 +810,93 @@ void help(vectStr const& argv)
     }
 }
 
+void interp(vectStr const& argv)
+{
+    static const char *modeNames[] = { "none", "nearest", "linear" };
+    if (argv.size() == 0)
+    {
+        WriteOutput(std::string("The current interpolation mode is ")
+                    + modeNames[TCFrameInterp::GetMode()] + ".");
+    }
+    else if (argv.size() == 1)
+    {
+        byte newMode;
+        for (newMode = TC_INTERP_NONE; newMode <= TC_INTERP_LINEAR; newMode++)
+        {
+            if (argv[0] == modeNames[newMode]) break;
+        }
+        if (newMode <= TC_INTERP_LINEAR)
+        {
+            TCFrameInterp::SetMode(newMode);
+        }
+        else
+        {
+            WriteOutput(TC_Console_Error::INVALID_ARG_VALUE);
+        }
+    }
+    else
+    {
+        WriteOutput(TC_Console_Error::INVALID_NUM_ARGS_MORE);
+    }
+}
+
+void layer(vectStr const& argv)
+{
+    // The arguments are checked here, and the layers are changed (or listed) by a task
+    // run on the animation thread (see LayerTask).
+    if (argv.size() == 0)
+    {
+        PostAnimTask(LayerTask, new vectStr(argv));
+        return;
+    }
+    if (argv[0] == "add")
+    {
+        if (argv.size() < 2)
+        {
+            WriteOutput(TC_Console_Error::INVALID_NUM_ARGS_LESS);
+            return;
+        }
+        // The animation is loaded on this thread, since it may run a Lua file.
+        TCAnim *newLayer = LoadAnimation(argv, 1);
+        if (newLayer != NULL) PostAnimTask(AddLayerTask, newLayer);
+        return;
+    }
+    // The remaining sub-commands all take the index of an existing layer.
+    unsigned int index;
+    std::stringstream ssIndex(argv.size() > 1 ? argv[1] : "");
+    if (argv[0] != "remove" && argv[0] != "blend" && argv[0] != "opacity")
+    {
+        WriteOutput(TC_Console_Error::INVALID_ARG_VALUE);
+        return;
+    }
+    if (argv.size() != (argv[0] == "remove" ? 2u : 3u))
+    {
+        TC_Console_Error::WrongArgCount(argv.size(), argv[0] == "remove" ? 2 : 3);
+        return;
+    }
+    int  newValue = 0;
+    bool validArg = !(ssIndex >> index).fail();
+    if (validArg && argv[0] == "blend")
+    {
+        for (newValue = 0; newValue < TC_NUM_BLENDS; newValue++)
+        {
+            if (argv[2] == TCCompositor::GetBlendName(newValue)) break;
+        }
+        validArg = (newValue < TC_NUM_BLENDS);
+    }
+    else if (validArg && argv[0] == "opacity")
+    {
+        std::stringstream ssOpacity(argv[2]);
+        validArg = (ssOpacity >> newValue) && newValue >= 0 && newValue <= 0xFF;
+    }
+    if (!validArg)
+    {
+        WriteOutput(TC_Console_Error::INVALID_ARG_VALUE);
+        return;
+    }
+    PostAnimTask(LayerTask, new vectStr(argv));
+}
+
 void list(vectStr const& argv)
 {
     if (argv.size() == 1)
@@ -482,40 +950,9 @@ void loadanim(vectStr const& argv)
         WriteOutput(TC_Console_Error::INVALID_NUM_ARGS_LESS);
         return;
     }
-    int *argVals = NULL;    // Array holding the values of each argument.
-    if (argv.size() > 1)    // If we have arguments to pass to the Lua script...
-    {
-        argVals = new int[argv.size() - 1];         // Initialize the argument value array.
-        for (size_t i = 1; i < argv.size(); i++)    // So, looping through each argument...
-        {
-            // First, we determine if the argument represents a constant.
-            int argVal;
-            if (StringToConst(argv[i], argVal)) // If the argument value was correctly parsed...
-            {
-                argVals[i-1] = argVal;  // Update the argument vector.
-            }
-            else            // Else, we try to convert it into an integer...
-            {
-                std::stringstream argStr(argv[i]);      // Contains the argument.
-                int argVal;                             // The argument value itself.    
-                if (!(argStr >> argVal))                // So if we could not convert it...
-                {
-                    WriteOutput(TC_Console_Error::INVALID_ARG_VALUE);  // Output an error, delete
-                    delete argVals;                             // the argument vector,
-                    return;                                     // and return.
-                }
-                else                                    // Else, if we did convert it...
-                {
-                    argVals[i-1] = argVal;                  // Update the argument vector.
-                }
-            }
-        }
-    }
-    // Now, we get the animation from the Lua animation loader (defined in TCAnimLua.h)
+    // Now, we load the animation (from its Lua file, unless it is a native animation)
     // and directly pass the new animation to SetAnim (defined in main.h).
-    SetAnim(LuaAnimLoader(argv[0].c_str(), argv.size() - 1, argVals));
-    // Finally, we delete the memory used for the argument values (if applicable).
-    delete argVals;
+    SetAnim(LoadAnimation(argv, 0));
 }
 
 void netdrv(vectStr const& argv)
@@ -1084,25 +1521,160 @@ void showfps(vectStr const& argv)
     }
 }
 
+void slot(vectStr const& argv)
+{
+    TCSlotEngine *engine = GetSlotEngine();
+    if (argv.size() == 0)       // With no arguments, we list the slots.
+    {
+        std::vector<TCSlotStatus> status;
+        engine->GetStatus(status);
+        if (status.empty())
+        {
+            WriteOutput("There are no animation slots.");
+        }
+        for (size_t i = 0; i < status.size(); i++)
+        {
+            std::stringstream ssOutput;
+            ssOutput << status[i].name << ": " << (int)status[i].size[0] << "x"
+                     << (int)status[i].size[1] << "x" << (int)status[i].size[2] << ", "
+                     << (!status[i].hasAnim ? "empty" :
+                         (status[i].running ? "running" : "stopped"))
+                     << " at " << status[i].tickRate << " ticks/s (achieved "
+                     << status[i].achievedRate << ", " << status[i].maxLateness
+                     << " ms max lateness), " << status[i].ticks << " ticks, "
+                     << (status[i].hasDriver ? "with a driver." : "no driver.");
+            WriteOutput(ssOutput.str());
+        }
+    }
+    else if (argv[0] == "add")  // slot add name [size | sx sy sz]
+    {
+        Uint16 newSize[3] = { cubeSize[0], cubeSize[1], cubeSize[2] };
+        bool   validArgs  = (argv.size() == 2 || argv.size() == 3 || argv.size() == 5)
+                            && argv[1] != "add" && argv[1] != "remove";
+        for (size_t i = 2; validArgs && i < argv.size(); i++)
+        {
+            std::stringstream strSize(argv[i]);
+            validArgs = (strSize >> newSize[i - 2]) && newSize[i - 2] > 0
+                        && newSize[i - 2] <= 255;
+        }
+        if (argv.size() == 3) newSize[1] = newSize[2] = newSize[0];
+        byte size[3] = { (byte)newSize[0], (byte)newSize[1], (byte)newSize[2] };
+        if (!validArgs)
+        {
+            WriteOutput(TC_Console_Error::INVALID_ARG_VALUE);
+        }
+        else if (!engine->AddSlot(argv[1], size, GetTickRate()))
+        {
+            WriteOutput("Error - there is already a slot named `" + argv[1] + "`.");
+        }
+    }
+    else if (argv[0] == "remove")
+    {
+        if (argv.size() != 2)
+        {
+            TC_Console_Error::WrongArgCount(argv.size(), 2);
+        }
+        else if (!engine->RemoveSlot(argv[1]))
+        {
+            WriteOutput("Error - there is no slot named `" + argv[1] + "`.");
+        }
+    }
+    else                        // Otherwise, the command is applied to the named slot.
+    {
+        byte size[3];
+        if (argv.size() < 2 || (argv.size() < 3 && argv[1] != "unload"))
+        {
+            WriteOutput(TC_Console_Error::INVALID_NUM_ARGS_LESS);
+        }
+        else if (!engine->GetSize(argv[0], size))
+        {
+            WriteOutput("Error - there is no slot named `" + argv[0] + "`.");
+        }
+        else if (argv[1] == "loadanim")
+        {
+            TCAnim *newAnim = LoadAnimation(argv, 2, size);
+            if (newAnim != NULL) engine->SetAnim(argv[0], newAnim);
+        }
+        else if (argv[1] == "unload" && argv.size() == 2)
+        {
+            engine->SetAnim(argv[0], NULL);
+        }
+        else if (argv[1] == "tickrate" && argv.size() == 3)
+        {
+            std::stringstream strTickRate(argv[2]);
+            double newTickRate;
+            if (    !(strTickRate >> newTickRate) || !strTickRate.eof()
+                 || newTickRate < TC_MIN_TICK_RATE || newTickRate > TC_MAX_TICK_RATE)
+            {
+                WriteOutput(TC_Console_Error::INVALID_ARG_VALUE);
+            }
+            else
+            {
+                engine->SetTickRate(argv[0], newTickRate);
+            }
+        }
+        else if (argv[1] == "runanim" && argv.size() == 3)
+        {
+            bool tmpResult;
+            if (StringToBool(argv[2], tmpResult))
+            {
+                engine->SetRunning(argv[0], tmpResult);
+            }
+            else
+            {
+                WriteOutput(TC_Console_Error::INVALID_ARG_VALUE);
+            }
+        }
+        else if (argv[1] == "netdrv" && argv.size() == 3)
+        {
+            std::stringstream strCubeNum(argv[2]);
+            unsigned int cubeNum;
+            if (argv[2] == "off")
+            {
+                engine->SetDriver(argv[0], NULL);
+            }
+            else if (!(strCubeNum >> cubeNum) || !strCubeNum.eof())
+            {
+                WriteOutput(TC_Console_Error::INVALID_ARG_VALUE);
+            }
+            else
+            {
+                // The slot is always sent every frame (so the driver is synchronous).
+                TCDriver *newDriver = netdrv_OpenCube(cubeNum, 0);
+                if (newDriver == NULL) return;
+                byte *remoteSize = cubeList[cubeNum - 1].cube_size;
+                if (    remoteSize[0] != size[0] || remoteSize[1] != size[1]
+                     || remoteSize[2] != size[2] )
+                {
+                    WriteOutput("Error - the cube is not the same size as the slot.");
+                    delete newDriver;
+                }
+                else
+                {
+                    engine->SetDriver(argv[0], newDriver);
+                }
+            }
+        }
+        else
+        {
+            WriteOutput(TC_Console_Error::INVALID_ARG_VALUE);
+        }
+    }
+}
+
 void tick(vectStr const& argv)
 {
     switch (argv.size())
     {
         case 0:
-            LockAnimMutex();
-            currAnim->Tick();
-            UnlockAnimMutex();
+            // The animation is ticked by the animation thread, which then publishes it.
+            PostAnimTask(TickTask, new int(1));
             break;
         case 1:
             int tmpResult;
             if (StringToInt(argv[0], tmpResult) || tmpResult > 0)
             {
-                LockAnimMutex();
-                for (int i = 0; i < tmpResult; i++)
-                {
-                    currAnim->Tick();
-                }
-                UnlockAnimMutex();
+                PostAnimTask(TickTask, new int(tmpResult));
             }
             else
             {
@@ -1117,19 +1689,32 @@ void tick(vectStr const& argv)
 
 void tickrate(vectStr const& argv)
 {
+    TCScheduler *scheduler = GetScheduler();
     if (argv.size() == 0)
     {
-        std::string outputStr = "Current tickrate: ";
-        std::stringstream ssTickRate;
-        ssTickRate << GetTickRate();
-        outputStr += ssTickRate.str();
-        WriteOutput(outputStr);
+        std::stringstream ssOutput;
+        ssOutput << "Current tickrate: " << GetTickRate() << " (achieved "
+                 << scheduler->GetAchievedRate() << ", "
+                 << TCScheduler::GetCatchUpName(scheduler->GetCatchUp())
+                 << " when late).\nLateness: " << scheduler->GetMeanLateness()
+                 << " ms mean, " << scheduler->GetMaxLateness() << " ms max, "
+                 << scheduler->GetSkippedTicks() << " ticks skipped.";
+        WriteOutput(ssOutput.str());
     }
     else if (argv.size() == 1)
     {
         std::stringstream strTickRate(argv[0]);
-        Uint16 newTickRate;
-        if (!(strTickRate >> newTickRate) || newTickRate == 0 || newTickRate > 1000)
+        double newTickRate;
+        if (argv[0] == "skip")
+        {
+            scheduler->SetCatchUp(TC_CATCHUP_SKIP);
+        }
+        else if (argv[0] == "burst")
+        {
+            scheduler->SetCatchUp(TC_CATCHUP_BURST);
+        }
+        else if (   !(strTickRate >> newTickRate) || !strTickRate.eof()
+                 || newTickRate < TC_MIN_TICK_RATE || newTickRate > TC_MAX_TICK_RATE)
         {
             WriteOutput(TC_Console_Error::INVALID_ARG_VALUE);
         }
@@ -1144,6 +1729,49 @@ void tickrate(vectStr const& argv)
     }
 }
 
+void tonemap(vectStr const& argv)
+{
+    switch (argv.size())
+    {
+        case 0:
+        {
+            std::stringstream ssOutput;
+            ssOutput << "The current output gain is " << TCToneMap::GetGain()
+                     << ", and the gamma is " << TCToneMap::GetGamma() << ".";
+            WriteOutput(ssOutput.str());
+            break;
+        }
+
+        case 1:
+        case 2:
+        {
+            std::stringstream ssGain(argv[0]);
+            float newGain, newGamma = TCToneMap::GetGamma();
+            if (!(ssGain >> newGain) || newGain < 0.0f)
+            {
+                WriteOutput(TC_Console_Error::INVALID_ARG_VALUE);
+                break;
+            }
+            if (argv.size() == 2)
+            {
+                std::stringstream ssGamma(argv[1]);
+                if (!(ssGamma >> newGamma) || newGamma <= 0.0f)
+                {
+                    WriteOutput(TC_Console_Error::INVALID_ARG_VALUE);
+                    break;
+                }
+            }
+            TCToneMap::SetGain(newGain);
+            TCToneMap::SetGamma(newGamma);
+            break;
+        }
+
+        default:
+            WriteOutput(TC_Console_Error::INVALID_NUM_ARGS_MORE);
+            break;
+    }
+}
+
 void wait(vectStr const& argv)
 {
     if (argv.size() == 2)
@@ -1224,6 +1852,15 @@ void wait(vectStr const& argv)
 ///
 void RegisterCommands()
 {
+    cmdList.push_back(new ConsoleCommand("benchcube", benchcube,
+        "Benchmarks the cube operators (AND, OR, XOR, NOT, and plane comparisons) with "
+        "each set of cube kernels supported by this CPU, on cubes from 4*4*4 to "
+        "128*128*128 voxels. Usage:\n\n"
+        "    benchcube\n\n"
+        "The time taken (in milliseconds) and the speedup over the scalar kernels is shown "
+        "for each cube size. Note that the program will not respond until the benchmark "
+        "is complete (which may take a few seconds)."));
+
     cmdList.push_back(new ConsoleCommand("bind", bind,
         "Assigns a key combination to a particular console command. Usage:\n\n"
         "    bind [flags] key cmd     Where each argument is as follows:\n\n"
@@ -1263,6 +1900,16 @@ void RegisterCommands()
         "Calling this function without any arguments displays the current cube size. "
         "Note that this function will close the currently running animation."));
 
+    cmdList.push_back(new ConsoleCommand("driverqueue", driverqueue,
+        "Sets how the frames are queued for a synchronous driver, which sends them from "
+        "its own thread (in the order they were published). Usage:\n\n"
+        "    driverqueue drop     Drops the oldest queued frame when full (default).\n"
+        "    driverqueue block    Delays the animation until the driver takes a frame.\n"
+        "    driverqueue depth    Sets the number of frames queued (1 to 16).\n\n"
+        "With drop, the cube stays close to the animation even if the driver is slow, "
+        "and with block, every frame is sent.  With no arguments, the number of frames "
+        "queued and dropped is displayed."));
+
     cmdList.push_back(new ConsoleCommand("echo", echo,
         "Outputs each passed command line argument as it is parsed. Usage:\n\n"
         "    echo [-v | -verbose] [-o | -omit] [arg1, arg2, ...]\n\n"
@@ -1272,6 +1919,23 @@ void RegisterCommands()
         "or -omit is specified, the first two arguments (e.g. the two flags) are omitted "
         "from the output. The omit flag has no effect if verbose mode is not specified."));
 
+    cmdList.push_back(new ConsoleCommand("effect", effect,
+        "Applies post-processing effects to the current animation, in the order they are "
+        "added. Usage:\n\n"
+        "    effect add type value    Adds an effect to the end of the list.\n"
+        "    effect remove n          Removes effect n.\n"
+        "    effect clear             Removes every effect.\n\n"
+        "Where the type and value of each effect is one of the following:\n"
+        "    decay value        Leaves trails, keeping value (0 to 1) of each voxel per tick.\n"
+        "    blur radius        Averages the voxels within radius (1 to 7) of each voxel.\n"
+        "    gaussian radius    Same as blur, but smoother (the blur is done three times).\n"
+        "    scale value        Multiplies the brightness of every voxel by value.\n"
+        "    threshold level    Turns off the voxels dimmer than level (0 to 255).\n\n"
+        "The effects only change the cube as it is drawn (and sent to drivers), and are "
+        "removed when another animation is loaded.  Animations without colors become "
+        "single color animations while they have any effects.  With no arguments, the "
+        "current effects are listed."));
+
     cmdList.push_back(new ConsoleCommand("fpsmax", fpsmax,
         "Sets the maximum framerate of the rendering engine. Usage:\n\n"
         "    fpsmax 60    Sets the maximum framerate to 60 frames per second (FPS).\n"
@@ -1284,6 +1948,32 @@ void RegisterCommands()
         "    help [cmd]    Where [cmd] is the name of a particular command (e.g. help "
         "list).\n\nIf [cmd] is omitted, the quick help guide is shown."));
 
+    cmdList.push_back(new ConsoleCommand("interp", interp,
+        "Sets how the cube is drawn (and sent to asynchronous drivers) between two ticks "
+        "of the animation. Usage:\n\n"
+        "    interp [mode]\n\n"
+        "Where [mode] is one of the following:\n"
+        "    none       The last state of the animation is used (the default).\n"
+        "    nearest    The closer of the last two states is used.\n"
+        "    linear     The last two states are crossfaded.\n\n"
+        "With nearest or linear, the cube is one tick behind the animation, but a low "
+        "tickrate can be used with a smooth output (e.g. an animation ticking at 20 Hz, "
+        "drawn at 100 FPS).  Animations without colors are never crossfaded.  If the mode "
+        "is omitted, the current mode is displayed."));
+
+    cmdList.push_back(new ConsoleCommand("layer", layer,
+        "Runs several animations at once as layers, which are blended together on every "
+        "tick. Usage:\n\n"
+        "    layer add filename [arg1, arg2, ...]    Loads an animation as the top layer.\n"
+        "    layer remove n                          Removes layer n.\n"
+        "    layer blend n mode                      Sets the blend mode of layer n.\n"
+        "    layer opacity n value                   Sets the opacity of layer n.\n\n"
+        "Where the arguments of add are the same as for loadanim, and the layers are "
+        "numbered from 0 (the bottom layer).  The first layer added is placed over the "
+        "current animation, which becomes layer 0.  The blend mode is one of add (the "
+        "default), max, multiply, alpha, or xor, and the opacity is from 0 (hidden) to "
+        "255 (the default).  With no arguments, the current layers are listed."));
+
     cmdList.push_back(new ConsoleCommand("list", list,
         "Used to list the available console commands or command aliases.  Usage:\n\n"
         "    list arg         Where arg is one of the following\n"
@@ -1299,7 +1989,12 @@ void RegisterCommands()
         "    loadanim sendplane.lua    Loads the sendplane.lua animation.\n"
         "    loadanim rain.lua 4       Loads the rain.lua animation with 4 rain drops.\n\n"
         "Note that the .lua extension is optional (i.e. \"loadanim rain\" will load the "
-        "file rain.lua, unless the file rain exists - which will be executed instead)."));
+        "file rain.lua, unless the file rain exists - which will be executed instead).\n\n"
+        "The name automaton loads the built-in 3D cellular automaton instead:\n\n"
+        "    loadanim automaton [rule] [neighbours] [border] [density]\n\n"
+        "Where rule is the birth and survival counts (e.g. B5/S4-5, the default), "
+        "neighbours is 6, 18, or 26 (the default), border is wrap (the default) or clamp, "
+        "and density is the percentage of cells alive when seeded (25 by default)."));
 
     cmdList.push_back(new ConsoleCommand("loadscript", loadscript,
         "Loads a script from a file. Usage:\n\n"
@@ -1364,6 +2059,22 @@ void RegisterCommands()
         "false, the FPS counter will not be drawn.  If [bool] is omitted, the state of "
         "the FPS counter is toggled."));
         
+    cmdList.push_back(new ConsoleCommand("slot", slot,
+        "Runs other animations in named slots, independently of the current animation "
+        "(e.g. to drive several cubes at once). Usage:\n\n"
+        "    slot add name [size]          Adds a slot (see cubesize for the size).\n"
+        "    slot remove name              Removes a slot.\n"
+        "    slot name loadanim anim ...   Loads an animation (see loadanim).\n"
+        "    slot name unload              Unloads the slot's animation.\n"
+        "    slot name tickrate rate       Sets the slot's tickrate (see tickrate).\n"
+        "    slot name runanim state       Starts (1) or stops (0) the slot's animation.\n"
+        "    slot name netdrv cube         Sends the slot to a cube (see netdrv list).\n"
+        "    slot name netdrv off          Disconnects the slot's cube.\n\n"
+        "If the size is omitted, the current cube size is used, and each slot starts with "
+        "the current tickrate.  The slots are ticked by a fixed number of worker threads "
+        "(one per processor), and are not drawn on the screen.  A cube must be the same "
+        "size as its slot.  With no arguments, every slot is listed."));
+
     cmdList.push_back(new ConsoleCommand("tick", tick,
         "Advances the animation state by the set number of ticks.  Usage:\n\n"
         "    tick [amount]    Where [amount] is an optional integer parameter.\n\n"
@@ -1372,9 +2083,23 @@ void RegisterCommands()
 
     cmdList.push_back(new ConsoleCommand("tickrate", tickrate,
         "Sets the current tickrate for running animations (or updates per second). Usage:\n\n"
-        "    tickrate [newrate]    Where [newrate] is an optional integer parameter.\n\n"
-        "If omitted, the current tickrate is displayed.  If set, [newrate] must be a valid "
-        "integer between 1 and 1000."));
+        "    tickrate [newrate]    Where [newrate] is an optional decimal parameter.\n"
+        "    tickrate skip         Skips the ticks missed when running late (default).\n"
+        "    tickrate burst        Runs the ticks missed when running late at once.\n\n"
+        "If omitted, the current tickrate is displayed, along with the tickrate actually "
+        "achieved and how late the ticks were run over the last second.  If set, "
+        "[newrate] must be a number between 0.01 and 10000 (e.g. 29.97).  Ticks are "
+        "always due at whole multiples of the tick period, so the tickrate does not "
+        "drift, and at most 16 ticks are run at once in burst mode."));
+
+    cmdList.push_back(new ConsoleCommand("tonemap", tonemap,
+        "Sets how the voxel colors are converted to the brightness sent to a device (and "
+        "drawn on the screen). Usage:\n\n"
+        "    tonemap [gain] [gamma]\n\n"
+        "Where [gain] scales the brightness of every voxel (1.0 by default), and [gamma] "
+        "is the exponent applied to each color (1.0 by default, or e.g. 2.2 to correct for "
+        "the non-linear brightness of the LEDs). If both are omitted, the current values "
+        "are displayed."));
 
     cmdList.push_back(new ConsoleCommand("wait", wait,
         "Delays execution of any further console commands by the set amount.  Usage:\n\n"
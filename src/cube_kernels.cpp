@@ -0,0 +1,836 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *                               Cube Kernels Source Code                              *
+ *                                      TRICLYSM                                       *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  This file contains the scalar, SSE2, and AVX2 implementations of the voxel buffer  *
+ *  kernels used by the TCCube class, as well as the functions which select between    *
+ *  them at runtime (depending on which instruction sets the CPU supports).            *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  Copyright (C) 2011 Brandon Castellano, Ryan Mantha. All rights reserved.           *
+ *  Triclysm is provided under the BSD-2-Clause license. This program uses the SDL     *
+ *  (Simple DirectMedia Layer) library, and the Lua scripting language. See the        *
+ *  included LICENSE file or <http://www.triclysm.com/> for more details.              *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+///
+/// \file  cube_kernels.cpp
+/// \brief This file contains all implementations of the voxel buffer kernels, and the
+///        functions used to select between them.
+///
+
+#include "cube_kernels.h"
+
+// The SIMD kernels are only built for x86 targets with a GCC-compatible compiler, since
+// they rely on the target attribute (so the rest of the program is built as usual).
+#if (defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)))
+    #define TC_KERNELS_X86
+    #include <immintrin.h>
+    #define TC_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+
+namespace TC_Kernels
+{
+    /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+     *                                  SCALAR KERNELS                                   *
+     * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+    // These are the reference implementations, and are also used for the remaining
+    // voxels which do not fill an entire register in the SIMD kernels below.
+
+    void AndScalar(byte *pDst, const byte *pSrc, size_t count)
+    {
+        for (size_t i = 0; i < count; i++) pDst[i] &= pSrc[i];
+    }
+
+    void OrScalar(byte *pDst, const byte *pSrc, size_t count)
+    {
+        for (size_t i = 0; i < count; i++) pDst[i] |= pSrc[i];
+    }
+
+    void XorScalar(byte *pDst, const byte *pSrc, size_t count)
+    {
+        for (size_t i = 0; i < count; i++) pDst[i] ^= pSrc[i];
+    }
+
+    void NotScalar(byte *pDst, size_t count)
+    {
+        for (size_t i = 0; i < count; i++) pDst[i] = !pDst[i];
+    }
+
+    bool EqualScalar(const byte *pSrc, byte cmpVal, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            if (pSrc[i] != cmpVal) return false;
+        }
+        return true;
+    }
+
+    size_t CountScalar(const byte *pSrc, size_t count)
+    {
+        size_t numLit = 0;
+        for (size_t i = 0; i < count; i++) numLit += (pSrc[i] != 0);
+        return numLit;
+    }
+
+    uint64_t SumScalar(const byte *pSrc, size_t count)
+    {
+        uint64_t sum = 0;
+        for (size_t i = 0; i < count; i++) sum += pSrc[i];
+        return sum;
+    }
+
+    void QuantizeScalar(byte *pDst, const uint16_t *pSrc, uint16_t maxVal, size_t count)
+    {
+        // Dividing by 0x10000 instead of 0xFFFF is off by at most 1/256 of a step, and
+        // is what the SIMD kernels compute (with the high half of the product).
+        for (size_t i = 0; i < count; i++)
+        {
+            pDst[i] = (byte)(((uint32_t)pSrc[i] * maxVal + 0x8000) >> 16);
+        }
+    }
+
+    void AverageScalar(uint16_t *pDst, const uint16_t *pR, const uint16_t *pG,
+                       const uint16_t *pB, size_t count)
+    {
+        // Each level is multiplied by 0x5555 / 0x10000 (just under 1/3) separately, so the
+        // sum never overflows 16 bits (and matches the SIMD kernels exactly).
+        for (size_t i = 0; i < count; i++)
+        {
+            pDst[i] = (uint16_t)((((uint32_t)pR[i] * 0x5555) >> 16) +
+                                 (((uint32_t)pG[i] * 0x5555) >> 16) +
+                                 (((uint32_t)pB[i] * 0x5555) >> 16));
+        }
+    }
+
+    // Multiplies two 8-bit values and divides the product by 255, rounded to the nearest
+    // value (without a division, so the SIMD kernels can compute the same result).
+    inline unsigned int Mul255(unsigned int a, unsigned int b)
+    {
+        unsigned int t = a * b + 128;
+        return (t + (t >> 8)) >> 8;
+    }
+
+    void BlendAddScalar(byte *pDst, const byte *pSrc, byte opacity, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            unsigned int v = pDst[i] + Mul255(pSrc[i], opacity);
+            pDst[i] = (byte)((v > 0xFF) ? 0xFF : v);
+        }
+    }
+
+    void BlendMaxScalar(byte *pDst, const byte *pSrc, byte opacity, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            unsigned int s = Mul255(pSrc[i], opacity);
+            if (s > pDst[i]) pDst[i] = (byte)s;
+        }
+    }
+
+    void BlendMultiplyScalar(byte *pDst, const byte *pSrc, byte opacity, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            pDst[i] = (byte)Mul255(pDst[i], 0xFF - opacity + Mul255(pSrc[i], opacity));
+        }
+    }
+
+    void BlendAlphaScalar(byte *pDst, const byte *pSrc, byte opacity, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            // Both terms are rounded, so their sum can be one over full brightness.
+            unsigned int v = Mul255(pDst[i], 0xFF - opacity) + Mul255(pSrc[i], opacity);
+            pDst[i] = (byte)((v > 0xFF) ? 0xFF : v);
+        }
+    }
+
+    void BlendXorScalar(byte *pDst, const byte *pSrc, byte opacity, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            pDst[i] ^= (byte)Mul255(pSrc[i], opacity);
+        }
+    }
+
+    void WindowAddScalar(uint16_t *pSum, const byte *pSrc, size_t count)
+    {
+        for (size_t i = 0; i < count; i++) pSum[i] += pSrc[i];
+    }
+
+    void WindowSubScalar(uint16_t *pSum, const byte *pSrc, size_t count)
+    {
+        for (size_t i = 0; i < count; i++) pSum[i] -= pSrc[i];
+    }
+
+    // Returns the 16-bit reciprocal used to divide by the passed divisor.  The rounded-up
+    // reciprocal gives the exact rounded quotient of any sum of up to 15 voxels.
+    inline uint16_t Reciprocal(byte divisor)
+    {
+        return (uint16_t)((0x10000 + divisor - 1) / divisor);
+    }
+
+    void WindowAverageScalar(byte *pDst, const uint16_t *pSum, byte divisor, size_t count)
+    {
+        uint32_t recip = Reciprocal(divisor),
+                 half  = divisor / 2;
+        for (size_t i = 0; i < count; i++)
+        {
+            pDst[i] = (byte)(((pSum[i] + half) * recip) >> 16);
+        }
+    }
+
+    void ScaleScalar(byte *pDst, uint16_t factor, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            uint32_t v = ((uint32_t)pDst[i] * factor) >> 8;
+            pDst[i] = (byte)((v > 0xFF) ? 0xFF : v);
+        }
+    }
+
+    void ThresholdScalar(byte *pDst, byte level, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            if (pDst[i] < level) pDst[i] = 0;
+        }
+    }
+
+
+#ifdef TC_KERNELS_X86
+    /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+     *                                   SSE2 KERNELS                                    *
+     * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+    // Each of these kernels processes 16 voxels at a time.  Unaligned loads are used, since
+    // rows and planes (unlike the whole voxel buffer) may start at any offset.
+
+    #define TC_SSE2_BINARY_OP(name, intrinsic, scalar)                                   \
+        TC_TARGET("sse2") void name(byte *pDst, const byte *pSrc, size_t count)          \
+        {                                                                                \
+            size_t i = 0;                                                                \
+            for (; i + 16 <= count; i += 16)                                             \
+            {                                                                            \
+                __m128i a = _mm_loadu_si128((const __m128i *)(pDst + i)),                \
+                        b = _mm_loadu_si128((const __m128i *)(pSrc + i));                \
+                _mm_storeu_si128((__m128i *)(pDst + i), intrinsic(a, b));                \
+            }                                                                            \
+            scalar(pDst + i, pSrc + i, count - i);                                       \
+        }
+
+    TC_SSE2_BINARY_OP(AndSSE2, _mm_and_si128, AndScalar)
+    TC_SSE2_BINARY_OP(OrSSE2,  _mm_or_si128,  OrScalar)
+    TC_SSE2_BINARY_OP(XorSSE2, _mm_xor_si128, XorScalar)
+
+    TC_TARGET("sse2") void NotSSE2(byte *pDst, size_t count)
+    {
+        const __m128i zero = _mm_setzero_si128(),
+                      one  = _mm_set1_epi8(1);
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            // Each voxel equal to zero becomes 0xFF (and then 0x01), all others become 0.
+            __m128i a = _mm_loadu_si128((const __m128i *)(pDst + i));
+            _mm_storeu_si128((__m128i *)(pDst + i),
+                             _mm_and_si128(_mm_cmpeq_epi8(a, zero), one));
+        }
+        NotScalar(pDst + i, count - i);
+    }
+
+    TC_TARGET("sse2") bool EqualSSE2(const byte *pSrc, byte cmpVal, size_t count)
+    {
+        const __m128i cmp = _mm_set1_epi8((char)cmpVal);
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            __m128i a = _mm_loadu_si128((const __m128i *)(pSrc + i));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(a, cmp)) != 0xFFFF) return false;
+        }
+        return EqualScalar(pSrc + i, cmpVal, count - i);
+    }
+
+    TC_TARGET("sse2") size_t CountSSE2(const byte *pSrc, size_t count)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        size_t numLit = 0, i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            // Each bit of the mask is set for a voxel equal to zero.
+            __m128i a = _mm_loadu_si128((const __m128i *)(pSrc + i));
+            numLit += 16 - __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(a, zero)));
+        }
+        return numLit + CountScalar(pSrc + i, count - i);
+    }
+
+    TC_TARGET("sse2") uint64_t SumSSE2(const byte *pSrc, size_t count)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        __m128i acc = zero;
+        size_t  i   = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            // The SAD instruction adds each group of 8 voxels into a 64-bit lane.
+            __m128i a = _mm_loadu_si128((const __m128i *)(pSrc + i));
+            acc = _mm_add_epi64(acc, _mm_sad_epu8(a, zero));
+        }
+        uint64_t lanes[2];
+        _mm_storeu_si128((__m128i *)lanes, acc);
+        return lanes[0] + lanes[1] + SumScalar(pSrc + i, count - i);
+    }
+
+    TC_TARGET("sse2") void QuantizeSSE2(byte *pDst, const uint16_t *pSrc, uint16_t maxVal,
+                                        size_t count)
+    {
+        const __m128i scale = _mm_set1_epi16((short)maxVal);
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            // The high half of each product is the result, and the top bit of the low
+            // half rounds it to the nearest value.
+            __m128i a  = _mm_loadu_si128((const __m128i *)(pSrc + i)),
+                    b  = _mm_loadu_si128((const __m128i *)(pSrc + i + 8)),
+                    qa = _mm_add_epi16(_mm_mulhi_epu16(a, scale),
+                                       _mm_srli_epi16(_mm_mullo_epi16(a, scale), 15)),
+                    qb = _mm_add_epi16(_mm_mulhi_epu16(b, scale),
+                                       _mm_srli_epi16(_mm_mullo_epi16(b, scale), 15));
+            _mm_storeu_si128((__m128i *)(pDst + i), _mm_packus_epi16(qa, qb));
+        }
+        QuantizeScalar(pDst + i, pSrc + i, maxVal, count - i);
+    }
+
+    TC_TARGET("sse2") void AverageSSE2(uint16_t *pDst, const uint16_t *pR,
+                                       const uint16_t *pG, const uint16_t *pB, size_t count)
+    {
+        const __m128i third = _mm_set1_epi16(0x5555);
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m128i r = _mm_loadu_si128((const __m128i *)(pR + i)),
+                    g = _mm_loadu_si128((const __m128i *)(pG + i)),
+                    b = _mm_loadu_si128((const __m128i *)(pB + i));
+            _mm_storeu_si128((__m128i *)(pDst + i),
+                             _mm_add_epi16(_mm_add_epi16(_mm_mulhi_epu16(r, third),
+                                                         _mm_mulhi_epu16(g, third)),
+                                           _mm_mulhi_epu16(b, third)));
+        }
+        AverageScalar(pDst + i, pR + i, pG + i, pB + i, count - i);
+    }
+
+    // Same as Mul255, on eight 16-bit lanes.
+    TC_TARGET("sse2") inline __m128i Mul255SSE2(__m128i a, __m128i b)
+    {
+        __m128i t = _mm_add_epi16(_mm_mullo_epi16(a, b), _mm_set1_epi16(128));
+        return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+    }
+
+    // The blending kernels widen each voxel to 16 bits, combine the destination (d) with
+    // the scaled source (s) using the passed expression, and narrow the result again with
+    // unsigned saturation (which clamps it to 255).  The inverse opacity is in inv.
+    #define TC_SSE2_BLEND_OP(name, expr, scalar)                                         \
+        TC_TARGET("sse2") void name(byte *pDst, const byte *pSrc, byte opacity,          \
+                                    size_t count)                                        \
+        {                                                                                \
+            const __m128i zero = _mm_setzero_si128(),                                    \
+                          op   = _mm_set1_epi16(opacity),                                \
+                          inv  = _mm_set1_epi16(0xFF - opacity);                         \
+            (void)inv;                                                                   \
+            size_t i = 0;                                                                \
+            for (; i + 16 <= count; i += 16)                                             \
+            {                                                                            \
+                __m128i a = _mm_loadu_si128((const __m128i *)(pDst + i)),                \
+                        b = _mm_loadu_si128((const __m128i *)(pSrc + i)),                \
+                        d, s, lo, hi;                                                    \
+                d  = _mm_unpacklo_epi8(a, zero);                                         \
+                s  = Mul255SSE2(_mm_unpacklo_epi8(b, zero), op);                         \
+                lo = expr;                                                               \
+                d  = _mm_unpackhi_epi8(a, zero);                                         \
+                s  = Mul255SSE2(_mm_unpackhi_epi8(b, zero), op);                         \
+                hi = expr;                                                               \
+                _mm_storeu_si128((__m128i *)(pDst + i), _mm_packus_epi16(lo, hi));       \
+            }                                                                            \
+            scalar(pDst + i, pSrc + i, opacity, count - i);                              \
+        }
+
+    TC_SSE2_BLEND_OP(BlendAddSSE2,      _mm_add_epi16(d, s),               BlendAddScalar)
+    TC_SSE2_BLEND_OP(BlendMaxSSE2,      _mm_max_epi16(d, s),               BlendMaxScalar)
+    TC_SSE2_BLEND_OP(BlendMultiplySSE2, Mul255SSE2(d, _mm_add_epi16(inv, s)),
+                     BlendMultiplyScalar)
+    TC_SSE2_BLEND_OP(BlendAlphaSSE2,    _mm_add_epi16(Mul255SSE2(d, inv), s),
+                     BlendAlphaScalar)
+    TC_SSE2_BLEND_OP(BlendXorSSE2,      _mm_xor_si128(d, s),               BlendXorScalar)
+
+    // The window kernels widen 16 voxels to two registers of 16-bit sums at a time.
+    #define TC_SSE2_WINDOW_OP(name, intrinsic, scalar)                                   \
+        TC_TARGET("sse2") void name(uint16_t *pSum, const byte *pSrc, size_t count)      \
+        {                                                                                \
+            const __m128i zero = _mm_setzero_si128();                                    \
+            size_t i = 0;                                                                \
+            for (; i + 16 <= count; i += 16)                                             \
+            {                                                                            \
+                __m128i a  = _mm_loadu_si128((const __m128i *)(pSrc + i)),               \
+                        lo = _mm_loadu_si128((const __m128i *)(pSum + i)),               \
+                        hi = _mm_loadu_si128((const __m128i *)(pSum + i + 8));           \
+                _mm_storeu_si128((__m128i *)(pSum + i),                                  \
+                                 intrinsic(lo, _mm_unpacklo_epi8(a, zero)));             \
+                _mm_storeu_si128((__m128i *)(pSum + i + 8),                              \
+                                 intrinsic(hi, _mm_unpackhi_epi8(a, zero)));             \
+            }                                                                            \
+            scalar(pSum + i, pSrc + i, count - i);                                       \
+        }
+
+    TC_SSE2_WINDOW_OP(WindowAddSSE2, _mm_add_epi16, WindowAddScalar)
+    TC_SSE2_WINDOW_OP(WindowSubSSE2, _mm_sub_epi16, WindowSubScalar)
+
+    TC_TARGET("sse2") void WindowAverageSSE2(byte *pDst, const uint16_t *pSum, byte divisor,
+                                             size_t count)
+    {
+        const __m128i recip = _mm_set1_epi16((short)Reciprocal(divisor)),
+                      half  = _mm_set1_epi16(divisor / 2);
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            __m128i a = _mm_loadu_si128((const __m128i *)(pSum + i)),
+                    b = _mm_loadu_si128((const __m128i *)(pSum + i + 8));
+            _mm_storeu_si128((__m128i *)(pDst + i),
+                             _mm_packus_epi16(_mm_mulhi_epu16(_mm_add_epi16(a, half), recip),
+                                              _mm_mulhi_epu16(_mm_add_epi16(b, half), recip)));
+        }
+        WindowAverageScalar(pDst + i, pSum + i, divisor, count - i);
+    }
+
+    TC_TARGET("sse2") void ScaleSSE2(byte *pDst, uint16_t factor, size_t count)
+    {
+        const __m128i zero  = _mm_setzero_si128(),
+                      scale = _mm_set1_epi16((short)factor);
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            // Each voxel is moved to the high byte of its lane, so the high half of the
+            // product is the voxel times the factor divided by 256 (which stays positive
+            // for the signed saturation of the pack, since the factor is below 0x8000).
+            __m128i a = _mm_loadu_si128((const __m128i *)(pDst + i));
+            _mm_storeu_si128((__m128i *)(pDst + i),
+                _mm_packus_epi16(_mm_mulhi_epu16(_mm_unpacklo_epi8(zero, a), scale),
+                                 _mm_mulhi_epu16(_mm_unpackhi_epi8(zero, a), scale)));
+        }
+        ScaleScalar(pDst + i, factor, count - i);
+    }
+
+    TC_TARGET("sse2") void ThresholdSSE2(byte *pDst, byte level, size_t count)
+    {
+        const __m128i lvl = _mm_set1_epi8((char)level);
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            // A voxel is at least the level if the larger of the two is the voxel.
+            __m128i a = _mm_loadu_si128((const __m128i *)(pDst + i));
+            _mm_storeu_si128((__m128i *)(pDst + i),
+                             _mm_and_si128(a, _mm_cmpeq_epi8(_mm_max_epu8(a, lvl), a)));
+        }
+        ThresholdScalar(pDst + i, level, count - i);
+    }
+
+
+    /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+     *                                   AVX2 KERNELS                                    *
+     * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+    // Each of these kernels processes 32 voxels at a time, and passes any remaining
+    // voxels to the SSE2 kernels (which every AVX2 processor also supports).
+
+    #define TC_AVX2_BINARY_OP(name, intrinsic, sse2)                                     \
+        TC_TARGET("avx2") void name(byte *pDst, const byte *pSrc, size_t count)          \
+        {                                                                                \
+            size_t i = 0;                                                                \
+            for (; i + 32 <= count; i += 32)                                             \
+            {                                                                            \
+                __m256i a = _mm256_loadu_si256((const __m256i *)(pDst + i)),             \
+                        b = _mm256_loadu_si256((const __m256i *)(pSrc + i));             \
+                _mm256_storeu_si256((__m256i *)(pDst + i), intrinsic(a, b));             \
+            }                                                                            \
+            sse2(pDst + i, pSrc + i, count - i);                                         \
+        }
+
+    TC_AVX2_BINARY_OP(AndAVX2, _mm256_and_si256, AndSSE2)
+    TC_AVX2_BINARY_OP(OrAVX2,  _mm256_or_si256,  OrSSE2)
+    TC_AVX2_BINARY_OP(XorAVX2, _mm256_xor_si256, XorSSE2)
+
+    TC_TARGET("avx2") void NotAVX2(byte *pDst, size_t count)
+    {
+        const __m256i zero = _mm256_setzero_si256(),
+                      one  = _mm256_set1_epi8(1);
+        size_t i = 0;
+        for (; i + 32 <= count; i += 32)
+        {
+            __m256i a = _mm256_loadu_si256((const __m256i *)(pDst + i));
+            _mm256_storeu_si256((__m256i *)(pDst + i),
+                                _mm256_and_si256(_mm256_cmpeq_epi8(a, zero), one));
+        }
+        NotSSE2(pDst + i, count - i);
+    }
+
+    TC_TARGET("avx2") bool EqualAVX2(const byte *pSrc, byte cmpVal, size_t count)
+    {
+        const __m256i cmp = _mm256_set1_epi8((char)cmpVal);
+        size_t i = 0;
+        for (; i + 32 <= count; i += 32)
+        {
+            __m256i a = _mm256_loadu_si256((const __m256i *)(pSrc + i));
+            if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, cmp)) != -1) return false;
+        }
+        return EqualSSE2(pSrc + i, cmpVal, count - i);
+    }
+
+    TC_TARGET("avx2,popcnt") size_t CountAVX2(const byte *pSrc, size_t count)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        size_t numLit = 0, i = 0;
+        for (; i + 32 <= count; i += 32)
+        {
+            __m256i a = _mm256_loadu_si256((const __m256i *)(pSrc + i));
+            numLit += 32 - _mm_popcnt_u32(
+                (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, zero)));
+        }
+        return numLit + CountSSE2(pSrc + i, count - i);
+    }
+
+    TC_TARGET("avx2") uint64_t SumAVX2(const byte *pSrc, size_t count)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        __m256i acc = zero;
+        size_t  i   = 0;
+        for (; i + 32 <= count; i += 32)
+        {
+            __m256i a = _mm256_loadu_si256((const __m256i *)(pSrc + i));
+            acc = _mm256_add_epi64(acc, _mm256_sad_epu8(a, zero));
+        }
+        uint64_t lanes[4];
+        _mm256_storeu_si256((__m256i *)lanes, acc);
+        return lanes[0] + lanes[1] + lanes[2] + lanes[3] + SumSSE2(pSrc + i, count - i);
+    }
+
+    TC_TARGET("avx2") void QuantizeAVX2(byte *pDst, const uint16_t *pSrc, uint16_t maxVal,
+                                        size_t count)
+    {
+        const __m256i scale = _mm256_set1_epi16((short)maxVal);
+        size_t i = 0;
+        for (; i + 32 <= count; i += 32)
+        {
+            __m256i a  = _mm256_loadu_si256((const __m256i *)(pSrc + i)),
+                    b  = _mm256_loadu_si256((const __m256i *)(pSrc + i + 16)),
+                    qa = _mm256_add_epi16(_mm256_mulhi_epu16(a, scale),
+                                          _mm256_srli_epi16(_mm256_mullo_epi16(a, scale), 15)),
+                    qb = _mm256_add_epi16(_mm256_mulhi_epu16(b, scale),
+                                          _mm256_srli_epi16(_mm256_mullo_epi16(b, scale), 15));
+            // The pack works within each 128-bit lane, so the 64-bit groups are reordered.
+            _mm256_storeu_si256((__m256i *)(pDst + i),
+                _mm256_permute4x64_epi64(_mm256_packus_epi16(qa, qb), 0xD8));
+        }
+        QuantizeSSE2(pDst + i, pSrc + i, maxVal, count - i);
+    }
+
+    TC_TARGET("avx2") void AverageAVX2(uint16_t *pDst, const uint16_t *pR,
+                                       const uint16_t *pG, const uint16_t *pB, size_t count)
+    {
+        const __m256i third = _mm256_set1_epi16(0x5555);
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            __m256i r = _mm256_loadu_si256((const __m256i *)(pR + i)),
+                    g = _mm256_loadu_si256((const __m256i *)(pG + i)),
+                    b = _mm256_loadu_si256((const __m256i *)(pB + i));
+            _mm256_storeu_si256((__m256i *)(pDst + i),
+                _mm256_add_epi16(_mm256_add_epi16(_mm256_mulhi_epu16(r, third),
+                                                  _mm256_mulhi_epu16(g, third)),
+                                 _mm256_mulhi_epu16(b, third)));
+        }
+        AverageSSE2(pDst + i, pR + i, pG + i, pB + i, count - i);
+    }
+
+    // Same as Mul255, on sixteen 16-bit lanes.
+    TC_TARGET("avx2") inline __m256i Mul255AVX2(__m256i a, __m256i b)
+    {
+        __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(a, b), _mm256_set1_epi16(128));
+        return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+    }
+
+    // Same as TC_SSE2_BLEND_OP.  The unpack and pack instructions both work within each
+    // 128-bit lane, so the voxels end up back in their original order.
+    #define TC_AVX2_BLEND_OP(name, expr, sse2)                                           \
+        TC_TARGET("avx2") void name(byte *pDst, const byte *pSrc, byte opacity,          \
+                                    size_t count)                                        \
+        {                                                                                \
+            const __m256i zero = _mm256_setzero_si256(),                                 \
+                          op   = _mm256_set1_epi16(opacity),                             \
+                          inv  = _mm256_set1_epi16(0xFF - opacity);                      \
+            (void)inv;                                                                   \
+            size_t i = 0;                                                                \
+            for (; i + 32 <= count; i += 32)                                             \
+            {                                                                            \
+                __m256i a = _mm256_loadu_si256((const __m256i *)(pDst + i)),             \
+                        b = _mm256_loadu_si256((const __m256i *)(pSrc + i)),             \
+                        d, s, lo, hi;                                                    \
+                d  = _mm256_unpacklo_epi8(a, zero);                                      \
+                s  = Mul255AVX2(_mm256_unpacklo_epi8(b, zero), op);                      \
+                lo = expr;                                                               \
+                d  = _mm256_unpackhi_epi8(a, zero);                                      \
+                s  = Mul255AVX2(_mm256_unpackhi_epi8(b, zero), op);                      \
+                hi = expr;                                                               \
+                _mm256_storeu_si256((__m256i *)(pDst + i), _mm256_packus_epi16(lo, hi)); \
+            }                                                                            \
+            sse2(pDst + i, pSrc + i, opacity, count - i);                                \
+        }
+
+    TC_AVX2_BLEND_OP(BlendAddAVX2,      _mm256_add_epi16(d, s),            BlendAddSSE2)
+    TC_AVX2_BLEND_OP(BlendMaxAVX2,      _mm256_max_epi16(d, s),            BlendMaxSSE2)
+    TC_AVX2_BLEND_OP(BlendMultiplyAVX2, Mul255AVX2(d, _mm256_add_epi16(inv, s)),
+                     BlendMultiplySSE2)
+    TC_AVX2_BLEND_OP(BlendAlphaAVX2,    _mm256_add_epi16(Mul255AVX2(d, inv), s),
+                     BlendAlphaSSE2)
+    TC_AVX2_BLEND_OP(BlendXorAVX2,      _mm256_xor_si256(d, s),            BlendXorSSE2)
+
+    // The voxels are widened 16 at a time (in order) with a zero extension.
+    #define TC_AVX2_WINDOW_OP(name, intrinsic, sse2)                                     \
+        TC_TARGET("avx2") void name(uint16_t *pSum, const byte *pSrc, size_t count)      \
+        {                                                                                \
+            size_t i = 0;                                                                \
+            for (; i + 32 <= count; i += 32)                                             \
+            {                                                                            \
+                __m256i a  = _mm256_cvtepu8_epi16(                                       \
+                                 _mm_loadu_si128((const __m128i *)(pSrc + i))),          \
+                        b  = _mm256_cvtepu8_epi16(                                       \
+                                 _mm_loadu_si128((const __m128i *)(pSrc + i + 16))),     \
+                        lo = _mm256_loadu_si256((const __m256i *)(pSum + i)),            \
+                        hi = _mm256_loadu_si256((const __m256i *)(pSum + i + 16));       \
+                _mm256_storeu_si256((__m256i *)(pSum + i),      intrinsic(lo, a));       \
+                _mm256_storeu_si256((__m256i *)(pSum + i + 16), intrinsic(hi, b));       \
+            }                                                                            \
+            sse2(pSum + i, pSrc + i, count - i);                                         \
+        }
+
+    TC_AVX2_WINDOW_OP(WindowAddAVX2, _mm256_add_epi16, WindowAddSSE2)
+    TC_AVX2_WINDOW_OP(WindowSubAVX2, _mm256_sub_epi16, WindowSubSSE2)
+
+    TC_TARGET("avx2") void WindowAverageAVX2(byte *pDst, const uint16_t *pSum, byte divisor,
+                                             size_t count)
+    {
+        const __m256i recip = _mm256_set1_epi16((short)Reciprocal(divisor)),
+                      half  = _mm256_set1_epi16(divisor / 2);
+        size_t i = 0;
+        for (; i + 32 <= count; i += 32)
+        {
+            __m256i a = _mm256_loadu_si256((const __m256i *)(pSum + i)),
+                    b = _mm256_loadu_si256((const __m256i *)(pSum + i + 16)),
+                    q = _mm256_packus_epi16(
+                            _mm256_mulhi_epu16(_mm256_add_epi16(a, half), recip),
+                            _mm256_mulhi_epu16(_mm256_add_epi16(b, half), recip));
+            // The pack works within each 128-bit lane, so the 64-bit groups are reordered.
+            _mm256_storeu_si256((__m256i *)(pDst + i), _mm256_permute4x64_epi64(q, 0xD8));
+        }
+        WindowAverageSSE2(pDst + i, pSum + i, divisor, count - i);
+    }
+
+    TC_TARGET("avx2") void ScaleAVX2(byte *pDst, uint16_t factor, size_t count)
+    {
+        const __m256i zero  = _mm256_setzero_si256(),
+                      scale = _mm256_set1_epi16((short)factor);
+        size_t i = 0;
+        for (; i + 32 <= count; i += 32)
+        {
+            // The unpack and pack instructions both work within each 128-bit lane, so the
+            // voxels end up back in their original order.
+            __m256i a = _mm256_loadu_si256((const __m256i *)(pDst + i));
+            _mm256_storeu_si256((__m256i *)(pDst + i),
+                _mm256_packus_epi16(_mm256_mulhi_epu16(_mm256_unpacklo_epi8(zero, a), scale),
+                                    _mm256_mulhi_epu16(_mm256_unpackhi_epi8(zero, a), scale)));
+        }
+        ScaleSSE2(pDst + i, factor, count - i);
+    }
+
+    TC_TARGET("avx2") void ThresholdAVX2(byte *pDst, byte level, size_t count)
+    {
+        const __m256i lvl = _mm256_set1_epi8((char)level);
+        size_t i = 0;
+        for (; i + 32 <= count; i += 32)
+        {
+            __m256i a = _mm256_loadu_si256((const __m256i *)(pDst + i));
+            _mm256_storeu_si256((__m256i *)(pDst + i),
+                _mm256_and_si256(a, _mm256_cmpeq_epi8(_mm256_max_epu8(a, lvl), a)));
+        }
+        ThresholdSSE2(pDst + i, level, count - i);
+    }
+#endif
+
+
+    /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+     *                                 KERNEL SELECTION                                  *
+     * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+    BinaryOp  And   = AndScalar;        ///< The selected AND kernel.
+    BinaryOp  Or    = OrScalar;         ///< The selected OR kernel.
+    BinaryOp  Xor   = XorScalar;        ///< The selected XOR kernel.
+    UnaryOp   Not   = NotScalar;        ///< The selected NOT kernel.
+    CompareOp Equal = EqualScalar;      ///< The selected comparison kernel.
+    CountOp   Count = CountScalar;      ///< The selected counting kernel.
+    SumOp     Sum   = SumScalar;        ///< The selected summing kernel.
+
+    QuantizeOp Quantize = QuantizeScalar;   ///< The selected quantization kernel.
+    AverageOp  Average  = AverageScalar;    ///< The selected averaging kernel.
+
+    BlendOp BlendAdd      = BlendAddScalar;         ///< The selected add blending kernel.
+    BlendOp BlendMax      = BlendMaxScalar;         ///< The selected max blending kernel.
+    BlendOp BlendMultiply = BlendMultiplyScalar;    ///< The selected multiply kernel.
+    BlendOp BlendAlpha    = BlendAlphaScalar;       ///< The selected alpha kernel.
+    BlendOp BlendXor      = BlendXorScalar;         ///< The selected XOR blending kernel.
+
+    WindowOp    WindowAdd     = WindowAddScalar;    ///< The selected window adding kernel.
+    WindowOp    WindowSub     = WindowSubScalar;    ///< The selected window removal kernel.
+    DivideOp    WindowAverage = WindowAverageScalar;///< The selected averaging kernel.
+    ScaleOp     Scale         = ScaleScalar;        ///< The selected scaling kernel.
+    ThresholdOp Threshold     = ThresholdScalar;    ///< The selected threshold kernel.
+
+    int selected = TC_KERNELS_SCALAR;   ///< The currently selected kernel set.
+
+
+    ///
+    /// \brief Initialize Kernels
+    ///
+    /// Selects the fastest kernel set supported by the current CPU.  Until this is called,
+    /// the scalar kernels are used.
+    ///
+    /// \see IsSupported | Select
+    ///
+    void Init()
+    {
+        for (int kernelSet = TC_KERNELS_COUNT - 1; kernelSet > TC_KERNELS_SCALAR; kernelSet--)
+        {
+            if (Select(kernelSet)) return;
+        }
+        Select(TC_KERNELS_SCALAR);
+    }
+
+
+    ///
+    /// \brief Is Supported
+    ///
+    /// Checks if the current CPU (and build) supports the passed kernel set.
+    ///
+    /// \param kernelSet The kernel set to check (e.g. TC_KERNELS_AVX2).
+    ///
+    /// \returns True if the kernel set can be used, false otherwise.
+    ///
+    bool IsSupported(int kernelSet)
+    {
+        switch (kernelSet)
+        {
+            case TC_KERNELS_SCALAR:
+                return true;
+#ifdef TC_KERNELS_X86
+            case TC_KERNELS_SSE2:
+                return __builtin_cpu_supports("sse2");
+            case TC_KERNELS_AVX2:
+                return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+#endif
+        }
+        return false;
+    }
+
+
+    ///
+    /// \brief Select Kernels
+    ///
+    /// Sets every kernel function pointer to the implementation from the passed kernel set.
+    ///
+    /// \param kernelSet The kernel set to use (e.g. TC_KERNELS_SSE2).
+    ///
+    /// \returns True if the kernel set was selected, false if it is not supported (in
+    ///          which case the current kernels are left unchanged).
+    ///
+    bool Select(int kernelSet)
+    {
+        if (!IsSupported(kernelSet)) return false;
+        switch (kernelSet)
+        {
+            case TC_KERNELS_SCALAR:
+                And = AndScalar; Or = OrScalar; Xor = XorScalar;
+                Not = NotScalar; Equal = EqualScalar;
+                Count = CountScalar; Sum = SumScalar;
+                Quantize = QuantizeScalar; Average = AverageScalar;
+                BlendAdd = BlendAddScalar; BlendMax = BlendMaxScalar;
+                BlendMultiply = BlendMultiplyScalar; BlendAlpha = BlendAlphaScalar;
+                BlendXor = BlendXorScalar;
+                WindowAdd = WindowAddScalar; WindowSub = WindowSubScalar;
+                WindowAverage = WindowAverageScalar;
+                Scale = ScaleScalar; Threshold = ThresholdScalar;
+                break;
+#ifdef TC_KERNELS_X86
+            case TC_KERNELS_SSE2:
+                And = AndSSE2; Or = OrSSE2; Xor = XorSSE2;
+                Not = NotSSE2; Equal = EqualSSE2;
+                Count = CountSSE2; Sum = SumSSE2;
+                Quantize = QuantizeSSE2; Average = AverageSSE2;
+                BlendAdd = BlendAddSSE2; BlendMax = BlendMaxSSE2;
+                BlendMultiply = BlendMultiplySSE2; BlendAlpha = BlendAlphaSSE2;
+                BlendXor = BlendXorSSE2;
+                WindowAdd = WindowAddSSE2; WindowSub = WindowSubSSE2;
+                WindowAverage = WindowAverageSSE2;
+                Scale = ScaleSSE2; Threshold = ThresholdSSE2;
+                break;
+            case TC_KERNELS_AVX2:
+                And = AndAVX2; Or = OrAVX2; Xor = XorAVX2;
+                Not = NotAVX2; Equal = EqualAVX2;
+                Count = CountAVX2; Sum = SumAVX2;
+                Quantize = QuantizeAVX2; Average = AverageAVX2;
+                BlendAdd = BlendAddAVX2; BlendMax = BlendMaxAVX2;
+                BlendMultiply = BlendMultiplyAVX2; BlendAlpha = BlendAlphaAVX2;
+                BlendXor = BlendXorAVX2;
+                WindowAdd = WindowAddAVX2; WindowSub = WindowSubAVX2;
+                WindowAverage = WindowAverageAVX2;
+                Scale = ScaleAVX2; Threshold = ThresholdAVX2;
+                break;
+#endif
+        }
+        selected = kernelSet;
+        return true;
+    }
+
+
+    ///
+    /// \brief Get Selected Kernels
+    ///
+    /// \returns The currently selected kernel set (e.g. TC_KERNELS_SCALAR).
+    ///
+    int GetSelected()
+    {
+        return selected;
+    }
+
+
+    ///
+    /// \brief Get Kernel Set Name
+    ///
+    /// \param kernelSet The kernel set to get the name of.
+    ///
+    /// \returns A string containing the name of the kernel set (e.g. "AVX2").
+    ///
+    const char *GetName(int kernelSet)
+    {
+        switch (kernelSet)
+        {
+            case TC_KERNELS_SCALAR: return "scalar";
+            case TC_KERNELS_SSE2:   return "SSE2";
+            case TC_KERNELS_AVX2:   return "AVX2";
+        }
+        return "unknown";
+    }
+}
@@ -0,0 +1,106 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *                               Cube Kernels Header File                              *
+ *                                      TRICLYSM                                       *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  This file contains the definitions of the voxel buffer kernels implemented in      *
+ *  cube_kernels.cpp.  These functions perform the bulk operations of the TCCube class  *
+ *  (e.g. the cube operators), and are selected at startup based on the instruction    *
+ *  sets supported by the CPU (scalar, SSE2, or AVX2).                                 *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                     *
+ *  Copyright (C) 2011 Brandon Castellano, Ryan Mantha. All rights reserved.           *
+ *  Triclysm is provided under the BSD-2-Clause license. This program uses the SDL     *
+ *  (Simple DirectMedia Layer) library, and the Lua scripting language. See the        *
+ *  included LICENSE file or <http://www.triclysm.com/> for more details.              *
+ *                                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+///
+/// \file  cube_kernels.h
+/// \brief This file contains the definitions of the voxel buffer kernels, and the
+///        functions used to select which implementation of them is used.
+///
+
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                               PREPROCESSOR DIRECTIVES                               *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#pragma once
+#ifndef TC_CUBE_KERNELS_
+#define TC_CUBE_KERNELS_
+
+#include <cstddef>
+#include <stdint.h>
+#include "TCCube.h"
+
+// Kernel Set Definitions
+#define TC_KERNELS_SCALAR   0   ///< Specifies the portable scalar kernels.
+#define TC_KERNELS_SSE2     1   ///< Specifies the SSE2 (16 voxels at a time) kernels.
+#define TC_KERNELS_AVX2     2   ///< Specifies the AVX2 (32 voxels at a time) kernels.
+#define TC_KERNELS_COUNT    3   ///< The number of kernel sets.
+
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                 FUNCTION PROTOTYPES                                 *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+namespace TC_Kernels
+{
+    // Kernel function types (each one works on count consecutive voxels):
+    typedef void (*BinaryOp)(byte *pDst, const byte *pSrc, size_t count);
+    typedef void (*UnaryOp)(byte *pDst, size_t count);
+    typedef bool (*CompareOp)(const byte *pSrc, byte cmpVal, size_t count);
+    typedef size_t   (*CountOp)(const byte *pSrc, size_t count);
+    typedef uint64_t (*SumOp)(const byte *pSrc, size_t count);
+    typedef void (*QuantizeOp)(byte *pDst, const uint16_t *pSrc, uint16_t maxVal,
+                               size_t count);
+    typedef void (*AverageOp)(uint16_t *pDst, const uint16_t *pR, const uint16_t *pG,
+                              const uint16_t *pB, size_t count);
+    typedef void (*BlendOp)(byte *pDst, const byte *pSrc, byte opacity, size_t count);
+    typedef void (*WindowOp)(uint16_t *pSum, const byte *pSrc, size_t count);
+    typedef void (*DivideOp)(byte *pDst, const uint16_t *pSum, byte divisor, size_t count);
+    typedef void (*ScaleOp)(byte *pDst, uint16_t factor, size_t count);
+    typedef void (*ThresholdOp)(byte *pDst, byte level, size_t count);
+
+    // The currently selected kernels (initially the scalar ones):
+    extern BinaryOp  And;       // pDst[i] &= pSrc[i]
+    extern BinaryOp  Or;        // pDst[i] |= pSrc[i]
+    extern BinaryOp  Xor;       // pDst[i] ^= pSrc[i]
+    extern UnaryOp   Not;       // pDst[i]  = !pDst[i]
+    extern CompareOp Equal;     // True if every pSrc[i] == cmpVal
+    extern CountOp   Count;     // Number of pSrc[i] != 0
+    extern SumOp     Sum;       // Sum of every pSrc[i]
+
+    // Tone mapping kernels (on 16-bit levels, where 0xFFFF is full brightness):
+    extern QuantizeOp Quantize; // pDst[i] = pSrc[i] * maxVal / 0xFFFF (rounded)
+    extern AverageOp  Average;  // pDst[i] = (pR[i] + pG[i] + pB[i]) / 3
+
+    // Blending kernels (on 8-bit colors, where s = pSrc[i] * opacity / 255, rounded, and
+    // the result is clamped to 255):
+    extern BlendOp BlendAdd;        // pDst[i] = pDst[i] + s
+    extern BlendOp BlendMax;        // pDst[i] = max(pDst[i], s)
+    extern BlendOp BlendMultiply;   // pDst[i] = pDst[i] * (255 - opacity + s) / 255
+    extern BlendOp BlendAlpha;      // pDst[i] = pDst[i] * (255 - opacity) / 255 + s
+    extern BlendOp BlendXor;        // pDst[i] = pDst[i] ^ s
+
+    // Effect kernels (see TCEffectChain):
+    extern WindowOp    WindowAdd;       // pSum[i] += pSrc[i]
+    extern WindowOp    WindowSub;       // pSum[i] -= pSrc[i]
+    extern DivideOp    WindowAverage;   // pDst[i] = pSum[i] / divisor (rounded, 2 to 15)
+    extern ScaleOp     Scale;           // pDst[i] = pDst[i] * factor / 256 (factor < 0x8000)
+    extern ThresholdOp Threshold;       // pDst[i] = (pDst[i] < level) ? 0 : pDst[i]
+
+    // Kernel selection functions:
+    void        Init();                     // Selects the best supported kernel set.
+    bool        IsSupported(int kernelSet); // True if the CPU supports the kernel set.
+    bool        Select(int kernelSet);      // Selects a specific kernel set.
+    int         GetSelected();              // Returns the selected kernel set.
+    const char *GetName(int kernelSet);     // Returns the name of a kernel set.
+}
+
+#endif
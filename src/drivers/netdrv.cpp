@@ -52,9 +52,10 @@ std::vector<cubeInfo> cubeList; ///< Holds all devices found by the `netdrv list
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
 TCDriver_netdrv::TCDriver_netdrv(cubeInfo &cube_params, bool &connected, Uint32 rate)
-    : TCDriver(rate)
+    : TCDriver(rate), lastFrameGen(0), lastFrameTone(0)
 {
     connected = false;
+    lastFrameLedOn[0] = lastFrameLedOn[1] = lastFrameLedOn[2] = 0.0f;
 
     // Create UDP sockets.
     if (    !(sckSend = SDLNet_UDP_Open(PortToInt(cube_params.cube_listenport)))
@@ -82,18 +83,6 @@ TCDriver_netdrv::TCDriver_netdrv(cubeInfo &cube_params, bool &connected, Uint32
     remoteCubeSize[1] = cube_params.cube_size[1];
     remoteCubeSize[2] = cube_params.cube_size[2];
 
-
-    // Update the current cube size to match the physical cube.
-    byte *currSize = GetCubeSize();
-    // We only need to change the size if there is a mis-match.
-    if ( !(    remoteCubeSize[0] == currSize[0]
-            && remoteCubeSize[1] == currSize[1]
-            && remoteCubeSize[2] == currSize[2] ))
-    {
-        SetCubeSize(remoteCubeSize[0], remoteCubeSize[1], remoteCubeSize[2]);
-    }
-    delete currSize;
-
     // Finally, set the connected flag to true.
     connected = true;
 }
@@ -132,11 +121,51 @@ bool TCDriver_netdrv::RecvString(std::string &toRecv)
 
 
 void TCDriver_netdrv::Poll()
+{
+    // Stream the last frame published by the animation thread (so we never have to wait
+    // for a Tick to finish).
+    TCFrame *frame = AcquireFrame(TC_FRAME_READER_DRIVER);
+    if (frame != NULL) SendFrame(frame);
+}
+
+
+void TCDriver_netdrv::SendFrame(TCFrame *frame)
 {
     std::string toSend = "*TF*";
-    byte nc = currAnim->GetNumColors();
-    // Finally, stream cube data.
-    LockAnimMutex();
+    byte nc = frame->GetNumColors();
+    // The LED colour is read once, since the driver may not run on the console thread.
+    float ledOn[3];
+    GetLedOnColor(ledOn);
+    // If the cube state (and LED colour and tone mapping) has not changed since the last
+    // frame was encoded, we can just send the same frame again.
+    uint64_t     currGen  = frame->GetGeneration();
+    unsigned int currTone = TCToneMap::GetSettingsVersion();
+    if (    !lastFrame.empty() && currGen == lastFrameGen && currTone == lastFrameTone
+         && lastFrameLedOn[0] == ledOn[0] && lastFrameLedOn[1] == ledOn[1]
+         && lastFrameLedOn[2] == ledOn[2] )
+    {
+        frame->Release();
+        SendCommand(lastFrame);
+        return;
+    }
+    // The frame is encoded without any bounds checking, so we check once that the cube
+    // is at least as big as the frame (it may have been resized after connecting).
+    byte frameSize = (    frameFormat == TC_FF_0C_444_BITPACK
+                       || frameFormat == TC_FF_3C_444 ) ? 4 : 8;
+    for (byte axis = TC_X_AXIS; axis <= TC_Z_AXIS; axis++)
+    {
+        if (frame->GetSize(axis) < frameSize)
+        {
+            frame->Release();
+            return;
+        }
+    }
+    // The brightness levels are converted to the number of bits used by the frame format
+    // once for the whole frame (see TCToneMap), and each voxel's level is then found in
+    // the output at the same offset as in the frame's voxel buffers.
+    size_t      strideX = frame->GetStride(TC_X_AXIS),
+                strideY = frame->GetStride(TC_Y_AXIS);
+    const byte *pLevel[3];
     switch (frameFormat)
     {
         //
@@ -151,7 +180,7 @@ void TCDriver_netdrv::Poll()
                     Uint8 sliceData = 0x00;
                     for (int x = 0; x < 8; x++)
                     {
-                        if (currAnim->GetVoxelColor(x, y, z))
+                        if (frame->GetVoxelColor(x, y, z))
                         {
                             sliceData |= (1 << x);
                         }
@@ -166,45 +195,17 @@ void TCDriver_netdrv::Poll()
         // Each byte represents two 4-bit voxel brightness values.
         //
         case TC_FF_1C_888_CD4_BYTEPACK:
-            if (nc == 1)
-            {
-                for (int z = 0; z < 8; z++)
-                {
-                    for (int y = 0; y < 8; y++)
-                    {
-                        for (int x = 0; x < 4; x++)
-                        {
-                            Uint8 toAdd = 0x00,
-                                  colVal;
-
-                            colVal = ((Uint8)currAnim->cubeState[0]->GetVoxelState((2*x), y, z)) >> 4;
-                            toAdd = colVal & 0x0F;
-                            colVal = ((Uint8)currAnim->cubeState[0]->GetVoxelState((2*x)+1, y, z));
-                            toAdd |= (colVal & 0xF0);
-
-                            // put 2*x in lower vox., (2*x)+1 in upper.
-                            toSend += (char)toAdd;
-                        }
-                    }
-                }
-            }
-            else
+            toneMap.Map(*frame, 1, 4);
+            pLevel[0] = toneMap.GetOutput(0);
+            for (int z = 0; z < 8; z++)
             {
-                for (int z = 0; z < 8; z++)
+                for (int y = 0; y < 8; y++)
                 {
-                    for (int y = 0; y < 8; y++)
+                    for (int x = 0; x < 4; x++)
                     {
-                        for (int x = 0; x < 4; x++)
-                        {
-                            Uint8 toAdd = 0x00;
-                            if (currAnim->GetVoxelColor((2*x), y, z))
-                                toAdd |= (0x0F);
-
-                            if (currAnim->GetVoxelColor((2*x)+1, y, z))
-                                toAdd |= (0xF0);
-
-                            toSend += (char)toAdd;
-                        }
+                        // put 2*x in lower vox., (2*x)+1 in upper.
+                        size_t i = (2*x) * strideX + y * strideY + z;
+                        toSend += (char)(pLevel[0][i] | (pLevel[0][i + strideX] << 4));
                     }
                 }
             }
@@ -216,49 +217,17 @@ void TCDriver_netdrv::Poll()
         // Each byte represents each voxel's 6-bit brightness value.
         //
         case TC_FF_1C_888_CD6:
-            switch (nc)
+            toneMap.Map(*frame, 1, 6);
+            pLevel[0] = toneMap.GetOutput(0);
+            for (int z = 0; z < 8; z++)
             {
-                case 0:
-                    for (int z = 0; z < 8; z++)
-                    {
-                        for (int y = 0; y < 8; y++)
-                        {
-                            for (int x = 0; x < 8; x++)
-                            {
-                                toSend += (char)((currAnim->cubeState[0]->GetVoxelState(x, y, z) ? 0xFF : 0x00) >> 2);
-                            }
-                        }
-                    }
-                    break;
-                case 1:
-                    for (int z = 0; z < 8; z++)
-                    {
-                        for (int y = 0; y < 8; y++)
-                        {
-                            for (int x = 0; x < 8; x++)
-                            {
-                                toSend += (char)(currAnim->cubeState[0]->GetVoxelState(x, y, z) >> 2);
-                            }
-                        }
-                    }
-                    break;
-
-                case 3:
-                    for (int z = 0; z < 8; z++)
+                for (int y = 0; y < 8; y++)
+                {
+                    for (int x = 0; x < 8; x++)
                     {
-                        for (int y = 0; y < 8; y++)
-                        {
-                            for (int x = 0; x < 8; x++)
-                            {
-                                unsigned int brightness = currAnim->cubeState[0]->GetVoxelState(x, y, z)
-                                                        + currAnim->cubeState[1]->GetVoxelState(x, y, z)
-                                                        + currAnim->cubeState[2]->GetVoxelState(x, y, z);
-                                brightness /= (0xFF*3);
-                                toSend += (char)(brightness >> 2);
-                            }
-                        }
+                        toSend += (char)pLevel[0][x * strideX + y * strideY + z];
                     }
-                    break;
+                }
             }
             break;
 
@@ -275,7 +244,7 @@ void TCDriver_netdrv::Poll()
                 {
                     for (int x = 0; x < 4; x++)
                     {
-                        if (currAnim->GetVoxelColor(x, y, z))
+                        if (frame->GetVoxelColor(x, y, z))
                             sliceData[y/2] |= (1 << (x + ( (y % 2 == 0) ? (0) : (4) )));
                     }
                 }
@@ -286,69 +255,39 @@ void TCDriver_netdrv::Poll()
 
 
         case TC_FF_3C_444:
-            switch (nc)
+            // Animations without RGB colors are sent in the colour of the on LEDs.
+            toneMap.Map(*frame, 3, 8, (nc == 3) ? NULL : ledOn);
+            pLevel[0] = toneMap.GetOutput(0);
+            pLevel[1] = toneMap.GetOutput(1);
+            pLevel[2] = toneMap.GetOutput(2);
+            for (int z = 0; z < 4; z++)
             {
-                case 0:
-                    for (int z = 0; z < 4; z++)
-                    {
-                        for (int y = 0; y < 4; y++)
-                        {
-                            for (int x = 0; x < 4; x++)
-                            {
-                                if (currAnim->cubeState[0]->GetVoxelState(x, y, z))
-                                {
-                                    toSend += (char)(0xFF * colLedOn[0]);
-                                    toSend += (char)(0xFF * colLedOn[1]);
-                                    toSend += (char)(0xFF * colLedOn[2]);
-                                }
-                                else
-                                {
-                                    toSend += (char)0;
-                                    toSend += (char)0;
-                                    toSend += (char)0;
-                                }
-                            }
-                        }
-                    }
-                    break;
-                case 1:
-                    for (int z = 0; z < 4; z++)
-                    {
-                        for (int y = 0; y < 4; y++)
-                        {
-                            for (int x = 0; x < 4; x++)
-                            {
-                                toSend += (char)(currAnim->cubeState[0]->GetVoxelState(x, y, z) * colLedOn[0]);
-                                toSend += (char)(currAnim->cubeState[0]->GetVoxelState(x, y, z) * colLedOn[1]);
-                                toSend += (char)(currAnim->cubeState[0]->GetVoxelState(x, y, z) * colLedOn[2]);
-                            }
-                        }
-                    }
-                    break;
-                case 3:
-                    for (int z = 0; z < 4; z++)
+                for (int y = 0; y < 4; y++)
+                {
+                    for (int x = 0; x < 4; x++)
                     {
-                        for (int y = 0; y < 4; y++)
-                        {
-                            for (int x = 0; x < 4; x++)
-                            {
-                                toSend += (char)(currAnim->cubeState[0]->GetVoxelState(x, y, z));
-                                toSend += (char)(currAnim->cubeState[1]->GetVoxelState(x, y, z));
-                                toSend += (char)(currAnim->cubeState[2]->GetVoxelState(x, y, z));\
-                            }
-                        }
+                        size_t i = x * strideX + y * strideY + z;
+                        toSend += (char)pLevel[0][i];
+                        toSend += (char)pLevel[1][i];
+                        toSend += (char)pLevel[2][i];
                     }
-                    break;
+                }
             }
             break;
 
         default:
-            runDriver = false;
-            break;
+            // The frame format is unknown, so the driver stops (see TCDriver::HasFailed).
+            driverFailed = true;
+            frame->Release();
+            return;
     }
-    UnlockAnimMutex();
+    frame->Release();
 
     toSend += "*TE*";
+    lastFrame     = toSend;
+    lastFrameGen  = currGen;
+    lastFrameTone = currTone;
+    for (int i = 0; i < 3; i++) lastFrameLedOn[i] = ledOn[i];
     SendCommand(toSend);
 }
 
@@ -517,39 +456,36 @@ void netdrv_GetCubeList(Uint32 cube_ip, Uint16 cube_listenport,
 
 
 ///
-/// \brief Connect To Cube
+/// \brief Open Cube
 ///
-/// Attempts to connect to the passed cube held within the global cubeList object.  If the
-/// connection is successful, the respective driver is loaded.
+/// Attempts to connect to the passed cube held within the global cubeList object, without
+/// loading the driver (so it can also be used by an animation slot, see TCSlotEngine).
 ///
-/// \param cube_num The cube number to connect to (matching up to the result shown after
+/// \param cubeNum  The cube number to connect to (matching up to the result shown after
 ///                 running the `netdrv list` command).
 /// \param pollRate The poll rate of the driver in milliseconds (set to zero to synchronize
-///                 the driver to the global tickrate).
+///                 the driver to the tickrate).
 ///
-/// \returns True if the cube was connected to (and loaded as a driver), false otherwise.
+/// \returns The driver connected to the cube, or NULL if the connection failed (in which
+///          case the reason is printed to the Triclysm console).
 ///
-/// \remarks Relevant information will be printed to the Triclysm console before this
-///          function returns false.
+/// \see netdrv_ConnectCube | TCDriver_netdrv | cubeList
 ///
-/// \see netdrv_GetCubeList | TCDriver_netdrv | SetDriver | cubeList
-///
-bool netdrv_ConnectCube(unsigned int cubeNum, Uint32 pollRate)
+TCDriver *netdrv_OpenCube(unsigned int cubeNum, Uint32 pollRate)
 {
-    TCDriver *toLoad    = NULL;
-    bool     connStatus = false;
+    TCDriver *toLoad     = NULL;
+    bool      connStatus = false;
 
     if (cubeList.size() == 0)
     {
         WriteOutput("netdrv: Error - no cubes found. "
                     "Please run `netdrv list` to scan for remote devices.");
-        return false;
+        return NULL;
     }
-    else if (cubeNum < 0 || cubeNum > cubeList.size())
+    else if (cubeNum == 0 || cubeNum > cubeList.size())
     {
-
         WriteOutput("netdrv: Error - invalid cube index.");
-        return false;
+        return NULL;
     }
 
     // attempt to load that driver.
@@ -557,13 +493,53 @@ bool netdrv_ConnectCube(unsigned int cubeNum, Uint32 pollRate)
     toLoad = new TCDriver_netdrv(cubeList[cubeNum], connStatus, pollRate);
     if (connStatus == true)
     {
-        SetDriver(toLoad);
         WriteOutput("netdrv: Successfully connected to `" + cubeList[cubeNum].cube_name + "`");
-        return true;
+        return toLoad;
     }
     else
     {
         WriteOutput("netdrv: Error - could not connect to cube.");
-        return false;
+        return NULL;
     }
 }
+
+
+///
+/// \brief Connect To Cube
+///
+/// Attempts to connect to the passed cube held within the global cubeList object.  If the
+/// connection is successful, the respective driver is loaded, and the cube size is set to
+/// the size of the remote cube.
+///
+/// \param cube_num The cube number to connect to (matching up to the result shown after
+///                 running the `netdrv list` command).
+/// \param pollRate The poll rate of the driver in milliseconds (set to zero to synchronize
+///                 the driver to the global tickrate).
+///
+/// \returns True if the cube was connected to (and loaded as a driver), false otherwise.
+///
+/// \remarks Relevant information will be printed to the Triclysm console before this
+///          function returns false.
+///
+/// \see netdrv_GetCubeList | TCDriver_netdrv | SetDriver | cubeList
+///
+bool netdrv_ConnectCube(unsigned int cubeNum, Uint32 pollRate)
+{
+    TCDriver *toLoad = netdrv_OpenCube(cubeNum, pollRate);
+    if (toLoad == NULL) return false;
+
+    // Update the current cube size to match the physical cube.
+    byte *currSize   = GetCubeSize(),
+         *remoteSize = cubeList[cubeNum - 1].cube_size;
+    // We only need to change the size if there is a mis-match.
+    if ( !(    remoteSize[0] == currSize[0]
+            && remoteSize[1] == currSize[1]
+            && remoteSize[2] == currSize[2] ))
+    {
+        SetCubeSize(remoteSize[0], remoteSize[1], remoteSize[2]);
+    }
+    delete[] currSize;
+
+    SetDriver(toLoad);
+    return true;
+}
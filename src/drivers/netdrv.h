@@ -31,6 +31,7 @@
 
 #include "../TCDriver.h"         // Base driver class to override.
 #include "../TCCube.h"
+#include "../TCToneMap.h"       // Output stage for the brightness of each voxel.
 #include "SDL.h"
 #include "SDL_net.h"
 #include <vector>
@@ -45,6 +46,7 @@
 void netdrv_GetCubeList(Uint32 cube_ip, Uint16 cube_listenport,
     Uint16 listenPort, unsigned int attempts = 3, Uint32 attempt_len_ms = 100);
 bool netdrv_ConnectCube(unsigned int cubeNum, Uint32 pollRate);
+TCDriver *netdrv_OpenCube(unsigned int cubeNum, Uint32 pollRate);
 
 
 ///
@@ -75,6 +77,7 @@ class TCDriver_netdrv : public TCDriver
     bool RecvString(std::string &toRecv);
 
     void Poll();
+    void SendFrame(TCFrame *frame);
 
   private:
 
@@ -85,6 +88,14 @@ class TCDriver_netdrv : public TCDriver
     UDPpacket *udpPkt;
     Uint8     frameFormat;
     byte      remoteCubeSize[3];
+
+    // The last frame sent, re-sent as long as the animation and LED colour are unchanged:
+    std::string  lastFrame;
+    uint64_t     lastFrameGen;
+    float        lastFrameLedOn[3];
+    unsigned int lastFrameTone;     // The TCToneMap settings version of the last frame.
+
+    TCToneMap    toneMap;           // Converts each frame to the levels that are sent.
 };
 
 
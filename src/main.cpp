@@ -43,6 +43,8 @@
 #include "render.h"                     // Includes all OpenGL-related rendering functions.
 #include "console.h"
 #include "events.h"
+#include "cube_kernels.h"
+#include "TCThreadPool.h"
 
 
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
@@ -58,8 +60,25 @@ SDL_Thread *animThread   = NULL, ///< The animation thread object.
 SDL_mutex  *animMutex    = NULL, ///< The mutex lock for the \ref currAnim object.
            *driverMutex  = NULL; ///< The mutex lock for the \ref currAnim object.
 
-Uint32      tickRate,            ///< The current tick rate (ticks/second).
-            msPerTick;           ///< Milliseconds per tick (see \ref SetTickRate).
+TCFrameBuffer frameBuffers[TC_NUM_FRAME_READERS];  ///< The frames published to each reader.
+TCFrameInterp frameInterps[TC_NUM_FRAME_READERS];  ///< The frames read between two ticks.
+TCFrameQueue  driverQueue;          ///< The frames sent to a synchronous driver, in order.
+TCSlotEngine *slotEngine = NULL;    ///< Runs the animation slots (see GetSlotEngine).
+
+/// \brief A task posted to the animation thread (see PostAnimTask).
+struct TCAnimTask
+{
+    TCAnimTaskFunc func;        ///< The function to call with the current animation.
+    void          *pData;       ///< The data passed to the function.
+    TCAnimTask    *next;        ///< The task posted before this one (or NULL).
+};
+TCAnimTask *postedTasks = NULL;  ///< Tasks not yet run, from the newest to the oldest.
+
+unsigned int publishedTicks      = 0,   ///< Ticks of the last published animation state.
+             publishedIterations = 0;   ///< Iterations of the same (see GetAnimTicks).
+
+TCScheduler scheduler(30.0);     ///< Decides when each tick is run (see UpdateAnim).
+Uint32      msPerTick;           ///< Tick period rounded to milliseconds (for AcquireFrame).
 int         iScrWidth  = 640,    ///< The initial screen width (in pixels).
             iScrHeight = 480;    ///< The initial screen height (in pixels).
 
@@ -95,6 +114,7 @@ Uint32 scrFlags =           ///< The initial SDL screen flags.
 ///
 int main(int argc, char *argv[])
 {
+    TC_Kernels::Init();         // Before anything uses a cube, select the cube kernels.
     SetTickRate(30);            // Also before initializing anything, we set the tick rate,
     SetCubeSize(8, 8, 8);       // and the initial cube size (also sets currAnim).
 
@@ -179,6 +199,15 @@ void CleanupSDL()
     SetAnim(NULL);
 
     SDL_WaitThread(animThread, NULL);
+    for (int i = 0; i < TC_NUM_FRAME_READERS; i++)
+    {
+        frameBuffers[i].Clear();
+        frameInterps[i].Clear();
+    }
+    driverQueue.Clear();
+    delete slotEngine;          // Stops the slot workers (before the pool they may use).
+    slotEngine = NULL;
+    TCThreadPool::CloseShared();
     SDL_DestroyMutex(animMutex);
     SDL_DestroyMutex(driverMutex);
 
@@ -202,13 +231,16 @@ void DisplayInitMessage()
 /// \brief Set Tick Rate
 ///
 /// Sets the current tick rate, or the rate at which the current animation is updated.
+/// The rate does not have to be an integer, and can be set from any thread (the next
+/// tick of the animation thread is due one new tick period after the last one).
 /// 
 /// \param newRate The new tick rate (ticks per/second).
 ///
-void SetTickRate(Uint32 newRate)
+void SetTickRate(double newRate)
 {
-    tickRate  = newRate;
-    msPerTick = 1000 / tickRate;
+    scheduler.SetRate(newRate);
+    double newMsPerTick = 1000.0 / newRate + 0.5;
+    msPerTick = (newMsPerTick < 1.0) ? 1 : (Uint32)newMsPerTick;
 }
 
 ///
@@ -216,9 +248,20 @@ void SetTickRate(Uint32 newRate)
 ///
 /// Gets the current tick rate.
 ///
-Uint32 GetTickRate()
+double GetTickRate()
 {
-    return tickRate;
+    return scheduler.GetRate();
+}
+
+///
+/// \brief Get Scheduler
+///
+/// \returns The scheduler deciding when each tick is run, which also measures the tick
+///          rate actually achieved (see TCScheduler::GetAchievedRate).
+///
+TCScheduler *GetScheduler()
+{
+    return &scheduler;
 }
 
 
@@ -238,6 +281,8 @@ void SetAnim(TCAnim *newAnim)
 {
     // We need to lock the animMutex before modifying the pointer.
     LockAnimMutex();
+    // Any tasks posted before this call are for the old animation, so they are run first.
+    RunAnimTasks();
 
     // Next, we delete the current animation, and replace it with the passed newAnim.
     // If newAnim is NULL, we set currAnim to a new, default ("blank") animation.
@@ -254,11 +299,55 @@ void SetAnim(TCAnim *newAnim)
         currAnim = new TCAnim(cubeSize);
         nullAnim = true;
     }
+    PublishFrame();     // The old frame is from the previous animation, so replace it.
     // Finally, we unlock the animMutex before returning.
     UnlockAnimMutex();
 }
 
 
+///
+/// \brief Get Compositor
+///
+/// Gets the current animation as a layer compositor, so other animations can be layered
+/// over it.  If \ref currAnim is not already a TCCompositor, it is replaced with a new one,
+/// and (unless it is the blank animation) becomes the compositor's bottom layer.  The
+/// new compositor is the size of the current animation (which may not be the size in
+/// \ref cubeSize yet, if the cube was just resized).
+///
+/// \returns A pointer to the compositor, which is the current animation.
+///
+/// \remarks The animMutex must be locked before calling this function, and kept locked
+///          while the compositor is used (it is deleted along with the animation).  This
+///          is always the case in a task posted with PostAnimTask.
+///
+/// \see     SetAnim | currAnim | TCCompositor
+///
+TCCompositor *GetCompositor()
+{
+    TCCompositor *compositor = dynamic_cast<TCCompositor *>(currAnim);
+    if (compositor == NULL)
+    {
+        // The old animation is kept as the first layer, so it is not deleted here.
+        byte animSize[3] = { currAnim->cubeState[0]->GetSize(TC_X_AXIS),
+                             currAnim->cubeState[0]->GetSize(TC_Y_AXIS),
+                             currAnim->cubeState[0]->GetSize(TC_Z_AXIS) };
+        compositor = new TCCompositor(animSize);
+        if (nullAnim)
+        {
+            delete currAnim;
+        }
+        else
+        {
+            compositor->AddLayer(currAnim);
+        }
+        currAnim = compositor;
+        nullAnim = false;
+        PublishFrame();
+    }
+    return compositor;
+}
+
+
 ///
 /// \brief Set Driver
 ///
@@ -273,10 +362,12 @@ void SetAnim(TCAnim *newAnim)
 ///
 void SetDriver(TCDriver *newDriver)
 {
-    // First, we gracefully stop the current driver.
-    LockAnimMutex(); LockDriverMutex();
+    // First, we gracefully stop the current driver (closing the queue wakes the thread
+    // of a synchronous driver, and any thread waiting to publish a frame).
+    LockDriverMutex();
     runDriver = false;
-    UnlockDriverMutex(); UnlockAnimMutex();
+    UnlockDriverMutex();
+    driverQueue.Close();
     if (driverThread != NULL)
     {
         SDL_WaitThread(driverThread, NULL);
@@ -294,8 +385,12 @@ void SetDriver(TCDriver *newDriver)
         // If the driver is synchronous...
         if (currDriver->GetDriverType() == TC_DRIVER_TYPE_SYNCHRONOUS)
         {
+            // We create a thread (based on the UpdateSyncDriver function) which sends
+            // each frame the animation thread pushes to the driver queue, so a slow
+            // driver never delays the next tick.
             runDriver    = true;
-            driverThread = NULL;
+            driverQueue.Open();
+            driverThread = SDL_CreateThread(UpdateSyncDriver, NULL);
         }
         // Else, if the driver is to be run asynchronously...
         else
@@ -304,14 +399,15 @@ void SetDriver(TCDriver *newDriver)
             // function) and have it continually loop in the thread.
             runDriver    = true;
             driverThread = SDL_CreateThread(UpdateDriver, NULL);
-            if (driverThread == NULL)   // If we couldn't create the thread...
-            {
-                // Print an error, and delete the driver object (since it's invalid now).
-                runDriver = false;
-                delete currDriver;
-                currDriver = NULL;
-                WriteOutput("Error - could not create driver thread!");
-            }
+        }
+        if (driverThread == NULL)   // If we couldn't create the thread...
+        {
+            // Print an error, and delete the driver object (since it's invalid now).
+            runDriver = false;
+            driverQueue.Close();
+            delete currDriver;
+            currDriver = NULL;
+            WriteOutput("Error - could not create driver thread!");
         }
     }
 
@@ -319,6 +415,36 @@ void SetDriver(TCDriver *newDriver)
 }
 
 
+///
+/// \brief Get Driver Queue
+///
+/// \returns The queue passing each published frame to a synchronous driver (which can be
+///          used to change its back-pressure policy and depth from any thread).
+/// \see     driverQueue | UpdateSyncDriver
+///
+TCFrameQueue *GetDriverQueue()
+{
+    return &driverQueue;
+}
+
+
+///
+/// \brief Get Slot Engine
+///
+/// Gets the engine running the animation slots, which run independently of the current
+/// animation (e.g. to drive several physical cubes at once).  The engine and its worker
+/// threads are only created the first time this function is called.
+///
+/// \returns A pointer to the slot engine (deleted by \ref CleanupSDL).
+/// \see     slotEngine | TCSlotEngine
+///
+TCSlotEngine *GetSlotEngine()
+{
+    if (slotEngine == NULL) slotEngine = new TCSlotEngine();
+    return slotEngine;
+}
+
+
 ///
 /// \brief Set Cube Size (Rectangular)
 ///
@@ -415,35 +541,36 @@ bool InitThreads()
 /// \brief Update Animation
 ///
 /// This function is run in a seperate thread, which continuously polls the Tick method of
-/// the current animation.
+/// the current animation, whenever the scheduler says a tick is due.  Before each tick,
+/// any tasks posted with \ref PostAnimTask are run (even while the animation is stopped).
 ///
 /// \returns Unused return value.
-/// \see     InitAnimThread | msPerTick | runAnim | runProgram | currAnim
+/// \see     InitAnimThread | scheduler | runAnim | runProgram | currAnim
 ///
 int UpdateAnim(void *unused)
 {
     while (runProgram)      // So, looping while the program is still running...
     {
-        Uint32 updateTime = SDL_GetTicks();
-        if (runAnim)            // If we are supposed to run the animation...
+        // We first wait until the next tick is due.  If the animation thread fell behind,
+        // more than one tick may be due at once (see TCScheduler::SetCatchUp).
+        unsigned int ticks = scheduler.Wait();
+        LockAnimMutex();            // We lock the animation mutex,
+        bool edited = RunAnimTasks();   // run the tasks posted by the console,
+        if (runAnim && ticks > 0)   // and if we are supposed to run the animation...
         {
-            LockAnimMutex();        // We lock the animation mutex,
-            currAnim->Tick();       // update the animation's state,
-            UnlockAnimMutex();      // and unlock the animation mutex.
-
-            // If we have a driver that we need to update, we do that here too.
-            LockDriverMutex();      // First, we lock the driver mutex.
-            // So, if the driver is supposed to run, and the driver is synchronous...
-            if (    (runDriver)
-                 && (currDriver->GetDriverType() == TC_DRIVER_TYPE_SYNCHRONOUS ) )
+            for (unsigned int i = 0; i < ticks; i++)
             {
-                currDriver->Poll();     // Poll the driver.
+                currAnim->Tick();   // update the animation's state,
             }
-            UnlockDriverMutex();    // Finally, we can unlock the driver mutex.
+            PublishFrame();         // and publish a snapshot of it for the readers.
+        }
+        else if (edited)            // Otherwise, the tasks may have changed the state.
+        {
+            PublishFrame();
         }
-        // Lastly, we delay by the proper amount before the next Tick.
-        updateTime = SDL_GetTicks() - updateTime;
-        if (updateTime < msPerTick) SDL_Delay(msPerTick - updateTime);
+        UnlockAnimMutex();          // Finally, we unlock the animation mutex.  A
+                                    // synchronous driver is sent the published frames
+                                    // by its own thread (see UpdateSyncDriver).
     }
     return 0;
 }
@@ -458,8 +585,12 @@ int UpdateAnim(void *unused)
 /// \returns Unused return value.
 /// \see     InitAnimThread | msPerTick | runAnim | runProgram | currAnim
 ///
+/// \remarks If the driver fails (see TCDriver::HasFailed), the thread stops, and the
+///          driver stays loaded but idle until it is replaced or unloaded.
+///
 int UpdateDriver(void *unused)
 {
+    bool failed = false;
     while (runDriver)      // So, looping while the driver is still running...
     {
         Uint32 delayVal,
@@ -469,10 +600,52 @@ int UpdateDriver(void *unused)
         // Now, we can poll the driver, and get the polling rate.
         currDriver->Poll();
         delayVal = currDriver->GetPollRate();
+        failed   = currDriver->HasFailed();
+        if (failed) runDriver = false;
         // Now, we can unlock the driver mutex, and delay for the appropriate time.
         UnlockDriverMutex();
         pollTime = SDL_GetTicks() - pollTime;
-        if (pollTime < delayVal) SDL_Delay(delayVal - pollTime);
+        if (!failed && pollTime < delayVal) SDL_Delay(delayVal - pollTime);
+    }
+    if (failed) PostOutput(TC_ERROR_DRIVER_FAILED);
+    return 0;
+}
+
+
+///
+/// \brief Update Synchronous Driver
+///
+/// This function is run in a seperate thread while a synchronous driver is loaded, and
+/// sends each frame published by the animation thread to the current driver, in the
+/// order they were published (see \ref driverQueue).
+///
+/// \returns Unused return value.
+/// \see     SetDriver | PublishFrame | TCDriver::SendFrame
+///
+/// \remarks If the driver fails (see TCDriver::HasFailed), the thread stops, and the
+///          driver stays loaded but idle until it is replaced or unloaded.
+///
+int UpdateSyncDriver(void * /*unused*/)
+{
+    bool failed = false;
+    while (runDriver)      // So, looping while the driver is still running...
+    {
+        // We wait for the next frame (checking runDriver at least every 100 ms),
+        TCFrame *frame = driverQueue.Pop(100);
+        if (frame == NULL) continue;
+        // and send it with the driver mutex locked (the driver releases the frame).
+        LockDriverMutex();
+        currDriver->SendFrame(frame);
+        failed = currDriver->HasFailed();
+        if (failed) runDriver = false;
+        UnlockDriverMutex();
+    }
+    if (failed)
+    {
+        // Nothing takes frames from the queue any more, so we close it (otherwise, the
+        // animation thread would wait forever to publish a frame into a full queue).
+        driverQueue.Close();
+        PostOutput(TC_ERROR_DRIVER_FAILED);
     }
     return 0;
 }
@@ -544,3 +717,158 @@ void UnlockDriverMutex()
         exit(1);
     }
 }
+
+
+///
+/// \brief Publish Frame
+///
+/// Captures the current state of \ref currAnim into a new TCFrame, and publishes it to
+/// the triple buffer of each reader.  Readers which still hold a reference to a previous
+/// frame can keep reading it, and it is deleted when the last of them releases it.
+///
+/// \remarks The animation mutex must be held by the caller (so only one thread publishes
+///          at a time).  Publishing never waits for a reader, except for a synchronous
+///          driver when its queue is full and set to block (see TCFrameQueue::SetPolicy).
+///          If the animation has any effects (see TCAnim::GetEffects), they are applied
+///          to the published frame.
+/// \see     AcquireFrame | frameBuffers | TCFrameBuffer | driverQueue
+///
+void PublishFrame()
+{
+    TCFrame *newFrame = new TCFrame(*currAnim, SDL_GetTicks());
+    if (currAnim->HasEffects())
+    {
+        // The readers get the frame with the animation's effects applied instead.
+        TCFrame *processed = new TCFrame(*newFrame, *currAnim->GetEffects(),
+                                         currAnim->GetTicks());
+        newFrame->Release();
+        newFrame = processed;
+    }
+    __atomic_store_n(&publishedTicks,      currAnim->GetTicks(),      __ATOMIC_RELEASE);
+    __atomic_store_n(&publishedIterations, currAnim->GetIterations(), __ATOMIC_RELEASE);
+    // The frame starts with one reference, and each reader's buffer takes over one (as
+    // does the driver queue, which just releases it if no synchronous driver is loaded).
+    for (int i = 0; i < TC_NUM_FRAME_READERS; i++)
+    {
+        newFrame->Retain();
+    }
+    for (int i = 0; i < TC_NUM_FRAME_READERS; i++)
+    {
+        frameBuffers[i].Publish(newFrame);
+    }
+    driverQueue.Push(newFrame);     // A synchronous driver gets every frame, in order.
+}
+
+
+///
+/// \brief Acquire Frame
+///
+/// Gets a reference to the last frame published by \ref PublishFrame.  The frame can be
+/// read for as long as needed without holding the animation mutex.  If an interpolation
+/// mode is set (see TCFrameInterp::SetMode), the frame is instead produced from the last
+/// two published frames, at the current time.
+///
+/// \param reader The reader getting the frame (e.g. TC_FRAME_READER_RENDER).  Each reader
+///               has its own triple buffer, so only one thread may use it at a time.
+///
+/// \returns A pointer to the frame (which must be released with TCFrame::Release once
+///          the caller is done with it), or NULL if no frame has been published yet.
+/// \see     PublishFrame | frameBuffers | frameInterps | TCFrameBuffer
+///
+TCFrame *AcquireFrame(byte reader)
+{
+    TCFrame *frame = frameBuffers[reader].Acquire();
+    if (frame != NULL) frame->Retain();
+    return frameInterps[reader].Interpolate(frame, SDL_GetTicks(), msPerTick);
+}
+
+
+///
+/// \brief Get Animation Ticks
+///
+/// \returns The number of ticks of the current animation when its state was last
+///          published (see PublishFrame).  This can be read from any thread, without
+///          locking the animation mutex.
+///
+unsigned int GetAnimTicks()
+{
+    return __atomic_load_n(&publishedTicks, __ATOMIC_ACQUIRE);
+}
+
+
+///
+/// \brief Get Animation Iterations
+///
+/// \returns The number of iterations of the current animation when its state was last
+///          published (see \ref GetAnimTicks).
+///
+unsigned int GetAnimIterations()
+{
+    return __atomic_load_n(&publishedIterations, __ATOMIC_ACQUIRE);
+}
+
+
+///
+/// \brief Post Animation Task
+///
+/// Posts a function to be called with the current animation by the animation thread,
+/// before its next tick.  Tasks are run in the order they were posted, and always with
+/// the animation mutex held, so they can modify the animation (or replace it, see
+/// GetCompositor).  Posting a task never waits for the animation thread.
+///
+/// \param func  The function to call.  It is passed \ref currAnim, and pData.
+/// \param pData The data passed to func (which is responsible for deleting it).
+///
+/// \remarks Tasks which write to the console must use PostOutput, since they are not
+///          run by the console's thread.  Tasks still waiting when the animation is
+///          replaced (see SetAnim) are run on the old animation first.
+///
+/// \see     RunAnimTasks | UpdateAnim
+///
+void PostAnimTask(TCAnimTaskFunc func, void *pData)
+{
+    TCAnimTask *task = new TCAnimTask;
+    task->func  = func;
+    task->pData = pData;
+    task->next  = __atomic_load_n(&postedTasks, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&postedTasks, &task->next, task, true,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+    {
+        // Another thread posted a task first (task->next was updated to it), so retry.
+    }
+}
+
+
+///
+/// \brief Run Animation Tasks
+///
+/// Takes every task posted with \ref PostAnimTask at once, and runs them in the order
+/// they were posted.
+///
+/// \returns True if any tasks were run.
+///
+/// \remarks The animation mutex must be held by the caller.
+///
+bool RunAnimTasks()
+{
+    TCAnimTask *task    = __atomic_exchange_n(&postedTasks, (TCAnimTask *)NULL,
+                                              __ATOMIC_ACQUIRE),
+               *ordered = NULL;
+    if (task == NULL) return false;
+    // The tasks were taken from the newest to the oldest, so we reverse them first.
+    while (task != NULL)
+    {
+        TCAnimTask *next = task->next;
+        task->next = ordered;
+        ordered    = task;
+        task       = next;
+    }
+    while (ordered != NULL)
+    {
+        TCAnimTask *next = ordered->next;
+        ordered->func(currAnim, ordered->pData);    // A task may replace currAnim.
+        delete ordered;
+        ordered = next;
+    }
+    return true;
+}
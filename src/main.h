@@ -34,13 +34,28 @@
 #define TC_MAIN_
 
 #include "TCAnim.h"     // The Triclysm Animation Object.
+#include "TCCompositor.h" // Animation blending the layers of other animations.
+#include "TCFrame.h"    // The Triclysm Frame (animation snapshot) Object.
+#include "TCFrameBuffer.h" // Triple buffer passing the frames to each reader.
+#include "TCFrameInterp.h" // Blends the frames read between two ticks.
+#include "TCFrameQueue.h" // Passes the frames to a synchronous driver's thread.
+#include "TCSlotEngine.h" // Runs the animation slots on a pool of worker threads.
 #include "TCDriver.h"   // The Triclysm Driver Object.
+#include "TCScheduler.h" // Decides when each animation tick is run.
 #include "SDL.h"        // The main SDL include file.
 
 #define TC_NAME                "Triclysm"
 #define TC_VERSION             "0.9b"
 #define TC_WINDOW_TITLE        "Triclysm (Beta)"  // The window title.
 
+// Frame readers (each has its own triple buffer, see AcquireFrame).
+#define TC_FRAME_READER_RENDER 0        // The frames drawn by the renderer.
+#define TC_FRAME_READER_DRIVER 1        // The frames sent by the current driver.
+#define TC_NUM_FRAME_READERS   2        // Number of frame readers.
+
+// Function run by the animation thread with the current animation (see PostAnimTask).
+typedef void (*TCAnimTaskFunc)(TCAnim *anim, void *pData);
+
 // Various error strings used in the initialization functions.
 #define TC_ERROR_SDL_INIT      "Error - SDL initialization failed:\n%s\n"
 #define TC_ERROR_SDL_VIDINFO   "Error - could not obtain SDL video information:\n%s\n"
@@ -49,6 +64,7 @@
 #define TC_ERROR_MUTEX_INIT    "Error - could not create animation mutex object:\n%s\n"
 #define TC_ERROR_MUTEX_LOCK    "Error - could not lock animation mutex:\n%s\n"
 #define TC_ERROR_MUTEX_UNLOCK  "Error - could not unlock animation mutex:\n%s\n"
+#define TC_ERROR_DRIVER_FAILED "Error - the current driver failed, and was stopped."
 
 
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
@@ -84,21 +100,36 @@ int    main(int argc, char *argv[]);            // The main program entry point.
 bool   InitSDL();                               // Initializes all SDL subsystems.
 void   CleanupSDL();                            // Cleans up all SDL objects.
 void   DisplayInitMessage();                    // Writes initialization info to console.
-void   SetTickRate(Uint32 newRate);             // Sets the animation tick rate.
-Uint32 GetTickRate();                           // Gets the current tick rate.
+void   SetTickRate(double newRate);             // Sets the animation tick rate.
+double GetTickRate();                           // Gets the current tick rate.
+TCScheduler *GetScheduler();                    // Gets the tick scheduler (for stats).
 void   SetCubeSize(byte sx, byte sy, byte sz);  // Updates the current cube size.
 byte   *GetCubeSize();                          // Returns an array of the cube size.
 void   SetAnim(TCAnim *newAnim);                // Sets the current animation.
+TCCompositor *GetCompositor();                  // Makes currAnim a layer compositor.
 void   SetDriver(TCDriver *newDriver);          // Sets the current driver.
+TCFrameQueue *GetDriverQueue();                 // Frames sent to a synchronous driver.
+TCSlotEngine *GetSlotEngine();                  // Runs the named animation slots.
 
 // Thread specific functions:
 int  UpdateAnim(void *unused);   // Updates the current animation at the current rate.
 int  UpdateDriver(void *unused); // Updates the current driver at the driver poll rate.
+int  UpdateSyncDriver(void *unused); // Sends each published frame to the current driver.
 bool InitThreads();              // Initializes the animation thread and mutex.
 void LockAnimMutex();            // Locks the animation mutex (for use with currAnim).
 void UnlockAnimMutex();          // Unlocks the animation mutex.
 void LockDriverMutex();          // Locks the driver mutex (for use with currDriver).
 void UnlockDriverMutex();        // Unlocks the driver mutex.
 
+// Frame publication functions:
+void     PublishFrame();             // Publishes a snapshot of currAnim (needs the animMutex).
+TCFrame *AcquireFrame(byte reader);  // Gets a reference to the last published frame.
+unsigned int GetAnimTicks();         // Ticks of the last published state (no lock needed).
+unsigned int GetAnimIterations();    // Iterations of the last published state.
+
+// Animation task functions (used to modify currAnim without locking the animMutex):
+void PostAnimTask(TCAnimTaskFunc func, void *pData);  // Runs func before the next tick.
+bool RunAnimTasks();                 // Runs the posted tasks (needs the animMutex).
+
 
 #endif
@@ -33,6 +33,7 @@
 #include <sstream>              // Needed for the FPS counter.
 
 #include "TCAnim.h"             // TCAnim object definition.
+#include "TCToneMap.h"          // Maps the voxel colors to the colors drawn.
 #include "SDL.h"                // Base SDL library header.
 #include "SDL_opengl.h"         // SDL OpenGL header (includes GL.h and GLU.h).
 
@@ -51,6 +52,12 @@ GLclampf colClear[4]   = {0.15f, 0.15f, 0.15f, 1.00f},  ///< The clear/backgroun
          colLedOn[4]   = {0.20f, 0.20f, 1.00f, 1.00f},  ///< Colour of an LED that is on.
          colLedOff[4]  = {0.00f, 0.00f, 0.00f, 0.50f};  ///< Colour of an LED that is off.
 
+/// \brief The red, green, and blue bytes of colLedOn, packed into one word (0xRRGGBB).
+///
+/// Read by the drivers (see GetLedOnColor), which may run on any thread, so all three
+/// colours are always read from the same call to SetLedOnColor.
+static Uint32 ledOnColor = 0x3333FF;
+
 GLclampf colAxisX[4]   = {0.75f, 0.00f, 0.00f, 1.00f},  ///< Colour of the x-axis cylinder.
          colAxisY[4]   = {0.00f, 0.75f, 0.00f, 1.00f},  ///< Colour of the y-axis cylinder.
          colAxisZ[4]   = {0.00f, 0.00f, 0.75f, 1.00f};  ///< Colour of the z-axis cylinder.
@@ -468,10 +475,10 @@ void DrawAxis()
 ///
 /// \brief Draw Cube
 ///
-/// Loops through each voxel in the current animation's cube state, and draws the LEDs
-/// on the screen in the proper state.
+/// Loops through each voxel in the last published frame of the current animation, and
+/// draws the LEDs on the screen in the proper state.
 ///
-/// \see currAnim | ledStartPos | dlistLed | PerspectiveModeBegin
+/// \see AcquireFrame | ledStartPos | dlistLed | PerspectiveModeBegin
 ///
 void DrawCube()
 {
@@ -480,26 +487,37 @@ void DrawCube()
     ledCurrPos[0] = ledStartPos[0];
     ledCurrPos[1] = ledStartPos[1];
     ledCurrPos[2] = ledStartPos[2];
-    // We also need to lock the animation mutex, since we need access to the voxel data.
-    LockAnimMutex();
+    // We also need the voxel data, which we read from the last published frame (so the
+    // animation thread can keep ticking while we draw).
+    TCFrame *frame = AcquireFrame(TC_FRAME_READER_RENDER);
+    if (frame == NULL) return;
+    byte frameSize[3] = { frame->GetSize(TC_X_AXIS),
+                          frame->GetSize(TC_Y_AXIS),
+                          frame->GetSize(TC_Z_AXIS) };
     // Now, we create a different render loop for the different animation color types.
     // We do this so we don't perform a comparison for every voxel in the cube.  The outer
     // loops for each case should be the same (i.e. loop through all x, y, and z values).
-    switch (currAnim->GetNumColors())
+    // Since this is the same order the voxels are stored in, we can just walk each
+    // frame's voxel buffer one voxel at a time instead of calling GetVoxelState.
+    static TCToneMap toneMap;       // Only used by this thread, so the buffers are kept.
+    const byte      *pVoxel[3],
+                    *pState;
+    switch (frame->GetNumColors())
     {
         case 0:
+            pVoxel[0] = frame->GetData(0);
             // Now, we can render each voxel (with the proper state, "on" or "off").
-            for (byte x = 0; x < cubeSize[0]; x++)
+            for (byte x = 0; x < frameSize[0]; x++)
             {
-                for (byte y = 0; y < cubeSize[1]; y++)
+                for (byte y = 0; y < frameSize[1]; y++)
                 {
-                    for (byte z = 0; z < cubeSize[2]; z++)
+                    for (byte z = 0; z < frameSize[2]; z++)
                     {
                         // First, we copy and translate the current matrix.
                         glPushMatrix();
                         glTranslatef(ledCurrPos[1], ledCurrPos[2], ledCurrPos[0]);
                         // Next, we set the LED color to either colLedOn or colLedOff.
-                        if (currAnim->cubeState[0]->GetVoxelState(x, y, z) != 0x00)
+                        if (*pVoxel[0]++ != 0x00)
                         {
                             glColor4fv(colLedOn);
                         }
@@ -522,22 +540,28 @@ void DrawCube()
             break;
 
         case 1:
+            // The voxel colors are drawn the same way they are sent to a device (with the
+            // output gain and gamma), in the color of the on LEDs.
+            toneMap.Map(*frame, 3, 8, colLedOn);
+            pVoxel[0] = toneMap.GetOutput(0);
+            pVoxel[1] = toneMap.GetOutput(1);
+            pVoxel[2] = toneMap.GetOutput(2);
+            pState    = frame->GetData(0);
             // Now, we can render each voxel (with the proper greyscale color).
-            for (byte x = 0; x < cubeSize[0]; x++)
+            for (byte x = 0; x < frameSize[0]; x++)
             {
-                for (byte y = 0; y < cubeSize[1]; y++)
+                for (byte y = 0; y < frameSize[1]; y++)
                 {
-                    for (byte z = 0; z < cubeSize[2]; z++)
+                    for (byte z = 0; z < frameSize[2]; z++)
                     {
                         // First, we copy and translate the current matrix.
                         glPushMatrix();
                         glTranslatef(ledCurrPos[1], ledCurrPos[2], ledCurrPos[0]);
-                        // Next we set the LED color based on colLedOn and the voxel state.
-                        byte voxelState = currAnim->cubeState[0]->GetVoxelState(x, y, z);
-                        glColor4f(colLedOn[0] * voxelState / 255.0f,
-                                  colLedOn[1] * voxelState / 255.0f,
-                                  colLedOn[2] * voxelState / 255.0f,
-                                  voxelState == 0x00 ? colLedOff[3] : colLedOn[3]);
+                        // Next we set the LED color based on the mapped voxel color.
+                        glColor4f(*pVoxel[0]++ / 255.0f,
+                                  *pVoxel[1]++ / 255.0f,
+                                  *pVoxel[2]++ / 255.0f,
+                                  *pState++ == 0x00 ? colLedOff[3] : colLedOn[3]);
                         // Now, we can call the LED display list to draw the current LED.
                         glCallList(dlistLed);
                         // Finally, we pop the matrix, and increment the z-coordinate.
@@ -553,20 +577,26 @@ void DrawCube()
             break;
 
         case 3:
+            // The voxel colors are drawn the same way they are sent to a device (with the
+            // output gain and gamma).
+            toneMap.Map(*frame, 3, 8);
+            pVoxel[0] = toneMap.GetOutput(0);
+            pVoxel[1] = toneMap.GetOutput(1);
+            pVoxel[2] = toneMap.GetOutput(2);
             // Now, we can render each voxel (with the proper color).
-            for (byte x = 0; x < cubeSize[0]; x++)
+            for (byte x = 0; x < frameSize[0]; x++)
             {
-                for (byte y = 0; y < cubeSize[1]; y++)
+                for (byte y = 0; y < frameSize[1]; y++)
                 {
-                    for (byte z = 0; z < cubeSize[2]; z++)
+                    for (byte z = 0; z < frameSize[2]; z++)
                     {
                         // First, we copy and translate the current matrix.
                         glPushMatrix();
                         glTranslatef(ledCurrPos[1], ledCurrPos[2], ledCurrPos[0]);
-                        // Next we set the LED color based on the animation's cube states.
-                        glColor4f(currAnim->cubeState[0]->GetVoxelState(x, y, z) / 255.0f,
-                                  currAnim->cubeState[1]->GetVoxelState(x, y, z) / 255.0f,
-                                  currAnim->cubeState[2]->GetVoxelState(x, y, z) / 255.0f,
+                        // Next we set the LED color based on the mapped voxel color.
+                        glColor4f(*pVoxel[0]++ / 255.0f,
+                                  *pVoxel[1]++ / 255.0f,
+                                  *pVoxel[2]++ / 255.0f,
                                   1.0f);    // We leave the alpha channel full.
                         // Now, we can call the LED display list to draw the current LED.
                         glCallList(dlistLed);
@@ -585,8 +615,8 @@ void DrawCube()
         default:
             break;
     }
-    // Finally, we unlock the animation mutex.
-    UnlockAnimMutex();
+    // Finally, we release our reference to the frame.
+    frame->Release();
 }
 
 
@@ -880,3 +910,39 @@ size_t GetNumLines(size_t strLen, GLfloat xMin, GLfloat xMax)
     // Finally, we return the number (and correct it if there was any decimal rounding).
     return (strLen % charsPerLine == 0) ? (numLines) : (numLines + 1);
 }
+
+
+///
+/// \brief Set LED On Colour
+///
+/// Sets the colour of an LED that is on (colLedOn), which is also used by the drivers
+/// for animations without RGB colours.
+///
+/// \param rgb The red, green, and blue values (0-255) of the colour.
+///
+void SetLedOnColor(const Uint8 rgb[3])
+{
+    for (int i = 0; i < 3; i++)
+    {
+        colLedOn[i] = rgb[i] / 255.0f;
+    }
+    __atomic_store_n(&ledOnColor, ((Uint32)rgb[0] << 16) | ((Uint32)rgb[1] << 8) | rgb[2],
+                     __ATOMIC_RELAXED);
+}
+
+
+///
+/// \brief Get LED On Colour
+///
+/// Gets the colour of an LED that is on.  Unlike colLedOn itself, this can be called from
+/// any thread (e.g. by the driver of an animation slot).
+///
+/// \param rgb Array set to the red, green, and blue values (0.0 to 1.0) of the colour.
+///
+void GetLedOnColor(float rgb[3])
+{
+    Uint32 color = __atomic_load_n(&ledOnColor, __ATOMIC_RELAXED);
+    rgb[0] = ((color >> 16) & 0xFF) / 255.0f;
+    rgb[1] = ((color >>  8) & 0xFF) / 255.0f;
+    rgb[2] = ( color        & 0xFF) / 255.0f;
+}
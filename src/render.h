@@ -89,6 +89,8 @@ void   InitFont();
 void   Resize(int width, int height);
 void   RenderScene();
 void   SetFpsLimit(Uint16 maxFps);
+void   SetLedOnColor(const Uint8 rgb[3]);   // Sets colLedOn (see GetLedOnColor).
+void   GetLedOnColor(float rgb[3]);         // Gets colLedOn from any thread.
 
 void   PerspectiveModeBegin();
 void   PerspectiveModeEnd();